@@ -0,0 +1,171 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+volatile uint64_t benchmarkSink = 0;
+
+static std::vector<Benchmark> &Registry() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+void RegisterBenchmark(const std::string &name, BenchmarkSetup setup) {
+  Registry().push_back({name, std::move(setup)});
+}
+
+const std::vector<Benchmark> &RegisteredBenchmarks() {
+  return Registry();
+}
+
+static double TimeBatch(const BenchmarkBody &body, uint64_t batch) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < batch; i++) {
+    body();
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+BenchmarkResult RunBenchmark(const Benchmark &benchmark, const BenchmarkOptions &options) {
+  BenchmarkResult result;
+  result.name = benchmark.name;
+
+  BenchmarkBody body;
+  try {
+    body = benchmark.setup();
+  } catch (const std::exception &e) {
+    result.skipped    = true;
+    result.skipReason = e.what();
+    return result;
+  }
+
+  // Warm up while doubling the batch until one batch fills a sample
+  uint64_t batch = 1;
+  while (TimeBatch(body, batch) < options.sampleTargetMs && batch < (1ull << 30)) {
+    batch *= 2;
+  }
+
+  std::vector<double> samples;
+  samples.reserve(options.samples);
+  for (uint32_t i = 0; i < std::max(options.samples, 1u); i++) {
+    samples.push_back(TimeBatch(body, batch) * 1e6 / static_cast<double>(batch));
+  }
+  std::sort(samples.begin(), samples.end());
+
+  double sum = 0.0;
+  for (double sample : samples) { sum += sample; }
+  double mean     = sum / static_cast<double>(samples.size());
+  double variance = 0.0;
+  for (double sample : samples) { variance += (sample - mean) * (sample - mean); }
+
+  size_t middle     = samples.size() / 2;
+  result.iterations = batch * samples.size();
+  result.medianNs   = samples.size() % 2 ? samples[middle]
+                                         : (samples[middle - 1] + samples[middle]) * 0.5;
+  result.meanNs     = mean;
+  result.minNs      = samples.front();
+  result.stddevNs   = samples.size() > 1
+                        ? std::sqrt(variance / static_cast<double>(samples.size() - 1))
+                        : 0.0;
+  return result;
+}
+
+void WriteResultsJson(std::ostream &out, const std::vector<BenchmarkResult> &results) {
+  out << "{\n  \"results\": [\n";
+  bool first = true;
+  for (const auto &result : results) {
+    if (result.skipped) { continue; }
+    if (!first) { out << ",\n"; }
+    first = false;
+    out << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+        << std::fixed << std::setprecision(2) << ", \"medianNs\": " << result.medianNs
+        << ", \"meanNs\": " << result.meanNs << ", \"minNs\": " << result.minNs
+        << ", \"stddevNs\": " << result.stddevNs << "}" << std::defaultfloat;
+  }
+  out << "\n  ]\n}\n";
+}
+
+// Returns the value following "key": in text, starting at position
+static std::string FindJsonValue(const std::string &text, const std::string &key, size_t from,
+                                 size_t to) {
+  std::string quotedKey = "\"" + key + "\"";
+  size_t      position  = text.find(quotedKey, from);
+  if (position == std::string::npos || position >= to) { return ""; }
+  position = text.find(':', position + quotedKey.size());
+  if (position == std::string::npos) { return ""; }
+  position = text.find_first_not_of(" \t\r\n", position + 1);
+  if (position == std::string::npos) { return ""; }
+
+  if (text[position] == '"') {
+    size_t end = text.find('"', position + 1);
+    return text.substr(position + 1, end - position - 1);
+  }
+  size_t end = text.find_first_of(",}", position);
+  return text.substr(position, end - position);
+}
+
+std::vector<BenchmarkResult> ReadResultsJson(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) { throw std::runtime_error("Failed to open baseline: " + path); }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text = buffer.str();
+
+  // The format is the flat one written above: one object per result
+  std::vector<BenchmarkResult> results;
+  size_t                       position = text.find('[');
+  while (position != std::string::npos) {
+    size_t begin = text.find('{', position);
+    if (begin == std::string::npos) { break; }
+    size_t end = text.find('}', begin);
+    if (end == std::string::npos) { break; }
+
+    BenchmarkResult result;
+    result.name          = FindJsonValue(text, "name", begin, end);
+    std::string median   = FindJsonValue(text, "medianNs", begin, end);
+    if (!result.name.empty() && !median.empty()) {
+      result.medianNs = std::stod(median);
+      results.push_back(result);
+    }
+    position = end + 1;
+  }
+  return results;
+}
+
+size_t CompareResults(std::ostream &out, const std::vector<BenchmarkResult> &baseline,
+                      const std::vector<BenchmarkResult> &current, double thresholdPercent) {
+  size_t regressions = 0;
+  out << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14)
+      << "baseline ns" << std::setw(14) << "current ns" << std::setw(10) << "delta" << "\n";
+
+  for (const auto &result : current) {
+    if (result.skipped) { continue; }
+    auto match = std::find_if(baseline.begin(), baseline.end(),
+                              [&](const BenchmarkResult &b) { return b.name == result.name; });
+    out << std::left << std::setw(40) << result.name << std::right << std::fixed
+        << std::setprecision(1);
+    if (match == baseline.end() || match->medianNs <= 0.0) {
+      out << std::setw(14) << "-" << std::setw(14) << result.medianNs << std::setw(10) << "new"
+          << "\n";
+      continue;
+    }
+
+    double delta = (result.medianNs - match->medianNs) / match->medianNs * 100.0;
+    out << std::setw(14) << match->medianNs << std::setw(14) << result.medianNs
+        << std::setw(9) << std::showpos << delta << std::noshowpos << "%";
+    if (delta > thresholdPercent) {
+      out << "  REGRESSION";
+      regressions++;
+    }
+    out << "\n";
+  }
+  out << std::defaultfloat;
+  return regressions;
+}
@@ -0,0 +1,56 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A benchmark's setup runs once, untimed, and returns the body that is
+// timed. Setup may throw to skip the benchmark (e.g. a missing asset).
+using BenchmarkBody  = std::function<void()>;
+using BenchmarkSetup = std::function<BenchmarkBody()>;
+
+struct Benchmark {
+    std::string    name;
+    BenchmarkSetup setup;
+};
+
+struct BenchmarkOptions {
+    uint32_t    samples        = 15;
+    double      sampleTargetMs = 20.0; // Each sample runs a batch at least this long
+    std::string filter;                // Substring of the names to run
+};
+
+// Timings are per call of the body, in nanoseconds
+struct BenchmarkResult {
+    std::string name;
+    uint64_t    iterations = 0;
+    double      medianNs   = 0.0;
+    double      meanNs     = 0.0;
+    double      minNs      = 0.0;
+    double      stddevNs   = 0.0;
+    bool        skipped    = false;
+    std::string skipReason;
+};
+
+void RegisterBenchmark(const std::string &name, BenchmarkSetup setup);
+const std::vector<Benchmark> &RegisteredBenchmarks();
+
+BenchmarkResult RunBenchmark(const Benchmark &benchmark, const BenchmarkOptions &options);
+
+void WriteResultsJson(std::ostream &out, const std::vector<BenchmarkResult> &results);
+// Reads medians back from a file written by WriteResultsJson
+std::vector<BenchmarkResult> ReadResultsJson(const std::string &path);
+
+// Prints a comparison table and returns the number of benchmarks whose
+// median got slower than the baseline by more than thresholdPercent
+size_t CompareResults(std::ostream &out, const std::vector<BenchmarkResult> &baseline,
+                      const std::vector<BenchmarkResult> &current, double thresholdPercent);
+
+// Keeps the optimizer from discarding work whose result is otherwise unused
+extern volatile uint64_t benchmarkSink;
+inline void Consume(uint64_t value) { benchmarkSink = benchmarkSink + value; }
+
+#endif // BENCHMARK_H
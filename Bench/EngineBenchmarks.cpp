@@ -0,0 +1,809 @@
+#include "Benchmark.h"
+#include "EngineBenchmarks.h"
+
+#include "Engine/ECS/RenderExtraction.h"
+#include "Engine/ECS/World.h"
+#include "Engine/Scene/AabbTree.h"
+#include "Engine/Scene/TransformHierarchy.h"
+#include "Engine/Graphics/AssetLoader.h"
+#include "Engine/Graphics/Procedural.h"
+#include "Engine/Graphics/RenderQueue.h"
+#include "Engine/Graphics/TextureAtlas.h"
+#include "Engine/Graphics/Voxel/ChunkMeshScheduler.h"
+#include "Engine/Graphics/Voxel/GpuVoxelBatch.h"
+#include "Engine/Graphics/Voxel/VoxelChunk.h"
+#include "Engine/Graphics/Voxel/VoxelMesher.h"
+#include "Engine/Graphics/Voxel/VoxelTerrain.h"
+#include "Engine/Graphics/Drivers/Dummy/Dummy.h"
+#include "Engine/Graphics/Drivers/Threaded/ThreadedDriver.h"
+#include "Engine/Graphics/Drivers/Vulkan/Vulkan.h"
+#include "Engine/Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+// Objects scattered in a cube around the origin with a camera looking at
+// it from outside, so part of the scene falls outside the frustum.
+// Resources are created through the driver when one is given, otherwise
+// they are standalone objects for the queue-only benchmarks.
+struct BenchScene {
+    std::vector<std::shared_ptr<Mesh>>    meshes;
+    std::vector<std::shared_ptr<Texture>> textures;
+    std::vector<RenderObject>             objects;
+    std::vector<RenderPacket>             packets; // The same draws as objects
+    glm::mat4                             view;
+    glm::mat4                             projection;
+    glm::mat4                             viewProjection;
+
+    BenchScene(uint32_t objectCount, IGraphicsDriver *driver = nullptr) {
+      const uint32_t       resourceCount = 16;
+      std::vector<uint8_t> pixels(4 * 4 * 4, 255);
+      for (uint32_t i = 0; i < resourceCount; i++) {
+        auto [vertices, indices] = GenerateCubeMesh(0.5f + 0.1f * i);
+        meshes.push_back(driver ? driver->CreateMesh(std::move(vertices), std::move(indices),
+                                                     MESH_CREATE_RELEASE_CPU_DATA)
+                                : std::make_shared<Mesh>(std::move(vertices), std::move(indices)));
+        textures.push_back(driver ? driver->CreateTexture(4, 4, pixels.data())
+                                  : std::make_shared<Texture>());
+      }
+
+      // Fixed seed so every run builds the same scene
+      std::mt19937                          random(1234);
+      std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+      std::uniform_int_distribution<size_t> resource(0, resourceCount - 1);
+      objects.reserve(objectCount);
+      for (uint32_t i = 0; i < objectCount; i++) {
+        glm::mat4 model = glm::translate(
+          glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+        objects.emplace_back(meshes[resource(random)], textures[resource(random)], model);
+      }
+      packets.reserve(objectCount);
+      for (const auto &object : objects) {
+        packets.push_back(RenderPacket{object.mesh.get(), object.texture.get(), object.modelMatrix});
+      }
+
+      view = glm::lookAt(glm::vec3(0.0f, 0.0f, 60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+      projection     = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+      viewProjection = projection * view;
+    }
+};
+
+// Writes a grid OBJ whose vertices are shared by up to six triangles, so
+// loading it exercises the vertex dedup path
+static std::string WriteGridObj(uint32_t gridSize) {
+  std::string   path = (std::filesystem::temp_directory_path() / "darkest_bench_grid.obj").string();
+  std::ofstream file(path);
+  if (!file.is_open()) { throw std::runtime_error("Failed to write " + path); }
+
+  for (uint32_t y = 0; y <= gridSize; y++) {
+    for (uint32_t x = 0; x <= gridSize; x++) {
+      file << "v " << x << " 0 " << y << "\n";
+      file << "vt " << static_cast<float>(x) / gridSize << " " << static_cast<float>(y) / gridSize
+           << "\n";
+    }
+  }
+  for (uint32_t y = 0; y < gridSize; y++) {
+    for (uint32_t x = 0; x < gridSize; x++) {
+      // OBJ indices are 1-based
+      uint32_t a = y * (gridSize + 1) + x + 1;
+      uint32_t b = a + 1;
+      uint32_t c = a + gridSize + 1;
+      uint32_t d = c + 1;
+      file << "f " << a << "/" << a << " " << b << "/" << b << " " << d << "/" << d << "\n";
+      file << "f " << d << "/" << d << " " << c << "/" << c << " " << a << "/" << a << "\n";
+    }
+  }
+  return path;
+}
+
+// Clears, submits the whole scene and renders one frame
+static void SubmitFrame(IGraphicsDriver &driver, const BenchScene &scene) {
+  driver.ClearRenderQueue();
+  for (const auto &object : scene.objects) {
+    driver.SubmitRenderObject(object);
+  }
+  driver.RenderFrame();
+}
+
+static void SubmitFramePackets(IGraphicsDriver &driver, const BenchScene &scene) {
+  driver.ClearRenderQueue();
+  driver.SubmitRenderPackets(scene.packets.data(), scene.packets.size());
+  driver.RenderFrame();
+}
+
+void RegisterEngineBenchmarks(bool withOffscreen) {
+  RegisterBenchmark("obj_load_dedup/grid128", []() -> BenchmarkBody {
+    std::string path = WriteGridObj(128);
+    return [path]() {
+      std::vector<Vertex>   vertices;
+      std::vector<uint32_t> indices;
+      LoadObjGeometry(path, vertices, indices);
+      Consume(vertices.size());
+    };
+  });
+
+  RegisterBenchmark("procedural_cube_mesh", []() -> BenchmarkBody {
+    return []() {
+      auto [vertices, indices] = GenerateCubeMesh(0.5f);
+      Consume(vertices.size() + indices.size());
+    };
+  });
+
+  RegisterBenchmark("procedural_grass_texture/256", []() -> BenchmarkBody {
+    return []() { Consume(GenerateGrassTexture(256, 256).size()); };
+  });
+
+  RegisterBenchmark("texture_decode/texture.jpg", []() -> BenchmarkBody {
+    std::string path = "textures/texture.jpg";
+    if (!std::ifstream(path).good()) {
+      throw std::runtime_error(path + " not found, run from the build directory");
+    }
+    return [path]() { Consume(LoadImagePixels(path).pixels.size()); };
+  });
+
+  RegisterBenchmark("texture_atlas_pack/512", []() -> BenchmarkBody {
+    // Mixed 8..64 texel sprites, the case the atlas exists for
+    std::mt19937                       rng(7);
+    std::uniform_int_distribution<int> size(8, 64);
+    std::vector<std::pair<uint32_t, uint32_t>> sizes(512);
+    for (auto &[width, height] : sizes) {
+      width  = size(rng);
+      height = size(rng);
+    }
+    std::vector<uint8_t> pixels(64 * 64 * 4, 255);
+    return [sizes, pixels]() {
+      TextureAtlas atlas(1024, 2);
+      for (auto [width, height] : sizes) {
+        atlas.Add(width, height, pixels.data());
+      }
+      atlas.Pack();
+      Consume(atlas.PageCount());
+    };
+  });
+
+  for (uint32_t count : {1000u, 10000u, 100000u}) {
+    std::string suffix = "/" + std::to_string(count);
+
+    RegisterBenchmark("render_queue_submit_sort" + suffix, [count]() -> BenchmarkBody {
+      auto scene = std::make_shared<BenchScene>(count);
+      auto queue = std::make_shared<RenderQueue>();
+      return [scene, queue]() {
+        queue->Clear();
+        for (const auto &object : scene->objects) {
+          queue->Submit(object);
+        }
+        queue->Prepare(scene->viewProjection);
+        Consume(queue->Visible().size());
+      };
+    });
+
+    RegisterBenchmark("render_queue_submit_packets" + suffix, [count]() -> BenchmarkBody {
+      auto scene = std::make_shared<BenchScene>(count);
+      auto queue = std::make_shared<RenderQueue>();
+      return [scene, queue]() {
+        queue->Clear();
+        queue->Submit(scene->packets.data(), scene->packets.size());
+        queue->Prepare(scene->viewProjection);
+        Consume(queue->Visible().size());
+      };
+    });
+
+    RegisterBenchmark("frustum_cull" + suffix, [count]() -> BenchmarkBody {
+      auto scene = std::make_shared<BenchScene>(count);
+      return [scene]() {
+        FrustumPlanes planes  = ExtractFrustumPlanes(scene->viewProjection);
+        uint64_t      visible = 0;
+        for (const auto &object : scene->objects) {
+          visible += IsBoxInFrustum(planes, object.mesh->GetBoundsMin(),
+                                    object.mesh->GetBoundsMax(), object.modelMatrix);
+        }
+        Consume(visible);
+      };
+    });
+  }
+
+  // The scene's draws as entities: a linear update over one component pair,
+  // and extracting packets straight from the chunks
+  RegisterBenchmark("ecs_query_update/100000", []() -> BenchmarkBody {
+    auto scene = std::make_shared<BenchScene>(100000);
+    auto world = std::make_shared<World>();
+    for (const auto &packet : scene->packets) {
+      Entity entity = world->Create();
+      world->Add(entity, LocalToWorld{packet.modelMatrix});
+      world->Add(entity, RenderMesh{packet.mesh, packet.texture});
+    }
+    return [scene, world]() {
+      world->ForEachChunk<LocalToWorld, const RenderMesh>(
+        [](uint32_t count, const Entity *, LocalToWorld *transforms, const RenderMesh *) {
+          for (uint32_t i = 0; i < count; i++) {
+            transforms[i].matrix[3].y += 0.01f;
+          }
+        });
+    };
+  });
+
+  RegisterBenchmark("ecs_render_extract/100000", []() -> BenchmarkBody {
+    auto scene   = std::make_shared<BenchScene>(100000);
+    auto world   = std::make_shared<World>();
+    auto packets = std::make_shared<std::vector<RenderPacket>>();
+    for (const auto &packet : scene->packets) {
+      Entity entity = world->Create();
+      world->Add(entity, LocalToWorld{packet.modelMatrix});
+      world->Add(entity, RenderMesh{packet.mesh, packet.texture});
+    }
+    return [scene, world, packets]() {
+      ExtractRenderPackets(*world, *packets);
+      Consume(packets->size());
+    };
+  });
+
+  // The scene in an AABB tree: 10% of the objects moving each frame, a
+  // frustum query feeding packets straight to the null driver, and picking
+  // rays. Compare the frame with null_driver_frame_packets/100000.
+  struct SpatialScene {
+      BenchScene             scene;
+      AabbTree               tree;
+      std::vector<AabbProxy> proxies;
+      std::vector<glm::vec3> boundsMin, boundsMax;
+      std::vector<glm::vec3> velocities; // Per turn
+      uint32_t               frame = 0;
+
+      SpatialScene(IGraphicsDriver *driver = nullptr) : scene(100000, driver) {
+        // Steps longer than the tree's 0.1 margin, in a fixed direction per
+        // object
+        std::mt19937                          random(4321);
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        for (uint32_t i = 0; i < scene.packets.size(); i++) {
+          const RenderPacket &packet = scene.packets[i];
+          glm::vec3           worldMin, worldMax;
+          WorldBounds(packet.mesh->GetBoundsMin(), packet.mesh->GetBoundsMax(), packet.modelMatrix,
+                      worldMin, worldMax);
+          proxies.push_back(tree.Insert(worldMin, worldMax, i));
+          boundsMin.push_back(worldMin);
+          boundsMax.push_back(worldMax);
+          glm::vec3 heading(direction(random), direction(random), direction(random));
+          velocities.push_back(glm::normalize(heading + glm::vec3(1e-3f)) * 0.25f);
+        }
+      }
+
+      // A different 10% every frame. Objects drift through the scene and
+      // wrap around at its -50..50 edges, so leaves keep leaving their fat
+      // boxes (about every fifth turn with the tree's stretch along the
+      // motion, and on every wrap) and get reinserted.
+      void MoveTenPercent() {
+        for (uint32_t i = frame % 10; i < proxies.size(); i += 10) {
+          glm::vec3 step     = velocities[i];
+          glm::vec3 position = glm::vec3(scene.packets[i].modelMatrix[3]) + step;
+          for (int axis = 0; axis < 3; axis++) {
+            if (position[axis] > 50.0f) {
+              step[axis] -= 100.0f;
+            } else if (position[axis] < -50.0f) {
+              step[axis] += 100.0f;
+            }
+          }
+          boundsMin[i] = boundsMin[i] + step;
+          boundsMax[i] = boundsMax[i] + step;
+          scene.packets[i].modelMatrix[3] += glm::vec4(step, 0.0f);
+          // A wrap is a jump, not motion to stretch the fat box along
+          bool wrapped = step != velocities[i];
+          tree.Move(proxies[i], boundsMin[i], boundsMax[i], wrapped ? glm::vec3(0.0f) : step);
+        }
+        frame++;
+      }
+  };
+
+  RegisterBenchmark("aabb_tree_move/100000/moving10pct", []() -> BenchmarkBody {
+    auto spatial = std::make_shared<SpatialScene>();
+    return [spatial]() { spatial->MoveTenPercent(); };
+  });
+
+  RegisterBenchmark("aabb_tree_frustum_query/100000", []() -> BenchmarkBody {
+    auto spatial = std::make_shared<SpatialScene>();
+    auto visible = std::make_shared<std::vector<uint32_t>>();
+    return [spatial, visible]() {
+      visible->clear();
+      spatial->tree.QueryFrustum(ExtractFrustumPlanes(spatial->scene.viewProjection), *visible);
+      Consume(visible->size());
+    };
+  });
+
+  RegisterBenchmark("aabb_tree_raycast/100000/1000rays", []() -> BenchmarkBody {
+    auto spatial = std::make_shared<SpatialScene>();
+    return [spatial]() {
+      std::mt19937                          random(99);
+      std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+      uint64_t                              hits = 0;
+      for (uint32_t i = 0; i < 1000; i++) {
+        RayHit hit;
+        hits += spatial->tree.Raycast(glm::vec3(0.0f, 0.0f, 60.0f),
+                                      glm::vec3(direction(random), direction(random), -1.0f),
+                                      200.0f, hit);
+      }
+      Consume(hits);
+    };
+  });
+
+  RegisterBenchmark("aabb_tree_frame/100000/moving10pct", []() -> BenchmarkBody {
+    auto driver = std::make_shared<DummyDriver>();
+    driver->SetupOffscreen(256, 256);
+    auto spatial = std::make_shared<SpatialScene>(driver.get());
+    auto packets = std::make_shared<std::vector<RenderPacket>>();
+    driver->SetViewMatrix(spatial->scene.view);
+    driver->SetProjectionMatrix(spatial->scene.projection);
+    return [driver, spatial, packets]() {
+      spatial->MoveTenPercent();
+      packets->clear();
+      const BenchScene &scene = spatial->scene;
+      spatial->tree.QueryFrustum(ExtractFrustumPlanes(scene.viewProjection),
+                                 [&](uint32_t index) { packets->push_back(scene.packets[index]); });
+      driver->ClearRenderQueue();
+      driver->SubmitRenderPackets(packets->data(), packets->size());
+      driver->RenderFrame();
+    };
+  });
+
+  // 100k nodes in trees of ten. "static" updates with nothing moved,
+  // "moved1pct" rotates 1% of the nodes (and so their subtrees) and "all"
+  // rotates every root, with and without the AVX path
+  struct TransformCase {
+      std::string name;
+      uint32_t    movedPerFrame; // UINT32_MAX: every root
+      bool        simd;
+  };
+  for (const TransformCase &transformCase :
+       {TransformCase{"static", 0, true}, TransformCase{"moved1pct", 1000, true},
+        TransformCase{"all", UINT32_MAX, true}, TransformCase{"all/scalar", UINT32_MAX, false}}) {
+    RegisterBenchmark("transform_hierarchy_update/100000/" + transformCase.name,
+                      [transformCase]() -> BenchmarkBody {
+      auto transforms = std::make_shared<TransformHierarchy>(transformCase.simd);
+      auto nodes      = std::make_shared<std::vector<TransformHandle>>();
+      auto roots      = std::make_shared<std::vector<TransformHandle>>();
+      std::mt19937                          random(1234);
+      std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+      for (uint32_t i = 0; i < 100000; i++) {
+        // Every tenth node starts a tree, the others hang off one of the
+        // nodes created since
+        TransformHandle parent = i % 10 == 0 ? INVALID_TRANSFORM
+                                             : (*nodes)[nodes->size() - 1 - random() % (i % 10)];
+        TransformHandle node   = transforms->Create(parent);
+        transforms->SetPosition(node, glm::vec3(offset(random), offset(random), offset(random)));
+        nodes->push_back(node);
+        if (parent == INVALID_TRANSFORM) { roots->push_back(node); }
+      }
+      transforms->Update();
+
+      uint32_t moved = transformCase.movedPerFrame;
+      return [transforms, nodes, roots, moved, angle = 0.0f]() mutable {
+        angle += 0.01f;
+        glm::quat rotation(std::cos(angle), 0.0f, std::sin(angle), 0.0f);
+        if (moved == UINT32_MAX) {
+          for (TransformHandle root : *roots) {
+            transforms->SetRotation(root, rotation);
+          }
+        } else {
+          for (uint32_t i = 0; i < moved; i++) {
+            transforms->SetRotation((*nodes)[(i * 97) % nodes->size()], rotation);
+          }
+        }
+        transforms->Update();
+        Consume(transforms->Changed().size());
+      };
+    });
+  }
+
+  // Palette-packed voxel storage on a terrain chunk (4 types, 2-bit
+  // indices): point reads and writes over the whole chunk, and bulk
+  // decode and encode
+  RegisterBenchmark("voxel_chunk_get/32768", []() -> BenchmarkBody {
+    auto chunk = std::make_shared<VoxelChunk>();
+    GenerateVoxelTerrain(*chunk, 0, 0, 0);
+    return [chunk]() {
+      uint64_t solid = 0;
+      for (uint32_t z = 0; z < VoxelChunk::SIZE; z++) {
+        for (uint32_t y = 0; y < VoxelChunk::SIZE; y++) {
+          for (uint32_t x = 0; x < VoxelChunk::SIZE; x++) {
+            solid += chunk->Get(x, y, z) != VOXEL_AIR;
+          }
+        }
+      }
+      Consume(solid);
+    };
+  });
+
+  RegisterBenchmark("voxel_chunk_set/1000", []() -> BenchmarkBody {
+    auto chunk = std::make_shared<VoxelChunk>();
+    GenerateVoxelTerrain(*chunk, 0, 0, 0);
+    return [chunk, type = VOXEL_STONE]() mutable {
+      // Toggling between two types already in the palette
+      type = type == VOXEL_STONE ? VOXEL_DIRT : VOXEL_STONE;
+      for (uint32_t i = 0; i < 1000; i++) {
+        chunk->Set((i * 7) % VoxelChunk::SIZE, (i * 13) % VoxelChunk::SIZE, (i * 17) % VoxelChunk::SIZE, type);
+      }
+    };
+  });
+
+  RegisterBenchmark("voxel_chunk_bulk_read", []() -> BenchmarkBody {
+    auto chunk  = std::make_shared<VoxelChunk>();
+    auto voxels = std::make_shared<std::vector<VoxelType>>(VoxelChunk::VOLUME);
+    GenerateVoxelTerrain(*chunk, 0, 0, 0);
+    return [chunk, voxels]() {
+      chunk->Read(voxels->data());
+      Consume((*voxels)[VoxelChunk::VOLUME / 2]);
+    };
+  });
+
+  RegisterBenchmark("voxel_chunk_bulk_write", []() -> BenchmarkBody {
+    auto chunk  = std::make_shared<VoxelChunk>();
+    auto voxels = std::make_shared<std::vector<VoxelType>>(VoxelChunk::VOLUME);
+    GenerateVoxelTerrain(*chunk, 0, 0, 0);
+    chunk->Read(voxels->data());
+    return [chunk, voxels]() {
+      chunk->Write(voxels->data());
+      Consume(chunk->BitsPerIndex());
+    };
+  });
+
+  // Meshing a terrain chunk inside its 26 terrain neighbours, per chunk:
+  // the binary greedy mesher to quads and on to Vertex or packed VoxelVertex
+  // data, and the per-face reference. Setup checks both cover exactly the
+  // same faces, with and without ambient occlusion.
+  struct VoxelMeshScene {
+      std::vector<VoxelChunk> chunks;
+      VoxelNeighborhood       neighborhood;
+      BinaryGreedyMesher      mesher;
+      std::vector<VoxelQuad>  quads;
+
+      VoxelMeshScene() : chunks(27) {
+        for (int dz = -1; dz <= 1; dz++) {
+          for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+              VoxelChunk &chunk = chunks[VoxelNeighborhood::Slot(dx, dy, dz)];
+              GenerateVoxelTerrain(chunk, dx, dy, dz);
+              neighborhood.At(dx, dy, dz) = &chunk;
+            }
+          }
+        }
+
+        for (bool ambientOcclusion : {false, true}) {
+          std::vector<VoxelQuad> reference;
+          quads.clear();
+          mesher.Mesh(neighborhood, quads, ambientOcclusion);
+          MeshVoxelChunkNaive(neighborhood, reference, ambientOcclusion);
+          if (UnitFaces(quads) != UnitFaces(reference)) {
+            throw std::runtime_error("greedy mesh differs from the per-face reference");
+          }
+        }
+      }
+
+      // Every voxel face a set of quads covers, with its type and occlusion
+      static std::vector<uint64_t> UnitFaces(const std::vector<VoxelQuad> &quads) {
+        static const uint32_t planeAxes[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+        std::vector<uint64_t> faces;
+        for (const VoxelQuad &quad : quads) {
+          const uint32_t *axes = planeAxes[quad.face / 2];
+          for (uint32_t v = 0; v < quad.height; v++) {
+            for (uint32_t u = 0; u < quad.width; u++) {
+              uint32_t voxel[3] = {quad.x, quad.y, quad.z};
+              voxel[axes[0]] += u;
+              voxel[axes[1]] += v;
+              faces.push_back(uint64_t(quad.ao) << 40 |
+                              uint64_t(VoxelChunk::Index(voxel[0], voxel[1], voxel[2])) << 24 |
+                              uint64_t(quad.face) << 16 | quad.type);
+            }
+          }
+        }
+        std::sort(faces.begin(), faces.end());
+        return faces;
+      }
+  };
+
+  RegisterBenchmark("voxel_mesh_binary_greedy/32", []() -> BenchmarkBody {
+    auto scene = std::make_shared<VoxelMeshScene>();
+    return [scene]() {
+      scene->quads.clear();
+      scene->mesher.Mesh(scene->neighborhood, scene->quads);
+      Consume(scene->quads.size());
+    };
+  });
+
+  RegisterBenchmark("voxel_mesh_binary_greedy/32/vertices", []() -> BenchmarkBody {
+    auto scene    = std::make_shared<VoxelMeshScene>();
+    auto vertices = std::make_shared<std::vector<Vertex>>();
+    auto indices  = std::make_shared<std::vector<uint32_t>>();
+    return [scene, vertices, indices]() {
+      scene->quads.clear();
+      vertices->clear();
+      indices->clear();
+      scene->mesher.Mesh(scene->neighborhood, scene->quads);
+      for (const VoxelQuad &quad : scene->quads) {
+        AppendQuadVertices(quad, glm::vec3(0.0f), glm::vec3(1.0f), *vertices, *indices);
+      }
+      Consume(indices->size());
+    };
+  });
+
+  RegisterBenchmark("voxel_mesh_binary_greedy/32/packed", []() -> BenchmarkBody {
+    auto scene    = std::make_shared<VoxelMeshScene>();
+    auto vertices = std::make_shared<std::vector<VoxelVertex>>();
+    return [scene, vertices]() {
+      scene->quads.clear();
+      vertices->clear();
+      scene->mesher.Mesh(scene->neighborhood, scene->quads, true);
+      for (const VoxelQuad &quad : scene->quads) {
+        AppendQuadPackedVertices(quad, quad.type, *vertices);
+      }
+      Consume(vertices->size());
+    };
+  });
+
+  RegisterBenchmark("voxel_mesh_naive/32", []() -> BenchmarkBody {
+    auto scene = std::make_shared<VoxelMeshScene>();
+    return [scene]() {
+      scene->quads.clear();
+      MeshVoxelChunkNaive(scene->neighborhood, scene->quads);
+      Consume(scene->quads.size());
+    };
+  });
+
+  // Remeshing through ChunkMeshScheduler on the null driver, a frame loop
+  // until every mesh is uploaded: one voxel toggled at a chunk border (two
+  // chunks), and an 8x2x8 world of terrain chunks streamed in again. The
+  // null driver never runs GPU batches, so /gpu is the CPU side of them:
+  // snapshots, packing and submission.
+  struct RemeshScene {
+      DummyDriver        driver;
+      JobSystem          jobs;
+      VoxelWorld         world;
+      ChunkMeshScheduler scheduler;
+      glm::vec3          camera = glm::vec3(128.0f, 40.0f, 128.0f);
+      FrustumPlanes      frustum;
+
+      explicit RemeshScene(const ChunkMeshSchedulerOptions &options = ChunkMeshSchedulerOptions())
+          : scheduler(world, driver, jobs, options) {
+        driver.SetupOffscreen(256, 256);
+        glm::mat4 view       = glm::lookAt(camera, glm::vec3(0.0f, 24.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 500.0f);
+        frustum              = ExtractFrustumPlanes(projection * view);
+        Stream(0);
+      }
+
+      void Stream(uint32_t seed) {
+        for (int32_t z = 0; z < 8; z++) {
+          for (int32_t y = 0; y < 2; y++) {
+            for (int32_t x = 0; x < 8; x++) {
+              VoxelChunk chunk;
+              GenerateVoxelTerrain(chunk, x, y, z, seed);
+              world.SetChunk({x, y, z}, std::move(chunk));
+            }
+          }
+        }
+        UpdateUntilIdle();
+      }
+
+      void UpdateUntilIdle() {
+        do {
+          scheduler.Update(camera, frustum);
+        } while (!scheduler.IsIdle());
+      }
+  };
+
+  RegisterBenchmark("voxel_remesh/border_edit", []() -> BenchmarkBody {
+    auto scene = std::make_shared<RemeshScene>();
+    return [scene, solid = false]() mutable {
+      // x = 95 is the last column of chunk 2; y = 40 is above the terrain
+      solid = !solid;
+      scene->world.SetVoxel(95, 40, 100, solid ? VOXEL_STONE : VOXEL_AIR);
+      scene->UpdateUntilIdle();
+      Consume(scene->scheduler.Stats().uploaded);
+    };
+  });
+
+  RegisterBenchmark("voxel_remesh/stream/128chunks", []() -> BenchmarkBody {
+    auto scene = std::make_shared<RemeshScene>();
+    return [scene, seed = 0u]() mutable {
+      scene->Stream(++seed);
+      Consume(scene->scheduler.MeshCount());
+    };
+  });
+
+  RegisterBenchmark("voxel_remesh/stream/128chunks/gpu", []() -> BenchmarkBody {
+    ChunkMeshSchedulerOptions options;
+    options.gpuMeshing = true;
+    auto scene         = std::make_shared<RemeshScene>(options);
+    return [scene, seed = 0u]() mutable {
+      scene->Stream(++seed);
+      Consume(scene->scheduler.MeshCount());
+    };
+  });
+
+  // Scaling from one thread to every core: the same culling work split by
+  // ParallelFor, and the per-job cost of Run/Wait
+  uint32_t              cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threads = 1; threads < cores; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(cores);
+  for (uint32_t threads : threadCounts) {
+    std::string suffix = "/threads" + std::to_string(threads);
+
+    RegisterBenchmark("parallel_frustum_cull/100000" + suffix, [threads]() -> BenchmarkBody {
+      auto scene = std::make_shared<BenchScene>(100000);
+      auto jobs  = std::make_shared<JobSystem>(JobSystemOptions{threads});
+      return [scene, jobs]() {
+        FrustumPlanes         planes = ExtractFrustumPlanes(scene->viewProjection);
+        std::atomic<uint64_t> visible{0};
+        jobs->ParallelFor(static_cast<uint32_t>(scene->objects.size()), 256,
+                          [&](uint32_t begin, uint32_t end) {
+                            uint64_t chunkVisible = 0;
+                            for (uint32_t i = begin; i < end; i++) {
+                              const RenderObject &object = scene->objects[i];
+                              chunkVisible += IsBoxInFrustum(planes, object.mesh->GetBoundsMin(),
+                                                             object.mesh->GetBoundsMax(),
+                                                             object.modelMatrix);
+                            }
+                            visible += chunkVisible;
+                          });
+        Consume(visible.load());
+      };
+    });
+
+    RegisterBenchmark("job_system_run_wait/10000" + suffix, [threads]() -> BenchmarkBody {
+      auto jobs = std::make_shared<JobSystem>(JobSystemOptions{threads});
+      return [jobs]() {
+        JobCounter            counter;
+        std::atomic<uint64_t> sum{0};
+        for (uint32_t i = 0; i < 10000; i++) {
+          jobs->Run([&sum, i]() { sum += i; }, counter);
+        }
+        jobs->Wait(counter);
+        Consume(sum.load());
+      };
+    });
+  }
+
+  for (uint32_t count : {1000u, 10000u, 100000u}) {
+    RegisterBenchmark("null_driver_frame/" + std::to_string(count), [count]() -> BenchmarkBody {
+      auto driver = std::make_shared<DummyDriver>();
+      driver->SetupOffscreen(256, 256);
+      auto scene = std::make_shared<BenchScene>(count, driver.get());
+      driver->SetViewMatrix(scene->view);
+      driver->SetProjectionMatrix(scene->projection);
+      return [driver, scene]() { SubmitFrame(*driver, *scene); };
+    });
+
+    RegisterBenchmark("null_driver_frame_packets/" + std::to_string(count), [count]() -> BenchmarkBody {
+      auto driver = std::make_shared<DummyDriver>();
+      driver->SetupOffscreen(256, 256);
+      auto scene = std::make_shared<BenchScene>(count, driver.get());
+      driver->SetViewMatrix(scene->view);
+      driver->SetProjectionMatrix(scene->projection);
+      return [driver, scene]() { SubmitFramePackets(*driver, *scene); };
+    });
+
+    // Game thread cost per frame once recording overlaps with the render
+    // thread's work
+    RegisterBenchmark("threaded_null_driver_frame_packets/" + std::to_string(count), [count]() -> BenchmarkBody {
+      // The deleter keeps the null driver alive until the render thread stopped
+      auto nullDriver = std::make_shared<DummyDriver>();
+      std::shared_ptr<ThreadedDriver> driver(new ThreadedDriver(nullDriver.get()),
+                                             [nullDriver](ThreadedDriver *threadedDriver) {
+                                               delete threadedDriver;
+                                             });
+      driver->SetupOffscreen(256, 256);
+      auto scene = std::make_shared<BenchScene>(count, driver.get());
+      driver->SetViewMatrix(scene->view);
+      driver->SetProjectionMatrix(scene->projection);
+      return [driver, scene]() { SubmitFramePackets(*driver, *scene); };
+    });
+  }
+
+  if (!withOffscreen) { return; }
+
+  // Needs a Vulkan device and the compiled shaders in the working directory
+  RegisterBenchmark("vulkan_offscreen_frame/1000", []() -> BenchmarkBody {
+    std::shared_ptr<VulkanDriver> driver(new VulkanDriver(), [](VulkanDriver *vulkanDriver) {
+      vulkanDriver->Destruct();
+      delete vulkanDriver;
+    });
+    driver->SetupOffscreen(256, 256);
+    auto scene = std::make_shared<BenchScene>(1000, driver.get());
+    driver->SetViewMatrix(scene->view);
+    driver->SetProjectionMatrix(scene->projection);
+    return [driver, scene]() { SubmitFrame(*driver, *scene); };
+  });
+
+  // A 3x3x3 block of terrain chunks meshed by the compute shader, released
+  // again each time. Setup reads one batch back and checks it against the
+  // CPU's per-face mesh, vertex for vertex.
+  RegisterBenchmark("vulkan_voxel_mesh_gpu/27chunks", []() -> BenchmarkBody {
+    std::shared_ptr<VulkanDriver> driver(new VulkanDriver(), [](VulkanDriver *vulkanDriver) {
+      vulkanDriver->Destruct();
+      delete vulkanDriver;
+    });
+    driver->SetupOffscreen(256, 256);
+    if (!driver->SupportsGpuVoxelMeshing()) {
+      throw std::runtime_error("the device can't run compute work on its graphics queue");
+    }
+
+    struct GpuMeshScene {
+        VoxelWorld                 world;
+        std::vector<VoxelSnapshot> snapshots;
+        GpuVoxelBatch              batch;
+    };
+    auto scene = std::make_shared<GpuMeshScene>();
+    for (int32_t z = 0; z < 3; z++) {
+      for (int32_t y = 0; y < 3; y++) {
+        for (int32_t x = 0; x < 3; x++) {
+          VoxelChunk chunk;
+          GenerateVoxelTerrain(chunk, x, y, z);
+          scene->world.SetChunk({x, y, z}, std::move(chunk));
+        }
+      }
+    }
+    for (int32_t z = 0; z < 3; z++) {
+      for (int32_t y = 0; y < 3; y++) {
+        for (int32_t x = 0; x < 3; x++) {
+          scene->snapshots.emplace_back();
+          scene->world.Snapshot({x, y, z}, scene->snapshots.back());
+          scene->batch.Add(scene->snapshots.back().Neighborhood());
+        }
+      }
+    }
+    // The naive mesh's worst case, so nothing overflows
+    GpuVoxelMeshInput input = scene->batch.Input(true, 27 * 32 * 32 * 32 * 3);
+
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    driver->MeshVoxelChunksOnGpu(input, meshes);
+    std::vector<VoxelQuad>   quads;
+    std::vector<VoxelVertex> expected;
+    std::vector<VoxelVertex> actual;
+    for (size_t chunk = 0; chunk < meshes.size(); chunk++) {
+      quads.clear();
+      expected.clear();
+      MeshVoxelChunkNaive(scene->snapshots[chunk].Neighborhood(), quads, true);
+      for (const VoxelQuad &quad : quads) {
+        AppendQuadPackedVertices(quad, quad.type, expected);
+      }
+      driver->ReadGpuVoxelMesh(meshes[chunk], actual);
+      if (actual.size() != expected.size() ||
+          !std::equal(actual.begin(), actual.end(), expected.begin(),
+                      [](const VoxelVertex &a, const VoxelVertex &b) { return a.data == b.data; })) {
+        throw std::runtime_error("GPU voxel mesh differs from the CPU one");
+      }
+      driver->ReleaseMesh(meshes[chunk]);
+    }
+
+    return [driver, scene, input, meshes]() mutable {
+      meshes.clear();
+      driver->MeshVoxelChunksOnGpu(input, meshes);
+      for (const std::shared_ptr<Mesh> &mesh : meshes) {
+        driver->ReleaseMesh(mesh);
+      }
+      driver->RenderFrame();
+    };
+  });
+
+  // Generated straight into staging memory, released again so the ring
+  // and the deferred destruction queue stay in steady state
+  RegisterBenchmark("vulkan_texture_upload/256", []() -> BenchmarkBody {
+    std::shared_ptr<VulkanDriver> driver(new VulkanDriver(), [](VulkanDriver *vulkanDriver) {
+      vulkanDriver->Destruct();
+      delete vulkanDriver;
+    });
+    driver->SetupOffscreen(256, 256);
+    return [driver]() {
+      TextureUpload upload = driver->BeginTextureUpload(256, 256);
+      GenerateGrassTexture(256, 256, upload.pixels);
+      driver->ReleaseTexture(driver->CommitTextureUpload(upload));
+      driver->RenderFrame();
+    };
+  });
+}
@@ -0,0 +1,9 @@
+#ifndef ENGINEBENCHMARKS_H
+#define ENGINEBENCHMARKS_H
+
+// Asset loading, procedural generation, render queue, culling and frame
+// submission benchmarks. The Vulkan offscreen benchmark needs a GPU and is
+// only registered on request.
+void RegisterEngineBenchmarks(bool withOffscreen);
+
+#endif // ENGINEBENCHMARKS_H
@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+#include "EngineBenchmarks.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+static void PrintUsage() {
+  std::cout << "Usage: DarkestPlanetBench [options]\n"
+               "  --filter <text>       Only run benchmarks whose name contains text\n"
+               "  --samples <n>         Timed samples per benchmark (default 15)\n"
+               "  --sample-ms <ms>      Minimum duration of one sample (default 20)\n"
+               "  --out <file.json>     Where to write results (default bench_results.json)\n"
+               "  --compare <file.json> Compare medians against a stored baseline\n"
+               "  --threshold <pct>     Slowdown that counts as a regression (default 10)\n"
+               "  --offscreen           Also run the GPU offscreen frame benchmark\n";
+}
+
+int main(int argc, char **argv) {
+  BenchmarkOptions options;
+  std::string      outPath = "bench_results.json";
+  std::string      baselinePath;
+  double           thresholdPercent = 10.0;
+  bool             withOffscreen    = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg     = argv[i];
+    bool        hasNext = i + 1 < argc;
+    if (arg == "--filter" && hasNext) {
+      options.filter = argv[++i];
+    } else if (arg == "--samples" && hasNext) {
+      options.samples = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--sample-ms" && hasNext) {
+      options.sampleTargetMs = std::stod(argv[++i]);
+    } else if (arg == "--out" && hasNext) {
+      outPath = argv[++i];
+    } else if (arg == "--compare" && hasNext) {
+      baselinePath = argv[++i];
+    } else if (arg == "--threshold" && hasNext) {
+      thresholdPercent = std::stod(argv[++i]);
+    } else if (arg == "--offscreen") {
+      withOffscreen = true;
+    } else {
+      PrintUsage();
+      return arg == "--help" ? 0 : 2;
+    }
+  }
+
+  RegisterEngineBenchmarks(withOffscreen);
+
+  std::vector<BenchmarkResult> results;
+  std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14)
+            << "median ns" << std::setw(14) << "mean ns" << std::setw(12) << "stddev" << "\n";
+  for (const auto &benchmark : RegisteredBenchmarks()) {
+    if (benchmark.name.find(options.filter) == std::string::npos) { continue; }
+
+    BenchmarkResult result = RunBenchmark(benchmark, options);
+    std::cout << std::left << std::setw(40) << result.name << std::right;
+    if (result.skipped) {
+      std::cout << "  skipped: " << result.skipReason << "\n";
+    } else {
+      std::cout << std::fixed << std::setprecision(1) << std::setw(14) << result.medianNs
+                << std::setw(14) << result.meanNs << std::setw(12) << result.stddevNs
+                << std::defaultfloat << "\n";
+    }
+    results.push_back(result);
+  }
+
+  std::ofstream out(outPath);
+  if (!out.is_open()) {
+    std::cerr << "Failed to write results to " << outPath << std::endl;
+    return 1;
+  }
+  WriteResultsJson(out, results);
+  std::cout << "\nResults written to " << outPath << std::endl;
+
+  if (baselinePath.empty()) { return 0; }
+
+  std::vector<BenchmarkResult> baseline;
+  try {
+    baseline = ReadResultsJson(baselinePath);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "\nComparing against " << baselinePath << " (threshold " << thresholdPercent
+            << "%)\n";
+  size_t regressions = CompareResults(std::cout, baseline, results, thresholdPercent);
+  if (regressions > 0) {
+    std::cout << regressions << " benchmark(s) regressed" << std::endl;
+    return 1;
+  }
+  std::cout << "No regressions" << std::endl;
+  return 0;
+}
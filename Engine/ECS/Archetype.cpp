@@ -0,0 +1,90 @@
+#include "Archetype.h"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::mutex                 componentRegistryMutex;
+static std::vector<ComponentInfo> componentRegistry;
+
+ComponentId RegisterComponent(size_t size, size_t alignment, const char *name) {
+  std::lock_guard<std::mutex> lock(componentRegistryMutex);
+  if (componentRegistry.size() >= MAX_COMPONENT_TYPES) {
+    throw std::runtime_error("Too many component types!");
+  }
+  if (alignment > alignof(std::max_align_t)) {
+    throw std::runtime_error(std::string("Component alignment not supported: ") + name);
+  }
+  // Reserved up front so references handed out stay valid
+  componentRegistry.reserve(MAX_COMPONENT_TYPES);
+  componentRegistry.push_back(ComponentInfo{size, alignment, name});
+  return static_cast<ComponentId>(componentRegistry.size() - 1);
+}
+
+const ComponentInfo &GetComponentInfo(ComponentId id) {
+  return componentRegistry[id];
+}
+
+static size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+Archetype::Archetype(ComponentMask mask) : mask(mask) {
+  size_t rowSize = sizeof(Entity);
+  for (ComponentId id = 0; id < MAX_COMPONENT_TYPES; id++) {
+    if (Has(id)) {
+      components.push_back(id);
+      rowSize += GetComponentInfo(id).size;
+    }
+  }
+
+  // Leave room for the padding between columns, then lay them out
+  capacity = static_cast<uint32_t>(
+    (CHUNK_SIZE - components.size() * alignof(std::max_align_t)) / rowSize);
+  if (capacity == 0) {
+    throw std::runtime_error("Components too large for a chunk!");
+  }
+  size_t offset = sizeof(Entity) * capacity;
+  for (ComponentId id : components) {
+    const ComponentInfo &info = GetComponentInfo(id);
+    offset                    = AlignUp(offset, info.alignment);
+    columnOffsets[id]         = offset;
+    offset += info.size * capacity;
+  }
+}
+
+size_t Archetype::EntityCount() const {
+  if (chunks.empty()) { return 0; }
+  return (chunks.size() - 1) * capacity + chunks.back().count;
+}
+
+uint32_t Archetype::Allocate(Entity entity, uint32_t &chunk) {
+  if (chunks.empty() || chunks.back().count == capacity) {
+    // operator new[] is aligned for any fundamental type
+    chunks.push_back(Chunk{std::unique_ptr<uint8_t[]>(new uint8_t[CHUNK_SIZE]), 0});
+  }
+  chunk                = static_cast<uint32_t>(chunks.size() - 1);
+  uint32_t row         = chunks.back().count++;
+  Entities(chunk)[row] = entity;
+  return row;
+}
+
+Entity Archetype::Remove(uint32_t chunk, uint32_t row) {
+  uint32_t lastChunk = static_cast<uint32_t>(chunks.size() - 1);
+  uint32_t lastRow   = chunks[lastChunk].count - 1;
+
+  Entity moved;
+  if (chunk != lastChunk || row != lastRow) {
+    moved                = Entities(lastChunk)[lastRow];
+    Entities(chunk)[row] = moved;
+    for (ComponentId id : components) {
+      std::memcpy(Component(chunk, row, id), Component(lastChunk, lastRow, id),
+                  GetComponentInfo(id).size);
+    }
+  }
+
+  if (--chunks[lastChunk].count == 0) { chunks.pop_back(); }
+  return moved;
+}
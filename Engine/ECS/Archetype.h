@@ -0,0 +1,61 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include "Entity.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Fixed-size block holding up to the archetype's capacity entities, one
+// contiguous array per component (SoA) after the entity array
+struct Chunk {
+    std::unique_ptr<uint8_t[]> data;
+    uint32_t                   count = 0;
+};
+
+// Storage for every entity with exactly one set of components. Chunks are
+// kept packed: all of them are full except the last, so iterating a chunk
+// touches count consecutive elements of each column.
+class Archetype {
+  public:
+    static const size_t CHUNK_SIZE = 16 * 1024;
+
+    explicit Archetype(ComponentMask mask);
+
+    ComponentMask                   Mask() const { return mask; }
+    const std::vector<ComponentId> &Components() const { return components; }
+    uint32_t                        Capacity() const { return capacity; }
+    size_t                          ChunkCount() const { return chunks.size(); }
+    uint32_t                        ChunkEntityCount(size_t chunk) const { return chunks[chunk].count; }
+    size_t                          EntityCount() const;
+
+    bool Has(ComponentId id) const { return (mask >> id) & 1; }
+
+    Entity *Entities(size_t chunk) const {
+      return reinterpret_cast<Entity *>(chunks[chunk].data.get());
+    }
+    // Start of the component's array in the chunk, nullptr if the
+    // archetype doesn't have it
+    void *Column(size_t chunk, ComponentId id) const {
+      if (!Has(id)) { return nullptr; }
+      return chunks[chunk].data.get() + columnOffsets[id];
+    }
+    void *Component(size_t chunk, uint32_t row, ComponentId id) const {
+      return static_cast<uint8_t *>(Column(chunk, id)) + row * GetComponentInfo(id).size;
+    }
+
+    // Appends an entity with uninitialized components, returns its row
+    uint32_t Allocate(Entity entity, uint32_t &chunk);
+    // Fills the hole with the archetype's last entity and returns the
+    // entity that moved there (invalid if the removed one was last)
+    Entity Remove(uint32_t chunk, uint32_t row);
+
+  private:
+    ComponentMask            mask;
+    std::vector<ComponentId> components;
+    size_t                   columnOffsets[MAX_COMPONENT_TYPES] = {};
+    uint32_t                 capacity                           = 0;
+    std::vector<Chunk>       chunks;
+};
+
+#endif // ARCHETYPE_H
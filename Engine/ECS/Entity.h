@@ -0,0 +1,52 @@
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+
+// Index into the world's entity table plus the generation it was created
+// with, so handles to destroyed entities can be told apart from the
+// entities that reuse their slot
+struct Entity {
+    uint32_t index      = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity &other) const {
+      return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const Entity &other) const { return !(*this == other); }
+    bool IsValid() const { return index != UINT32_MAX; }
+};
+
+using ComponentId = uint32_t;
+// One bit per component type, an archetype is identified by its mask
+using ComponentMask = uint64_t;
+
+const uint32_t MAX_COMPONENT_TYPES = 64;
+
+struct ComponentInfo {
+    size_t      size;
+    size_t      alignment;
+    const char *name;
+};
+
+// Assigns ids in registration order, throws past MAX_COMPONENT_TYPES
+ComponentId          RegisterComponent(size_t size, size_t alignment, const char *name);
+const ComponentInfo &GetComponentInfo(ComponentId id);
+
+// Components are plain data: chunks move them around with memcpy and
+// never run constructors or destructors
+template <typename T> ComponentId RegisteredComponentType() {
+  static_assert(std::is_trivially_copyable<T>::value, "Components must be trivially copyable");
+  static const ComponentId id = RegisterComponent(sizeof(T), alignof(T), typeid(T).name());
+  return id;
+}
+
+// Queries name read-only components as const, they share the id
+template <typename T> ComponentId ComponentType() {
+  return RegisteredComponentType<std::remove_const_t<T>>();
+}
+
+#endif // ENTITY_H
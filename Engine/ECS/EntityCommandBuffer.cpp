@@ -0,0 +1,79 @@
+#include "EntityCommandBuffer.h"
+
+// Stream layout: command, entity, component count, then per component its
+// id followed by its bytes (Remove carries just the id)
+void EntityCommandBuffer::BeginCommand(Command command, Entity entity, uint32_t componentCount) {
+  Write(command);
+  Write(entity);
+  Write(componentCount);
+}
+
+void EntityCommandBuffer::WriteComponent(ComponentId id, const void *data, size_t size) {
+  Write(id);
+  Write(data, size);
+}
+
+void EntityCommandBuffer::Write(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  stream.insert(stream.end(), bytes, bytes + size);
+}
+
+void EntityCommandBuffer::Playback(World &world) {
+  size_t offset = 0;
+  auto   read   = [this, &offset](void *data, size_t size) {
+    std::memcpy(data, stream.data() + offset, size);
+    offset += size;
+  };
+
+  while (offset < stream.size()) {
+    Command  command;
+    Entity   entity;
+    uint32_t componentCount;
+    read(&command, sizeof(command));
+    read(&entity, sizeof(entity));
+    read(&componentCount, sizeof(componentCount));
+
+    switch (command) {
+      case Command::Create: {
+        // Find the final archetype first, then fill in the components
+        ComponentMask mask  = 0;
+        size_t        start = offset;
+        for (uint32_t i = 0; i < componentCount; i++) {
+          ComponentId id;
+          read(&id, sizeof(id));
+          mask |= ComponentMask(1) << id;
+          offset += GetComponentInfo(id).size;
+        }
+        Entity created = world.CreateWithComponents(mask);
+        offset         = start;
+        for (uint32_t i = 0; i < componentCount; i++) {
+          ComponentId id;
+          read(&id, sizeof(id));
+          read(world.GetRaw(created, id), GetComponentInfo(id).size);
+        }
+        break;
+      }
+      case Command::Destroy:
+        if (world.IsAlive(entity)) { world.Destroy(entity); }
+        break;
+      case Command::Add: {
+        ComponentId id;
+        read(&id, sizeof(id));
+        size_t size = GetComponentInfo(id).size;
+        if (world.IsAlive(entity)) {
+          read(world.AddRaw(entity, id), size);
+        } else {
+          offset += size;
+        }
+        break;
+      }
+      case Command::Remove: {
+        ComponentId id;
+        read(&id, sizeof(id));
+        if (world.IsAlive(entity)) { world.RemoveRaw(entity, id); }
+        break;
+      }
+    }
+  }
+  stream.clear();
+}
@@ -0,0 +1,46 @@
+#ifndef ENTITYCOMMANDBUFFER_H
+#define ENTITYCOMMANDBUFFER_H
+
+#include "World.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Records structural changes while queries run and applies them in one go
+// with Playback. Entities created through the buffer are created with all
+// their components at once, so they land in their final archetype
+// without intermediate moves.
+class EntityCommandBuffer {
+  public:
+    template <typename... Ts> void Create(const Ts &...components) {
+      BeginCommand(Command::Create, Entity(), static_cast<uint32_t>(sizeof...(Ts)));
+      (WriteComponent(ComponentType<Ts>(), &components, sizeof(Ts)), ...);
+    }
+    void Destroy(Entity entity) { BeginCommand(Command::Destroy, entity, 0); }
+    template <typename T> void Add(Entity entity, const T &component) {
+      BeginCommand(Command::Add, entity, 1);
+      WriteComponent(ComponentType<T>(), &component, sizeof(T));
+    }
+    template <typename T> void Remove(Entity entity) {
+      BeginCommand(Command::Remove, entity, 0);
+      Write(ComponentType<T>());
+    }
+
+    bool Empty() const { return stream.empty(); }
+
+    // Applies the commands in recording order and clears the buffer.
+    // Commands on entities that died in the meantime are dropped.
+    void Playback(World &world);
+
+  private:
+    enum class Command : uint32_t { Create, Destroy, Add, Remove };
+
+    std::vector<uint8_t> stream;
+
+    void BeginCommand(Command command, Entity entity, uint32_t componentCount);
+    void WriteComponent(ComponentId id, const void *data, size_t size);
+    void Write(const void *data, size_t size);
+    template <typename T> void Write(const T &value) { Write(&value, sizeof(T)); }
+};
+
+#endif // ENTITYCOMMANDBUFFER_H
@@ -0,0 +1,16 @@
+#include "RenderExtraction.h"
+
+void ExtractRenderPackets(World &world, std::vector<RenderPacket> &packets) {
+  packets.clear();
+  world.ForEachChunk<const LocalToWorld, const RenderMesh>(
+    [&packets](uint32_t count, const Entity *, const LocalToWorld *transforms,
+               const RenderMesh *meshes) {
+      for (uint32_t i = 0; i < count; i++) {
+        if (!meshes[i].mesh) { continue; }
+        RenderPacket packet{meshes[i].mesh, meshes[i].texture, transforms[i].matrix};
+        packet.sortKey          = meshes[i].sortKey;
+        packet.pipelineFeatures = meshes[i].pipelineFeatures;
+        packets.push_back(packet);
+      }
+    });
+}
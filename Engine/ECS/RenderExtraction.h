@@ -0,0 +1,27 @@
+#ifndef RENDEREXTRACTION_H
+#define RENDEREXTRACTION_H
+
+#include "World.h"
+#include "../Graphics/Drivers/Vulkan/RenderObject.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// World-space transform used for rendering
+struct LocalToWorld {
+    glm::mat4 matrix = glm::mat4(1.0f);
+};
+
+// What to draw an entity with. The handles follow RenderPacket's rules:
+// raw pointers to resources created by the driver the packets go to.
+struct RenderMesh {
+    const Mesh      *mesh             = nullptr;
+    const Texture   *texture          = nullptr;
+    PipelineFeatures pipelineFeatures = 0;
+    uint64_t         sortKey          = 0;
+};
+
+// Render extraction system: one RenderPacket per entity with LocalToWorld
+// and RenderMesh, appended chunk by chunk, ready for SubmitRenderPackets
+void ExtractRenderPackets(World &world, std::vector<RenderPacket> &packets);
+
+#endif // RENDEREXTRACTION_H
@@ -0,0 +1,36 @@
+#ifndef SYSTEMACCESS_H
+#define SYSTEMACCESS_H
+
+#include "Entity.h"
+#include <type_traits>
+
+// Components a system reads and writes
+struct SystemAccess {
+    ComponentMask reads  = 0;
+    ComponentMask writes = 0;
+
+    bool ConflictsWith(const SystemAccess &other) const {
+      return (writes & (other.reads | other.writes)) != 0 ||
+             (other.writes & (reads | writes)) != 0;
+    }
+    // Whether other only touches what this access declares
+    bool Covers(const SystemAccess &other) const {
+      return (other.writes & ~writes) == 0 && (other.reads & ~(reads | writes)) == 0;
+    }
+};
+
+// Access of a query's parameter pack: const components are read, the
+// rest are written
+template <typename... Ts> SystemAccess AccessOf() {
+  SystemAccess access;
+  (((std::is_const<Ts>::value ? access.reads : access.writes) |=
+    ComponentMask(1) << ComponentType<Ts>()),
+   ...);
+  return access;
+}
+
+// Set by SystemScheduler while a system runs on this thread; debug builds
+// check every query against it
+extern thread_local const SystemAccess *runningSystemAccess;
+
+#endif // SYSTEMACCESS_H
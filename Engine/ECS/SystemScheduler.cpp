@@ -0,0 +1,66 @@
+#include "SystemScheduler.h"
+
+#include <algorithm>
+
+void SystemScheduler::Add(const std::string &name, const SystemAccess &access,
+                          SystemFunction function) {
+  size_t stage = 0;
+  for (const auto &system : systems) {
+    if (system.access.ConflictsWith(access)) {
+      stage = std::max(stage, system.stage + 1);
+    }
+  }
+  if (stage == stages.size()) { stages.emplace_back(); }
+  stages[stage].push_back(systems.size());
+
+  systems.push_back(System{name, access, std::move(function),
+                           std::make_unique<EntityCommandBuffer>(), stage});
+}
+
+// A system waiting on jobs can run another system's job on its thread,
+// so the previous access is restored rather than cleared
+static void RunSystem(const SystemAccess &access, const SystemFunction &function,
+                      World &world, EntityCommandBuffer &commands) {
+  const SystemAccess *previous = runningSystemAccess;
+  runningSystemAccess          = &access;
+  try {
+    function(world, commands);
+  } catch (...) {
+    runningSystemAccess = previous;
+    throw;
+  }
+  runningSystemAccess = previous;
+}
+
+void SystemScheduler::Run(World &world, JobSystem *jobs) {
+  for (const auto &stage : stages) {
+    if (!jobs || stage.size() == 1) {
+      for (size_t index : stage) {
+        System &system = systems[index];
+        RunSystem(system.access, system.function, world, *system.commands);
+      }
+      continue;
+    }
+
+    JobCounter counter;
+    for (size_t index : stage) {
+      System &system = systems[index];
+      jobs->Run([&world, &system]() {
+        RunSystem(system.access, system.function, world, *system.commands);
+      }, counter);
+    }
+    jobs->Wait(counter);
+  }
+
+  for (auto &system : systems) {
+    system.commands->Playback(world);
+  }
+}
+
+std::vector<std::string> SystemScheduler::StageSystems(size_t stage) const {
+  std::vector<std::string> names;
+  for (size_t index : stages[stage]) {
+    names.push_back(systems[index].name);
+  }
+  return names;
+}
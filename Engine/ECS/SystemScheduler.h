@@ -0,0 +1,47 @@
+#ifndef SYSTEMSCHEDULER_H
+#define SYSTEMSCHEDULER_H
+
+#include "EntityCommandBuffer.h"
+#include "SystemAccess.h"
+#include "World.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using SystemFunction = std::function<void(World &world, EntityCommandBuffer &commands)>;
+
+// Runs systems in stages: a system joins the first stage after the last
+// one holding a system it conflicts with, so conflicting systems keep
+// their registration order and everything else in a stage runs in
+// parallel on the job system. Debug builds throw when a system queries
+// components it didn't declare. Each system records structural changes in
+// its own command buffer, played back in registration order after the
+// last stage.
+class SystemScheduler {
+  public:
+    void Add(const std::string &name, const SystemAccess &access, SystemFunction function);
+    template <typename... Ts> void Add(const std::string &name, SystemFunction function) {
+      Add(name, AccessOf<Ts...>(), std::move(function));
+    }
+
+    // Without a job system the stages run on the calling thread
+    void Run(World &world, JobSystem *jobs = nullptr);
+
+    size_t                   StageCount() const { return stages.size(); }
+    std::vector<std::string> StageSystems(size_t stage) const;
+
+  private:
+    struct System {
+        std::string                          name;
+        SystemAccess                         access;
+        SystemFunction                       function;
+        std::unique_ptr<EntityCommandBuffer> commands;
+        size_t                               stage;
+    };
+
+    std::vector<System>              systems;
+    std::vector<std::vector<size_t>> stages; // Indices into systems
+};
+
+#endif // SYSTEMSCHEDULER_H
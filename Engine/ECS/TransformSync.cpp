@@ -0,0 +1,18 @@
+#include "TransformSync.h"
+
+void TransformSync::Bind(TransformHandle handle, Entity entity) {
+  if (handle >= entities.size()) { entities.resize(handle + 1); }
+  entities[handle] = entity;
+}
+
+void TransformSync::Unbind(TransformHandle handle) {
+  if (handle < entities.size()) { entities[handle] = Entity(); }
+}
+
+void TransformSync::Apply(const TransformHierarchy &transforms, World &world) const {
+  for (TransformHandle handle : transforms.Changed()) {
+    if (handle >= entities.size()) { continue; }
+    LocalToWorld *transform = world.Get<LocalToWorld>(entities[handle]);
+    if (transform) { transform->matrix = transforms.GetWorldMatrix(handle); }
+  }
+}
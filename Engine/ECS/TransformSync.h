@@ -0,0 +1,25 @@
+#ifndef TRANSFORMSYNC_H
+#define TRANSFORMSYNC_H
+
+#include "RenderExtraction.h"
+#include "World.h"
+#include "../Scene/TransformHierarchy.h"
+#include <vector>
+
+// Drives entities' LocalToWorld from TransformHierarchy nodes. Apply()
+// only copies the nodes the last TransformHierarchy::Update() recomputed,
+// so entities whose transforms didn't move cost nothing. Bind a node
+// before the Update() following its creation, or its first matrix is
+// missed until it moves.
+class TransformSync {
+  public:
+    void Bind(TransformHandle handle, Entity entity);
+    void Unbind(TransformHandle handle);
+
+    void Apply(const TransformHierarchy &transforms, World &world) const;
+
+  private:
+    std::vector<Entity> entities; // Indexed by handle
+};
+
+#endif // TRANSFORMSYNC_H
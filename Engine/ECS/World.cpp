@@ -0,0 +1,125 @@
+#include "World.h"
+
+#include <cstring>
+#include <stdexcept>
+
+thread_local const SystemAccess *runningSystemAccess = nullptr;
+
+Entity World::Create() {
+  return CreateWithComponents(0);
+}
+
+Entity World::CreateWithComponents(ComponentMask mask) {
+  CheckStructuralChange();
+
+  Entity entity;
+  if (!freeIndices.empty()) {
+    entity.index = freeIndices.back();
+    freeIndices.pop_back();
+  } else {
+    entity.index = static_cast<uint32_t>(records.size());
+    records.emplace_back();
+  }
+  entity.generation = records[entity.index].generation;
+  Place(entity, GetArchetype(mask));
+  return entity;
+}
+
+void World::Destroy(Entity entity) {
+  CheckStructuralChange();
+  const EntityRecord &record = Record(entity);
+
+  Entity moved = record.archetype->Remove(record.chunk, record.row);
+  if (moved.IsValid()) {
+    records[moved.index].chunk = record.chunk;
+    records[moved.index].row   = record.row;
+  }
+
+  EntityRecord &freed = records[entity.index];
+  freed.archetype     = nullptr;
+  freed.generation++;
+  freeIndices.push_back(entity.index);
+}
+
+bool World::IsAlive(Entity entity) const {
+  return entity.index < records.size() && records[entity.index].archetype &&
+         records[entity.index].generation == entity.generation;
+}
+
+void *World::AddRaw(Entity entity, ComponentId id) {
+  const EntityRecord &record = Record(entity);
+  if (!record.archetype->Has(id)) {
+    CheckStructuralChange();
+    MoveTo(entity, GetArchetype(record.archetype->Mask() | (ComponentMask(1) << id)));
+  }
+  return record.archetype->Component(record.chunk, record.row, id);
+}
+
+void World::RemoveRaw(Entity entity, ComponentId id) {
+  const EntityRecord &record = Record(entity);
+  if (!record.archetype->Has(id)) { return; }
+  CheckStructuralChange();
+  MoveTo(entity, GetArchetype(record.archetype->Mask() & ~(ComponentMask(1) << id)));
+}
+
+void *World::GetRaw(Entity entity, ComponentId id) const {
+  if (!IsAlive(entity)) { return nullptr; }
+  const EntityRecord &record = records[entity.index];
+  if (!record.archetype->Has(id)) { return nullptr; }
+  return record.archetype->Component(record.chunk, record.row, id);
+}
+
+Archetype &World::GetArchetype(ComponentMask mask) {
+  auto it = archetypesByMask.find(mask);
+  if (it != archetypesByMask.end()) { return *it->second; }
+
+  archetypes.push_back(std::make_unique<Archetype>(mask));
+  archetypesByMask[mask] = archetypes.back().get();
+  return *archetypes.back();
+}
+
+const World::EntityRecord &World::Record(Entity entity) const {
+  if (!IsAlive(entity)) {
+    throw std::runtime_error("Entity is not alive!");
+  }
+  return records[entity.index];
+}
+
+void World::Place(Entity entity, Archetype &archetype) {
+  EntityRecord &record = records[entity.index];
+  record.archetype     = &archetype;
+  record.row           = archetype.Allocate(entity, record.chunk);
+}
+
+// Copies the components both archetypes share; ones only the target has
+// are left uninitialized for the caller
+void World::MoveTo(Entity entity, Archetype &target) {
+  EntityRecord record = records[entity.index];
+  Place(entity, target);
+  const EntityRecord &placed = records[entity.index];
+  for (ComponentId id : record.archetype->Components()) {
+    if (target.Has(id)) {
+      std::memcpy(target.Component(placed.chunk, placed.row, id),
+                  record.archetype->Component(record.chunk, record.row, id),
+                  GetComponentInfo(id).size);
+    }
+  }
+
+  Entity moved = record.archetype->Remove(record.chunk, record.row);
+  if (moved.IsValid()) {
+    records[moved.index].chunk = record.chunk;
+    records[moved.index].row   = record.row;
+  }
+}
+
+void World::CheckStructuralChange() const {
+  if (activeQueries.load() != 0) {
+    throw std::runtime_error("Structural change during a query, use an EntityCommandBuffer!");
+  }
+}
+
+void World::CheckQueryAccess(const SystemAccess &query) const {
+  if (runningSystemAccess && !runningSystemAccess->Covers(query)) {
+    throw std::runtime_error("System queries components it did not declare!");
+  }
+}
@@ -0,0 +1,132 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "Archetype.h"
+#include "SystemAccess.h"
+#include "../Jobs/JobSystem.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Mask of the components in a query's parameter pack
+template <typename... Ts> ComponentMask ComponentMaskOf() {
+  return (ComponentMask(0) | ... | (ComponentMask(1) << ComponentType<Ts>()));
+}
+
+// Entity and component storage. Entities live in the archetype matching
+// their component set, adding or removing a component moves the entity to
+// another archetype. Queries visit every archetype that has the requested
+// components chunk by chunk, so they read each column linearly.
+//
+// Structural changes (create, destroy, add, remove) are not allowed while
+// a query is running; systems record them in an EntityCommandBuffer.
+class World {
+  public:
+    Entity Create();
+    // Creates the entity straight in the archetype for these components,
+    // with their contents left uninitialized
+    Entity CreateWithComponents(ComponentMask mask);
+    void   Destroy(Entity entity);
+    bool   IsAlive(Entity entity) const;
+    size_t EntityCount() const { return records.size() - freeIndices.size(); }
+
+    template <typename T> void Add(Entity entity, const T &component) {
+      std::memcpy(AddRaw(entity, ComponentType<T>()), &component, sizeof(T));
+    }
+    template <typename T> void Remove(Entity entity) { RemoveRaw(entity, ComponentType<T>()); }
+    template <typename T> bool Has(Entity entity) const {
+      return GetRaw(entity, ComponentType<T>()) != nullptr;
+    }
+    // nullptr if the entity doesn't have the component
+    template <typename T> T *Get(Entity entity) const {
+      return static_cast<T *>(GetRaw(entity, ComponentType<T>()));
+    }
+
+    // Type-erased forms, the component memory is returned uninitialized
+    // when it was just added
+    void *AddRaw(Entity entity, ComponentId id);
+    void  RemoveRaw(Entity entity, ComponentId id);
+    void *GetRaw(Entity entity, ComponentId id) const;
+
+    // Calls f(count, entities, columns...) for every chunk that has all of
+    // Ts; declare components that are only read as const
+    template <typename... Ts, typename F> void ForEachChunk(F &&f) {
+      QueryScope scope(*this);
+#ifndef NDEBUG
+      CheckQueryAccess(AccessOf<Ts...>());
+#endif
+      ComponentMask mask = ComponentMaskOf<Ts...>();
+      for (const auto &archetype : archetypes) {
+        if ((archetype->Mask() & mask) != mask) { continue; }
+        for (size_t chunk = 0; chunk < archetype->ChunkCount(); chunk++) {
+          f(archetype->ChunkEntityCount(chunk), archetype->Entities(chunk),
+            static_cast<Ts *>(archetype->Column(chunk, ComponentType<Ts>()))...);
+        }
+      }
+    }
+
+    // Same, with the chunks spread over the job system
+    template <typename... Ts, typename F> void ParallelForEachChunk(JobSystem &jobs, F &&f) {
+      QueryScope scope(*this);
+#ifndef NDEBUG
+      CheckQueryAccess(AccessOf<Ts...>());
+#endif
+      ComponentMask mask = ComponentMaskOf<Ts...>();
+      std::vector<std::pair<Archetype *, uint32_t>> work;
+      for (const auto &archetype : archetypes) {
+        if ((archetype->Mask() & mask) != mask) { continue; }
+        for (size_t chunk = 0; chunk < archetype->ChunkCount(); chunk++) {
+          work.emplace_back(archetype.get(), static_cast<uint32_t>(chunk));
+        }
+      }
+      jobs.ParallelFor(static_cast<uint32_t>(work.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+          auto [archetype, chunk] = work[i];
+          f(archetype->ChunkEntityCount(chunk), archetype->Entities(chunk),
+            static_cast<Ts *>(archetype->Column(chunk, ComponentType<Ts>()))...);
+        }
+      });
+    }
+
+    // Calls f(entity, components...) per entity
+    template <typename... Ts, typename F> void Each(F &&f) {
+      ForEachChunk<Ts...>([&f](uint32_t count, const Entity *entities, Ts *...columns) {
+        for (uint32_t i = 0; i < count; i++) {
+          f(entities[i], columns[i]...);
+        }
+      });
+    }
+
+  private:
+    struct EntityRecord {
+        Archetype *archetype  = nullptr;
+        uint32_t   chunk      = 0;
+        uint32_t   row        = 0;
+        uint32_t   generation = 0;
+    };
+
+    // Counts running queries; systems in parallel stages query at once
+    struct QueryScope {
+        World &world;
+        explicit QueryScope(World &world) : world(world) { world.activeQueries++; }
+        ~QueryScope() { world.activeQueries--; }
+    };
+
+    std::vector<EntityRecord>                      records;
+    std::vector<uint32_t>                          freeIndices;
+    std::vector<std::unique_ptr<Archetype>>        archetypes;
+    std::unordered_map<ComponentMask, Archetype *> archetypesByMask;
+    std::atomic<uint32_t>                          activeQueries{0};
+
+    Archetype          &GetArchetype(ComponentMask mask);
+    const EntityRecord &Record(Entity entity) const;
+    void                Place(Entity entity, Archetype &archetype);
+    void                MoveTo(Entity entity, Archetype &target);
+    void                CheckStructuralChange() const;
+    void                CheckQueryAccess(const SystemAccess &query) const;
+};
+
+#endif // WORLD_H
@@ -0,0 +1,72 @@
+#include "AssetLoader.h"
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+void LoadObjGeometry(const std::string& modelPath, std::vector<Vertex>& vertices,
+                     std::vector<uint32_t>& indices) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str())) {
+        throw std::runtime_error("Failed to load model: " + warn + err);
+    }
+
+    for (const auto& shape: shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            Vertex vertex{};
+
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+            
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            vertex.color = {1.0f, 1.0f, 1.0f};
+
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+            
+            indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+}
+
+ImagePixels LoadImagePixels(const std::string& texturePath) {
+    ImagePixels image;
+    LoadImagePixels(texturePath, [&image](uint32_t width, uint32_t height) {
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        return image.pixels.data();
+    });
+    return image;
+}
+
+void LoadImagePixels(const std::string& texturePath,
+                     const std::function<uint8_t*(uint32_t width, uint32_t height)>& allocate) {
+    int texWidth, texHeight, texChannels;
+    stbi_uc *pixels = stbi_load(texturePath.c_str(), &texWidth, &texHeight,
+                                &texChannels, STBI_rgb_alpha);
+    if (!pixels) {
+        throw std::runtime_error("Failed to load texture: " + texturePath);
+    }
+
+    uint8_t* destination = allocate(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+    memcpy(destination, pixels, static_cast<size_t>(texWidth) * texHeight * 4);
+    stbi_image_free(pixels);
+}
@@ -0,0 +1,31 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include "Drivers/Vulkan/Vertex.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Tightly packed RGBA8 pixels decoded from an image file
+struct ImagePixels {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Driver independent file loading, shared by every graphics driver so the
+// CPU side of asset loading is identical whichever backend is used
+
+// Loads an OBJ model, deduplicating identical vertices
+void LoadObjGeometry(const std::string& modelPath, std::vector<Vertex>& vertices,
+                     std::vector<uint32_t>& indices);
+
+// Decodes an image file to RGBA8, throws if the file can't be read
+ImagePixels LoadImagePixels(const std::string& texturePath);
+// Same, but writes the pixels to memory returned by allocate(width, height)
+// (e.g. a driver's staging memory) instead of a vector of its own
+void LoadImagePixels(const std::string& texturePath,
+                     const std::function<uint8_t*(uint32_t width, uint32_t height)>& allocate);
+
+#endif // ASSETLOADER_H
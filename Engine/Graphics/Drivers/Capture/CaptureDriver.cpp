@@ -0,0 +1,354 @@
+#include "CaptureDriver.h"
+#include "../Vulkan/Mesh.h"
+#include "../Vulkan/RenderObject.h"
+#include "../../AssetLoader.h"
+#include <iostream>
+#include <stdexcept>
+
+uint64_t HashCaptureBytes(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t       hash  = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+CaptureDriver::CaptureDriver(IGraphicsDriver *driver, const std::string &capturePath)
+    : driver(driver), file(capturePath, std::ios::binary | std::ios::trunc) {
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open capture file: " + capturePath);
+  }
+  Write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+  Write(CAPTURE_VERSION);
+  Write(static_cast<uint32_t>(sizeof(Vertex)));
+  std::cout << "Capturing render commands to " << capturePath << std::endl;
+}
+
+CaptureDriver::~CaptureDriver() {
+  file.flush();
+}
+
+void CaptureDriver::Setup(GLFWwindow *window) {
+  driver->Setup(window);
+}
+
+void CaptureDriver::SetupOffscreen(uint32_t width, uint32_t height) {
+  driver->SetupOffscreen(width, height);
+}
+
+void CaptureDriver::Destruct() {
+  file.flush();
+  driver->Destruct();
+}
+
+void CaptureDriver::RenderFrame() {
+  WriteOp(CaptureOp::RenderFrame);
+  driver->RenderFrame();
+  frameData.clear();
+  // Keep the file usable if the process dies mid-run
+  file.flush();
+}
+
+void CaptureDriver::WindowIsResized() {
+  driver->WindowIsResized();
+}
+
+void CaptureDriver::SetFramebufferSize(uint32_t width, uint32_t height) {
+  driver->SetFramebufferSize(width, height);
+}
+
+void CaptureDriver::RequestFrameReadback(FrameReadbackCallback callback) {
+  driver->RequestFrameReadback(std::move(callback));
+}
+
+std::shared_ptr<Mesh> CaptureDriver::LoadMesh(const std::string &modelPath,
+                                              MeshCreateFlags    flags) {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  LoadObjGeometry(modelPath, vertices, indices);
+  return CreateMesh(std::move(vertices), std::move(indices), flags);
+}
+
+std::shared_ptr<Texture> CaptureDriver::LoadTexture(const std::string &texturePath) {
+  TextureUpload upload;
+  LoadImagePixels(texturePath, [this, &upload](uint32_t width, uint32_t height) {
+    upload = BeginTextureUpload(width, height);
+    return upload.pixels;
+  });
+  return CommitTextureUpload(upload);
+}
+
+std::shared_ptr<Mesh> CaptureDriver::CreateMesh(const std::vector<Vertex>   &vertices,
+                                                const std::vector<uint32_t> &indices,
+                                                MeshCreateFlags              flags) {
+  auto mesh = driver->CreateMesh(vertices, indices, flags);
+  RecordMesh(mesh, WriteVertexBlob(vertices.data(), vertices.size()),
+             WriteIndexBlob(indices.data(), indices.size()));
+  return mesh;
+}
+
+std::shared_ptr<Mesh> CaptureDriver::CreateMesh(std::vector<Vertex>   &&vertices,
+                                                std::vector<uint32_t> &&indices,
+                                                MeshCreateFlags         flags) {
+  // The vectors belong to the driver afterwards
+  uint64_t vertexBlob = WriteVertexBlob(vertices.data(), vertices.size());
+  uint64_t indexBlob  = WriteIndexBlob(indices.data(), indices.size());
+  auto     mesh       = driver->CreateMesh(std::move(vertices), std::move(indices), flags);
+  RecordMesh(mesh, vertexBlob, indexBlob);
+  return mesh;
+}
+
+// Nothing was created, so there's nothing to record
+void CaptureDriver::CancelMeshUpload(const MeshUpload &upload) {
+  driver->CancelMeshUpload(upload);
+}
+
+std::shared_ptr<Mesh> CaptureDriver::CreateMesh(const Vertex *vertices, size_t vertexCount,
+                                                const uint32_t *indices, size_t indexCount,
+                                                MeshCreateFlags flags) {
+  auto mesh = driver->CreateMesh(vertices, vertexCount, indices, indexCount, flags);
+  RecordMesh(mesh, WriteVertexBlob(vertices, vertexCount),
+             WriteIndexBlob(indices, indexCount));
+  return mesh;
+}
+
+MeshUpload CaptureDriver::BeginMeshUpload(size_t vertexCount, size_t indexCount) {
+  return driver->BeginMeshUpload(vertexCount, indexCount);
+}
+
+std::shared_ptr<Mesh> CaptureDriver::CommitMeshUpload(const MeshUpload &upload) {
+  uint64_t vertexBlob = WriteVertexBlob(upload.vertices, upload.vertexCount);
+  uint64_t indexBlob  = WriteIndexBlob(upload.indices, upload.indexCount);
+  auto     mesh       = driver->CommitMeshUpload(upload);
+  RecordMesh(mesh, vertexBlob, indexBlob);
+  return mesh;
+}
+
+std::shared_ptr<Mesh> CaptureDriver::CreateVoxelMesh(const VoxelVertex *vertices, size_t vertexCount) {
+  auto     mesh       = driver->CreateVoxelMesh(vertices, vertexCount);
+  uint64_t vertexBlob = WriteBlob(vertices, vertexCount * sizeof(VoxelVertex));
+  uint32_t id         = nextMeshId++;
+  meshIds[mesh]       = id;
+  WriteOp(CaptureOp::CreateVoxelMesh);
+  Write(id);
+  Write(vertexBlob);
+  return mesh;
+}
+
+bool CaptureDriver::SupportsGpuVoxelMeshing() {
+  return driver->SupportsGpuVoxelMeshing();
+}
+
+// Records the input rather than the meshes, which never reach the CPU
+void CaptureDriver::MeshVoxelChunksOnGpu(const GpuVoxelMeshInput &input,
+                                         std::vector<std::shared_ptr<Mesh>> &meshes) {
+  size_t first = meshes.size();
+  driver->MeshVoxelChunksOnGpu(input, meshes);
+  if (input.chunkCount == 0) { return; }
+  uint64_t slotBlob   = WriteBlob(input.slots, static_cast<size_t>(input.chunkCount) * 27 * sizeof(uint32_t));
+  uint64_t recordBlob = WriteBlob(input.records, input.recordWords * sizeof(uint32_t));
+  uint32_t firstId    = nextMeshId;
+  for (size_t i = first; i < meshes.size(); i++) {
+    meshIds[meshes[i]] = nextMeshId++;
+  }
+  WriteOp(CaptureOp::MeshVoxelChunksOnGpu);
+  Write(firstId);
+  Write(input.chunkCount);
+  Write(input.maxQuads);
+  Write(static_cast<uint32_t>(input.ambientOcclusion ? 1 : 0));
+  Write(slotBlob);
+  Write(recordBlob);
+}
+
+void CaptureDriver::CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>> &meshes) {
+  driver->CollectGpuVoxelMeshOverflows(meshes);
+}
+
+std::shared_ptr<Texture> CaptureDriver::CreateTexture(uint32_t width, uint32_t height,
+                                                      const void *pixelData) {
+  auto texture = driver->CreateTexture(width, height, pixelData);
+  RecordTexture(texture, width, height,
+                WriteBlob(pixelData, static_cast<size_t>(width) * height * 4));
+  return texture;
+}
+
+TextureUpload CaptureDriver::BeginTextureUpload(uint32_t width, uint32_t height) {
+  return driver->BeginTextureUpload(width, height);
+}
+
+std::shared_ptr<Texture> CaptureDriver::CommitTextureUpload(const TextureUpload &upload) {
+  // The staging memory is gone once the driver has the upload
+  uint64_t pixels  = WriteBlob(upload.pixels, upload.Size());
+  auto     texture = driver->CommitTextureUpload(upload);
+  RecordTexture(texture, upload.width, upload.height, pixels);
+  return texture;
+}
+
+void CaptureDriver::CancelTextureUpload(const TextureUpload &upload) {
+  driver->CancelTextureUpload(upload);
+}
+
+void CaptureDriver::ReleaseMesh(const std::shared_ptr<Mesh> &mesh) {
+  driver->ReleaseMesh(mesh);
+
+  auto it = meshIds.find(mesh);
+  if (it == meshIds.end()) { return; }
+  WriteOp(CaptureOp::ReleaseMesh);
+  Write(it->second);
+  meshIds.erase(it);
+}
+
+void CaptureDriver::ReleaseTexture(const std::shared_ptr<Texture> &texture) {
+  driver->ReleaseTexture(texture);
+
+  auto it = textureIds.find(texture);
+  if (it == textureIds.end()) { return; }
+  WriteOp(CaptureOp::ReleaseTexture);
+  Write(it->second);
+  textureIds.erase(it);
+}
+
+// Not recorded, replay compiles what the submissions need
+void CaptureDriver::PrecompilePipelines(const std::vector<PipelineFeatures> &featureSets) {
+  driver->PrecompilePipelines(featureSets);
+}
+
+void CaptureDriver::SubmitRenderObject(const RenderObject &renderObject) {
+  driver->SubmitRenderObject(renderObject);
+
+  // Objects the driver skipped or rejected are not recorded
+  auto mesh    = meshIds.find(renderObject.mesh);
+  auto texture = textureIds.find(renderObject.texture);
+  if (mesh == meshIds.end() || texture == textureIds.end()) { return; }
+
+  // Written before the Submit record, which references it
+  uint64_t frameDataBlob = 0;
+  if (renderObject.frameData != 0) {
+    auto data = frameData.find(renderObject.frameData);
+    if (data == frameData.end()) {
+      throw std::runtime_error("Frame data was not allocated for this frame");
+    }
+    frameDataBlob = WriteBlob(data->second.first, data->second.second);
+  }
+
+  WriteOp(CaptureOp::Submit);
+  Write(mesh->second);
+  Write(texture->second);
+  Write(renderObject.modelMatrix);
+  Write(renderObject.materialColor);
+  Write(renderObject.pipelineFeatures);
+  Write(renderObject.uvTransform);
+  Write(frameDataBlob);
+  Write(renderObject.instanceCount);
+}
+
+// Recorded as ordinary submissions with the default material, replay goes
+// through SubmitRenderObject. The sort key is not part of the format.
+void CaptureDriver::SubmitRenderPackets(const RenderPacket *packets, size_t count) {
+  driver->SubmitRenderPackets(packets, count);
+
+  const glm::vec4 materialColor(1.0f);
+  const glm::vec4 uvTransform(1.0f, 1.0f, 0.0f, 0.0f);
+  const uint64_t  frameDataBlob = 0;
+  const uint32_t  instanceCount = 1;
+  for (size_t i = 0; i < count; i++) {
+    auto mesh    = meshIds.find(LookupKey(packets[i].mesh));
+    auto texture = textureIds.find(LookupKey(packets[i].texture));
+    if (mesh == meshIds.end() || texture == textureIds.end()) { continue; }
+
+    WriteOp(CaptureOp::Submit);
+    Write(mesh->second);
+    Write(texture->second);
+    Write(packets[i].modelMatrix);
+    Write(materialColor);
+    Write(packets[i].pipelineFeatures);
+    Write(uvTransform);
+    Write(frameDataBlob);
+    Write(instanceCount);
+  }
+}
+
+void CaptureDriver::ClearRenderQueue() {
+  WriteOp(CaptureOp::ClearQueue);
+  driver->ClearRenderQueue();
+}
+
+FrameDataAllocation CaptureDriver::AllocateFrameData(size_t size) {
+  FrameDataAllocation allocation = driver->AllocateFrameData(size);
+  frameData[allocation.handle]   = {allocation.data, size};
+  return allocation;
+}
+
+void CaptureDriver::SetViewMatrix(const glm::mat4 &view) {
+  WriteOp(CaptureOp::SetView);
+  Write(view);
+  driver->SetViewMatrix(view);
+}
+
+void CaptureDriver::SetProjectionMatrix(const glm::mat4 &projection) {
+  WriteOp(CaptureOp::SetProjection);
+  Write(projection);
+  driver->SetProjectionMatrix(projection);
+}
+
+void CaptureDriver::SetFramePacing(const FramePacing &pacing) {
+  driver->SetFramePacing(pacing);
+}
+
+void CaptureDriver::WaitForNextFrame() {
+  driver->WaitForNextFrame();
+}
+
+RenderStats &CaptureDriver::GetRenderStats() {
+  return driver->GetRenderStats();
+}
+
+void CaptureDriver::RecordMesh(const std::shared_ptr<Mesh> &mesh, uint64_t vertices,
+                               uint64_t indices) {
+  uint32_t id   = nextMeshId++;
+  meshIds[mesh] = id;
+  WriteOp(CaptureOp::CreateMesh);
+  Write(id);
+  Write(vertices);
+  Write(indices);
+}
+
+uint64_t CaptureDriver::WriteVertexBlob(const Vertex *vertices, size_t vertexCount) {
+  return WriteBlob(vertices, vertexCount * sizeof(Vertex));
+}
+
+uint64_t CaptureDriver::WriteIndexBlob(const uint32_t *indices, size_t indexCount) {
+  return WriteBlob(indices, indexCount * sizeof(uint32_t));
+}
+
+void CaptureDriver::RecordTexture(const std::shared_ptr<Texture> &texture, uint32_t width,
+                                  uint32_t height, uint64_t pixels) {
+  uint32_t id         = nextTextureId++;
+  textureIds[texture] = id;
+  WriteOp(CaptureOp::CreateTexture);
+  Write(id);
+  Write(width);
+  Write(height);
+  Write(pixels);
+}
+
+uint64_t CaptureDriver::WriteBlob(const void *data, size_t size) {
+  uint64_t hash = HashCaptureBytes(data, size);
+  if (writtenBlobs.insert(hash).second) {
+    WriteOp(CaptureOp::Blob);
+    Write(hash);
+    Write(static_cast<uint64_t>(size));
+    Write(data, size);
+  }
+  return hash;
+}
+
+void CaptureDriver::WriteOp(CaptureOp op) {
+  Write(static_cast<uint8_t>(op));
+}
+
+void CaptureDriver::Write(const void *data, size_t size) {
+  file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+}
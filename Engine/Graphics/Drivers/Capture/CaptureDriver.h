@@ -0,0 +1,91 @@
+#ifndef CAPTUREDRIVER_H
+#define CAPTUREDRIVER_H
+
+#include "../IGraphicsDriver.h"
+#include "CaptureFormat.h"
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+// Decorator that forwards every call to another driver and records the
+// resource creation, camera and submission stream to a capture file for
+// CaptureReplayer. Meshes and textures loaded from disk are decoded here
+// and created through the wrapped driver's creation API, and geometry is
+// recorded from the caller's data rather than the mesh, so assets end up
+// in the capture even when the mesh drops its CPU copy.
+class CaptureDriver : public IGraphicsDriver {
+  public:
+    CaptureDriver(IGraphicsDriver *driver, const std::string &capturePath);
+    ~CaptureDriver();
+
+    void Setup(GLFWwindow *window) override;
+    void Destruct() override;
+    void RenderFrame() override;
+    void WindowIsResized() override;
+    void SetFramebufferSize(uint32_t width, uint32_t height) override;
+    void SetupOffscreen(uint32_t width, uint32_t height) override;
+    void RequestFrameReadback(FrameReadbackCallback callback) override;
+
+    std::shared_ptr<Mesh>    LoadMesh(const std::string &modelPath, MeshCreateFlags flags = 0) override;
+    std::shared_ptr<Texture> LoadTexture(const std::string &texturePath) override;
+    std::shared_ptr<Mesh>    CreateMesh(const std::vector<Vertex>   &vertices,
+                                        const std::vector<uint32_t> &indices,
+                                        MeshCreateFlags              flags = 0) override;
+    std::shared_ptr<Mesh>    CreateMesh(std::vector<Vertex>   &&vertices,
+                                        std::vector<uint32_t> &&indices,
+                                        MeshCreateFlags         flags = 0) override;
+    std::shared_ptr<Mesh>    CreateMesh(const Vertex *vertices, size_t vertexCount,
+                                        const uint32_t *indices, size_t indexCount,
+                                        MeshCreateFlags flags = 0) override;
+    std::shared_ptr<Texture> CreateTexture(uint32_t width, uint32_t height,
+                                           const void *pixelData) override;
+    TextureUpload            BeginTextureUpload(uint32_t width, uint32_t height) override;
+    std::shared_ptr<Texture> CommitTextureUpload(const TextureUpload &upload) override;
+    void                     CancelTextureUpload(const TextureUpload &upload) override;
+    MeshUpload               BeginMeshUpload(size_t vertexCount, size_t indexCount) override;
+    std::shared_ptr<Mesh>    CommitMeshUpload(const MeshUpload &upload) override;
+    void                     CancelMeshUpload(const MeshUpload &upload) override;
+    std::shared_ptr<Mesh>    CreateVoxelMesh(const VoxelVertex *vertices, size_t vertexCount) override;
+    bool                     SupportsGpuVoxelMeshing() override;
+    void MeshVoxelChunksOnGpu(const GpuVoxelMeshInput &input, std::vector<std::shared_ptr<Mesh>> &meshes) override;
+    void CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>> &meshes) override;
+    void                     ReleaseMesh(const std::shared_ptr<Mesh> &mesh) override;
+    void                     ReleaseTexture(const std::shared_ptr<Texture> &texture) override;
+    void                     PrecompilePipelines(const std::vector<PipelineFeatures> &featureSets) override;
+    void                     SubmitRenderObject(const RenderObject &renderObject) override;
+    void                     SubmitRenderPackets(const RenderPacket *packets, size_t count) override;
+    void                     ClearRenderQueue() override;
+    FrameDataAllocation      AllocateFrameData(size_t size) override;
+    void                     SetViewMatrix(const glm::mat4 &view) override;
+    void                     SetProjectionMatrix(const glm::mat4 &projection) override;
+    void                     SetFramePacing(const FramePacing &pacing) override;
+    void                     WaitForNextFrame() override;
+    RenderStats             &GetRenderStats() override;
+
+  private:
+    IGraphicsDriver *driver;
+    std::ofstream    file;
+
+    std::unordered_set<uint64_t>                         writtenBlobs;
+    std::unordered_map<std::shared_ptr<Mesh>, uint32_t>    meshIds;
+    std::unordered_map<std::shared_ptr<Texture>, uint32_t> textureIds;
+    uint32_t                                               nextMeshId    = 0;
+    uint32_t                                               nextTextureId = 0;
+    // This frame's frame data by handle, recorded as blobs on submission
+    std::unordered_map<uint64_t, std::pair<const void *, size_t>> frameData;
+
+    void     RecordMesh(const std::shared_ptr<Mesh> &mesh, uint64_t vertices, uint64_t indices);
+    uint64_t WriteVertexBlob(const Vertex *vertices, size_t vertexCount);
+    uint64_t WriteIndexBlob(const uint32_t *indices, size_t indexCount);
+    void     RecordTexture(const std::shared_ptr<Texture> &texture, uint32_t width,
+                           uint32_t height, uint64_t pixels);
+    uint64_t WriteBlob(const void *data, size_t size);
+    void     WriteOp(CaptureOp op);
+    void     Write(const void *data, size_t size);
+    template <typename T> void Write(const T &value) { Write(&value, sizeof(T)); }
+};
+
+#endif // CAPTUREDRIVER_H
@@ -0,0 +1,38 @@
+#ifndef CAPTUREFORMAT_H
+#define CAPTUREFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary render-command capture, in host byte order:
+//   header: magic "DPCF", version u32, sizeof(Vertex) u32
+//   records: op u8 followed by the op's fields
+// Vertex, index and pixel payloads are written once as Blob records and
+// referenced by their hash afterwards, so resources recreated with the
+// same data don't grow the file.
+const char     CAPTURE_MAGIC[4] = {'D', 'P', 'C', 'F'};
+const uint32_t CAPTURE_VERSION  = 8;
+
+enum class CaptureOp : uint8_t {
+  Blob            = 1,  // hash u64, size u64, bytes
+  CreateMesh      = 2,  // mesh id u32, vertex blob u64, index blob u64
+  CreateTexture   = 3,  // texture id u32, width u32, height u32, pixel blob u64
+  SetView         = 4,  // mat4
+  SetProjection   = 5,  // mat4
+  Submit          = 6,  // mesh id u32, texture id u32, model mat4, material vec4,
+                        // pipeline features u32, uv transform vec4,
+                        // frame data blob u64 (0 for none), instance count u32
+  ClearQueue      = 7,
+  RenderFrame     = 8,
+  ReleaseMesh     = 9,  // mesh id u32
+  ReleaseTexture  = 10, // texture id u32
+  CreateVoxelMesh = 11, // mesh id u32, VoxelVertex blob u64
+  MeshVoxelChunksOnGpu = 12, // first mesh id u32 (one id per chunk), chunk count u32,
+                             // max quads u32, ambient occlusion u32, slot blob u64,
+                             // record blob u64
+};
+
+// FNV-1a, used to reference payloads
+uint64_t HashCaptureBytes(const void *data, size_t size);
+
+#endif // CAPTUREFORMAT_H
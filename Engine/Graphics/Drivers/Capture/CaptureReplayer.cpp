@@ -0,0 +1,294 @@
+#include "CaptureReplayer.h"
+#include "../Vulkan/Mesh.h"
+#include "../Vulkan/RenderObject.h"
+#include "../../Voxel/GpuVoxelBatch.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+// Bounds checked reads over the loaded file
+class CaptureReader {
+  public:
+    explicit CaptureReader(const std::vector<uint8_t> &data) : data(data) {}
+
+    bool AtEnd() const { return position >= data.size(); }
+
+    void Read(void *destination, size_t size) {
+      if (size > data.size() - position) {
+        throw std::runtime_error("Capture file is truncated");
+      }
+      memcpy(destination, data.data() + position, size);
+      position += size;
+    }
+
+    template <typename T> T Read() {
+      T value;
+      Read(&value, sizeof(T));
+      return value;
+    }
+
+  private:
+    const std::vector<uint8_t> &data;
+    size_t                      position = 0;
+};
+
+// Checks a GpuVoxelBatch record the way voxel_mesh.comp reads it, so a
+// corrupt capture can't send the shader outside the input buffer
+void CheckVoxelRecord(const uint32_t *records, size_t recordWords, uint32_t offset) {
+  if (offset >= recordWords || recordWords - offset < 2) {
+    throw std::runtime_error("Corrupt capture file: voxel slot points past the records");
+  }
+  uint32_t bits        = records[offset];
+  uint32_t paletteSize = records[offset + 1];
+  if (bits != 0 && bits != 1 && bits != 2 && bits != 4 && bits != 8 && bits != 16) {
+    throw std::runtime_error("Corrupt capture file: voxel record has a bad index width");
+  }
+  size_t indexWords = static_cast<size_t>(VoxelChunk::VOLUME) * bits / 32;
+  if (paletteSize == 0 || recordWords - offset - 2 < paletteSize + indexWords) {
+    throw std::runtime_error("Corrupt capture file: voxel record runs past the records");
+  }
+
+  // Every index has to land in the palette
+  const uint32_t *words = records + offset + 2 + paletteSize;
+  uint32_t        mask  = (1u << bits) - 1;
+  for (uint32_t voxel = 0; bits != 0 && voxel < VoxelChunk::VOLUME; voxel++) {
+    uint32_t bit = voxel * bits;
+    if (((words[bit >> 5] >> (bit & 31)) & mask) >= paletteSize) {
+      throw std::runtime_error("Corrupt capture file: voxel index outside its palette");
+    }
+  }
+}
+} // namespace
+
+void CaptureReplayer::Load(const std::string &capturePath) {
+  std::ifstream file(capturePath, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open capture file: " + capturePath);
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+  commands.clear();
+  blobs.clear();
+  frameCount = 0;
+  meshes.clear();
+  textures.clear();
+  boundDriver = nullptr;
+
+  CaptureReader reader(data);
+  char          magic[4];
+  reader.Read(magic, sizeof(magic));
+  if (memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+    throw std::runtime_error("Not a capture file: " + capturePath);
+  }
+  if (reader.Read<uint32_t>() != CAPTURE_VERSION) {
+    throw std::runtime_error("Unsupported capture version: " + capturePath);
+  }
+  if (reader.Read<uint32_t>() != sizeof(Vertex)) {
+    throw std::runtime_error("Capture was written with a different vertex layout");
+  }
+
+  while (!reader.AtEnd()) {
+    Command command{};
+    command.op = static_cast<CaptureOp>(reader.Read<uint8_t>());
+    switch (command.op) {
+    case CaptureOp::Blob: {
+      uint64_t             hash = reader.Read<uint64_t>();
+      uint64_t             size = reader.Read<uint64_t>();
+      std::vector<uint8_t> bytes(size);
+      reader.Read(bytes.data(), bytes.size());
+      blobs[hash] = std::move(bytes);
+      continue;
+    }
+    case CaptureOp::CreateMesh:
+      command.a     = reader.Read<uint32_t>();
+      command.blobA = reader.Read<uint64_t>();
+      command.blobB = reader.Read<uint64_t>();
+      break;
+    case CaptureOp::CreateVoxelMesh:
+      command.a     = reader.Read<uint32_t>();
+      command.blobA = reader.Read<uint64_t>();
+      break;
+    case CaptureOp::MeshVoxelChunksOnGpu:
+      command.a     = reader.Read<uint32_t>();
+      command.b     = reader.Read<uint32_t>();
+      command.c     = reader.Read<uint32_t>();
+      command.d     = reader.Read<uint32_t>();
+      command.blobA = reader.Read<uint64_t>();
+      command.blobB = reader.Read<uint64_t>();
+      break;
+    case CaptureOp::CreateTexture:
+      command.a     = reader.Read<uint32_t>();
+      command.b     = reader.Read<uint32_t>();
+      command.c     = reader.Read<uint32_t>();
+      command.blobA = reader.Read<uint64_t>();
+      break;
+    case CaptureOp::SetView:
+    case CaptureOp::SetProjection:
+      command.matrix = reader.Read<glm::mat4>();
+      break;
+    case CaptureOp::Submit:
+      command.a      = reader.Read<uint32_t>();
+      command.b      = reader.Read<uint32_t>();
+      command.matrix = reader.Read<glm::mat4>();
+      command.color  = reader.Read<glm::vec4>();
+      command.c      = reader.Read<uint32_t>();
+      command.uv     = reader.Read<glm::vec4>();
+      command.blobA  = reader.Read<uint64_t>();
+      command.d      = reader.Read<uint32_t>();
+      break;
+    case CaptureOp::ReleaseMesh:
+    case CaptureOp::ReleaseTexture:
+      command.a = reader.Read<uint32_t>();
+      break;
+    case CaptureOp::ClearQueue:
+      break;
+    case CaptureOp::RenderFrame:
+      frameCount++;
+      break;
+    default:
+      throw std::runtime_error("Corrupt capture file: unknown record");
+    }
+    commands.push_back(command);
+  }
+}
+
+void CaptureReplayer::Replay(IGraphicsDriver &driver) {
+  if (boundDriver != &driver) {
+    meshes.clear();
+    textures.clear();
+    boundDriver = &driver;
+  }
+
+  for (const auto &command : commands) {
+    switch (command.op) {
+    case CaptureOp::CreateMesh: {
+      if (meshes.count(command.a)) { break; }
+      const auto &vertexBytes = Blob(command.blobA);
+      const auto &indexBytes  = Blob(command.blobB);
+      // Blobs are heap allocated and suitably aligned; replay never needs
+      // the meshes' CPU copies
+      meshes[command.a] = driver.CreateMesh(
+        reinterpret_cast<const Vertex *>(vertexBytes.data()), vertexBytes.size() / sizeof(Vertex),
+        reinterpret_cast<const uint32_t *>(indexBytes.data()), indexBytes.size() / sizeof(uint32_t),
+        MESH_CREATE_RELEASE_CPU_DATA);
+      break;
+    }
+    case CaptureOp::CreateVoxelMesh: {
+      if (meshes.count(command.a)) { break; }
+      const auto &vertexBytes = Blob(command.blobA);
+      meshes[command.a]       = driver.CreateVoxelMesh(
+        reinterpret_cast<const VoxelVertex *>(vertexBytes.data()),
+        vertexBytes.size() / sizeof(VoxelVertex));
+      break;
+    }
+    case CaptureOp::MeshVoxelChunksOnGpu: {
+      if (meshes.count(command.a)) { break; }
+      if (!driver.SupportsGpuVoxelMeshing()) {
+        throw std::runtime_error("Capture meshes voxels on the GPU, which this driver can't do");
+      }
+      const auto &slotBytes   = Blob(command.blobA);
+      const auto &recordBytes = Blob(command.blobB);
+      if (slotBytes.size() != static_cast<size_t>(command.b) * 27 * sizeof(uint32_t)) {
+        throw std::runtime_error("Capture voxel batch size does not match its slots");
+      }
+      GpuVoxelMeshInput input;
+      input.slots            = reinterpret_cast<const uint32_t *>(slotBytes.data());
+      input.records          = reinterpret_cast<const uint32_t *>(recordBytes.data());
+      input.recordWords      = recordBytes.size() / sizeof(uint32_t);
+      input.chunkCount       = command.b;
+      input.maxQuads         = command.c;
+      input.ambientOcclusion = command.d != 0;
+      // Neighbourhoods share records, each is checked once
+      std::unordered_set<uint32_t> checkedRecords;
+      for (size_t slot = 0; slot < static_cast<size_t>(command.b) * 27; slot++) {
+        uint32_t offset = input.slots[slot];
+        if (offset != GPU_VOXEL_NO_CHUNK && checkedRecords.insert(offset).second) {
+          CheckVoxelRecord(input.records, input.recordWords, offset);
+        }
+      }
+      // Chunks that overflowed when captured were meshed on the CPU
+      // afterwards, and recorded as such
+      std::vector<std::shared_ptr<Mesh>> batch;
+      driver.MeshVoxelChunksOnGpu(input, batch);
+      if (batch.size() != command.b) {
+        throw std::runtime_error("Driver returned the wrong number of voxel meshes for the batch");
+      }
+      for (uint32_t chunk = 0; chunk < command.b; chunk++) {
+        meshes[command.a + chunk] = batch[chunk];
+      }
+      break;
+    }
+    case CaptureOp::CreateTexture: {
+      if (textures.count(command.a)) { break; }
+      uint32_t width  = command.b;
+      uint32_t height = command.c;
+      const auto &pixels = Blob(command.blobA);
+      if (pixels.size() != static_cast<size_t>(width) * height * 4) {
+        throw std::runtime_error("Capture texture size does not match its pixels");
+      }
+      textures[command.a] = driver.CreateTexture(width, height, pixels.data());
+      break;
+    }
+    case CaptureOp::SetView:
+      driver.SetViewMatrix(command.matrix);
+      break;
+    case CaptureOp::SetProjection:
+      driver.SetProjectionMatrix(command.matrix);
+      break;
+    case CaptureOp::Submit: {
+      auto mesh    = meshes.find(command.a);
+      auto texture = textures.find(command.b);
+      if (mesh == meshes.end() || texture == textures.end()) {
+        throw std::runtime_error("Capture submits a resource it never created");
+      }
+      RenderObject renderObject(mesh->second, texture->second, command.matrix);
+      renderObject.materialColor    = command.color;
+      renderObject.pipelineFeatures = command.c;
+      renderObject.uvTransform      = command.uv;
+      renderObject.instanceCount    = command.d;
+      if (command.blobA != 0) {
+        const auto         &bytes     = Blob(command.blobA);
+        FrameDataAllocation frameData = driver.AllocateFrameData(bytes.size());
+        memcpy(frameData.data, bytes.data(), bytes.size());
+        renderObject.frameData = frameData.handle;
+      }
+      driver.SubmitRenderObject(renderObject);
+      break;
+    }
+    case CaptureOp::ReleaseMesh: {
+      auto mesh = meshes.find(command.a);
+      if (mesh == meshes.end()) { break; }
+      driver.ReleaseMesh(mesh->second);
+      meshes.erase(mesh);
+      break;
+    }
+    case CaptureOp::ReleaseTexture: {
+      auto texture = textures.find(command.a);
+      if (texture == textures.end()) { break; }
+      driver.ReleaseTexture(texture->second);
+      textures.erase(texture);
+      break;
+    }
+    case CaptureOp::ClearQueue:
+      driver.ClearRenderQueue();
+      break;
+    case CaptureOp::RenderFrame:
+      driver.RenderFrame();
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+const std::vector<uint8_t> &CaptureReplayer::Blob(uint64_t hash) const {
+  auto it = blobs.find(hash);
+  if (it == blobs.end()) {
+    throw std::runtime_error("Capture references a missing payload");
+  }
+  return it->second;
+}
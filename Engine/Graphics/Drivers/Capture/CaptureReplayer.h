@@ -0,0 +1,51 @@
+#ifndef CAPTUREREPLAYER_H
+#define CAPTUREREPLAYER_H
+
+#include "../IGraphicsDriver.h"
+#include "CaptureFormat.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Loads a file written by CaptureDriver and drives any IGraphicsDriver from
+// it as fast as the driver allows. The whole capture is parsed up front so
+// replay does no file I/O.
+class CaptureReplayer {
+  public:
+    void Load(const std::string &capturePath);
+
+    // Replays the stream once. Resources are created the first time their
+    // record is reached and reused on later calls with the same driver
+    // unless the capture released them in between.
+    void Replay(IGraphicsDriver &driver);
+
+    uint32_t FrameCount() const { return frameCount; }
+    size_t   CommandCount() const { return commands.size(); }
+
+  private:
+    struct Command {
+      CaptureOp op;
+      uint32_t  a      = 0; // Mesh id, or texture id in CreateTexture
+      uint32_t  b      = 0; // Texture id in Submit, width in CreateTexture
+      uint32_t  c      = 0; // Height in CreateTexture, features in Submit
+      uint32_t  d      = 0; // Ambient occlusion in MeshVoxelChunksOnGpu, instance count in Submit
+      uint64_t  blobA  = 0; // Frame data in Submit, 0 for none
+      uint64_t  blobB  = 0;
+      glm::mat4 matrix = glm::mat4(1.0f);
+      glm::vec4 color  = glm::vec4(1.0f);
+      glm::vec4 uv     = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    };
+
+    std::vector<Command>                                commands;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> blobs;
+    uint32_t                                            frameCount = 0;
+
+    IGraphicsDriver                                      *boundDriver = nullptr;
+    std::unordered_map<uint32_t, std::shared_ptr<Mesh>>    meshes;
+    std::unordered_map<uint32_t, std::shared_ptr<Texture>> textures;
+
+    const std::vector<uint8_t> &Blob(uint64_t hash) const;
+};
+
+#endif // CAPTUREREPLAYER_H
@@ -1,11 +1,381 @@
 #include "Dummy.h"
+#include "../Vulkan/Mesh.h"
+#include "../Vulkan/Texture.h"
+#include "../Vulkan/RenderObject.h"
+#include "../../AssetLoader.h"
+#include <chrono>
+#include <stdexcept>
 
 DummyDriver::DummyDriver() {}
 DummyDriver::~DummyDriver() {}
-void DummyDriver::RenderFrame() {}
 
 void DummyDriver::Setup(GLFWwindow* engineWindow) {
+	// The window is optional, nothing is ever presented to it
 	window = engineWindow;
 }
 
-void DummyDriver::Destruct() {}
+void DummyDriver::SetupOffscreen(uint32_t width, uint32_t height) {
+	window = nullptr;
+	offscreen = true;
+	offscreenWidth = width;
+	offscreenHeight = height;
+}
+
+void DummyDriver::Destruct() {
+	nextFrameReadback = nullptr;
+	renderQueue.Clear();
+	meshes.clear();
+	textures.clear();
+}
+
+void DummyDriver::WindowIsResized() {}
+
+void DummyDriver::SetFramebufferSize(uint32_t width, uint32_t height) {}
+
+void DummyDriver::RequestFrameReadback(FrameReadbackCallback callback) {
+	if (!offscreen) {
+		throw std::runtime_error("Frame readback is only available in offscreen mode!");
+	}
+	nextFrameReadback = std::move(callback);
+}
+
+void DummyDriver::SetFramePacing(const FramePacing& pacing) {
+	framePacer.SetPacing(pacing);
+}
+
+void DummyDriver::WaitForNextFrame() {
+	waitPacingSleepMs += framePacer.Throttle();
+	framePacer.LatchInput();
+}
+
+void DummyDriver::RenderFrame() {
+	if (!framePacer.InputLatched()) {
+		WaitForNextFrame();
+	}
+
+	FrameStats& stats = renderStats.Current();
+	stats.pacingSleepMs += waitPacingSleepMs;
+	waitPacingSleepMs = 0.0;
+	auto recordStart = std::chrono::steady_clock::now();
+
+	// Walk the queue the same way the Vulkan driver records it and count
+	// the binds and draws that would be issued
+	renderQueue.Prepare(projectionMatrix * viewMatrix);
+	stats.pipelineBinds++;
+	stats.descriptorSetBinds++;
+
+	PipelineFeatures boundFeatures = 0;
+	const Mesh* boundMesh = nullptr;
+	const Texture* boundTexture = nullptr;
+	bool objectDataBound = false;
+	RenderMaterial boundMaterial;
+	bool frameDataBound = false;
+	uint64_t boundFrameData = 0;
+	for (uint32_t index : renderQueue.Visible()) {
+		const RenderPacket& packet = renderQueue.Packet(index);
+		const RenderMaterial& material = renderQueue.Material(index);
+		// Every variant counts as ready, there is nothing to compile
+		if (packet.pipelineFeatures != boundFeatures) {
+			stats.pipelineBinds++;
+			boundFeatures = packet.pipelineFeatures;
+		}
+		if (packet.mesh != boundMesh) {
+			stats.vertexBufferBinds++;
+			boundMesh = packet.mesh;
+		}
+		if (packet.texture != boundTexture) {
+			stats.descriptorSetBinds++;
+			boundTexture = packet.texture;
+		}
+		if (!objectDataBound || !material.SameUniforms(boundMaterial)) {
+			stats.descriptorSetBinds++;
+			stats.bytesUploaded += 2 * sizeof(glm::vec4);
+			objectDataBound = true;
+			boundMaterial = material;
+		}
+		if (!frameDataBound || material.frameData != boundFrameData) {
+			stats.descriptorSetBinds++;
+			frameDataBound = true;
+			boundFrameData = material.frameData;
+		}
+		uint32_t instances = (packet.pipelineFeatures & PIPELINE_FEATURE_INSTANCED) ? material.instanceCount : 1;
+		stats.drawCalls++;
+		stats.trianglesSubmitted += packet.mesh->GetIndexCount() / 3 * instances;
+	}
+
+	stats.cpuRecordMs = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - recordStart).count();
+
+	if (nextFrameReadback) {
+		readbackPixels.assign(static_cast<size_t>(offscreenWidth) * offscreenHeight * 4, 0);
+		FrameReadback readback{renderStats.FrameCount(), offscreenWidth, offscreenHeight,
+		                       readbackPixels.data()};
+		FrameReadbackCallback callback = std::move(nextFrameReadback);
+		nextFrameReadback = nullptr;
+		callback(readback);
+	}
+
+	frameDataUsed = 0;
+
+	// Frames complete as soon as they are "recorded"
+	framePacer.FrameSubmitted(0);
+	stats.inputLatencyMs = framePacer.FrameCompleted(0);
+
+	renderStats.EndFrame();
+}
+
+std::shared_ptr<Mesh> DummyDriver::LoadMesh(const std::string& modelPath, MeshCreateFlags flags) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	LoadObjGeometry(modelPath, vertices, indices);
+
+	std::cout << "Loaded mesh from " << modelPath << ": " << vertices.size()
+	          << " vertices, " << indices.size() << " indices" << std::endl;
+
+	return CreateMesh(std::move(vertices), std::move(indices), flags);
+}
+
+std::shared_ptr<Texture> DummyDriver::LoadTexture(const std::string& texturePath) {
+	ImagePixels image = LoadImagePixels(texturePath);
+	std::cout << "Loaded texture from " << texturePath << std::endl;
+
+	return CreateTexture(image.width, image.height, image.pixels.data());
+}
+
+std::shared_ptr<Mesh> DummyDriver::CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshCreateFlags flags) {
+	return CreateMesh(std::vector<Vertex>(vertices), std::vector<uint32_t>(indices), flags);
+}
+
+std::shared_ptr<Mesh> DummyDriver::CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, MeshCreateFlags flags) {
+	auto mesh = std::make_shared<Mesh>(std::move(vertices), std::move(indices));
+	meshes.insert(mesh);
+
+	// Count what a GPU driver would have uploaded
+	renderStats.Current().bytesUploaded += mesh->GetVertexCount() * sizeof(Vertex) +
+	                                       mesh->GetIndexCount() * sizeof(uint32_t);
+	if (flags & MESH_CREATE_RELEASE_CPU_DATA) {
+		mesh->ReleaseCpuData();
+	}
+	return mesh;
+}
+
+std::shared_ptr<Mesh> DummyDriver::CreateMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshCreateFlags flags) {
+	return CreateMesh(std::vector<Vertex>(vertices, vertices + vertexCount),
+	                  std::vector<uint32_t>(indices, indices + indexCount), flags);
+}
+
+MeshUpload DummyDriver::BeginMeshUpload(size_t vertexCount, size_t indexCount) {
+	MeshUpload upload;
+	upload.id = nextUploadId++;
+	upload.vertexCount = vertexCount;
+	upload.indexCount = indexCount;
+	auto& [vertices, indices] = pendingMeshUploads[upload.id];
+	vertices.resize(vertexCount);
+	indices.resize(indexCount);
+	upload.vertices = vertices.data();
+	upload.indices = indices.data();
+	return upload;
+}
+
+std::shared_ptr<Mesh> DummyDriver::CommitMeshUpload(const MeshUpload& upload) {
+	if (pendingMeshUploads.erase(upload.id) == 0) {
+		throw std::runtime_error("CommitMeshUpload called with an unknown upload!");
+	}
+
+	auto mesh = std::make_shared<Mesh>(upload.vertexCount, upload.indexCount,
+	                                   upload.boundsMin, upload.boundsMax);
+	meshes.insert(mesh);
+	renderStats.Current().bytesUploaded += upload.vertexCount * sizeof(Vertex) +
+	                                       upload.indexCount * sizeof(uint32_t);
+	return mesh;
+}
+
+void DummyDriver::CancelMeshUpload(const MeshUpload& upload) {
+	if (pendingMeshUploads.erase(upload.id) == 0) {
+		throw std::runtime_error("CancelMeshUpload called with an unknown upload!");
+	}
+}
+
+std::shared_ptr<Mesh> DummyDriver::CreateVoxelMesh(const VoxelVertex* vertices, size_t vertexCount) {
+	if (vertexCount == 0 || vertexCount % 4 != 0) {
+		throw std::runtime_error("CreateVoxelMesh needs four vertices per quad!");
+	}
+
+	glm::vec3 boundsMin, boundsMax;
+	Mesh::ComputeBounds(vertices, vertexCount, boundsMin, boundsMax);
+	auto mesh = std::make_shared<Mesh>(vertexCount, vertexCount / 4 * 6, boundsMin, boundsMax,
+	                                   VERTEX_FORMAT_VOXEL);
+	meshes.insert(mesh);
+	// The shared quad indices are uploaded once, not per mesh
+	renderStats.Current().bytesUploaded += vertexCount * sizeof(VoxelVertex);
+	return mesh;
+}
+
+// Nothing runs the meshing: the chunks get empty meshes, and only the
+// input counts as uploaded
+bool DummyDriver::SupportsGpuVoxelMeshing() {
+	return true;
+}
+
+void DummyDriver::MeshVoxelChunksOnGpu(const GpuVoxelMeshInput& input, std::vector<std::shared_ptr<Mesh>>& meshes) {
+	for (uint32_t chunk = 0; chunk < input.chunkCount; chunk++) {
+		auto mesh = std::make_shared<Mesh>(0, 0, glm::vec3(0.0f), glm::vec3(32.0f), VERTEX_FORMAT_VOXEL);
+		this->meshes.insert(mesh);
+		meshes.push_back(mesh);
+	}
+	renderStats.Current().bytesUploaded += (static_cast<size_t>(input.chunkCount) * 27 + input.recordWords) * sizeof(uint32_t);
+}
+
+void DummyDriver::CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>>& meshes) {
+}
+
+std::shared_ptr<Texture> DummyDriver::CreateTexture(uint32_t width, uint32_t height, const void* pixelData) {
+	if (!pixelData) {
+		throw std::runtime_error("CreateTexture called without pixel data!");
+	}
+
+	auto texture = std::make_shared<Texture>();
+	textures.insert(texture);
+
+	renderStats.Current().bytesUploaded += static_cast<uint64_t>(width) * height * 4;
+	return texture;
+}
+
+TextureUpload DummyDriver::BeginTextureUpload(uint32_t width, uint32_t height) {
+	TextureUpload upload;
+	upload.id = nextUploadId++;
+	upload.width = width;
+	upload.height = height;
+	std::vector<uint8_t>& pixels = pendingUploads[upload.id];
+	pixels.resize(upload.Size());
+	upload.pixels = pixels.data();
+	return upload;
+}
+
+std::shared_ptr<Texture> DummyDriver::CommitTextureUpload(const TextureUpload& upload) {
+	auto it = pendingUploads.find(upload.id);
+	if (it == pendingUploads.end()) {
+		throw std::runtime_error("CommitTextureUpload called with an unknown upload!");
+	}
+	auto texture = CreateTexture(upload.width, upload.height, it->second.data());
+	pendingUploads.erase(it);
+	return texture;
+}
+
+void DummyDriver::CancelTextureUpload(const TextureUpload& upload) {
+	if (pendingUploads.erase(upload.id) == 0) {
+		throw std::runtime_error("CancelTextureUpload called with an unknown upload!");
+	}
+}
+
+// Nothing is in flight on the CPU, so releases take effect immediately
+void DummyDriver::ReleaseMesh(const std::shared_ptr<Mesh>& mesh) {
+	if (meshes.erase(mesh) == 0) {
+		std::cerr << "Warning: ReleaseMesh called for a mesh this driver does not own" << std::endl;
+		return;
+	}
+	renderQueue.Forget(mesh.get());
+}
+
+void DummyDriver::ReleaseTexture(const std::shared_ptr<Texture>& texture) {
+	if (textures.erase(texture) == 0) {
+		std::cerr << "Warning: ReleaseTexture called for a texture this driver does not own" << std::endl;
+		return;
+	}
+	renderQueue.Forget(texture.get());
+}
+
+void DummyDriver::PrecompilePipelines(const std::vector<PipelineFeatures>& featureSets) {
+	// No pipelines on the CPU
+}
+
+void DummyDriver::SubmitRenderObject(const RenderObject& renderObject) {
+	if (!renderObject.mesh || !renderObject.texture) {
+		std::cerr << "Warning: RenderObject missing mesh or texture, skipping" << std::endl;
+		return;
+	}
+
+	if (meshes.find(renderObject.mesh) == meshes.end()) {
+		throw std::runtime_error("Mesh not found in resources - was it loaded through LoadMesh?");
+	}
+	if (textures.find(renderObject.texture) == textures.end()) {
+		throw std::runtime_error("Texture not found in resources - was it loaded through LoadTexture?");
+	}
+	if ((renderObject.mesh->GetVertexFormat() == VERTEX_FORMAT_VOXEL) !=
+		((renderObject.pipelineFeatures & PIPELINE_FEATURE_VOXEL) != 0)) {
+		throw std::runtime_error("Voxel meshes must be drawn with PIPELINE_FEATURE_VOXEL, and only they");
+	}
+	if (renderObject.frameData > frameDataUsed) {
+		throw std::runtime_error("Frame data was not allocated for this frame");
+	}
+	if (renderObject.pipelineFeatures & PIPELINE_FEATURE_INSTANCED) {
+		if (renderObject.pipelineFeatures & PIPELINE_FEATURE_VOXEL) {
+			throw std::runtime_error("Voxel meshes can't be drawn instanced");
+		}
+		if (renderObject.frameData == 0 ||
+			static_cast<uint64_t>(renderObject.instanceCount) * sizeof(glm::mat4) > frameData[renderObject.frameData - 1].size()) {
+			throw std::runtime_error("Instanced objects need a mat4 per instance in their frame data");
+		}
+	}
+
+	renderQueue.Submit(renderObject);
+}
+
+void DummyDriver::SubmitRenderPackets(const RenderPacket* packets, size_t count) {
+#ifndef NDEBUG
+	for (size_t i = 0; i < count; i++) {
+		if (meshes.find(LookupKey(packets[i].mesh)) == meshes.end()) {
+			throw std::runtime_error("RenderPacket mesh not found in resources - was it created by this driver?");
+		}
+		if (textures.find(LookupKey(packets[i].texture)) == textures.end()) {
+			throw std::runtime_error("RenderPacket texture not found in resources - was it created by this driver?");
+		}
+		if ((packets[i].mesh->GetVertexFormat() == VERTEX_FORMAT_VOXEL) !=
+			((packets[i].pipelineFeatures & PIPELINE_FEATURE_VOXEL) != 0)) {
+			throw std::runtime_error("Voxel meshes must be drawn with PIPELINE_FEATURE_VOXEL, and only they");
+		}
+		if (packets[i].pipelineFeatures & PIPELINE_FEATURE_INSTANCED) {
+			throw std::runtime_error("RenderPackets have no frame data and can't be drawn instanced");
+		}
+	}
+#endif
+
+	renderQueue.Submit(packets, count);
+}
+
+void DummyDriver::ClearRenderQueue() {
+	renderQueue.Clear();
+}
+
+// Handles are the allocation's index plus one
+FrameDataAllocation DummyDriver::AllocateFrameData(size_t size) {
+	if (size > FRAME_DATA_MAX_SIZE) {
+		throw std::runtime_error("Frame data allocation is larger than FRAME_DATA_MAX_SIZE!");
+	}
+	if (!framePacer.InputLatched()) {
+		WaitForNextFrame();
+	}
+	if (frameDataUsed == frameData.size()) {
+		frameData.emplace_back();
+	}
+	std::vector<uint8_t>& bytes = frameData[frameDataUsed++];
+	bytes.resize(size);
+	renderStats.Current().bytesUploaded += size;
+
+	FrameDataAllocation allocation;
+	allocation.data = bytes.data();
+	allocation.handle = frameDataUsed;
+	return allocation;
+}
+
+void DummyDriver::SetViewMatrix(const glm::mat4& view) {
+	viewMatrix = view;
+}
+
+void DummyDriver::SetProjectionMatrix(const glm::mat4& projection) {
+	projectionMatrix = projection;
+}
+
+RenderStats& DummyDriver::GetRenderStats() {
+	return renderStats;
+}
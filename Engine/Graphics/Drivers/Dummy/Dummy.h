@@ -1,8 +1,16 @@
 #ifndef DUMMYDRIVER_H
 #define DUMMYDRIVER_H 
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include "../IGraphicsDriver.h"
+#include "../Vulkan/Vertex.h"
+#include "../../RenderQueue.h"
 
+// Null driver: runs the full CPU side of the engine (asset loading and
+// dedup, queue building, culling, sorting and stats) without touching a
+// GPU or needing a window, so engine CPU cost can be profiled in isolation.
 class DummyDriver : public IGraphicsDriver {
 	public: 
 		DummyDriver();
@@ -11,9 +19,73 @@ class DummyDriver : public IGraphicsDriver {
 		void Setup(GLFWwindow* window) override;
 		void Destruct() override;
 		void RenderFrame() override;
+		void WindowIsResized() override;
+		void SetFramebufferSize(uint32_t width, uint32_t height) override;
+		void SetupOffscreen(uint32_t width, uint32_t height) override;
+		void RequestFrameReadback(FrameReadbackCallback callback) override;
+
+		std::shared_ptr<Mesh> LoadMesh(const std::string& modelPath, MeshCreateFlags flags = 0) override;
+		std::shared_ptr<Texture> LoadTexture(const std::string& texturePath) override;
+		std::shared_ptr<Mesh> CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshCreateFlags flags = 0) override;
+		std::shared_ptr<Mesh> CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, MeshCreateFlags flags = 0) override;
+		std::shared_ptr<Mesh> CreateMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshCreateFlags flags = 0) override;
+		std::shared_ptr<Texture> CreateTexture(uint32_t width, uint32_t height, const void* pixelData) override;
+		TextureUpload BeginTextureUpload(uint32_t width, uint32_t height) override;
+		std::shared_ptr<Texture> CommitTextureUpload(const TextureUpload& upload) override;
+		void CancelTextureUpload(const TextureUpload& upload) override;
+		MeshUpload BeginMeshUpload(size_t vertexCount, size_t indexCount) override;
+		std::shared_ptr<Mesh> CommitMeshUpload(const MeshUpload& upload) override;
+		void CancelMeshUpload(const MeshUpload& upload) override;
+		std::shared_ptr<Mesh> CreateVoxelMesh(const VoxelVertex* vertices, size_t vertexCount) override;
+		bool SupportsGpuVoxelMeshing() override;
+		void MeshVoxelChunksOnGpu(const GpuVoxelMeshInput& input, std::vector<std::shared_ptr<Mesh>>& meshes) override;
+		void CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>>& meshes) override;
+		void ReleaseMesh(const std::shared_ptr<Mesh>& mesh) override;
+		void ReleaseTexture(const std::shared_ptr<Texture>& texture) override;
+		void PrecompilePipelines(const std::vector<PipelineFeatures>& featureSets) override;
+		void SubmitRenderObject(const RenderObject& renderObject) override;
+		void SubmitRenderPackets(const RenderPacket* packets, size_t count) override;
+		void ClearRenderQueue() override;
+		FrameDataAllocation AllocateFrameData(size_t size) override;
+		void SetViewMatrix(const glm::mat4& view) override;
+		void SetProjectionMatrix(const glm::mat4& projection) override;
+		void SetFramePacing(const FramePacing& pacing) override;
+		void WaitForNextFrame() override;
+		RenderStats& GetRenderStats() override;
 
 	private: 
-		GLFWwindow* window;
+		GLFWwindow* window = nullptr;
+
+		// Offscreen mode hands out blank frames of this size on readback
+		bool offscreen = false;
+		uint32_t offscreenWidth = 0;
+		uint32_t offscreenHeight = 0;
+		FrameReadbackCallback nextFrameReadback;
+		std::vector<uint8_t> readbackPixels;
+
+		std::unordered_set<std::shared_ptr<Mesh>> meshes;
+		std::unordered_set<std::shared_ptr<Texture>> textures;
+		// Staging memory for uploads that have begun but not been committed
+		std::unordered_map<uint64_t, std::vector<uint8_t>> pendingUploads;
+		std::unordered_map<uint64_t, std::pair<std::vector<Vertex>, std::vector<uint32_t>>> pendingMeshUploads;
+		uint64_t nextUploadId = 1;
+
+		RenderQueue renderQueue;
+		// Frame data, one buffer per allocation so pointers stay put; the
+		// buffers are reused from frame to frame
+		std::vector<std::vector<uint8_t>> frameData;
+		size_t frameDataUsed = 0;
+		glm::mat4 viewMatrix = glm::mat4(1.0f);
+		glm::mat4 projectionMatrix = glm::mat4(1.0f);
+
+		// There is no GPU queue, so only the frame cap and the latch to
+		// end-of-frame latency apply
+		FramePacer framePacer;
+		// Kept apart from the stats until RenderFrame, WaitForNextFrame may
+		// run next to resource calls on another thread
+		double waitPacingSleepMs = 0.0;
+
+		RenderStats renderStats;
 };
 
 #endif
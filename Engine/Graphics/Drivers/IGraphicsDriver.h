@@ -2,8 +2,13 @@
 #define IGRAPHICSDRIVER_H
 
 #include "GLFW/glfw3.h"
+#include "../RenderStats.h"
+#include "../FramePacer.h"
+#include "../PipelineFeatures.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,7 +17,75 @@
 class Mesh;
 class Texture;
 struct Vertex;
+struct VoxelVertex;
 struct RenderObject;
+struct RenderPacket;
+
+// CPU copy of a rendered frame, tightly packed RGBA8 rows.
+// The pixel pointer is only valid for the duration of the callback.
+struct FrameReadback {
+	uint64_t frameIndex;
+	uint32_t width;
+	uint32_t height;
+	const uint8_t* pixels;
+};
+
+using FrameReadbackCallback = std::function<void(const FrameReadback&)>;
+
+// Staging memory for a texture upload, tightly packed RGBA8 rows. Fill
+// pixels in place and pass the upload to CommitTextureUpload, or to
+// CancelTextureUpload to drop it; the pointer is not valid afterwards.
+struct TextureUpload {
+	uint64_t id = 0; // Driver-private
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint8_t* pixels = nullptr;
+
+	size_t Size() const { return static_cast<size_t>(width) * height * 4; }
+};
+
+// Mesh creation flags
+using MeshCreateFlags = uint32_t;
+// Frees the mesh's vertex and index vectors once they are on the GPU,
+// only counts and bounds stay in system memory
+const MeshCreateFlags MESH_CREATE_RELEASE_CPU_DATA = 1u << 0;
+
+// Staging memory for a mesh upload. Write the vertices and indices in
+// place and fill in the bounds (MeshBuilder does both), then pass it to
+// CommitMeshUpload, or to CancelMeshUpload to drop it; the pointers are
+// not valid afterwards.
+struct MeshUpload {
+	uint64_t id = 0; // Driver-private
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	Vertex* vertices = nullptr;
+	uint32_t* indices = nullptr;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Voxel chunks to mesh on the GPU, in their palette-packed form as laid
+// out by GpuVoxelBatch (Engine/Graphics/Voxel/GpuVoxelBatch.h). The arrays
+// only need to stay valid for the call.
+struct GpuVoxelMeshInput {
+	const uint32_t* slots = nullptr;   // 27 record offsets per chunk
+	const uint32_t* records = nullptr; // Palettes and packed indices
+	size_t recordWords = 0;
+	uint32_t chunkCount = 0;
+	uint32_t maxQuads = 0;             // Vertex space shared by the batch
+	bool ambientOcclusion = false;
+};
+
+// Largest single AllocateFrameData() allocation
+const size_t FRAME_DATA_MAX_SIZE = 64 * 1024;
+
+// Per-frame shader data, e.g. the instance transforms of a
+// PIPELINE_FEATURE_INSTANCED draw. Write it before submitting the objects
+// that reference it; it is gone once the next frame has rendered.
+struct FrameDataAllocation {
+	void* data = nullptr;
+	uint64_t handle = 0; // For RenderObject::frameData, 0 is none
+};
 
 class IGraphicsDriver {
 public: 
@@ -22,22 +95,106 @@ public:
 	virtual void Destruct() = 0;
 	virtual void RenderFrame() = 0;
 	virtual void WindowIsResized() = 0;
+	// Framebuffer size read on the window's thread. Once set, the driver sizes
+	// its swapchain from it instead of asking GLFW, so it can run elsewhere.
+	virtual void SetFramebufferSize(uint32_t width, uint32_t height) = 0;
+
+	// Offscreen API: render into driver-owned images without a window
+	virtual void SetupOffscreen(uint32_t width, uint32_t height) = 0;
+	// Copies the next rendered frame to CPU memory; the callback runs once
+	// the GPU has finished that frame, a few frames later
+	virtual void RequestFrameReadback(FrameReadbackCallback callback) = 0;
 	
 	// Resource loading API
-	virtual std::shared_ptr<Mesh> LoadMesh(const std::string& modelPath) = 0;
+	virtual std::shared_ptr<Mesh> LoadMesh(const std::string& modelPath, MeshCreateFlags flags = 0) = 0;
 	virtual std::shared_ptr<Texture> LoadTexture(const std::string& texturePath) = 0;
 	
 	// Programmatic resource creation API
-	virtual std::shared_ptr<Mesh> CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) = 0;
+	virtual std::shared_ptr<Mesh> CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshCreateFlags flags = 0) = 0;
+	// Moves the vectors into the mesh instead of copying them
+	virtual std::shared_ptr<Mesh> CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, MeshCreateFlags flags = 0) = 0;
+	// Copies straight to staging memory when the CPU copy is released
+	virtual std::shared_ptr<Mesh> CreateMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshCreateFlags flags = 0) = 0;
 	virtual std::shared_ptr<Texture> CreateTexture(uint32_t width, uint32_t height, const void* pixelData) = 0;
+
+	// Two-phase texture creation: reserves staging memory that generators and
+	// decoders write straight into, saving CreateTexture's copy. Every begun
+	// upload must be committed or cancelled, in any order.
+	virtual TextureUpload BeginTextureUpload(uint32_t width, uint32_t height) = 0;
+	virtual std::shared_ptr<Texture> CommitTextureUpload(const TextureUpload& upload) = 0;
+	// Gives the staging memory back without creating anything
+	virtual void CancelTextureUpload(const TextureUpload& upload) = 0;
+
+	// Two-phase mesh creation into staging memory, see MeshBuilder. The
+	// mesh never has a CPU copy.
+	virtual MeshUpload BeginMeshUpload(size_t vertexCount, size_t indexCount) = 0;
+	virtual std::shared_ptr<Mesh> CommitMeshUpload(const MeshUpload& upload) = 0;
+	virtual void CancelMeshUpload(const MeshUpload& upload) = 0;
+
+	// Voxel geometry in the packed 4 byte format, drawn with
+	// PIPELINE_FEATURE_VOXEL. Four vertices per quad, triangles (0, 1, 2)
+	// and (2, 3, 0) counter-clockwise; the driver shares one index buffer
+	// in that pattern between all voxel meshes, so they have none of their
+	// own. The mesh never has a CPU copy.
+	virtual std::shared_ptr<Mesh> CreateVoxelMesh(const VoxelVertex* vertices, size_t vertexCount) = 0;
+
+	// GPU voxel meshing: a compute pass meshes every chunk of the batch into
+	// one voxel mesh, appended to meshes in order, with the same vertices
+	// MeshVoxelChunkNaive() and AppendQuadPackedVertices() give. Face counts,
+	// vertices and draw arguments stay on the GPU, so the meshes draw
+	// indirectly and report no counts; their bounds are the whole chunk.
+	// The batch's chunks share maxQuads quads of scratch vertex memory
+	// while it runs; afterwards each mesh keeps only its own vertices. Chunks that
+	// don't fit draw nothing and are handed out by
+	// CollectGpuVoxelMeshOverflows() once the GPU has run the batch, so
+	// they can be meshed on the CPU instead. The first support query may
+	// build the meshing pipelines.
+	virtual bool SupportsGpuVoxelMeshing() = 0;
+	virtual void MeshVoxelChunksOnGpu(const GpuVoxelMeshInput& input, std::vector<std::shared_ptr<Mesh>>& meshes) = 0;
+	virtual void CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>>& meshes) = 0;
+
+	// Resource release API: the driver drops its reference right away and
+	// frees GPU memory once no frame in flight can use it anymore. Released
+	// resources must not be submitted again.
+	virtual void ReleaseMesh(const std::shared_ptr<Mesh>& mesh) = 0;
+	virtual void ReleaseTexture(const std::shared_ptr<Texture>& texture) = 0;
+
+	// Builds the pipeline variants for these feature combinations now, e.g.
+	// behind a loading screen. Variants first seen during a frame compile in
+	// the background and draw with the default pipeline until ready.
+	virtual void PrecompilePipelines(const std::vector<PipelineFeatures>& featureSets) = 0;
 	
 	// Render queue API
 	virtual void SubmitRenderObject(const RenderObject& renderObject) = 0;
+	// Batch path for large draw counts: the packets are copied into the
+	// queue's reusable frame storage without reference counting. Handles
+	// are only validated in debug builds, see RenderPacket.
+	virtual void SubmitRenderPackets(const RenderPacket* packets, size_t count) = 0;
 	virtual void ClearRenderQueue() = 0;
+	// Memory for the frame being built, read by the shaders through the
+	// frame data storage binding (set 2) of the objects that reference it.
+	// Waits for the next frame like WaitForNextFrame if that hasn't been
+	// called yet.
+	virtual FrameDataAllocation AllocateFrameData(size_t size) = 0;
 	
 	// Camera API
 	virtual void SetViewMatrix(const glm::mat4& view) = 0;
 	virtual void SetProjectionMatrix(const glm::mat4& projection) = 0;
+
+	// Frame pacing API
+	virtual void SetFramePacing(const FramePacing& pacing) = 0;
+	// Blocks until the driver can accept another frame (and holds the frame
+	// cap). Call it right before sampling input so the frame is built from
+	// the freshest state; RenderFrame waits by itself if it wasn't called.
+	// It only waits, so it may run on one thread while another makes
+	// resource calls; the frame's resources are recycled once the frame is
+	// recorded into.
+	virtual void WaitForNextFrame() = 0;
+
+	// Statistics API
+	// Only updated by the thread calling RenderFrame; ThreadedDriver hands
+	// out a copy that the game thread owns
+	virtual RenderStats& GetRenderStats() = 0;
 };
 
 #endif
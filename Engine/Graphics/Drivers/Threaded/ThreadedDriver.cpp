@@ -0,0 +1,468 @@
+#include "ThreadedDriver.h"
+#include "../Vulkan/Vertex.h"
+#include "../../AssetLoader.h"
+#include <cstring>
+#include <stdexcept>
+
+void ThreadedDriver::FramePacket::Clear() {
+  ops.clear();
+  objects.clear();
+  packets.clear();
+  matrices.clear();
+  meshReleases.clear();
+  textureReleases.clear();
+  readbacks.clear();
+  framebufferSizes.clear();
+  pacings.clear();
+  frameDataUsed = 0;
+  render        = false;
+}
+
+ThreadedDriver::ThreadedDriver(IGraphicsDriver *driver) : driver(driver) {}
+
+ThreadedDriver::~ThreadedDriver() {
+  StopRenderThread();
+}
+
+void ThreadedDriver::Setup(GLFWwindow *window) {
+  this->window = window;
+  int width = 0, height = 0;
+  glfwGetFramebufferSize(window, &width, &height);
+  driver->SetFramebufferSize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+  driver->Setup(window);
+  StartRenderThread();
+}
+
+void ThreadedDriver::SetupOffscreen(uint32_t width, uint32_t height) {
+  driver->SetupOffscreen(width, height);
+  StartRenderThread();
+}
+
+void ThreadedDriver::Destruct() {
+  Drain();
+  StopRenderThread();
+  driver->Destruct();
+}
+
+// A minimized window has nothing to present to. The wait happens here
+// because glfwWaitEvents must be called on the main thread; the resize
+// callbacks it runs record the restored size into this frame.
+void ThreadedDriver::RenderFrame() {
+  if (window) {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    while (width == 0 || height == 0) {
+      glfwWaitEvents();
+      glfwGetFramebufferSize(window, &width, &height);
+    }
+  }
+  Publish(true);
+}
+
+// Called from GLFW's resize callback, so the size is read right here
+void ThreadedDriver::WindowIsResized() {
+  if (window) {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    SetFramebufferSize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+  }
+  Record(FrameOp::Type::WindowResized, 0, 0);
+}
+
+void ThreadedDriver::SetFramebufferSize(uint32_t width, uint32_t height) {
+  FramePacket &frame = Recording();
+  frame.framebufferSizes.push_back(glm::uvec2(width, height));
+  Record(FrameOp::Type::FramebufferSize,
+         static_cast<uint32_t>(frame.framebufferSizes.size() - 1));
+}
+
+void ThreadedDriver::RequestFrameReadback(FrameReadbackCallback callback) {
+  FramePacket &frame = Recording();
+  frame.readbacks.push_back(std::move(callback));
+  Record(FrameOp::Type::Readback, static_cast<uint32_t>(frame.readbacks.size() - 1));
+}
+
+// Decoded on the calling thread, only the upload itself waits for the
+// render thread
+std::shared_ptr<Mesh> ThreadedDriver::LoadMesh(const std::string &modelPath,
+                                               MeshCreateFlags    flags) {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  LoadObjGeometry(modelPath, vertices, indices);
+  return CreateMesh(std::move(vertices), std::move(indices), flags);
+}
+
+std::shared_ptr<Texture> ThreadedDriver::LoadTexture(const std::string &texturePath) {
+  TextureUpload upload;
+  LoadImagePixels(texturePath, [this, &upload](uint32_t width, uint32_t height) {
+    upload = BeginTextureUpload(width, height);
+    return upload.pixels;
+  });
+  return CommitTextureUpload(upload);
+}
+
+std::shared_ptr<Mesh> ThreadedDriver::CreateMesh(const std::vector<Vertex>   &vertices,
+                                                 const std::vector<uint32_t> &indices,
+                                                 MeshCreateFlags              flags) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CreateMesh(vertices, indices, flags);
+}
+
+std::shared_ptr<Mesh> ThreadedDriver::CreateMesh(std::vector<Vertex>   &&vertices,
+                                                 std::vector<uint32_t> &&indices,
+                                                 MeshCreateFlags         flags) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CreateMesh(std::move(vertices), std::move(indices), flags);
+}
+
+std::shared_ptr<Mesh> ThreadedDriver::CreateMesh(const Vertex *vertices, size_t vertexCount,
+                                                 const uint32_t *indices, size_t indexCount,
+                                                 MeshCreateFlags flags) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CreateMesh(vertices, vertexCount, indices, indexCount, flags);
+}
+
+std::shared_ptr<Texture> ThreadedDriver::CreateTexture(uint32_t width, uint32_t height,
+                                                       const void *pixelData) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CreateTexture(width, height, pixelData);
+}
+
+// The staging memory is written between Begin and Commit without the
+// lock, the render thread never touches reserved space
+TextureUpload ThreadedDriver::BeginTextureUpload(uint32_t width, uint32_t height) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->BeginTextureUpload(width, height);
+}
+
+std::shared_ptr<Texture> ThreadedDriver::CommitTextureUpload(const TextureUpload &upload) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CommitTextureUpload(upload);
+}
+
+void ThreadedDriver::CancelTextureUpload(const TextureUpload &upload) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  driver->CancelTextureUpload(upload);
+}
+
+MeshUpload ThreadedDriver::BeginMeshUpload(size_t vertexCount, size_t indexCount) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->BeginMeshUpload(vertexCount, indexCount);
+}
+
+std::shared_ptr<Mesh> ThreadedDriver::CommitMeshUpload(const MeshUpload &upload) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CommitMeshUpload(upload);
+}
+
+void ThreadedDriver::CancelMeshUpload(const MeshUpload &upload) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  driver->CancelMeshUpload(upload);
+}
+
+std::shared_ptr<Mesh> ThreadedDriver::CreateVoxelMesh(const VoxelVertex *vertices, size_t vertexCount) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->CreateVoxelMesh(vertices, vertexCount);
+}
+
+bool ThreadedDriver::SupportsGpuVoxelMeshing() {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  return driver->SupportsGpuVoxelMeshing();
+}
+
+void ThreadedDriver::MeshVoxelChunksOnGpu(const GpuVoxelMeshInput &input,
+                                          std::vector<std::shared_ptr<Mesh>> &meshes) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  driver->MeshVoxelChunksOnGpu(input, meshes);
+}
+
+void ThreadedDriver::CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>> &meshes) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  driver->CollectGpuVoxelMeshOverflows(meshes);
+}
+
+// Replayed after the submissions recorded before it, the packet keeps the
+// resource alive until then
+void ThreadedDriver::ReleaseMesh(const std::shared_ptr<Mesh> &mesh) {
+  FramePacket &frame = Recording();
+  frame.meshReleases.push_back(mesh);
+  Record(FrameOp::Type::ReleaseMesh, static_cast<uint32_t>(frame.meshReleases.size() - 1));
+}
+
+void ThreadedDriver::ReleaseTexture(const std::shared_ptr<Texture> &texture) {
+  FramePacket &frame = Recording();
+  frame.textureReleases.push_back(texture);
+  Record(FrameOp::Type::ReleaseTexture, static_cast<uint32_t>(frame.textureReleases.size() - 1));
+}
+
+void ThreadedDriver::PrecompilePipelines(const std::vector<PipelineFeatures> &featureSets) {
+  std::lock_guard<std::mutex> lock(driverMutex);
+  driver->PrecompilePipelines(featureSets);
+}
+
+void ThreadedDriver::SubmitRenderObject(const RenderObject &renderObject) {
+  FramePacket &frame = Recording();
+  frame.objects.push_back(renderObject);
+  Record(FrameOp::Type::SubmitObjects, static_cast<uint32_t>(frame.objects.size() - 1));
+}
+
+void ThreadedDriver::SubmitRenderPackets(const RenderPacket *packets, size_t count) {
+  FramePacket &frame = Recording();
+  uint32_t     first = static_cast<uint32_t>(frame.packets.size());
+  frame.packets.insert(frame.packets.end(), packets, packets + count);
+  Record(FrameOp::Type::SubmitPackets, first, static_cast<uint32_t>(count));
+}
+
+void ThreadedDriver::ClearRenderQueue() {
+  Record(FrameOp::Type::ClearQueue, 0, 0);
+}
+
+FrameDataAllocation ThreadedDriver::AllocateFrameData(size_t size) {
+  if (size > FRAME_DATA_MAX_SIZE) {
+    throw std::runtime_error("Frame data allocation is larger than FRAME_DATA_MAX_SIZE!");
+  }
+  FramePacket &frame = Recording();
+  if (frame.frameDataUsed == frame.frameData.size()) { frame.frameData.emplace_back(); }
+  std::vector<uint8_t> &bytes = frame.frameData[frame.frameDataUsed++];
+  bytes.resize(size);
+
+  FrameDataAllocation allocation;
+  allocation.data   = bytes.data();
+  allocation.handle = frame.frameDataUsed;
+  return allocation;
+}
+
+void ThreadedDriver::SetViewMatrix(const glm::mat4 &view) {
+  FramePacket &frame = Recording();
+  frame.matrices.push_back(view);
+  Record(FrameOp::Type::SetView, static_cast<uint32_t>(frame.matrices.size() - 1));
+}
+
+void ThreadedDriver::SetProjectionMatrix(const glm::mat4 &projection) {
+  FramePacket &frame = Recording();
+  frame.matrices.push_back(projection);
+  Record(FrameOp::Type::SetProjection, static_cast<uint32_t>(frame.matrices.size() - 1));
+}
+
+// Applied on the render thread between frames, it owns the pacer and the
+// frame slots
+void ThreadedDriver::SetFramePacing(const FramePacing &pacing) {
+  FramePacket &frame = Recording();
+  frame.pacings.push_back(pacing);
+  Record(FrameOp::Type::SetFramePacing, static_cast<uint32_t>(frame.pacings.size() - 1));
+}
+
+// Waits for a free frame packet, which is when the render thread has
+// started on the previous frame. The wrapped driver's own frame slot wait
+// happens on the render thread before it replays the frame.
+void ThreadedDriver::WaitForNextFrame() {
+  Recording();
+}
+
+// The wrapped driver's stats belong to the render thread, so this returns
+// a copy: every frame handed over so far, plus the frame in progress (the
+// staging counters of resource calls) copied under the lock
+RenderStats &ThreadedDriver::GetRenderStats() {
+  Drain();
+  CollectRenderedFrames();
+  std::lock_guard<std::mutex> lock(driverMutex);
+  stats.Current() = driver->GetRenderStats().Current();
+  return stats;
+}
+
+ThreadedDriver::FramePacket &ThreadedDriver::Recording() {
+  uint64_t published = publishedFrames.load(std::memory_order_relaxed);
+  if (!recording) {
+    if (published - consumedFrames.load(std::memory_order_acquire) >= FRAME_PACKETS) {
+      std::unique_lock<std::mutex> lock(parkMutex);
+      parked.wait(lock, [&]() {
+        return published - consumedFrames.load(std::memory_order_acquire) < FRAME_PACKETS;
+      });
+    }
+    RethrowRenderError();
+    recording = true;
+  }
+  return frames[published % FRAME_PACKETS];
+}
+
+void ThreadedDriver::Record(FrameOp::Type type, uint32_t first, uint32_t count) {
+  FramePacket &frame = Recording();
+  bool         isSubmit = type == FrameOp::Type::SubmitObjects ||
+                  type == FrameOp::Type::SubmitPackets;
+  if (isSubmit && !frame.ops.empty()) {
+    FrameOp &last = frame.ops.back();
+    if (last.type == type && last.first + last.count == first) {
+      last.count += count;
+      return;
+    }
+  }
+  frame.ops.push_back(FrameOp{type, first, count});
+}
+
+void ThreadedDriver::Publish(bool render) {
+  FramePacket &frame = Recording();
+  frame.render       = render;
+  recording          = false;
+  if (!renderThread.joinable()) {
+    // Not set up yet, run it here
+    std::lock_guard<std::mutex> lock(driverMutex);
+    Replay(frame);
+    if (render) { stats.AddFrame(driver->GetRenderStats().LastFrame()); }
+    frame.Clear();
+    return;
+  }
+  publishedFrames.store(publishedFrames.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+  Notify();
+  CollectRenderedFrames();
+}
+
+// Hands over whatever was recorded and waits for the render thread to
+// finish everything it was given
+void ThreadedDriver::Drain() {
+  if (recording && !Recording().ops.empty()) {
+    Publish(false);
+  }
+  uint64_t published = publishedFrames.load(std::memory_order_relaxed);
+  if (consumedFrames.load(std::memory_order_acquire) != published) {
+    std::unique_lock<std::mutex> lock(parkMutex);
+    parked.wait(lock, [&]() {
+      return consumedFrames.load(std::memory_order_acquire) == published;
+    });
+  }
+  RethrowRenderError();
+}
+
+// Runs on the game thread, so stats dumps are written from there too
+void ThreadedDriver::CollectRenderedFrames() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  for (const FrameStats &frame : renderedFrames) {
+    stats.AddFrame(frame);
+  }
+  renderedFrames.clear();
+}
+
+void ThreadedDriver::StartRenderThread() {
+  if (renderThread.joinable()) { return; }
+  stopping.store(false);
+  renderThread = std::thread(&ThreadedDriver::RenderLoop, this);
+}
+
+// Frames already handed over are still rendered
+void ThreadedDriver::StopRenderThread() {
+  if (!renderThread.joinable()) { return; }
+  stopping.store(true);
+  Notify();
+  renderThread.join();
+}
+
+void ThreadedDriver::RenderLoop() {
+  while (true) {
+    uint64_t next = consumedFrames.load(std::memory_order_relaxed);
+    if (publishedFrames.load(std::memory_order_acquire) == next) {
+      std::unique_lock<std::mutex> lock(parkMutex);
+      parked.wait(lock, [&]() {
+        return publishedFrames.load(std::memory_order_acquire) != next || stopping.load();
+      });
+      if (publishedFrames.load(std::memory_order_acquire) == next) { return; }
+    }
+
+    FramePacket &frame = frames[next % FRAME_PACKETS];
+    try {
+      // Pacing sleeps and fence waits don't hold up resource calls
+      if (frame.render) { driver->WaitForNextFrame(); }
+      std::lock_guard<std::mutex> lock(driverMutex);
+      Replay(frame);
+      if (frame.render) {
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        renderedFrames.push_back(driver->GetRenderStats().LastFrame());
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(parkMutex);
+      if (!renderError) { renderError = std::current_exception(); }
+    }
+    frame.Clear();
+    consumedFrames.store(next + 1, std::memory_order_release);
+    Notify();
+  }
+}
+
+void ThreadedDriver::Replay(FramePacket &frame) {
+  frame.replayedFrameData.assign(frame.frameDataUsed, 0);
+  for (const FrameOp &op : frame.ops) {
+    switch (op.type) {
+      case FrameOp::Type::SubmitObjects:
+        for (uint32_t i = op.first; i < op.first + op.count; i++) {
+          RenderObject &object = frame.objects[i];
+          if (object.frameData != 0) {
+            object.frameData = ReplayFrameData(frame, object.frameData);
+          }
+          driver->SubmitRenderObject(object);
+        }
+        break;
+      case FrameOp::Type::SubmitPackets:
+        driver->SubmitRenderPackets(frame.packets.data() + op.first, op.count);
+        break;
+      case FrameOp::Type::ClearQueue:
+        driver->ClearRenderQueue();
+        break;
+      case FrameOp::Type::SetView:
+        driver->SetViewMatrix(frame.matrices[op.first]);
+        break;
+      case FrameOp::Type::SetProjection:
+        driver->SetProjectionMatrix(frame.matrices[op.first]);
+        break;
+      case FrameOp::Type::ReleaseMesh:
+        driver->ReleaseMesh(frame.meshReleases[op.first]);
+        break;
+      case FrameOp::Type::ReleaseTexture:
+        driver->ReleaseTexture(frame.textureReleases[op.first]);
+        break;
+      case FrameOp::Type::Readback:
+        driver->RequestFrameReadback(std::move(frame.readbacks[op.first]));
+        break;
+      case FrameOp::Type::WindowResized:
+        driver->WindowIsResized();
+        break;
+      case FrameOp::Type::FramebufferSize:
+        driver->SetFramebufferSize(frame.framebufferSizes[op.first].x,
+                                   frame.framebufferSizes[op.first].y);
+        break;
+      case FrameOp::Type::SetFramePacing:
+        driver->SetFramePacing(frame.pacings[op.first]);
+        break;
+    }
+  }
+  if (frame.render) { driver->RenderFrame(); }
+}
+
+// Copied once per allocation, however many objects share it
+uint64_t ThreadedDriver::ReplayFrameData(FramePacket &frame, uint64_t handle) {
+  if (handle > frame.frameDataUsed) {
+    throw std::runtime_error("Frame data was not allocated for this frame");
+  }
+  uint64_t &replayed = frame.replayedFrameData[handle - 1];
+  if (replayed == 0) {
+    const std::vector<uint8_t> &bytes      = frame.frameData[handle - 1];
+    FrameDataAllocation         allocation = driver->AllocateFrameData(bytes.size());
+    memcpy(allocation.data, bytes.data(), bytes.size());
+    replayed = allocation.handle;
+  }
+  return replayed;
+}
+
+// Taking the lock orders the counter update before a parked thread's
+// predicate check, so the wakeup can't be missed
+void ThreadedDriver::Notify() {
+  { std::lock_guard<std::mutex> lock(parkMutex); }
+  parked.notify_all();
+}
+
+void ThreadedDriver::RethrowRenderError() {
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(parkMutex);
+    std::swap(error, renderError);
+  }
+  if (error) { std::rethrow_exception(error); }
+}
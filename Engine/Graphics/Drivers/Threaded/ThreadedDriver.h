@@ -0,0 +1,171 @@
+#ifndef THREADEDDRIVER_H
+#define THREADEDDRIVER_H
+
+#include "../IGraphicsDriver.h"
+#include "../Vulkan/RenderObject.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decorator that runs another driver on a dedicated render thread. The
+// game thread records the queue, camera and releases for frame N+1 into
+// one of two frame packets while the render thread replays frame N into
+// the wrapped driver, records and submits it. Packets change hands through
+// two atomic frame counters; the mutex and condition variable only park a
+// thread that has nothing to do.
+//
+// Resource creation runs on the calling thread, serialized with the render
+// thread's use of the wrapped driver, so it can wait for up to one frame.
+// Decoding (LoadMesh, LoadTexture) and filling upload memory happen outside
+// that lock. Releases are replayed in order with the frame's submissions,
+// and frame data is kept in the packet and copied into the wrapped
+// driver's frame data when the objects using it are replayed.
+// Readback callbacks run on the render thread.
+//
+// The render thread waits for the wrapped driver's next frame slot (frame
+// cap, fences) before it takes the lock, and holds it while it replays,
+// records and submits the frame. Present stays inside: it goes to the
+// graphics queue that upload submissions use too. Frame pacing changes
+// travel in the frame packet so only the render thread touches the pacer.
+// GetRenderStats returns the game thread's own copy of the stats, which
+// picks up the frames the render thread finished.
+//
+// GLFW window calls stay on the game thread: the framebuffer size travels
+// in the frame packet and RenderFrame waits out a minimized window.
+class ThreadedDriver : public IGraphicsDriver {
+  public:
+    explicit ThreadedDriver(IGraphicsDriver *driver);
+    ~ThreadedDriver();
+
+    void Setup(GLFWwindow *window) override;
+    void Destruct() override;
+    void RenderFrame() override;
+    void WindowIsResized() override;
+    void SetFramebufferSize(uint32_t width, uint32_t height) override;
+    void SetupOffscreen(uint32_t width, uint32_t height) override;
+    void RequestFrameReadback(FrameReadbackCallback callback) override;
+
+    std::shared_ptr<Mesh>    LoadMesh(const std::string &modelPath, MeshCreateFlags flags = 0) override;
+    std::shared_ptr<Texture> LoadTexture(const std::string &texturePath) override;
+    std::shared_ptr<Mesh>    CreateMesh(const std::vector<Vertex>   &vertices,
+                                        const std::vector<uint32_t> &indices,
+                                        MeshCreateFlags              flags = 0) override;
+    std::shared_ptr<Mesh>    CreateMesh(std::vector<Vertex>   &&vertices,
+                                        std::vector<uint32_t> &&indices,
+                                        MeshCreateFlags         flags = 0) override;
+    std::shared_ptr<Mesh>    CreateMesh(const Vertex *vertices, size_t vertexCount,
+                                        const uint32_t *indices, size_t indexCount,
+                                        MeshCreateFlags flags = 0) override;
+    std::shared_ptr<Texture> CreateTexture(uint32_t width, uint32_t height,
+                                           const void *pixelData) override;
+    TextureUpload            BeginTextureUpload(uint32_t width, uint32_t height) override;
+    std::shared_ptr<Texture> CommitTextureUpload(const TextureUpload &upload) override;
+    void                     CancelTextureUpload(const TextureUpload &upload) override;
+    MeshUpload               BeginMeshUpload(size_t vertexCount, size_t indexCount) override;
+    std::shared_ptr<Mesh>    CommitMeshUpload(const MeshUpload &upload) override;
+    void                     CancelMeshUpload(const MeshUpload &upload) override;
+    std::shared_ptr<Mesh>    CreateVoxelMesh(const VoxelVertex *vertices, size_t vertexCount) override;
+    bool                     SupportsGpuVoxelMeshing() override;
+    void MeshVoxelChunksOnGpu(const GpuVoxelMeshInput &input, std::vector<std::shared_ptr<Mesh>> &meshes) override;
+    void CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>> &meshes) override;
+    void                     ReleaseMesh(const std::shared_ptr<Mesh> &mesh) override;
+    void                     ReleaseTexture(const std::shared_ptr<Texture> &texture) override;
+    void                     PrecompilePipelines(const std::vector<PipelineFeatures> &featureSets) override;
+    void                     SubmitRenderObject(const RenderObject &renderObject) override;
+    void                     SubmitRenderPackets(const RenderPacket *packets, size_t count) override;
+    void                     ClearRenderQueue() override;
+    FrameDataAllocation      AllocateFrameData(size_t size) override;
+    void                     SetViewMatrix(const glm::mat4 &view) override;
+    void                     SetProjectionMatrix(const glm::mat4 &projection) override;
+    void                     SetFramePacing(const FramePacing &pacing) override;
+    void                     WaitForNextFrame() override;
+    RenderStats             &GetRenderStats() override;
+
+  private:
+    // One recorded call; submissions of the same kind that follow each
+    // other share an op
+    struct FrameOp {
+        enum class Type : uint8_t {
+          SubmitObjects,
+          SubmitPackets,
+          ClearQueue,
+          SetView,
+          SetProjection,
+          ReleaseMesh,
+          ReleaseTexture,
+          Readback,
+          WindowResized,
+          FramebufferSize,
+          SetFramePacing,
+        };
+        Type     type;
+        uint32_t first; // Index into the packet's array for this type
+        uint32_t count;
+    };
+
+    // Everything the game thread recorded for one frame. The vectors keep
+    // their capacity from frame to frame.
+    struct FramePacket {
+        std::vector<FrameOp>                  ops;
+        std::vector<RenderObject>             objects;
+        std::vector<RenderPacket>             packets;
+        std::vector<glm::mat4>                matrices;
+        std::vector<std::shared_ptr<Mesh>>    meshReleases;
+        std::vector<std::shared_ptr<Texture>> textureReleases;
+        std::vector<FrameReadbackCallback>    readbacks;
+        std::vector<glm::uvec2>               framebufferSizes;
+        std::vector<FramePacing>              pacings;
+        // One buffer per AllocateFrameData so pointers stay put, handles
+        // are the index plus one
+        std::vector<std::vector<uint8_t>>     frameData;
+        size_t                                frameDataUsed = 0;
+        std::vector<uint64_t>                 replayedFrameData; // The wrapped driver's handles
+        bool                                  render = false; // Ends with RenderFrame
+
+        void Clear();
+    };
+
+    static const uint32_t FRAME_PACKETS = 2;
+
+    IGraphicsDriver *driver;
+    GLFWwindow      *window = nullptr; // Only touched on the game thread
+    // Held by the render thread while it uses the wrapped driver and by
+    // resource calls on the game thread
+    std::mutex driverMutex;
+
+    FramePacket           frames[FRAME_PACKETS];
+    std::atomic<uint64_t> publishedFrames{0}; // Written by the game thread
+    std::atomic<uint64_t> consumedFrames{0};  // Written by the render thread
+    bool                  recording = false;  // The game thread owns the next packet
+
+    std::thread             renderThread;
+    std::atomic<bool>       stopping{false};
+    std::mutex              parkMutex;
+    std::condition_variable parked;
+    std::exception_ptr      renderError; // Rethrown on the game thread
+
+    // Stats the render thread finished, until the game thread adds them to
+    // its copy
+    RenderStats             stats;
+    std::mutex              statsMutex;
+    std::vector<FrameStats> renderedFrames;
+
+    FramePacket &Recording();
+    void         Record(FrameOp::Type type, uint32_t first, uint32_t count = 1);
+    void         Publish(bool render);
+    void         Drain();
+    void         CollectRenderedFrames();
+    void         StartRenderThread();
+    void         StopRenderThread();
+    void         RenderLoop();
+    void         Replay(FramePacket &frame);
+    uint64_t     ReplayFrameData(FramePacket &frame, uint64_t handle);
+    void         Notify();
+    void         RethrowRenderError();
+};
+
+#endif // THREADEDDRIVER_H
@@ -1,4 +1,5 @@
 #include "Vulkan.h"
+#include <cstring>
 #include <ios>
 #include <vulkan/vulkan_core.h>
 
@@ -42,8 +43,11 @@ void VulkanDriver::RecordCommandBuffer(VkCommandBuffer commandBuffer,
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
                        VK_SUBPASS_CONTENTS_INLINE);
 
+  FrameStats &stats = renderStats.Current();
+
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                     graphicsPipeline);
+  stats.pipelineBinds++;
 
   VkViewport viewport{};
   viewport.x        = 0.0f;
@@ -62,40 +66,127 @@ void VulkanDriver::RecordCommandBuffer(VkCommandBuffer commandBuffer,
   // Bind global descriptor set (view/projection matrices)
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
                          pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+  stats.descriptorSetBinds++;
+
+  // Render all visible objects, the queue is sorted so binds are only
+  // issued when the mesh or texture changes. Released resources never
+  // reach this point, the queue forgets them on release.
+  renderQueue.Prepare(projectionMatrix * viewMatrix);
+  PipelineFeatures  boundFeatures = 0;
+  VkPipeline        boundPipeline = graphicsPipeline;
+  const Mesh*       boundMesh     = nullptr;
+  const Texture*    boundTexture  = nullptr;
+  const VulkanMesh* vulkanMesh    = nullptr;
+  bool              objectDataBound = false;
+  RenderMaterial    boundMaterial;
+  bool              frameDataBound  = false;
+  uint64_t          boundFrameData  = 0;
+  const std::vector<FrameDataBlock>& frameBlocks = frameDataBlocks[currentFrame];
+  for (uint32_t index : renderQueue.Visible()) {
+    const RenderPacket&   packet   = renderQueue.Packet(index);
+    const RenderMaterial& material = renderQueue.Material(index);
 
-  // Render all objects in the queue
-  for (const auto& renderObject : renderQueue) {
-    // Get Vulkan resources
-    auto& vulkanMesh = meshResources[renderObject.mesh];
-    auto& vulkanTexture = textureResources[renderObject.texture];
+    // Variants share the pipeline layout, so bound descriptor sets stay
+    // valid; a variant that is still compiling draws with the default one
+    // for its vertex format
+    if (packet.pipelineFeatures != boundFeatures) {
+      VkPipeline fallback = (packet.pipelineFeatures & PIPELINE_FEATURE_VOXEL) ? voxelPipeline
+                                                                               : graphicsPipeline;
+      VkPipeline pipeline = pipelineCache.GetOrQueue(
+        PipelineStateFor(packet.pipelineFeatures), fallback);
+      if (pipeline != boundPipeline) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        stats.pipelineBinds++;
+        boundPipeline = pipeline;
+      }
+      boundFeatures = packet.pipelineFeatures;
+    }
     
-    // Bind vertex and index buffers
-    VkBuffer vertexBuffers[] = {vulkanMesh.vertexBuffer};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, vulkanMesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    // Bind vertex and index buffers, the resource lookup only happens when
+    // the mesh changes
+    if (packet.mesh != boundMesh) {
+      auto meshIt = meshResources.find(LookupKey(packet.mesh));
+      // GPU-meshed chunks without faces end up with no buffers
+      if (meshIt == meshResources.end() || meshIt->second.vertexBuffer == VK_NULL_HANDLE) {
+        continue;
+      }
+      vulkanMesh = &meshIt->second;
+      VkBuffer vertexBuffers[] = {vulkanMesh->vertexBuffer};
+      VkDeviceSize offsets[] = {0};
+      vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+      // Voxel meshes draw through the shared quad indices
+      VkBuffer indexBuffer = vulkanMesh->indexBuffer != VK_NULL_HANDLE ? vulkanMesh->indexBuffer
+                                                                       : quadIndexBuffer;
+      vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+      stats.vertexBufferBinds++;
+      boundMesh = packet.mesh;
+    }
     
     // Push model matrix as push constant
     vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 
-                       0, sizeof(glm::mat4), &renderObject.modelMatrix);
+                       0, sizeof(glm::mat4), &packet.modelMatrix);
     
     // Bind per-texture descriptor set
-    auto it = textureDescriptorSets.find(renderObject.texture);
-    if (it != textureDescriptorSets.end()) {
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
-                               pipelineLayout, 0, 1, &it->second[currentFrame], 0, nullptr);
-    } else {
-        // Fallback to default descriptor set if texture doesn't have one
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
-                               pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+    if (packet.texture != boundTexture) {
+      auto it = textureDescriptorSets.find(LookupKey(packet.texture));
+      if (it != textureDescriptorSets.end()) {
+          vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
+                                 pipelineLayout, 0, 1, &it->second[currentFrame], 0, nullptr);
+      } else {
+          // Fallback to default descriptor set if texture doesn't have one
+          vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
+                                 pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+      }
+      stats.descriptorSetBinds++;
+      boundTexture = packet.texture;
+    }
+    
+    // Per-object data comes from the frame allocator, consecutive objects
+    // with the same parameters share one allocation
+    if (!objectDataBound || !material.SameUniforms(boundMaterial)) {
+      FrameAllocation allocation = AllocateFrameMemory(sizeof(ObjectUniforms));
+      ObjectUniforms  uniforms{material.color, material.uvTransform};
+      memcpy(allocation.data, &uniforms, sizeof(uniforms));
+
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              pipelineLayout, 1, 1, &frameBlocks[allocation.block].objectSet,
+                              1, &allocation.offset);
+      stats.descriptorSetBinds++;
+      objectDataBound = true;
+      boundMaterial   = material;
+    }
+
+    // Frame data the caller wrote through AllocateFrameData; draws without
+    // any bind the start of the first block so set 2 is always valid
+    if (!frameDataBound || material.frameData != boundFrameData) {
+      uint32_t block  = material.frameData ? static_cast<uint32_t>(material.frameData >> 32) - 1 : 0;
+      uint32_t offset = static_cast<uint32_t>(material.frameData);
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              pipelineLayout, 2, 1, &frameBlocks[block].storageSet, 1, &offset);
+      stats.descriptorSetBinds++;
+      frameDataBound = true;
+      boundFrameData = material.frameData;
     }
     
-    // Draw
-    vkCmdDrawIndexed(commandBuffer, vulkanMesh.indexCount, 1, 0, 0, 0);
+    // Draw; GPU-meshed chunks take their counts from the compute pass
+    if (vulkanMesh->voxelBatch) {
+      vkCmdDrawIndexedIndirect(commandBuffer, vulkanMesh->voxelBatch->drawBuffer, vulkanMesh->drawOffset, 1,
+                               sizeof(VkDrawIndexedIndirectCommand));
+      stats.drawCalls++;
+      continue;
+    }
+    uint32_t instances = (packet.pipelineFeatures & PIPELINE_FEATURE_INSTANCED) ? material.instanceCount : 1;
+    vkCmdDrawIndexed(commandBuffer, vulkanMesh->indexCount, instances, 0, 0, 0);
+    stats.drawCalls++;
+    stats.trianglesSubmitted += vulkanMesh->indexCount / 3 * instances;
   }
 
   vkCmdEndRenderPass(commandBuffer);
 
+  if (offscreen && offscreenReadbacks[currentFrame].callback) {
+    RecordReadbackCopy(commandBuffer, imageIndex);
+  }
+
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to record command buffer!");
   }
@@ -0,0 +1,18 @@
+#include "Vulkan.h"
+
+void VulkanDriver::DeferDestruction(std::function<void()> destroy) {
+  // Every piece of work submitted so far may still reference the resource
+  deferredDestructions.push_back({submittedWorkValue, std::move(destroy)});
+}
+
+void VulkanDriver::CollectDeferredDestructions(bool waitedIdle) {
+  if (waitedIdle) {
+    completedWorkValue = submittedWorkValue;
+  }
+
+  while (!deferredDestructions.empty() &&
+         IsGpuWorkComplete(deferredDestructions.front().retiredAfterWork)) {
+    deferredDestructions.front().destroy();
+    deferredDestructions.pop_front();
+  }
+}
@@ -4,16 +4,44 @@
 #include <vulkan/vulkan_core.h>
 
 void VulkanDriver::CreateDepthResources() {
+  // A larger depth attachment is valid for a smaller framebuffer, so a
+  // resize only reallocates when the new extent grows past the old one
+  if (depthImage != VK_NULL_HANDLE &&
+      swapChainExtent.width <= depthImageExtent.width &&
+      swapChainExtent.height <= depthImageExtent.height) {
+    return;
+  }
+
+  if (depthImage != VK_NULL_HANDLE) {
+    VkImage        oldImage  = depthImage;
+    VkDeviceMemory oldMemory = depthImageMemory;
+    VkImageView    oldView   = depthImageView;
+    DeferDestruction([this, oldImage, oldMemory, oldView]() {
+      vkDestroyImageView(device, oldView, nullptr);
+      vkDestroyImage(device, oldImage, nullptr);
+      vkFreeMemory(device, oldMemory, nullptr);
+    });
+  }
+
+  auto roundUp = [](uint32_t value) {
+    return (value + DEPTH_EXTENT_GRANULARITY - 1) / DEPTH_EXTENT_GRANULARITY *
+           DEPTH_EXTENT_GRANULARITY;
+  };
+  // Offscreen targets never resize, so they get an exact fit
+  depthImageExtent = offscreen ? swapChainExtent
+                               : VkExtent2D{roundUp(swapChainExtent.width),
+                                            roundUp(swapChainExtent.height)};
+
   VkFormat depthFormat = FindDepthFormat();
   CreateImage(
-    swapChainExtent.width, swapChainExtent.height, depthFormat,
+    depthImageExtent.width, depthImageExtent.height, depthFormat,
     VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
 
 	depthImageView = CreateImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
-	TransitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-
+	// No explicit transition: the render pass takes the depth attachment from
+	// UNDEFINED every frame, and a one-time transition would stall the queue
 }
 
 VkFormat
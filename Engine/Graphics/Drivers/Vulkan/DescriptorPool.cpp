@@ -3,19 +3,26 @@
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
+// Each texture needs a set per frame in flight
+static const uint32_t MAX_TEXTURES = 100;
+// Per frame in flight: the global set and one per texture, every one with a
+// UBO binding
+static const uint32_t DESCRIPTOR_SETS_PER_FRAME = MAX_TEXTURES + 1;
+
 void VulkanDriver::CreateDescriptorPool() {
   std::array<VkDescriptorPoolSize, 2> poolSizes;
   poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-  // Allow for many textures (each texture needs MAX_FRAMES_IN_FLIGHT descriptor sets)
+  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * DESCRIPTOR_SETS_PER_FRAME);
   poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 100);  // Support up to 100 textures
+  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * MAX_TEXTURES);
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  // Released textures hand their sets back individually
+  poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   poolInfo.pPoolSizes    = poolSizes.data();
-  poolInfo.maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 101);  // UBO sets + texture sets
+  poolInfo.maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * DESCRIPTOR_SETS_PER_FRAME);
 
   if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) !=
       VK_SUCCESS) {
@@ -37,6 +44,7 @@ void VulkanDriver::CreateDescriptorSets() {
       VK_SUCCESS) {
     throw std::runtime_error("Failed to allocate Descriptor sets!");
   }
+  renderStats.Current().descriptorSetsAllocated += MAX_FRAMES_IN_FLIGHT;
 
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     VkDescriptorBufferInfo bufferInfo{};
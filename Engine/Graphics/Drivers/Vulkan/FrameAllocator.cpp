@@ -0,0 +1,190 @@
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vulkan/vulkan_core.h>
+
+static VkDescriptorSetLayout CreateDynamicBufferLayout(VkDevice         device,
+                                                       VkDescriptorType type) {
+  VkDescriptorSetLayoutBinding binding{};
+  binding.binding         = 0;
+  binding.descriptorType  = type;
+  binding.descriptorCount = 1;
+  binding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = 1;
+  layoutInfo.pBindings    = &binding;
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create frame allocator descriptor set layout!");
+  }
+  return layout;
+}
+
+void VulkanDriver::CreateFrameAllocator() {
+  VkPhysicalDeviceProperties properties{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  frameDataAlignment =
+    std::max(properties.limits.minUniformBufferOffsetAlignment,
+             properties.limits.minStorageBufferOffsetAlignment);
+
+  // Set 1: object uniforms, set 2: frame data from AllocateFrameData
+  objectDescriptorSetLayout =
+    CreateDynamicBufferLayout(device, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+  frameDataDescriptorSetLayout =
+    CreateDynamicBufferLayout(device, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC);
+
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    AddFrameDataBlock(frame, FRAME_ALLOCATOR_SIZE);
+  }
+}
+
+void VulkanDriver::DestroyFrameAllocator() {
+  for (auto &blocks : frameDataBlocks) {
+    for (FrameDataBlock &block : blocks) {
+      vkDestroyDescriptorPool(device, block.descriptorPool, nullptr);
+      vkUnmapMemory(device, block.memory);
+      vkDestroyBuffer(device, block.buffer, nullptr);
+      vkFreeMemory(device, block.memory, nullptr);
+    }
+    blocks.clear();
+  }
+  vkDestroyDescriptorSetLayout(device, objectDescriptorSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, frameDataDescriptorSetLayout, nullptr);
+}
+
+// Each block gets a small descriptor pool of its own, so blocks can be
+// chained on mid-frame without running the shared pool dry
+void VulkanDriver::AddFrameDataBlock(uint32_t frame, VkDeviceSize size) {
+  FrameDataBlock block;
+  block.size = size;
+
+  // The tail padding keeps offset + binding range inside the buffer for
+  // allocations at the very end of the block
+  VkDeviceSize bufferSize = size + std::max(FRAME_UNIFORM_RANGE, FRAME_STORAGE_RANGE);
+  CreateBuffer(bufferSize,
+               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               block.buffer, block.memory);
+
+  void *mapped;
+  vkMapMemory(device, block.memory, 0, bufferSize, 0, &mapped);
+  block.mapped = static_cast<uint8_t *>(mapped);
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  poolSizes[0].descriptorCount = 1;
+  poolSizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+  poolSizes[1].descriptorCount = 1;
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+  poolInfo.maxSets       = 2;
+
+  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &block.descriptorPool) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create frame allocator descriptor pool!");
+  }
+
+  std::array<VkDescriptorSetLayout, 2> layouts = {objectDescriptorSetLayout,
+                                                  frameDataDescriptorSetLayout};
+  std::array<VkDescriptorSet, 2>       sets{};
+  VkDescriptorSetAllocateInfo          allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool     = block.descriptorPool;
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+  allocInfo.pSetLayouts        = layouts.data();
+
+  if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to allocate frame allocator descriptor sets!");
+  }
+  renderStats.Current().descriptorSetsAllocated += 2;
+  block.objectSet  = sets[0];
+  block.storageSet = sets[1];
+
+  VkDescriptorBufferInfo uniformInfo{};
+  uniformInfo.buffer = block.buffer;
+  uniformInfo.offset = 0;
+  uniformInfo.range  = FRAME_UNIFORM_RANGE;
+
+  VkDescriptorBufferInfo storageInfo{};
+  storageInfo.buffer = block.buffer;
+  storageInfo.offset = 0;
+  storageInfo.range  = FRAME_STORAGE_RANGE;
+
+  std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+  descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrites[0].dstSet          = block.objectSet;
+  descriptorWrites[0].dstBinding      = 0;
+  descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  descriptorWrites[0].descriptorCount = 1;
+  descriptorWrites[0].pBufferInfo     = &uniformInfo;
+
+  descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrites[1].dstSet          = block.storageSet;
+  descriptorWrites[1].dstBinding      = 0;
+  descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+  descriptorWrites[1].descriptorCount = 1;
+  descriptorWrites[1].pBufferInfo     = &storageInfo;
+
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()),
+                         descriptorWrites.data(), 0, nullptr);
+
+  frameDataBlocks[frame].push_back(block);
+}
+
+// Only call once the frame's fence has signaled, the GPU may still be
+// reading the slot's blocks until then
+void VulkanDriver::ResetFrameAllocator(uint32_t frame) {
+  frameDataFrame = frame;
+  frameDataBlock = 0;
+  frameDataHead  = 0;
+}
+
+// Never fails for lack of space: a full block moves on to the next one in
+// the slot's chain, adding it if needed, since this runs in the middle of
+// recording
+FrameAllocation VulkanDriver::AllocateFrameMemory(VkDeviceSize size) {
+  std::vector<FrameDataBlock> &blocks = frameDataBlocks[frameDataFrame];
+  VkDeviceSize                 offset =
+    (frameDataHead + frameDataAlignment - 1) / frameDataAlignment * frameDataAlignment;
+  while (offset + size > blocks[frameDataBlock].size) {
+    frameDataBlock++;
+    if (frameDataBlock == blocks.size()) {
+      AddFrameDataBlock(frameDataFrame, std::max(FRAME_ALLOCATOR_SIZE, size));
+    }
+    offset = 0;
+  }
+  frameDataHead = offset + size;
+  renderStats.Current().bytesUploaded += size;
+
+  return {blocks[frameDataBlock].mapped + offset, static_cast<uint32_t>(offset),
+          frameDataBlock};
+}
+
+// The slot is only known once the frame has waited for it, so this waits
+// like DrawFrame would
+FrameDataAllocation VulkanDriver::AllocateFrameData(size_t size) {
+  if (size > FRAME_DATA_MAX_SIZE) {
+    throw std::runtime_error("Frame data allocation is larger than FRAME_DATA_MAX_SIZE!");
+  }
+  if (!framePacer.InputLatched()) {
+    WaitForNextFrame();
+  }
+  BeginFrameSlot();
+
+  FrameAllocation     allocation = AllocateFrameMemory(size);
+  FrameDataAllocation frameData;
+  frameData.data = allocation.data;
+  // Block (from 1, so 0 stays "none") and offset
+  frameData.handle = (static_cast<uint64_t>(allocation.block) + 1) << 32 | allocation.offset;
+  return frameData;
+}
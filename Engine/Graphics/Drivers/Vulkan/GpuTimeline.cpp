@@ -0,0 +1,153 @@
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void VulkanDriver::CreateGpuTimeline() {
+  timelineSupported = false;
+  for (const char *extensionName : enabledDeviceExtensions) {
+    if (strcmp(extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) {
+      timelineSupported = true;
+    }
+  }
+
+  if (timelineSupported) {
+    waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+      vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+    getCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+      vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+    timelineSupported = waitSemaphores != nullptr && getCounterValue != nullptr;
+  }
+
+  if (!timelineSupported) {
+    std::cout << "Timeline semaphores unavailable, using frame fences"
+              << std::endl;
+    return;
+  }
+
+  VkSemaphoreTypeCreateInfoKHR typeInfo{};
+  typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  typeInfo.initialValue  = submittedWorkValue;
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+
+  if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &gpuTimeline) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create timeline semaphore!");
+  }
+}
+
+uint64_t VulkanDriver::SubmitGraphicsWork(const VkSubmitInfo &submitInfo,
+                                          VkFence             fallbackFence) {
+  uint64_t workValue = submittedWorkValue + 1;
+  VkResult result;
+
+  if (timelineSupported) {
+    // Signal the timeline next to whatever binary semaphores the caller
+    // signals, binary entries ignore their value
+    std::vector<VkSemaphore> signalSemaphores(
+      submitInfo.pSignalSemaphores,
+      submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(gpuTimeline);
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+    signalValues.back() = workValue;
+    std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues    = signalValues.data();
+
+    VkSubmitInfo timelineSubmit         = submitInfo;
+    timelineSubmit.pNext                = &timelineInfo;
+    timelineSubmit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    timelineSubmit.pSignalSemaphores    = signalSemaphores.data();
+    result = vkQueueSubmit(graphicsQueue, 1, &timelineSubmit, VK_NULL_HANDLE);
+  } else {
+    if (fallbackFence != VK_NULL_HANDLE) {
+      vkResetFences(device, 1, &fallbackFence);
+    }
+    result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, fallbackFence);
+  }
+
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit graphics work!");
+  }
+  submittedWorkValue = workValue;
+  return workValue;
+}
+
+bool VulkanDriver::IsGpuWorkComplete(uint64_t workValue) {
+  if (workValue <= completedWorkValue) {
+    return true;
+  }
+
+  if (timelineSupported) {
+    uint64_t counter = 0;
+    if (getCounterValue(device, gpuTimeline, &counter) == VK_SUCCESS) {
+      completedWorkValue = std::max(completedWorkValue, counter);
+    }
+  } else {
+    // Work completes in submission order, so any signaled frame fence
+    // vouches for everything submitted before its frame
+    for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++) {
+      if (slotWorkValues[slot] > completedWorkValue &&
+          vkGetFenceStatus(device, inFlightFences[slot]) == VK_SUCCESS) {
+        completedWorkValue = slotWorkValues[slot];
+      }
+    }
+  }
+  return workValue <= completedWorkValue;
+}
+
+void VulkanDriver::WaitForGpuWork(uint64_t workValue) {
+  if (IsGpuWorkComplete(workValue)) {
+    return;
+  }
+
+  if (timelineSupported) {
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &gpuTimeline;
+    waitInfo.pValues        = &workValue;
+    waitSemaphores(device, &waitInfo, UINT64_MAX);
+    completedWorkValue = std::max(completedWorkValue, workValue);
+    return;
+  }
+
+  // The earliest frame fence submitted at or after the work covers it,
+  // anything else can only be waited for by idling the queue
+  int coveringSlot = -1;
+  for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++) {
+    if (slotWorkValues[slot] >= workValue &&
+        (coveringSlot < 0 ||
+         slotWorkValues[slot] < slotWorkValues[coveringSlot])) {
+      coveringSlot = static_cast<int>(slot);
+    }
+  }
+
+  if (coveringSlot >= 0) {
+    vkWaitForFences(device, 1, &inFlightFences[coveringSlot], VK_TRUE,
+                    UINT64_MAX);
+    completedWorkValue =
+      std::max(completedWorkValue, slotWorkValues[coveringSlot]);
+  } else {
+    vkQueueWaitIdle(graphicsQueue);
+    completedWorkValue = submittedWorkValue;
+  }
+}
+
+void VulkanDriver::FrameSubmitted(uint64_t workValue) {
+  slotWorkValues[currentFrame] = workValue;
+  framePacer.FrameSubmitted(currentFrame);
+  frameSlotBegun = false;
+}
@@ -1,28 +1,118 @@
 #include "../../../../Utils/FileUtils.h"
 #include "Vulkan.h"
 
+#include <chrono>
 #include <vulkan/vulkan_core.h>
 
 void VulkanDriver::CreateGraphicsPipeline() {
+  // Kept alive for the driver's lifetime, variants compile from them on the
+  // pipeline cache's thread
   auto vertShaderCode = readFile("shaders/vert.spv");
   auto fragShaderCode = readFile("shaders/frag.spv");
+  vertShaderModule    = CreateShaderModule(vertShaderCode);
+  fragShaderModule    = CreateShaderModule(fragShaderCode);
+  auto voxelVertShaderCode = readFile("shaders/voxel_vert.spv");
+  auto voxelFragShaderCode = readFile("shaders/voxel_frag.spv");
+  voxelVertShaderModule    = CreateShaderModule(voxelVertShaderCode);
+  voxelFragShaderModule    = CreateShaderModule(voxelFragShaderCode);
 
-  VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
-  VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
+  // Push constant for model matrix
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(glm::mat4);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  // Set 0: camera UBO and texture, sets 1 and 2: frame allocator object
+  // uniforms and frame data
+  std::array<VkDescriptorSetLayout, 3> setLayouts = {descriptorSetLayout,
+                                                     objectDescriptorSetLayout,
+                                                     frameDataDescriptorSetLayout};
+  pipelineLayoutInfo.setLayoutCount         = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 1;       // Optional
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange; // Optional
+
+  if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
+                             &pipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  pipelineCache.Start(device, PIPELINE_CACHE_PATH,
+                      [this](const PipelineState &state, VkPipelineCache cache) {
+                        return CreatePipelineVariant(state, cache);
+                      });
+
+  // The default variant doubles as the fallback while others compile
+  graphicsPipeline = pipelineCache.GetOrCompile(PipelineStateFor(0));
+  if (graphicsPipeline == VK_NULL_HANDLE) {
+    throw std::runtime_error("failed to create graphics pipeline!");
+  }
+  // Voxel meshes can't fall back to the default, their vertices don't fit it
+  voxelPipeline = pipelineCache.GetOrCompile(PipelineStateFor(PIPELINE_FEATURE_VOXEL));
+  if (voxelPipeline == VK_NULL_HANDLE) {
+    throw std::runtime_error("failed to create voxel graphics pipeline!");
+  }
+}
+
+void VulkanDriver::PrecompilePipelines(const std::vector<PipelineFeatures> &featureSets) {
+  for (PipelineFeatures features : featureSets) {
+    pipelineCache.GetOrCompile(PipelineStateFor(features));
+  }
+}
+
+PipelineState VulkanDriver::PipelineStateFor(PipelineFeatures features) const {
+  PipelineState state{};
+  state.renderPass     = renderPass;
+  state.shaderFeatures = features & PIPELINE_SHADER_FEATURES;
+  state.vertexFormat   = (features & PIPELINE_FEATURE_VOXEL) ? VERTEX_FORMAT_VOXEL
+                                                             : VERTEX_FORMAT_STANDARD;
+  if (features & PIPELINE_FEATURE_DOUBLE_SIDED) {
+    state.cullMode = VK_CULL_MODE_NONE;
+  }
+  // Without fillModeNonSolid wireframe falls back to filled polygons
+  if ((features & PIPELINE_FEATURE_WIREFRAME) && wireframeSupported) {
+    state.polygonMode = VK_POLYGON_MODE_LINE;
+    state.cullMode    = VK_CULL_MODE_NONE;
+  }
+  return state;
+}
+
+VkPipeline VulkanDriver::CreatePipelineVariant(const PipelineState &state,
+                                               VkPipelineCache      cache) {
+  // One VkBool32 specialization constant per shader feature bit
+  std::array<VkBool32, 32>              featureValues{};
+  std::vector<VkSpecializationMapEntry> mapEntries;
+  for (uint32_t bit = 0; bit < 32; bit++) {
+    if (PIPELINE_SHADER_FEATURES & (1u << bit)) {
+      featureValues[bit] = (state.shaderFeatures & (1u << bit)) ? VK_TRUE : VK_FALSE;
+      mapEntries.push_back({bit, static_cast<uint32_t>(bit * sizeof(VkBool32)),
+                            sizeof(VkBool32)});
+    }
+  }
+  VkSpecializationInfo specializationInfo{};
+  specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+  specializationInfo.pMapEntries   = mapEntries.data();
+  specializationInfo.dataSize      = sizeof(featureValues);
+  specializationInfo.pData         = featureValues.data();
 
   VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
   vertShaderStageInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   vertShaderStageInfo.stage  = VK_SHADER_STAGE_VERTEX_BIT;
-  vertShaderStageInfo.module = vertShaderModule;
+  bool voxel = state.vertexFormat == VERTEX_FORMAT_VOXEL;
+  vertShaderStageInfo.module = voxel ? voxelVertShaderModule : vertShaderModule;
   vertShaderStageInfo.pName  = "main";
+  vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
   VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
   fragShaderStageInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   fragShaderStageInfo.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-  fragShaderStageInfo.module = fragShaderModule;
+  fragShaderStageInfo.module = voxel ? voxelFragShaderModule : fragShaderModule;
   fragShaderStageInfo.pName  = "main";
+  fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
   VkPipelineShaderStageCreateInfo shaderStages[] = {fragShaderStageInfo,
                                                     vertShaderStageInfo};
@@ -36,17 +126,26 @@ void VulkanDriver::CreateGraphicsPipeline() {
   dynamicState.pDynamicStates    = dynamicStates.data();
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-  auto bindingDescription    = Vertex::GetBindingDescription();
-  auto attributeDescriptions = Vertex::GetAttributeDescriptions();
+  auto bindingDescription         = Vertex::GetBindingDescription();
+  auto attributeDescriptions      = Vertex::GetAttributeDescriptions();
+  auto voxelBindingDescription    = VoxelVertex::GetBindingDescription();
+  auto voxelAttributeDescriptions = VoxelVertex::GetAttributeDescriptions();
 
   vertexInputInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
   vertexInputInfo.vertexBindingDescriptionCount = 1;
-  vertexInputInfo.pVertexBindingDescriptions = &bindingDescription; // Optional
-  vertexInputInfo.vertexAttributeDescriptionCount =
-    static_cast<uint32_t>(attributeDescriptions.size());
-  vertexInputInfo.pVertexAttributeDescriptions =
-    attributeDescriptions.data(); // Optional
+  if (voxel) {
+    vertexInputInfo.pVertexBindingDescriptions = &voxelBindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount =
+      static_cast<uint32_t>(voxelAttributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = voxelAttributeDescriptions.data();
+  } else {
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription; // Optional
+    vertexInputInfo.vertexAttributeDescriptionCount =
+      static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions =
+      attributeDescriptions.data(); // Optional
+  }
 
   VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
   inputAssembly.sType =
@@ -54,17 +153,19 @@ void VulkanDriver::CreateGraphicsPipeline() {
   inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
   inputAssembly.primitiveRestartEnable = VK_FALSE;
 
+  // Viewport and scissor are dynamic state, these are placeholders so that
+  // variants don't depend on the (resizable) swapchain extent
   VkViewport viewport{};
   viewport.x        = 0.0f;
   viewport.y        = 0.0f;
-  viewport.width    = (float) swapChainExtent.width;
-  viewport.height   = (float) swapChainExtent.height;
+  viewport.width    = 1.0f;
+  viewport.height   = 1.0f;
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
   VkRect2D scissor{};
   scissor.offset = {0, 0};
-  scissor.extent = swapChainExtent;
+  scissor.extent = {1, 1};
 
   VkPipelineViewportStateCreateInfo viewportState{};
   viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -77,9 +178,9 @@ void VulkanDriver::CreateGraphicsPipeline() {
   rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
   rasterizer.depthClampEnable        = VK_FALSE;
   rasterizer.rasterizerDiscardEnable = VK_FALSE;
-  rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+  rasterizer.polygonMode             = state.polygonMode;
   rasterizer.lineWidth               = 1.0f;
-  rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
+  rasterizer.cullMode                = state.cullMode;
   rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
   rasterizer.depthBiasEnable         = VK_FALSE;
   rasterizer.depthBiasConstantFactor = 0.0f; // Optional
@@ -107,7 +208,7 @@ void VulkanDriver::CreateGraphicsPipeline() {
   colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;  // Optional
   colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
   colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;      // Optional
-  colorBlendAttachment.blendEnable         = VK_TRUE;
+  colorBlendAttachment.blendEnable         = state.blendEnable;
   colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
   colorBlendAttachment.dstColorBlendFactor =
     VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -128,28 +229,10 @@ void VulkanDriver::CreateGraphicsPipeline() {
   colorBlending.blendConstants[2] = 0.0f;             // Optional
   colorBlending.blendConstants[3] = 0.0f;             // Optional
 
-  // Push constant for model matrix
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(glm::mat4);
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount         = 1;       // Optional
-  pipelineLayoutInfo.pSetLayouts            = &descriptorSetLayout; // Optional
-  pipelineLayoutInfo.pushConstantRangeCount = 1;       // Optional
-  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange; // Optional
-
-  if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
-                             &pipelineLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
-
   VkPipelineDepthStencilStateCreateInfo depthStencil{};
   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencil.depthTestEnable = VK_TRUE;
-  depthStencil.depthWriteEnable = VK_TRUE;
+  depthStencil.depthWriteEnable = state.depthWrite;
   depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
   depthStencil.depthBoundsTestEnable = VK_FALSE;
   depthStencil.minDepthBounds = 0.0f;
@@ -171,18 +254,17 @@ void VulkanDriver::CreateGraphicsPipeline() {
   pipelineInfo.pColorBlendState    = &colorBlending;
   pipelineInfo.pDynamicState       = &dynamicState;
   pipelineInfo.layout              = pipelineLayout;
-  pipelineInfo.renderPass          = renderPass;
+  pipelineInfo.renderPass          = state.renderPass;
   pipelineInfo.subpass             = 0;
   pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE; // Optional
   pipelineInfo.basePipelineIndex   = -1;             // Optional
 
-  if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr, &graphicsPipeline) != VK_SUCCESS) {
+  VkPipeline pipeline;
+  if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr,
+                                &pipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline!");
   }
-
-  vkDestroyShaderModule(device, fragShaderModule, nullptr);
-  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+  return pipeline;
 }
 
 VkShaderModule VulkanDriver::CreateShaderModule(const std::vector<char> &code) {
@@ -200,8 +282,10 @@ VkShaderModule VulkanDriver::CreateShaderModule(const std::vector<char> &code) {
 }
 
 void VulkanDriver::DrawFrame() {
-  vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE,
-                  UINT64_MAX);
+  if (!framePacer.InputLatched()) {
+    WaitForNextFrame();
+  }
+  BeginFrameSlot();
 
   uint32_t imageIndex;
   VkResult result = vkAcquireNextImageKHR(
@@ -210,14 +294,22 @@ void VulkanDriver::DrawFrame() {
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     RecreateSwapChain();
+    // Nothing was submitted, so the next frame waits and latches input again
+    // and starts the slot over
+    framePacer.ClearInputLatch();
+    frameSlotBegun = false;
     return;
   } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
     throw std::runtime_error("Failed to acquire swap chain image!");
   }
 
-  vkResetFences(device, 1, &inFlightFences[currentFrame]);
+  auto recordStart = std::chrono::steady_clock::now();
   vkResetCommandBuffer(commandBuffers[currentFrame], 0);
   RecordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+  renderStats.Current().cpuRecordMs +=
+    std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - recordStart)
+      .count();
 
   UpdateUniformBuffer(currentFrame);
   VkSubmitInfo submitInfo{};
@@ -235,10 +327,7 @@ void VulkanDriver::DrawFrame() {
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores    = signalSemaphores;
 
-  if (vkQueueSubmit(graphicsQueue, 1, &submitInfo,
-                    inFlightFences[currentFrame]) != VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
+  FrameSubmitted(SubmitGraphicsWork(submitInfo, inFlightFences[currentFrame]));
 
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -260,5 +349,5 @@ void VulkanDriver::DrawFrame() {
     throw std::runtime_error("Failed to present swapchain image!");
   }
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % framesInFlight;
 }
@@ -3,16 +3,19 @@
 #include <iostream>
 #include <vulkan/vulkan_core.h>
 
-std::vector<const char *> getRequiredExtensions() {
-  uint32_t     glfwExtensionCount = 0;
-  const char **glfwExtensions;
+std::vector<const char *> getRequiredExtensions(bool withSurface) {
+  std::vector<const char *> requiredExtensions;
 
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+  // Offscreen rendering runs without GLFW, so no surface extensions
+  if (withSurface) {
+    uint32_t     glfwExtensionCount = 0;
+    const char **glfwExtensions;
 
-  std::vector<const char *> requiredExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-  for (uint32_t i = 0; i < glfwExtensionCount; i++) {
-    requiredExtensions.emplace_back(glfwExtensions[i]);
+    for (uint32_t i = 0; i < glfwExtensionCount; i++) {
+      requiredExtensions.emplace_back(glfwExtensions[i]);
+    }
   }
 
   requiredExtensions.emplace_back(
@@ -79,6 +82,11 @@ void VulkanDriver::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   }
 
   vkBindBufferMemory(device, buffer, bufferMemory, 0);
+
+  if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+    renderStats.Current().stagingAllocations++;
+    renderStats.Current().stagingBytes += size;
+  }
 }
 
 uint32_t VulkanDriver::FindMemoryType(uint32_t              typeFilter,
@@ -87,7 +95,8 @@ uint32_t VulkanDriver::FindMemoryType(uint32_t              typeFilter,
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
   for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
     if (typeFilter & (1 << i) &&
-        (memProperties.memoryTypes[i].propertyFlags & properties)) {
+        (memProperties.memoryTypes[i].propertyFlags & properties) ==
+          properties) {
       return i;
     }
   }
@@ -122,8 +131,8 @@ void VulkanDriver::EndSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
+	// Waits on this submission's timeline value rather than idling the queue
+	WaitForGpuWork(SubmitGraphicsWork(submitInfo, VK_NULL_HANDLE));
 
 	vkFreeCommandBuffers(device, commandPool,  1, &commandBuffer);
 }
@@ -136,4 +145,5 @@ void VulkanDriver::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSi
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
 	EndSingleTimeCommands(commandBuffer);
+	renderStats.Current().bytesUploaded += size;
 }
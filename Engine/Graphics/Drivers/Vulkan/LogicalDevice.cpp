@@ -1,4 +1,5 @@
 #include "Vulkan.h"
+#include <cstring>
 #include <set>
 #include <iostream>
 
@@ -6,7 +7,10 @@ void VulkanDriver::CreateLogicalDevice() {
 	QueueFamilyIndices indices = FindQueueFamilies(physicalDevice);
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value()};
+	if (indices.presentFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.presentFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -18,8 +22,14 @@ void VulkanDriver::CreateLogicalDevice() {
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	// Needed for the wireframe pipeline variant only
+	wireframeSupported = supportedFeatures.fillModeNonSolid == VK_TRUE;
+	deviceFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -27,8 +37,18 @@ void VulkanDriver::CreateLogicalDevice() {
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
+
+	// The timeline semaphore feature comes with the extension when advertised
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.timelineSemaphore = VK_TRUE;
+	for (const char *extensionName : enabledDeviceExtensions) {
+		if (strcmp(extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) {
+			createInfo.pNext = &timelineFeatures;
+		}
+	}
 
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -42,5 +62,7 @@ void VulkanDriver::CreateLogicalDevice() {
 	}
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+	if (indices.presentFamily.has_value()) {
+		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+	}
 }
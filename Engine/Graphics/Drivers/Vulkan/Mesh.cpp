@@ -1,9 +1,53 @@
 #include "Mesh.h"
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
-    : vertices(vertices), indices(indices) {
+#include <utility>
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+    : vertices(std::move(vertices)), indices(std::move(indices)) {
+    vertexCount = this->vertices.size();
+    indexCount = this->indices.size();
+    ComputeBounds(this->vertices.data(), vertexCount, boundsMin, boundsMax);
+}
+
+Mesh::Mesh(size_t vertexCount, size_t indexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+           VertexFormat vertexFormat)
+    : vertexCount(vertexCount), indexCount(indexCount), vertexFormat(vertexFormat),
+      boundsMin(boundsMin), boundsMax(boundsMax) {
 }
 
 Mesh::~Mesh() {
 }
 
+void Mesh::ReleaseCpuData() {
+    // Swapping with empty vectors actually returns the memory
+    std::vector<Vertex>().swap(vertices);
+    std::vector<uint32_t>().swap(indices);
+}
+
+void Mesh::ComputeBounds(const Vertex* vertices, size_t vertexCount,
+                         glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    boundsMin = glm::vec3(0.0f);
+    boundsMax = glm::vec3(0.0f);
+    if (vertexCount > 0) {
+        boundsMin = vertices[0].pos;
+        boundsMax = vertices[0].pos;
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+        boundsMin = glm::min(boundsMin, vertices[i].pos);
+        boundsMax = glm::max(boundsMax, vertices[i].pos);
+    }
+}
+
+void Mesh::ComputeBounds(const VoxelVertex* vertices, size_t vertexCount,
+                         glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    boundsMin = glm::vec3(0.0f);
+    boundsMax = glm::vec3(0.0f);
+    if (vertexCount > 0) {
+        boundsMin = vertices[0].Position();
+        boundsMax = vertices[0].Position();
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+        boundsMin = glm::min(boundsMin, vertices[i].Position());
+        boundsMax = glm::max(boundsMax, vertices[i].Position());
+    }
+}
@@ -8,18 +8,40 @@
 // Mesh represents a loaded 3D model with vertices and indices
 class Mesh {
 public:
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+    // A mesh that lives on the GPU only, e.g. built in staging memory
+    Mesh(size_t vertexCount, size_t indexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+         VertexFormat vertexFormat = VERTEX_FORMAT_STANDARD);
     ~Mesh();
 
+    // Empty once the CPU copy has been released
     const std::vector<Vertex>& GetVertices() const { return vertices; }
     const std::vector<uint32_t>& GetIndices() const { return indices; }
-    size_t GetVertexCount() const { return vertices.size(); }
-    size_t GetIndexCount() const { return indices.size(); }
+    bool HasCpuData() const { return !vertices.empty(); }
+    size_t GetVertexCount() const { return vertexCount; }
+    size_t GetIndexCount() const { return indexCount; }
+    VertexFormat GetVertexFormat() const { return vertexFormat; }
+
+    // Object-space axis aligned bounds, used for culling
+    const glm::vec3& GetBoundsMin() const { return boundsMin; }
+    const glm::vec3& GetBoundsMax() const { return boundsMax; }
+
+    // Frees the vertex and index vectors, counts and bounds stay valid
+    void ReleaseCpuData();
+
+    static void ComputeBounds(const Vertex* vertices, size_t vertexCount,
+                              glm::vec3& boundsMin, glm::vec3& boundsMax);
+    static void ComputeBounds(const VoxelVertex* vertices, size_t vertexCount,
+                              glm::vec3& boundsMin, glm::vec3& boundsMax);
 
 private:
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    VertexFormat vertexFormat = VERTEX_FORMAT_STANDARD;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 };
 
 #endif // MESH_H
-
@@ -0,0 +1,150 @@
+#include "Vulkan.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <vulkan/vulkan_core.h>
+
+void VulkanDriver::CreateOffscreenTargets() {
+  // One color target per frame in flight so frames pipeline exactly like
+  // swapchain images do
+  swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+  swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+  offscreenImagesMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  offscreenReadbacks.resize(MAX_FRAMES_IN_FLIGHT);
+
+  VkDeviceSize readbackSize =
+    static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    CreateImage(swapChainExtent.width, swapChainExtent.height,
+                swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i],
+                offscreenImagesMemory[i]);
+
+    OffscreenReadback &readback = offscreenReadbacks[i];
+    CreateBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 readback.buffer, readback.bufferMemory);
+    vkMapMemory(device, readback.bufferMemory, 0, readbackSize, 0,
+                &readback.mapped);
+  }
+
+  CreateImageViews();
+}
+
+void VulkanDriver::DestroyOffscreenTargets() {
+  // The device is idle at this point, so every pending copy has landed
+  for (uint32_t i = 0; i < offscreenReadbacks.size(); i++) {
+    CompleteFrameReadback(i);
+  }
+
+  for (size_t i = 0; i < swapChainImages.size(); i++) {
+    vkDestroyImage(device, swapChainImages[i], nullptr);
+    vkFreeMemory(device, offscreenImagesMemory[i], nullptr);
+  }
+  swapChainImages.clear();
+  offscreenImagesMemory.clear();
+
+  for (auto &readback : offscreenReadbacks) {
+    vkUnmapMemory(device, readback.bufferMemory);
+    vkDestroyBuffer(device, readback.buffer, nullptr);
+    vkFreeMemory(device, readback.bufferMemory, nullptr);
+  }
+  offscreenReadbacks.clear();
+}
+
+void VulkanDriver::RequestFrameReadback(FrameReadbackCallback callback) {
+  if (!offscreen) {
+    throw std::runtime_error("Frame readback requires offscreen mode");
+  }
+  nextFrameReadback = std::move(callback);
+}
+
+void VulkanDriver::CompleteFrameReadback(uint32_t frame) {
+  OffscreenReadback &readback = offscreenReadbacks[frame];
+  if (!readback.callback) { return; }
+
+  FrameReadback result{};
+  result.frameIndex = readback.frameIndex;
+  result.width      = swapChainExtent.width;
+  result.height     = swapChainExtent.height;
+  result.pixels     = static_cast<const uint8_t *>(readback.mapped);
+
+  // Clear first so the callback may request another readback
+  FrameReadbackCallback callback = std::move(readback.callback);
+  readback.callback              = nullptr;
+  callback(result);
+}
+
+void VulkanDriver::RecordReadbackCopy(VkCommandBuffer commandBuffer,
+                                      uint32_t        imageIndex) {
+  // The render pass leaves the image in TRANSFER_SRC_OPTIMAL
+  VkBufferImageCopy region{};
+  region.bufferOffset                    = 0;
+  region.bufferRowLength                 = 0;
+  region.bufferImageHeight               = 0;
+  region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel       = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount     = 1;
+  region.imageOffset                     = {0, 0, 0};
+  region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+
+  vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex],
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         offscreenReadbacks[currentFrame].buffer, 1, &region);
+
+  // Make the copy visible to the host once the frame fence signals
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer              = offscreenReadbacks[currentFrame].buffer;
+  barrier.offset              = 0;
+  barrier.size                = VK_WHOLE_SIZE;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier,
+                       0, nullptr);
+}
+
+void VulkanDriver::DrawOffscreenFrame() {
+  if (!framePacer.InputLatched()) {
+    WaitForNextFrame();
+  }
+  BeginFrameSlot();
+
+  // Whatever this slot copied framesInFlight frames ago is ready now
+  CompleteFrameReadback(currentFrame);
+
+  if (nextFrameReadback) {
+    offscreenReadbacks[currentFrame].callback   = std::move(nextFrameReadback);
+    offscreenReadbacks[currentFrame].frameIndex = renderStats.FrameCount();
+    nextFrameReadback                           = nullptr;
+  }
+
+  auto recordStart = std::chrono::steady_clock::now();
+  vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+  RecordCommandBuffer(commandBuffers[currentFrame], currentFrame);
+  renderStats.Current().cpuRecordMs +=
+    std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - recordStart)
+      .count();
+
+  UpdateUniformBuffer(currentFrame);
+
+  // No swapchain image to wait for and nothing to present
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &commandBuffers[currentFrame];
+
+  FrameSubmitted(SubmitGraphicsWork(submitInfo, inFlightFences[currentFrame]));
+
+  currentFrame = (currentFrame + 1) % framesInFlight;
+}
@@ -1,5 +1,6 @@
 #include "Vulkan.h"
 
+#include <cstring>
 #include <set>
 #include <vulkan/vulkan_core.h>
 
@@ -45,6 +46,27 @@ void VulkanDriver::PickPhysicalDevice() {
   if (physicalDevice == VK_NULL_HANDLE) {
     throw std::runtime_error("Failed to find suitable GPU");
   }
+
+  // Required extensions plus the optional ones this device advertises
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount,
+                                       nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount,
+                                       availableExtensions.data());
+
+  enabledDeviceExtensions.clear();
+  if (!offscreen) {
+    enabledDeviceExtensions = presentDeviceExtensions;
+  }
+  for (const char *extensionName : optionalDeviceExtensions) {
+    for (const auto &extension : availableExtensions) {
+      if (strcmp(extensionName, extension.extensionName) == 0) {
+        enabledDeviceExtensions.push_back(extensionName);
+        break;
+      }
+    }
+  }
 }
 
 bool VulkanDriver::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -56,8 +78,11 @@ bool VulkanDriver::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
                                        availableExtensions.data());
 
-  std::set<std::string> requiredExtensions(deviceExtensions.begin(),
-                                           deviceExtensions.end());
+  std::set<std::string> requiredExtensions;
+  if (!offscreen) {
+    requiredExtensions.insert(presentDeviceExtensions.begin(),
+                              presentDeviceExtensions.end());
+  }
 
   for (const auto &extension : availableExtensions) {
     requiredExtensions.erase(extension.extensionName);
@@ -70,8 +95,8 @@ bool VulkanDriver::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = FindQueueFamilies(device);
 
   bool extensionsSupported = CheckDeviceExtensionSupport(device);
-  bool swapChainAdequate   = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate   = offscreen;
+  if (extensionsSupported && !offscreen) {
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() &&
                         !swapChainSupport.presentModes.empty();
@@ -80,6 +105,6 @@ bool VulkanDriver::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
+  return indices.isComplete(!offscreen) && extensionsSupported && swapChainAdequate &&
          supportedFeatures.samplerAnisotropy;
 }
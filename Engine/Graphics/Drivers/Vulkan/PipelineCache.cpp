@@ -0,0 +1,204 @@
+#include "PipelineCache.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace {
+// FNV-1a over one field at a time, so struct padding never reaches the hash
+template <typename T> void HashField(uint64_t &hash, const T &value) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+  for (size_t i = 0; i < sizeof(T); i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+} // namespace
+
+bool operator==(const PipelineState &a, const PipelineState &b) {
+  return a.renderPass == b.renderPass && a.shaderFeatures == b.shaderFeatures &&
+         a.vertexFormat == b.vertexFormat && a.polygonMode == b.polygonMode &&
+         a.cullMode == b.cullMode && a.depthWrite == b.depthWrite &&
+         a.blendEnable == b.blendEnable;
+}
+
+uint64_t HashPipelineState(const PipelineState &state) {
+  uint64_t hash = 14695981039346656037ull;
+  HashField(hash, state.renderPass);
+  HashField(hash, state.shaderFeatures);
+  HashField(hash, state.vertexFormat);
+  HashField(hash, state.polygonMode);
+  HashField(hash, state.cullMode);
+  HashField(hash, state.depthWrite);
+  HashField(hash, state.blendEnable);
+  return hash;
+}
+
+PipelineCache::~PipelineCache() {
+  // Only reached without Stop() when setup failed, the device may already
+  // be gone so just let the thread go
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobReady.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void PipelineCache::Start(VkDevice device, const std::string &cachePath,
+                          Builder builder) {
+  this->device    = device;
+  this->cachePath = cachePath;
+  this->builder   = std::move(builder);
+
+  // The driver validates the header and ignores data from another device
+  // or driver version, so a stale file only costs the warm start
+  std::vector<char> initialData;
+  std::ifstream     file(cachePath, std::ios::binary);
+  if (file.is_open()) {
+    initialData.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  }
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = initialData.size();
+  createInfo.pInitialData    = initialData.empty() ? nullptr : initialData.data();
+  if (vkCreatePipelineCache(device, &createInfo, nullptr, &driverCache) !=
+      VK_SUCCESS) {
+    // Pipelines still build without a cache, just slower
+    std::cerr << "Warning: failed to create pipeline cache" << std::endl;
+    driverCache = VK_NULL_HANDLE;
+  }
+
+  stopping = false;
+  worker   = std::thread(&PipelineCache::WorkerLoop, this);
+}
+
+void PipelineCache::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    // Dropped jobs will never finish, threads waiting for them recheck
+    for (const PipelineState &state : jobs) {
+      pending.erase(state);
+    }
+    jobs.clear();
+  }
+  jobReady.notify_all();
+  variantReady.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &[state, pipeline] : variants) {
+      if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+      }
+    }
+    variants.clear();
+  }
+
+  if (driverCache == VK_NULL_HANDLE) {
+    return;
+  }
+
+  size_t dataSize = 0;
+  vkGetPipelineCacheData(device, driverCache, &dataSize, nullptr);
+  std::vector<char> data(dataSize);
+  if (dataSize > 0 &&
+      vkGetPipelineCacheData(device, driverCache, &dataSize, data.data()) ==
+        VK_SUCCESS) {
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(dataSize));
+  }
+  vkDestroyPipelineCache(device, driverCache, nullptr);
+  driverCache = VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineCache::GetOrCompile(const PipelineState &state) {
+  std::unique_lock<std::mutex> lock(mutex);
+  // Another thread is already building it, share that result
+  variantReady.wait(lock, [&]() { return pending.count(state) == 0; });
+  auto it = variants.find(state);
+  if (it != variants.end()) {
+    return it->second;
+  }
+  // Stopped while waiting, the device is going away
+  if (stopping) {
+    return VK_NULL_HANDLE;
+  }
+
+  pending.insert(state);
+  lock.unlock();
+  VkPipeline pipeline = Build(state);
+  lock.lock();
+  variants[state] = pipeline;
+  pending.erase(state);
+  lock.unlock();
+  variantReady.notify_all();
+  return pipeline;
+}
+
+VkPipeline PipelineCache::GetOrQueue(const PipelineState &state,
+                                     VkPipeline           fallback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto                        it = variants.find(state);
+  if (it != variants.end()) {
+    return it->second != VK_NULL_HANDLE ? it->second : fallback;
+  }
+
+  if (stopping) {
+    return fallback;
+  }
+  if (pending.insert(state).second) {
+    jobs.push_back(state);
+    jobReady.notify_one();
+  }
+  return fallback;
+}
+
+size_t PipelineCache::VariantCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return variants.size();
+}
+
+size_t PipelineCache::PendingCount() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending.size();
+}
+
+VkPipeline PipelineCache::Build(const PipelineState &state) {
+  try {
+    return builder(state, driverCache);
+  } catch (const std::exception &e) {
+    std::cerr << "Pipeline variant failed to compile: " << e.what()
+              << std::endl;
+    return VK_NULL_HANDLE;
+  }
+}
+
+void PipelineCache::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    jobReady.wait(lock, [&]() { return stopping || !jobs.empty(); });
+    if (stopping) {
+      return;
+    }
+
+    PipelineState state = jobs.front();
+    jobs.pop_front();
+    lock.unlock();
+    VkPipeline pipeline = Build(state);
+    lock.lock();
+
+    variants[state] = pipeline;
+    pending.erase(state);
+    variantReady.notify_all();
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef PIPELINECACHE_H
+#define PIPELINECACHE_H
+
+#include <vulkan/vulkan_core.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// Everything a graphics pipeline variant is built from
+struct PipelineState {
+  VkRenderPass    renderPass     = VK_NULL_HANDLE;
+  uint32_t        shaderFeatures = 0; // Specialization constant toggles
+  uint32_t        vertexFormat   = 0; // VERTEX_FORMAT_*, picks vertex input and shaders
+  VkPolygonMode   polygonMode    = VK_POLYGON_MODE_FILL;
+  VkCullModeFlags cullMode       = VK_CULL_MODE_BACK_BIT;
+  VkBool32        depthWrite     = VK_TRUE;
+  VkBool32        blendEnable    = VK_TRUE;
+};
+
+bool     operator==(const PipelineState &a, const PipelineState &b);
+uint64_t HashPipelineState(const PipelineState &state);
+
+struct PipelineStateHash {
+  size_t operator()(const PipelineState &state) const {
+    return static_cast<size_t>(HashPipelineState(state));
+  }
+};
+
+// Graphics pipeline variants keyed by their full state, backed by
+// a VkPipelineCache that is saved to disk between runs. Variants requested
+// through GetOrQueue compile on a background thread so the frame that first
+// needs one never waits for the driver's shader compiler.
+class PipelineCache {
+  public:
+    using Builder =
+      std::function<VkPipeline(const PipelineState &, VkPipelineCache)>;
+
+    ~PipelineCache();
+
+    // Seeds the driver cache from cachePath (when present) and starts the
+    // compile thread
+    void Start(VkDevice device, const std::string &cachePath, Builder builder);
+    // Joins the compile thread, destroys every variant and writes the
+    // driver cache back to cachePath
+    void Stop();
+
+    // Returns the variant, compiling it on the calling thread if needed;
+    // VK_NULL_HANDLE once Stop() has been called
+    VkPipeline GetOrCompile(const PipelineState &state);
+    // Never blocks: returns the variant when it is ready, otherwise queues
+    // it for the compile thread and returns the fallback
+    VkPipeline GetOrQueue(const PipelineState &state, VkPipeline fallback);
+
+    size_t VariantCount();
+    size_t PendingCount();
+
+  private:
+    VkDevice        device      = VK_NULL_HANDLE;
+    VkPipelineCache driverCache = VK_NULL_HANDLE;
+    std::string     cachePath;
+    Builder         builder;
+
+    // Failed variants are stored as VK_NULL_HANDLE so they aren't retried
+    std::mutex                                                       mutex;
+    std::condition_variable                                          jobReady;
+    std::condition_variable                                          variantReady;
+    std::unordered_map<PipelineState, VkPipeline, PipelineStateHash> variants;
+    std::unordered_set<PipelineState, PipelineStateHash>             pending;
+    std::deque<PipelineState>                                        jobs;
+    std::thread                                                      worker;
+    bool                                                             stopping = false;
+
+    VkPipeline Build(const PipelineState &state);
+    void       WorkerLoop();
+};
+
+#endif // PIPELINECACHE_H
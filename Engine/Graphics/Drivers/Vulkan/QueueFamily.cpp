@@ -1,7 +1,7 @@
 #include "Vulkan.h"
 
-bool QueueFamilyIndices::isComplete() {
-	return graphicsFamily.has_value() && presentFamily.has_value();
+bool QueueFamilyIndices::isComplete(bool requirePresent) {
+	return graphicsFamily.has_value() && (!requirePresent || presentFamily.has_value());
 }
 
 QueueFamilyIndices VulkanDriver::FindQueueFamilies(VkPhysicalDevice device) {
@@ -19,13 +19,16 @@ QueueFamilyIndices VulkanDriver::FindQueueFamilies(VkPhysicalDevice device) {
 			indices.graphicsFamily = i;
 		}
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-		if (presentSupport) {
-			indices.presentFamily = i;
+		// No surface to present to in offscreen mode
+		if (!offscreen) {
+			VkBool32 presentSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+			if (presentSupport) {
+				indices.presentFamily = i;
+			}
 		}
 
-		if (indices.isComplete()) {
+		if (indices.isComplete(!offscreen)) {
 			break;
 		}
 
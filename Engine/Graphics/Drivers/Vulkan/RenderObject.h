@@ -3,7 +3,9 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
 #include <memory>
+#include "../../PipelineFeatures.h"
 
 class Mesh;
 class Texture;
@@ -14,10 +16,37 @@ struct RenderObject {
     std::shared_ptr<Mesh> mesh;
     std::shared_ptr<Texture> texture;
     glm::mat4 modelMatrix;  // Model transformation matrix
+    glm::vec4 materialColor = glm::vec4(1.0f);  // Multiplied with the texture
+    glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);  // uv * xy + zw, see TextureAtlas
+    PipelineFeatures pipelineFeatures = 0;      // PIPELINE_FEATURE_* bits
+    uint64_t frameData = 0;                     // FrameDataAllocation::handle, 0 for none
+    uint32_t instanceCount = 1;                 // With PIPELINE_FEATURE_INSTANCED
     
     RenderObject(std::shared_ptr<Mesh> mesh, std::shared_ptr<Texture> texture, const glm::mat4& modelMatrix = glm::mat4(1.0f))
         : mesh(mesh), texture(texture), modelMatrix(modelMatrix) {}
 };
 
+// Compact POD form of a draw for batch submission (SubmitRenderPackets).
+// The handles are raw pointers to resources created by the same driver and
+// are not reference counted: keep the resources alive until the frame is
+// rendered (releasing them drops the queued packets that use them).
+// Packets draw with the default material color and UV transform and
+// without frame data.
+struct RenderPacket {
+    const Mesh* mesh;
+    const Texture* texture;
+    glm::mat4 modelMatrix;
+    uint64_t sortKey = 0;                   // Draw order, lower first; ties sort by state
+    PipelineFeatures pipelineFeatures = 0;  // PIPELINE_FEATURE_* bits
+};
+
+// Non-owning shared_ptr for looking a raw handle up in containers keyed by
+// shared_ptr: hashing and equality only use the stored pointer, and with
+// an empty owner no reference count is touched
+template <typename T>
+std::shared_ptr<T> LookupKey(const T* pointer) {
+    return std::shared_ptr<T>(std::shared_ptr<T>(), const_cast<T*>(pointer));
+}
+
 #endif // RENDEROBJECT_H
 
@@ -10,7 +10,10 @@ void VulkanDriver::CreateRenderPass() {
   colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // Offscreen targets are left ready to be copied back to the CPU
+  colorAttachment.finalLayout    = offscreen
+                                     ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                     : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference colorAttachmentRef{};
   colorAttachmentRef.attachment = 0;
@@ -44,6 +47,17 @@ void VulkanDriver::CreateRenderPass() {
   dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+  // Color writes must be visible to the readback copy after the pass
+  VkSubpassDependency readbackDependency{};
+  readbackDependency.srcSubpass    = 0;
+  readbackDependency.dstSubpass    = VK_SUBPASS_EXTERNAL;
+  readbackDependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  readbackDependency.dstStageMask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::array<VkSubpassDependency, 2> dependencies = { dependency, readbackDependency };
+
   std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
   VkRenderPassCreateInfo renderPassInfo{};
   renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -51,8 +65,8 @@ void VulkanDriver::CreateRenderPass() {
   renderPassInfo.pAttachments    = attachments.data(); 
   renderPassInfo.subpassCount    = 1;
   renderPassInfo.pSubpasses      = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies   = &dependency;
+  renderPassInfo.dependencyCount = offscreen ? 2 : 1;
+  renderPassInfo.pDependencies   = dependencies.data();
 
   if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) !=
       VK_SUCCESS) {
@@ -1,178 +1,235 @@
 #include "Vulkan.h"
 #include "RenderObject.h"
+#include "../../AssetLoader.h"
 #include "../../../../Utils/FileUtils.h"
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-#include <unordered_map>
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 
-std::shared_ptr<Mesh> VulkanDriver::LoadMesh(const std::string& modelPath) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    
+std::shared_ptr<Mesh> VulkanDriver::LoadMesh(const std::string& modelPath, MeshCreateFlags flags) {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
-    
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str())) {
-        throw std::runtime_error("Failed to load model: " + warn + err);
-    }
-
-    for (const auto& shape: shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-            
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-
-            vertex.color = {1.0f, 1.0f, 1.0f};
-
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            
-            indices.push_back(uniqueVertices[vertex]);
-        }
-    }
+    LoadObjGeometry(modelPath, vertices, indices);
 
     std::cout << "Loaded mesh from " << modelPath << ": " << vertices.size() 
               << " vertices, " << indices.size() << " indices" << std::endl;
 
-    auto mesh = std::make_shared<Mesh>(vertices, indices);
+    auto mesh = std::make_shared<Mesh>(std::move(vertices), std::move(indices));
     
     // Create Vulkan resources for this mesh
-    meshResources[mesh] = CreateVulkanMesh(*mesh);
+    RegisterMesh(mesh, flags);
     
     return mesh;
 }
 
 std::shared_ptr<Texture> VulkanDriver::LoadTexture(const std::string& texturePath) {
-    auto texture = std::make_shared<Texture>();
-    
-    // Create Vulkan resources for this texture
-    VulkanTexture vulkanTexture = CreateVulkanTexture(texturePath);
-    textureResources[texture] = vulkanTexture;
-    
-    // Create descriptor sets for this texture
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
-    
-    std::vector<VkDescriptorSet> textureSets(MAX_FRAMES_IN_FLIGHT);
-    if (vkAllocateDescriptorSets(device, &allocInfo, textureSets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate texture descriptor sets!");
-    }
-    
-    // Update descriptor sets with texture info
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-        
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = vulkanTexture.imageView;
-        imageInfo.sampler = defaultTextureSampler;
-        
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = textureSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-        
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = textureSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-        
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()),
-                              descriptorWrites.data(), 0, nullptr);
-    }
-    
-    textureDescriptorSets[texture] = textureSets;
-    
-    // Update texture object with Vulkan handles
-    texture->image = vulkanTexture.image;
-    texture->imageMemory = vulkanTexture.imageMemory;
-    texture->imageView = vulkanTexture.imageView;
-    texture->sampler = defaultTextureSampler;  // Use shared sampler
+    // Decode straight into staging memory
+    TextureUpload upload;
+    LoadImagePixels(texturePath, [this, &upload](uint32_t width, uint32_t height) {
+        upload = BeginTextureUpload(width, height);
+        return upload.pixels;
+    });
+    auto texture = CommitTextureUpload(upload);
     
     std::cout << "Loaded texture from " << texturePath << std::endl;
     
     return texture;
 }
 
-std::shared_ptr<Mesh> VulkanDriver::CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
-    auto mesh = std::make_shared<Mesh>(vertices, indices);
+std::shared_ptr<Mesh> VulkanDriver::CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshCreateFlags flags) {
+    return CreateMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), flags);
+}
+
+std::shared_ptr<Mesh> VulkanDriver::CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, MeshCreateFlags flags) {
+    auto mesh = std::make_shared<Mesh>(std::move(vertices), std::move(indices));
     
     // Create Vulkan resources for this mesh
-    meshResources[mesh] = CreateVulkanMesh(*mesh);
+    RegisterMesh(mesh, flags);
     
-    std::cout << "Created mesh programmatically: " << vertices.size() 
-              << " vertices, " << indices.size() << " indices" << std::endl;
+    std::cout << "Created mesh programmatically: " << mesh->GetVertexCount() 
+              << " vertices, " << mesh->GetIndexCount() << " indices" << std::endl;
     
     return mesh;
 }
 
-std::shared_ptr<Texture> VulkanDriver::CreateTexture(uint32_t width, uint32_t height, const void* pixelData) {
-    auto texture = std::make_shared<Texture>();
+std::shared_ptr<Mesh> VulkanDriver::CreateMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshCreateFlags flags) {
+    if (!(flags & MESH_CREATE_RELEASE_CPU_DATA)) {
+        return CreateMesh(std::vector<Vertex>(vertices, vertices + vertexCount),
+                          std::vector<uint32_t>(indices, indices + indexCount), flags);
+    }
+
+    // Nothing to keep, so skip the vectors and copy to staging directly
+    MeshUpload upload = BeginMeshUpload(vertexCount, indexCount);
+    memcpy(upload.vertices, vertices, vertexCount * sizeof(Vertex));
+    memcpy(upload.indices, indices, indexCount * sizeof(uint32_t));
+    Mesh::ComputeBounds(vertices, vertexCount, upload.boundsMin, upload.boundsMax);
+    auto mesh = CommitMeshUpload(upload);
     
-    // Create Vulkan texture from pixel data
-    VkDeviceSize imageSize = width * height * 4; // RGBA
+    std::cout << "Created mesh programmatically: " << vertexCount 
+              << " vertices, " << indexCount << " indices" << std::endl;
     
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    return mesh;
+}
+
+// Indices follow the vertices in one staging reservation
+static VkDeviceSize MeshIndexOffset(size_t vertexCount) {
+    return (sizeof(Vertex) * vertexCount + 15) / 16 * 16;
+}
+
+MeshUpload VulkanDriver::BeginMeshUpload(size_t vertexCount, size_t indexCount) {
+    if (vertexCount == 0 || indexCount == 0) {
+        throw std::runtime_error("BeginMeshUpload called for an empty mesh!");
+    }
+
+    StagingReservation reservation =
+        ReserveStaging(MeshIndexOffset(vertexCount) + sizeof(uint32_t) * indexCount);
+    MeshUpload upload;
+    upload.id = reservation.id;
+    upload.vertexCount = vertexCount;
+    upload.indexCount = indexCount;
+    upload.vertices = reinterpret_cast<Vertex*>(reservation.data);
+    upload.indices = reinterpret_cast<uint32_t*>(reservation.data + MeshIndexOffset(vertexCount));
+    return upload;
+}
+
+std::shared_ptr<Mesh> VulkanDriver::CommitMeshUpload(const MeshUpload& upload) {
+    auto mesh = std::make_shared<Mesh>(upload.vertexCount, upload.indexCount,
+                                       upload.boundsMin, upload.boundsMax);
+    meshResources[mesh] = UploadMesh(upload);
+    return mesh;
+}
+
+void VulkanDriver::CancelMeshUpload(const MeshUpload& upload) {
+    CancelStaging(upload.id);
+}
+
+std::shared_ptr<Mesh> VulkanDriver::CreateVoxelMesh(const VoxelVertex* vertices, size_t vertexCount) {
+    if (vertexCount == 0 || vertexCount % 4 != 0) {
+        throw std::runtime_error("CreateVoxelMesh needs four vertices per quad!");
+    }
+    size_t quadCount = vertexCount / 4;
+    EnsureQuadIndices(quadCount);
+
+    VkDeviceSize vertexBufferSize = sizeof(VoxelVertex) * vertexCount;
+    StagingReservation staging = ReserveStaging(vertexBufferSize);
+    memcpy(staging.data, vertices, vertexBufferSize);
+
+    VulkanMesh vulkanMesh{};
+    UploadStagedBuffer(staging, vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                       VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                       vulkanMesh.vertexBuffer, vulkanMesh.vertexBufferMemory);
+    vulkanMesh.indexBuffer = VK_NULL_HANDLE;
+    vulkanMesh.indexBufferMemory = VK_NULL_HANDLE;
+    vulkanMesh.indexCount = static_cast<uint32_t>(quadCount * 6);
+
+    glm::vec3 boundsMin, boundsMax;
+    Mesh::ComputeBounds(vertices, vertexCount, boundsMin, boundsMax);
+    auto mesh = std::make_shared<Mesh>(vertexCount, quadCount * 6, boundsMin, boundsMax,
+                                       VERTEX_FORMAT_VOXEL);
+    meshResources[mesh] = vulkanMesh;
+    return mesh;
+}
+
+void VulkanDriver::EnsureQuadIndices(size_t quadCount) {
+    if (quadCount <= quadIndexCapacity) {
+        return;
+    }
+    // Vertex numbers have to fit the 32-bit indices
+    if (quadCount > UINT32_MAX / 4) {
+        throw std::runtime_error("Voxel mesh has too many quads!");
+    }
+    size_t capacity = std::max<size_t>(quadIndexCapacity * 2, 16384);
+    while (capacity < quadCount) {
+        capacity *= 2;
+    }
+    capacity = std::min<size_t>(capacity, UINT32_MAX / 4);
+
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * 6 * capacity;
+    StagingReservation staging = ReserveStaging(indexBufferSize);
+    uint32_t* indices = reinterpret_cast<uint32_t*>(staging.data);
+    for (size_t quad = 0; quad < capacity; quad++) {
+        uint32_t first = static_cast<uint32_t>(quad * 4);
+        uint32_t* out = indices + quad * 6;
+        out[0] = first;
+        out[1] = first + 1;
+        out[2] = first + 2;
+        out[3] = first + 2;
+        out[4] = first + 3;
+        out[5] = first;
+    }
+
+    // Frames in flight may still draw with the smaller buffer
+    if (quadIndexBuffer != VK_NULL_HANDLE) {
+        VkBuffer oldBuffer = quadIndexBuffer;
+        VkDeviceMemory oldMemory = quadIndexBufferMemory;
+        DeferDestruction([this, oldBuffer, oldMemory]() {
+            vkDestroyBuffer(device, oldBuffer, nullptr);
+            vkFreeMemory(device, oldMemory, nullptr);
+        });
+    }
+    UploadStagedBuffer(staging, indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                       VK_ACCESS_INDEX_READ_BIT, quadIndexBuffer, quadIndexBufferMemory);
+    quadIndexCapacity = capacity;
+}
+
+std::shared_ptr<Texture> VulkanDriver::CreateTexture(uint32_t width, uint32_t height, const void* pixelData) {
+    if (!pixelData) {
+        throw std::runtime_error("CreateTexture called without pixel data!");
+    }
+
+    TextureUpload upload = BeginTextureUpload(width, height);
+    memcpy(upload.pixels, pixelData, upload.Size());
+    auto texture = CommitTextureUpload(upload);
     
-    CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory);
+    std::cout << "Created texture programmatically: " << width << "x" << height << std::endl;
     
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixelData, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+    return texture;
+}
+
+void VulkanDriver::CancelTextureUpload(const TextureUpload& upload) {
+    CancelStaging(upload.id);
+}
+
+TextureUpload VulkanDriver::BeginTextureUpload(uint32_t width, uint32_t height) {
+    if (width == 0 || height == 0) {
+        throw std::runtime_error("BeginTextureUpload called for an empty image!");
+    }
+
+    TextureUpload upload;
+    upload.width = width;
+    upload.height = height;
+    StagingReservation reservation = ReserveStaging(upload.Size());
+    upload.id = reservation.id;
+    upload.pixels = reservation.data;
+    return upload;
+}
+
+std::shared_ptr<Texture> VulkanDriver::CommitTextureUpload(const TextureUpload& upload) {
+    StagingReservation* reservation = FindStaging(upload.id);
+    if (!reservation || reservation->size < upload.Size()) {
+        throw std::runtime_error("CommitTextureUpload called with an unknown upload!");
+    }
+
+    auto texture = std::make_shared<Texture>();
     
     VulkanTexture vulkanTexture{};
-    CreateImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+    CreateImage(upload.width, upload.height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 vulkanTexture.image, vulkanTexture.imageMemory);
     
-    TransitionImageLayout(vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    CopyBufferToImage(stagingBuffer, vulkanTexture.image, width, height);
-    
-    TransitionImageLayout(vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    // Transitions and copy go out as one submission nobody waits for, the
+    // barriers order it before any later frame that samples the image
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    RecordImageLayoutTransition(commandBuffer, vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    RecordCopyBufferToImage(commandBuffer, reservation->buffer, reservation->offset,
+                            vulkanTexture.image, upload.width, upload.height);
+    RecordImageLayoutTransition(commandBuffer, vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    SubmitUploadCommands(commandBuffer, upload.id);
     
     vulkanTexture.imageView = CreateImageView(vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
                                                VK_IMAGE_ASPECT_COLOR_BIT);
@@ -192,6 +249,7 @@ std::shared_ptr<Texture> VulkanDriver::CreateTexture(uint32_t width, uint32_t he
     if (vkAllocateDescriptorSets(device, &allocInfo, textureSets.data()) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate texture descriptor sets!");
     }
+    renderStats.Current().descriptorSetsAllocated += MAX_FRAMES_IN_FLIGHT;
     
     // Update descriptor sets with texture info
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -234,11 +292,61 @@ std::shared_ptr<Texture> VulkanDriver::CreateTexture(uint32_t width, uint32_t he
     texture->imageView = vulkanTexture.imageView;
     texture->sampler = defaultTextureSampler;
     
-    std::cout << "Created texture programmatically: " << width << "x" << height << std::endl;
-    
     return texture;
 }
 
+void VulkanDriver::ReleaseMesh(const std::shared_ptr<Mesh>& mesh) {
+    auto it = meshResources.find(mesh);
+    if (it == meshResources.end()) {
+        std::cerr << "Warning: ReleaseMesh called for a mesh this driver does not own" << std::endl;
+        return;
+    }
+
+    // Frames in flight may still draw from the buffers
+    VulkanMesh vulkanMesh = it->second;
+    meshResources.erase(it);
+    renderQueue.Forget(mesh.get());
+    DeferDestruction([this, vulkanMesh]() mutable {
+        DestroyVulkanMesh(vulkanMesh);
+    });
+}
+
+void VulkanDriver::ReleaseTexture(const std::shared_ptr<Texture>& texture) {
+    auto it = textureResources.find(texture);
+    if (it == textureResources.end()) {
+        std::cerr << "Warning: ReleaseTexture called for a texture this driver does not own" << std::endl;
+        return;
+    }
+
+    VulkanTexture vulkanTexture = it->second;
+    textureResources.erase(it);
+    renderQueue.Forget(texture.get());
+
+    std::vector<VkDescriptorSet> textureSets;
+    auto setsIt = textureDescriptorSets.find(texture);
+    if (setsIt != textureDescriptorSets.end()) {
+        textureSets = std::move(setsIt->second);
+        textureDescriptorSets.erase(setsIt);
+    }
+
+    // The handles are about to go away, don't leave them dangling
+    texture->image = VK_NULL_HANDLE;
+    texture->imageMemory = VK_NULL_HANDLE;
+    texture->imageView = VK_NULL_HANDLE;
+    texture->sampler = VK_NULL_HANDLE;
+
+    // Frames in flight may still sample the image through its sets, the sets
+    // go back to the pool together with the image
+    DeferDestruction([this, vulkanTexture, textureSets]() mutable {
+        if (!textureSets.empty()) {
+            vkFreeDescriptorSets(device, descriptorPool,
+                                 static_cast<uint32_t>(textureSets.size()),
+                                 textureSets.data());
+        }
+        DestroyVulkanTexture(vulkanTexture);
+    });
+}
+
 void VulkanDriver::SubmitRenderObject(const RenderObject& renderObject) {
     if (!renderObject.mesh || !renderObject.texture) {
         std::cerr << "Warning: RenderObject missing mesh or texture, skipping" << std::endl;
@@ -252,12 +360,54 @@ void VulkanDriver::SubmitRenderObject(const RenderObject& renderObject) {
     if (textureResources.find(renderObject.texture) == textureResources.end()) {
         throw std::runtime_error("Texture not found in resources - was it loaded through LoadTexture?");
     }
+    if ((renderObject.mesh->GetVertexFormat() == VERTEX_FORMAT_VOXEL) !=
+        ((renderObject.pipelineFeatures & PIPELINE_FEATURE_VOXEL) != 0)) {
+        throw std::runtime_error("Voxel meshes must be drawn with PIPELINE_FEATURE_VOXEL, and only they");
+    }
+    // Handles are only good for the frame they were allocated in, which is
+    // the latched one
+    if (renderObject.frameData != 0 &&
+        (!framePacer.InputLatched() ||
+         (renderObject.frameData >> 32) > frameDataBlocks[frameDataFrame].size())) {
+        throw std::runtime_error("Frame data was not allocated for this frame");
+    }
+    if (renderObject.pipelineFeatures & PIPELINE_FEATURE_INSTANCED) {
+        if (renderObject.pipelineFeatures & PIPELINE_FEATURE_VOXEL) {
+            throw std::runtime_error("Voxel meshes can't be drawn instanced");
+        }
+        if (renderObject.frameData == 0 ||
+            static_cast<uint64_t>(renderObject.instanceCount) * sizeof(glm::mat4) > FRAME_DATA_MAX_SIZE) {
+            throw std::runtime_error("Instanced objects need a mat4 per instance in their frame data");
+        }
+    }
     
-    renderQueue.push_back(renderObject);
+    renderQueue.Submit(renderObject);
+}
+
+void VulkanDriver::SubmitRenderPackets(const RenderPacket* packets, size_t count) {
+#ifndef NDEBUG
+    for (size_t i = 0; i < count; i++) {
+        if (meshResources.find(LookupKey(packets[i].mesh)) == meshResources.end()) {
+            throw std::runtime_error("RenderPacket mesh not found in resources - was it created by this driver?");
+        }
+        if (textureResources.find(LookupKey(packets[i].texture)) == textureResources.end()) {
+            throw std::runtime_error("RenderPacket texture not found in resources - was it created by this driver?");
+        }
+        if ((packets[i].mesh->GetVertexFormat() == VERTEX_FORMAT_VOXEL) !=
+            ((packets[i].pipelineFeatures & PIPELINE_FEATURE_VOXEL) != 0)) {
+            throw std::runtime_error("Voxel meshes must be drawn with PIPELINE_FEATURE_VOXEL, and only they");
+        }
+        if (packets[i].pipelineFeatures & PIPELINE_FEATURE_INSTANCED) {
+            throw std::runtime_error("RenderPackets have no frame data and can't be drawn instanced");
+        }
+    }
+#endif
+
+    renderQueue.Submit(packets, count);
 }
 
 void VulkanDriver::ClearRenderQueue() {
-    renderQueue.clear();
+    renderQueue.Clear();
 }
 
 void VulkanDriver::SetViewMatrix(const glm::mat4& view) {
@@ -268,116 +418,108 @@ void VulkanDriver::SetProjectionMatrix(const glm::mat4& projection) {
     projectionMatrix = projection;
 }
 
-VulkanMesh VulkanDriver::CreateVulkanMesh(const Mesh& mesh) {
-    VulkanMesh vulkanMesh{};
-    const auto& vertices = mesh.GetVertices();
-    const auto& indices = mesh.GetIndices();
-    
-    // Create vertex buffer
-    VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-    
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory);
+RenderStats& VulkanDriver::GetRenderStats() {
+    return renderStats;
+}
 
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, vertexBufferSize, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(vertexBufferSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+// Uploads the mesh's CPU data, then drops it if the flags say so
+void VulkanDriver::RegisterMesh(const std::shared_ptr<Mesh>& mesh, MeshCreateFlags flags) {
+    const auto& vertices = mesh->GetVertices();
+    const auto& indices = mesh->GetIndices();
 
-    CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 vulkanMesh.vertexBuffer, vulkanMesh.vertexBufferMemory);
+    MeshUpload upload = BeginMeshUpload(vertices.size(), indices.size());
+    memcpy(upload.vertices, vertices.data(), vertices.size() * sizeof(Vertex));
+    memcpy(upload.indices, indices.data(), indices.size() * sizeof(uint32_t));
+    meshResources[mesh] = UploadMesh(upload);
 
-    CopyBuffer(stagingBuffer, vulkanMesh.vertexBuffer, vertexBufferSize);
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    if (flags & MESH_CREATE_RELEASE_CPU_DATA) {
+        mesh->ReleaseCpuData();
+    }
+}
 
-    // Create index buffer
-    VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
-    
-    CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                 stagingBuffer, stagingBufferMemory);
+VulkanMesh VulkanDriver::UploadMesh(const MeshUpload& upload) {
+    StagingReservation* staging = FindStaging(upload.id);
+    if (!staging) {
+        throw std::runtime_error("CommitMeshUpload called with an unknown upload!");
+    }
 
-    vkMapMemory(device, stagingBufferMemory, 0, indexBufferSize, 0, &data);
-    memcpy(data, indices.data(), indexBufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+    VulkanMesh vulkanMesh{};
+    VkDeviceSize vertexBufferSize = sizeof(Vertex) * upload.vertexCount;
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * upload.indexCount;
 
+    CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 vulkanMesh.vertexBuffer, vulkanMesh.vertexBufferMemory);
     CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                  vulkanMesh.indexBuffer, vulkanMesh.indexBufferMemory);
-    CopyBuffer(stagingBuffer, vulkanMesh.indexBuffer, indexBufferSize);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-    
-    vulkanMesh.indexCount = static_cast<uint32_t>(indices.size());
-    
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+
+    VkBufferCopy vertexCopy{};
+    vertexCopy.srcOffset = staging->offset;
+    vertexCopy.size = vertexBufferSize;
+    vkCmdCopyBuffer(commandBuffer, staging->buffer, vulkanMesh.vertexBuffer, 1, &vertexCopy);
+
+    VkBufferCopy indexCopy{};
+    indexCopy.srcOffset = staging->offset + MeshIndexOffset(upload.vertexCount);
+    indexCopy.size = indexBufferSize;
+    vkCmdCopyBuffer(commandBuffer, staging->buffer, vulkanMesh.indexBuffer, 1, &indexCopy);
+
+    // Nobody waits for the copies, later frames on the queue read the
+    // buffers after this barrier
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier,
+                         0, nullptr, 0, nullptr);
+
+    SubmitUploadCommands(commandBuffer, upload.id);
+    renderStats.Current().bytesUploaded += vertexBufferSize + indexBufferSize;
+
+    vulkanMesh.indexCount = static_cast<uint32_t>(upload.indexCount);
     return vulkanMesh;
 }
 
+void VulkanDriver::UploadStagedBuffer(const StagingReservation& staging, VkDeviceSize size,
+                                      VkBufferUsageFlags usage, VkAccessFlags dstAccess,
+                                      VkBuffer& buffer, VkDeviceMemory& memory) {
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    VkBufferCopy copy{};
+    copy.srcOffset = staging.offset;
+    copy.size = size;
+    vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer, 1, &copy);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier,
+                         0, nullptr, 0, nullptr);
+
+    SubmitUploadCommands(commandBuffer, staging.id);
+    renderStats.Current().bytesUploaded += size;
+}
+
 void VulkanDriver::DestroyVulkanMesh(VulkanMesh& vulkanMesh) {
+    // GPU-meshed chunks not moved out of their batch yet own nothing, the
+    // batch's buffers go with CompactGpuVoxelMeshes()
+    if (vulkanMesh.voxelBatch) {
+        vulkanMesh.voxelBatch.reset();
+        return;
+    }
     vkDestroyBuffer(device, vulkanMesh.vertexBuffer, nullptr);
     vkFreeMemory(device, vulkanMesh.vertexBufferMemory, nullptr);
     vkDestroyBuffer(device, vulkanMesh.indexBuffer, nullptr);
     vkFreeMemory(device, vulkanMesh.indexBufferMemory, nullptr);
 }
 
-VulkanTexture VulkanDriver::CreateVulkanTexture(const std::string& texturePath) {
-    VulkanTexture vulkanTexture{};
-    
-    int texWidth, texHeight, texChannels;
-    stbi_uc *pixels = stbi_load(texturePath.c_str(), &texWidth, &texHeight,
-                                &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-    if (!pixels) {
-        throw std::runtime_error("Failed to load texture: " + texturePath);
-    }
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
-    stbi_image_free(pixels);
-
-    CreateImage(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight),
-                VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                vulkanTexture.image, vulkanTexture.imageMemory);
-
-    TransitionImageLayout(vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
-                          VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    CopyBufferToImage(stagingBuffer, vulkanTexture.image,
-                      static_cast<uint32_t>(texWidth),
-                      static_cast<uint32_t>(texHeight));
-
-    TransitionImageLayout(vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-    
-    vulkanTexture.imageView = CreateImageView(vulkanTexture.image, VK_FORMAT_R8G8B8A8_SRGB,
-                                               VK_IMAGE_ASPECT_COLOR_BIT);
-    vulkanTexture.sampler = defaultTextureSampler;
-    
-    return vulkanTexture;
-}
-
 void VulkanDriver::DestroyVulkanTexture(VulkanTexture& vulkanTexture) {
     vkDestroyImageView(device, vulkanTexture.imageView, nullptr);
     vkDestroyImage(device, vulkanTexture.image, nullptr);
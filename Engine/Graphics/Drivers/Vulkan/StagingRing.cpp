@@ -0,0 +1,189 @@
+#include "Vulkan.h"
+
+#include <stdexcept>
+
+// Buffer to image copies of RGBA8 data need 4 byte offsets, buffer copies
+// are happy with anything; 16 keeps reservations on a comfortable boundary
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+void VulkanDriver::CreateStagingRing() {
+  CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               stagingRingBuffer, stagingRingMemory);
+
+  void *mapped;
+  vkMapMemory(device, stagingRingMemory, 0, STAGING_RING_SIZE, 0, &mapped);
+  stagingRingMapped = static_cast<uint8_t *>(mapped);
+  stagingRingHead   = 0;
+}
+
+// Only call once the device is idle
+void VulkanDriver::DestroyStagingRing() {
+  for (auto &[id, reservation] : dedicatedStaging) {
+    vkUnmapMemory(device, reservation.dedicatedMemory);
+    vkDestroyBuffer(device, reservation.buffer, nullptr);
+    vkFreeMemory(device, reservation.dedicatedMemory, nullptr);
+  }
+  dedicatedStaging.clear();
+  stagingReservations.clear();
+
+  if (stagingRingBuffer != VK_NULL_HANDLE) {
+    vkUnmapMemory(device, stagingRingMemory);
+    vkDestroyBuffer(device, stagingRingBuffer, nullptr);
+    vkFreeMemory(device, stagingRingMemory, nullptr);
+    stagingRingBuffer = VK_NULL_HANDLE;
+    stagingRingMapped = nullptr;
+  }
+}
+
+VulkanDriver::StagingReservation VulkanDriver::ReserveStaging(VkDeviceSize size) {
+  size = (size + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+  ReclaimStaging();
+
+  // Live reservations sit between the front's offset (the tail) and the
+  // head, possibly wrapping around the end of the buffer
+  auto findSpace = [&](VkDeviceSize &offset) {
+    if (stagingReservations.empty()) {
+      stagingRingHead = 0;
+      offset          = 0;
+      return true;
+    }
+    VkDeviceSize tail = stagingReservations.front().offset;
+    if (stagingRingHead > tail) {
+      if (stagingRingHead + size <= STAGING_RING_SIZE) {
+        offset = stagingRingHead;
+        return true;
+      }
+      // Wrap, stopping short of the tail so a full ring never looks empty
+      if (size < tail) {
+        offset = 0;
+        return true;
+      }
+      return false;
+    }
+    if (stagingRingHead + size < tail) {
+      offset = stagingRingHead;
+      return true;
+    }
+    return false;
+  };
+
+  if (size <= STAGING_RING_SIZE) {
+    VkDeviceSize offset = 0;
+    bool         found  = findSpace(offset);
+    // Full of copies in flight, wait for the oldest one to execute
+    while (!found && stagingReservations.front().committed) {
+      WaitForGpuWork(stagingReservations.front().retiredAfterWork);
+      ReclaimStaging();
+      found = findSpace(offset);
+    }
+
+    if (found) {
+      StagingReservation reservation{nextStagingId++, stagingRingBuffer, offset,
+                                     size, stagingRingMapped + offset};
+      stagingReservations.push_back(reservation);
+      stagingRingHead = offset + size;
+      return reservation;
+    }
+  }
+
+  // Larger than the whole ring, or the front is still being filled by
+  // the caller and nothing behind it can be reclaimed
+  StagingReservation reservation{nextStagingId++, VK_NULL_HANDLE, 0, size, nullptr};
+  CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               reservation.buffer, reservation.dedicatedMemory);
+  void *mapped;
+  vkMapMemory(device, reservation.dedicatedMemory, 0, size, 0, &mapped);
+  reservation.data                  = static_cast<uint8_t *>(mapped);
+  dedicatedStaging[reservation.id] = reservation;
+  return reservation;
+}
+
+VulkanDriver::StagingReservation *VulkanDriver::FindStaging(uint64_t id) {
+  for (auto &reservation : stagingReservations) {
+    if (reservation.id == id) { return &reservation; }
+  }
+  auto it = dedicatedStaging.find(id);
+  return it != dedicatedStaging.end() ? &it->second : nullptr;
+}
+
+// Call right after submitting the work that reads the reservation
+void VulkanDriver::RetireStaging(uint64_t id) {
+  auto it = dedicatedStaging.find(id);
+  if (it != dedicatedStaging.end()) {
+    StagingReservation reservation = it->second;
+    dedicatedStaging.erase(it);
+    DeferDestruction([this, reservation]() {
+      vkUnmapMemory(device, reservation.dedicatedMemory);
+      vkDestroyBuffer(device, reservation.buffer, nullptr);
+      vkFreeMemory(device, reservation.dedicatedMemory, nullptr);
+    });
+    return;
+  }
+
+  StagingReservation *reservation = FindStaging(id);
+  if (!reservation) {
+    throw std::runtime_error("Unknown staging reservation!");
+  }
+  reservation->committed        = true;
+  reservation->retiredAfterWork = submittedWorkValue;
+}
+
+// For a reservation nothing will read. A dedicated buffer goes at once;
+// ring space is retired as already executed, so reclaim gets past it
+// rather than stopping there for good.
+void VulkanDriver::CancelStaging(uint64_t id) {
+  auto it = dedicatedStaging.find(id);
+  if (it != dedicatedStaging.end()) {
+    vkUnmapMemory(device, it->second.dedicatedMemory);
+    vkDestroyBuffer(device, it->second.buffer, nullptr);
+    vkFreeMemory(device, it->second.dedicatedMemory, nullptr);
+    dedicatedStaging.erase(it);
+    return;
+  }
+
+  StagingReservation *reservation = FindStaging(id);
+  if (!reservation || reservation->committed) {
+    throw std::runtime_error("Unknown staging reservation!");
+  }
+  reservation->committed        = true;
+  reservation->retiredAfterWork = completedWorkValue;
+  ReclaimStaging();
+}
+
+// Ends and submits upload commands that read from a staging reservation.
+// Nothing waits for them, the command buffer and the staging space are
+// recycled once the GPU timeline passes the submission.
+void VulkanDriver::SubmitUploadCommands(VkCommandBuffer commandBuffer,
+                                        uint64_t        stagingId) {
+  SubmitSingleTimeCommands(commandBuffer);
+  RetireStaging(stagingId);
+}
+
+// EndSingleTimeCommands() without the wait, the command buffer is freed
+// once it has run
+void VulkanDriver::SubmitSingleTimeCommands(VkCommandBuffer commandBuffer) {
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &commandBuffer;
+  SubmitGraphicsWork(submitInfo, VK_NULL_HANDLE);
+
+  DeferDestruction([this, commandBuffer]() {
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+  });
+}
+
+void VulkanDriver::ReclaimStaging() {
+  // Reservations commit in any order but are freed in ring order, a slow
+  // one at the front holds back the ones behind it
+  while (!stagingReservations.empty() && stagingReservations.front().committed &&
+         IsGpuWorkComplete(stagingReservations.front().retiredAfterWork)) {
+    stagingReservations.pop_front();
+  }
+}
@@ -1,4 +1,5 @@
 #include "Vulkan.h"
+#include <algorithm>
 #include <iostream>
 #include <vulkan/vulkan_core.h>
 
@@ -44,9 +45,25 @@ VkSurfaceFormatKHR VulkanDriver::ChooseSwapSurfaceFormat(
 
 VkPresentModeKHR VulkanDriver::ChooseSwapPresentMode(
   const std::vector<VkPresentModeKHR> &availablePresentModes) {
-  for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      return availablePresentMode;
+  // FIFO is the only mode every device supports
+  std::vector<VkPresentModeKHR> preferred;
+  switch (framePacer.Pacing().mode) {
+  case FramePacingMode::Throughput:
+    preferred = {VK_PRESENT_MODE_MAILBOX_KHR};
+    break;
+  case FramePacingMode::LowLatency:
+    // Mailbox replaces queued images, immediate skips the queue entirely
+    preferred = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+    break;
+  case FramePacingMode::PowerSaver:
+    // Vsync'd so the GPU never renders frames that are never shown
+    break;
+  }
+
+  for (auto presentMode : preferred) {
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(),
+                  presentMode) != availablePresentModes.end()) {
+      return presentMode;
     }
   }
 
@@ -59,11 +76,7 @@ VkExtent2D
       std::numeric_limits<uint32_t>::max()) {
     return capabilities.currentExtent;
   } else {
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-
-    VkExtent2D actualExtent = {static_cast<uint32_t>(width),
-                               static_cast<uint32_t>(height)};
+    VkExtent2D actualExtent = CurrentFramebufferSize();
 
     actualExtent.width =
       std::clamp(actualExtent.width, capabilities.minImageExtent.width,
@@ -76,7 +89,7 @@ VkExtent2D
   }
 }
 
-void VulkanDriver::CreateSwapChain() {
+void VulkanDriver::CreateSwapChain(VkSwapchainKHR oldSwapChain) {
   SwapChainSupportDetails swapChainSupport =
     QuerySwapChainSupport(physicalDevice);
 
@@ -120,7 +133,7 @@ void VulkanDriver::CreateSwapChain() {
   createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
   createInfo.presentMode    = presentMode;
   createInfo.clipped        = VK_TRUE;
-  createInfo.oldSwapchain   = VK_NULL_HANDLE;
+  createInfo.oldSwapchain   = oldSwapChain;
 
   if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) !=
       VK_SUCCESS) {
@@ -160,17 +173,51 @@ void VulkanDriver::CreateFrameBuffers() {
   }
 }
 
-void VulkanDriver::RecreateSwapChain() {
-  vkDeviceWaitIdle(device);
+VkExtent2D VulkanDriver::CurrentFramebufferSize() {
+  if (framebufferSizeGiven) {
+    return framebufferSize;
+  }
   int width = 0, height = 0;
   glfwGetFramebufferSize(window, &width, &height);
-  while (width == 0 || height == 0) {
-    glfwGetFramebufferSize(window, &width, &height);
-    glfwWaitEvents();
+  return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+}
+
+void VulkanDriver::RecreateSwapChain() {
+  VkExtent2D size = CurrentFramebufferSize();
+  if (framebufferSizeGiven) {
+    // Minimized: the window's thread waits for it to come back and sends
+    // the new size, retry then
+    if (size.width == 0 || size.height == 0) {
+      framebufferResized = true;
+      return;
+    }
+  } else {
+    while (size.width == 0 || size.height == 0) {
+      glfwWaitEvents();
+      size = CurrentFramebufferSize();
+    }
   }
 
-  CleanupSwapChain();
-  CreateSwapChain();
+  // Frames in flight may still render to or present the old images, so they
+  // are retired instead of draining the device and freed once those frames'
+  // fences signal
+  VkSwapchainKHR             oldSwapChain    = swapChain;
+  std::vector<VkFramebuffer> oldFramebuffers = std::move(swapChainFramebuffers);
+  std::vector<VkImageView>   oldImageViews   = std::move(swapChainImageViews);
+  swapChainFramebuffers.clear();
+  swapChainImageViews.clear();
+
+  CreateSwapChain(oldSwapChain);
+  DeferDestruction([this, oldSwapChain, oldFramebuffers, oldImageViews]() {
+    for (auto framebuffer : oldFramebuffers) {
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (auto imageView : oldImageViews) {
+      vkDestroyImageView(device, imageView, nullptr);
+    }
+    vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+  });
+
   CreateImageViews();
   CreateDepthResources();
   CreateFrameBuffers();
@@ -188,5 +235,10 @@ void VulkanDriver::CleanupSwapChain() {
   vkDestroyImageView(device, depthImageView, nullptr);
   vkDestroyImage(device, depthImage, nullptr);
   vkFreeMemory(device, depthImageMemory, nullptr);
-  vkDestroySwapchainKHR(device, swapChain, nullptr);
+  depthImage       = VK_NULL_HANDLE;
+  depthImageExtent = {0, 0};
+  // Offscreen mode never loads the swapchain extension
+  if (swapChain != VK_NULL_HANDLE) {
+    vkDestroySwapchainKHR(device, swapChain, nullptr);
+  }
 }
@@ -51,7 +51,14 @@ void VulkanDriver::TransitionImageLayout(VkImage image, VkFormat format,
                                          VkImageLayout oldLayout,
                                          VkImageLayout newLayout) {
   VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+  RecordImageLayoutTransition(commandBuffer, image, format, oldLayout, newLayout);
+  EndSingleTimeCommands(commandBuffer);
+}
 
+void VulkanDriver::RecordImageLayoutTransition(VkCommandBuffer commandBuffer,
+                                               VkImage image, VkFormat format,
+                                               VkImageLayout oldLayout,
+                                               VkImageLayout newLayout) {
   VkImageMemoryBarrier barrier{};
   barrier.sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.oldLayout                   = oldLayout;
@@ -105,16 +112,21 @@ void VulkanDriver::TransitionImageLayout(VkImage image, VkFormat format,
 
   vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0,
                        nullptr, 0, nullptr, 1, &barrier);
-
-  EndSingleTimeCommands(commandBuffer);
 }
 
 void VulkanDriver::CopyBufferToImage(VkBuffer buffer, VkImage image,
                                      uint32_t width, uint32_t height) {
   VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+  RecordCopyBufferToImage(commandBuffer, buffer, 0, image, width, height);
+  EndSingleTimeCommands(commandBuffer);
+}
 
+void VulkanDriver::RecordCopyBufferToImage(VkCommandBuffer commandBuffer,
+                                           VkBuffer buffer, VkDeviceSize bufferOffset,
+                                           VkImage image, uint32_t width,
+                                           uint32_t height) {
   VkBufferImageCopy region{};
-  region.bufferOffset      = 0;
+  region.bufferOffset      = bufferOffset;
   region.bufferRowLength   = 0;
   region.bufferImageHeight = 0;
 
@@ -128,8 +140,7 @@ void VulkanDriver::CopyBufferToImage(VkBuffer buffer, VkImage image,
 
   vkCmdCopyBufferToImage(commandBuffer, buffer, image,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-  EndSingleTimeCommands(commandBuffer);
+  renderStats.Current().bytesUploaded += static_cast<uint64_t>(width) * height * 4;
 }
 
 void VulkanDriver::CreateDefaultTextureSampler() {
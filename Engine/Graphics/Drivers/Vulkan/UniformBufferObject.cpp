@@ -57,4 +57,5 @@ void VulkanDriver::UpdateUniformBuffer(uint32_t currentImage) {
 	ubo.proj[1][1] *= -1;
 
 	memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+	renderStats.Current().bytesUploaded += sizeof(ubo);
 }
@@ -33,3 +33,23 @@ std::array<VkVertexInputAttributeDescription, 3> Vertex::GetAttributeDescription
 	attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
 	return attributeDescriptions;
 }
+
+VkVertexInputBindingDescription VoxelVertex::GetBindingDescription() {
+	VkVertexInputBindingDescription bindingDescription{};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(VoxelVertex);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 1> VoxelVertex::GetAttributeDescriptions() {
+	std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
+
+	// The whole packed word, the vertex shader unpacks it
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32_UINT;
+	attributeDescriptions[0].offset = offsetof(VoxelVertex, data);
+	return attributeDescriptions;
+}
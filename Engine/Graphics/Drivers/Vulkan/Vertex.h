@@ -4,6 +4,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
@@ -20,6 +23,47 @@ struct Vertex {
 	}
 };
 
+// Which vertex struct a mesh's vertex buffer holds
+using VertexFormat = uint32_t;
+const VertexFormat VERTEX_FORMAT_STANDARD = 0; // Vertex
+const VertexFormat VERTEX_FORMAT_VOXEL    = 1; // VoxelVertex
+
+// Texture layers a VoxelVertex can address: the layer gets 9 bits, so
+// voxel types used as layers must stay below 512
+const uint32_t VOXEL_VERTEX_MAX_LAYERS = 512;
+
+// Corner of a voxel face in chunk-local space, packed into 32 bits and
+// decoded by the voxel shaders (shaders/voxel.vert):
+//   bits  0-17  x, y, z, 6 bits each (0..32)
+//   bits 18-20  face direction, VOXEL_FACE_*
+//   bits 21-22  ambient occlusion, 0 darkest to 3 unoccluded
+//   bits 23-31  texture layer, below VOXEL_VERTEX_MAX_LAYERS
+// Voxel meshes hold four of these per quad and no indices, see
+// IGraphicsDriver::CreateVoxelMesh.
+struct VoxelVertex {
+	uint32_t data;
+
+	// Throws when the layer doesn't fit rather than aliasing another one
+	static VoxelVertex Pack(uint32_t x, uint32_t y, uint32_t z, uint32_t face, uint32_t ao, uint32_t layer) {
+		if (layer >= VOXEL_VERTEX_MAX_LAYERS) {
+			throw std::runtime_error("Voxel texture layer out of range!");
+		}
+		return {(x & 63u) | (y & 63u) << 6 | (z & 63u) << 12 | (face & 7u) << 18 | (ao & 3u) << 21 |
+		        layer << 23};
+	}
+	glm::vec3 Position() const {
+		return glm::vec3(float(data & 63u), float((data >> 6) & 63u), float((data >> 12) & 63u));
+	}
+	uint32_t Face() const { return (data >> 18) & 7u; }
+	uint32_t AmbientOcclusion() const { return (data >> 21) & 3u; }
+	uint32_t Layer() const { return data >> 23; }
+
+	static VkVertexInputBindingDescription GetBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 1> GetAttributeDescriptions();
+
+	bool operator==(const VoxelVertex& other) const { return data == other.data; }
+};
+
 namespace std {
 	template<> struct hash<Vertex> {
 		size_t operator()(Vertex const& vertex) const {
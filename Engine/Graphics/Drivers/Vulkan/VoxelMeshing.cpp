@@ -0,0 +1,483 @@
+#include "../../../../Utils/FileUtils.h"
+#include "Mesh.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// Bindings of shaders/voxel_mesh.comp
+static const uint32_t VOXEL_MESH_BINDINGS = 5;
+// Invocations per workgroup and rows per chunk, as in the shader
+static const uint32_t VOXEL_MESH_GROUP_SIZE = 128;
+static const uint32_t VOXEL_MESH_CHUNK_ROWS = 32 * 32;
+// Status buffer header before the per-chunk quads
+static const VkDeviceSize VOXEL_MESH_STATUS_HEADER = 4 * sizeof(uint32_t);
+static const uint32_t     VOXEL_MESH_NO_CHUNK      = 0xFFFFFFFFu;
+// The shared quad index buffer stops growing here; a larger batch still
+// draws because each chunk starts from its own vertex offset
+static const size_t VOXEL_MESH_MAX_CHUNK_QUADS = 32 * 32 * 32 * 3;
+
+struct VoxelMeshPushConstants {
+  uint32_t chunkCount;
+  uint32_t recordBase;
+  uint32_t maxQuads;
+  uint32_t ambientOcclusion;
+};
+
+void VulkanDriver::CreateGpuVoxelMesher() {
+  // Meshing is recorded next to uploads on the graphics queue
+  QueueFamilyIndices indices = FindQueueFamilies(physicalDevice);
+  uint32_t           familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+  if (!(families[indices.graphicsFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+    throw std::runtime_error("the graphics queue can't run compute work");
+  }
+
+  std::vector<char> shaderCode;
+  try {
+    shaderCode = readFile("shaders/voxel_mesh_comp.spv");
+  } catch (const std::exception &) {
+    throw std::runtime_error("shaders/voxel_mesh_comp.spv is missing");
+  }
+  voxelMeshShaderModule = CreateShaderModule(shaderCode);
+
+  std::array<VkDescriptorSetLayoutBinding, VOXEL_MESH_BINDINGS> bindings{};
+  for (uint32_t binding = 0; binding < VOXEL_MESH_BINDINGS; binding++) {
+    bindings[binding].binding         = binding;
+    bindings[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[binding].descriptorCount = 1;
+    bindings[binding].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings    = bindings.data();
+  if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &voxelMeshSetLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create voxel meshing descriptor set layout!");
+  }
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset     = 0;
+  pushConstantRange.size       = sizeof(VoxelMeshPushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount         = 1;
+  pipelineLayoutInfo.pSetLayouts            = &voxelMeshSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+  if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &voxelMeshPipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create voxel meshing pipeline layout!");
+  }
+
+  // One pipeline per pass, picked by the PASS specialization constant
+  for (uint32_t pass = 0; pass < GPU_VOXEL_MESH_PASSES; pass++) {
+    VkSpecializationMapEntry mapEntry{0, 0, sizeof(uint32_t)};
+    VkSpecializationInfo     specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries   = &mapEntry;
+    specializationInfo.dataSize      = sizeof(uint32_t);
+    specializationInfo.pData         = &pass;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module              = voxelMeshShaderModule;
+    pipelineInfo.stage.pName               = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+    pipelineInfo.layout = voxelMeshPipelineLayout;
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+                                 &voxelMeshPipelines[pass]) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to create voxel meshing pipeline!");
+    }
+  }
+
+  VkDescriptorPoolSize poolSize{};
+  poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = GPU_VOXEL_MAX_BATCHES * VOXEL_MESH_BINDINGS;
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  // Each batch hands its set back once it has run
+  poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+  poolInfo.poolSizeCount = 1;
+  poolInfo.pPoolSizes    = &poolSize;
+  poolInfo.maxSets       = GPU_VOXEL_MAX_BATCHES;
+  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &voxelMeshDescriptorPool) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to create voxel meshing descriptor pool!");
+  }
+
+  gpuVoxelMeshingSupported = true;
+}
+
+// Only call once the device is idle and every batch has been collected.
+// Also cleans up after a CreateGpuVoxelMesher() that failed halfway.
+void VulkanDriver::DestroyGpuVoxelMesher() {
+  vkDestroyDescriptorPool(device, voxelMeshDescriptorPool, nullptr);
+  for (VkPipeline &pipeline : voxelMeshPipelines) {
+    vkDestroyPipeline(device, pipeline, nullptr);
+    pipeline = VK_NULL_HANDLE;
+  }
+  vkDestroyPipelineLayout(device, voxelMeshPipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, voxelMeshSetLayout, nullptr);
+  vkDestroyShaderModule(device, voxelMeshShaderModule, nullptr);
+  for (const FinishedVoxelBatch &finished : finishedVoxelBatches) {
+    vkDestroyBuffer(device, finished.batch->vertexBuffer, nullptr);
+    vkFreeMemory(device, finished.batch->vertexBufferMemory, nullptr);
+    vkDestroyBuffer(device, finished.batch->drawBuffer, nullptr);
+    vkFreeMemory(device, finished.batch->drawBufferMemory, nullptr);
+  }
+  finishedVoxelBatches.clear();
+  voxelMeshDescriptorPool  = VK_NULL_HANDLE;
+  voxelMeshPipelineLayout  = VK_NULL_HANDLE;
+  voxelMeshSetLayout       = VK_NULL_HANDLE;
+  voxelMeshShaderModule    = VK_NULL_HANDLE;
+  voxelMeshOverflows.clear();
+  gpuVoxelMeshingSupported = false;
+}
+
+// Builds the mesher on the first call. A missing shader or a device that
+// can't run it turns GPU meshing off instead of failing the driver.
+bool VulkanDriver::SupportsGpuVoxelMeshing() {
+  if (!gpuVoxelMesherProbed) {
+    gpuVoxelMesherProbed = true;
+    try {
+      CreateGpuVoxelMesher();
+    } catch (const std::exception &e) {
+      std::cerr << "GPU voxel meshing unavailable: " << e.what() << std::endl;
+      DestroyGpuVoxelMesher();
+    }
+  }
+  return gpuVoxelMeshingSupported;
+}
+
+VkDescriptorSet VulkanDriver::AllocateVoxelMeshSet() {
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool     = voxelMeshDescriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts        = &voxelMeshSetLayout;
+
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+    // Every set belongs to a batch in flight, wait for them to run
+    WaitForGpuWork(submittedWorkValue);
+    CollectDeferredDestructions();
+    if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+      throw std::runtime_error("Failed to allocate voxel meshing descriptor set!");
+    }
+  }
+  renderStats.Current().descriptorSetsAllocated++;
+  return set;
+}
+
+// Uploads the batch, records the three passes with barriers between them
+// and submits without waiting. The scratch buffers go once the GPU is
+// done, after the status buffer has been read for overflows and quad
+// counts; CompactGpuVoxelMeshes() then frees the batch's vertex space.
+void VulkanDriver::MeshVoxelChunksOnGpu(const GpuVoxelMeshInput &input,
+                                        std::vector<std::shared_ptr<Mesh>> &meshes) {
+  if (!SupportsGpuVoxelMeshing()) {
+    throw std::runtime_error("GPU voxel meshing is not supported on this device!");
+  }
+  if (input.chunkCount == 0) { return; }
+  if (input.maxQuads == 0 || input.maxQuads > INT32_MAX / 4) {
+    throw std::runtime_error("GPU voxel meshing batch has an invalid quad budget!");
+  }
+  EnsureQuadIndices(std::min<size_t>(input.maxQuads, VOXEL_MESH_MAX_CHUNK_QUADS));
+
+  size_t       slotWords  = static_cast<size_t>(input.chunkCount) * 27;
+  VkDeviceSize inputSize  = (slotWords + input.recordWords) * sizeof(uint32_t);
+  VkDeviceSize rowsSize   = VkDeviceSize(input.chunkCount) * VOXEL_MESH_CHUNK_ROWS * sizeof(uint32_t);
+  VkDeviceSize statusSize = VOXEL_MESH_STATUS_HEADER + VkDeviceSize(input.chunkCount) * 2 * sizeof(uint32_t);
+  VkDeviceSize drawsSize  = VkDeviceSize(input.chunkCount) * sizeof(VkDrawIndexedIndirectCommand);
+  VkDeviceSize vertexSize = VkDeviceSize(input.maxQuads) * 4 * sizeof(VoxelVertex);
+
+  StagingReservation staging = ReserveStaging(inputSize);
+  memcpy(staging.data, input.slots, slotWords * sizeof(uint32_t));
+  if (input.recordWords > 0) {
+    memcpy(staging.data + slotWords * sizeof(uint32_t), input.records,
+           input.recordWords * sizeof(uint32_t));
+  }
+
+  VkBuffer       inputBuffer, rowsBuffer, statusBuffer;
+  VkDeviceMemory inputMemory, rowsMemory, statusMemory;
+  CreateBuffer(inputSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, inputBuffer, inputMemory);
+  CreateBuffer(rowsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+               rowsBuffer, rowsMemory);
+  CreateBuffer(statusSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               statusBuffer, statusMemory);
+  void *statusMapped;
+  vkMapMemory(device, statusMemory, 0, statusSize, 0, &statusMapped);
+  memset(statusMapped, 0, statusSize);
+
+  auto batch = std::make_shared<VulkanVoxelBatch>();
+  CreateBuffer(drawsSize,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, batch->drawBuffer, batch->drawBufferMemory);
+  CreateBuffer(vertexSize,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, batch->vertexBuffer, batch->vertexBufferMemory);
+
+  VkDescriptorSet set = AllocateVoxelMeshSet();
+  std::array<VkDescriptorBufferInfo, VOXEL_MESH_BINDINGS> bufferInfos{};
+  bufferInfos[0] = {inputBuffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[1] = {rowsBuffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[2] = {statusBuffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[3] = {batch->drawBuffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[4] = {batch->vertexBuffer, 0, VK_WHOLE_SIZE};
+  std::array<VkWriteDescriptorSet, VOXEL_MESH_BINDINGS> writes{};
+  for (uint32_t binding = 0; binding < VOXEL_MESH_BINDINGS; binding++) {
+    writes[binding].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[binding].dstSet          = set;
+    writes[binding].dstBinding      = binding;
+    writes[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[binding].descriptorCount = 1;
+    writes[binding].pBufferInfo     = &bufferInfos[binding];
+  }
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+  VkBufferCopy    copy{};
+  copy.srcOffset = staging.offset;
+  copy.size      = inputSize;
+  vkCmdCopyBuffer(commandBuffer, staging.buffer, inputBuffer, 1, &copy);
+
+  auto memoryBarrier = [commandBuffer](VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                                       VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+  };
+  memoryBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+  VoxelMeshPushConstants constants{input.chunkCount, static_cast<uint32_t>(slotWords), input.maxQuads,
+                                   input.ambientOcclusion ? 1u : 0u};
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, voxelMeshPipelineLayout, 0, 1,
+                          &set, 0, nullptr);
+  vkCmdPushConstants(commandBuffer, voxelMeshPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(constants), &constants);
+  // Passes 0 and 2 run an invocation per row, pass 1 a workgroup per chunk
+  uint32_t rowGroups = input.chunkCount * (VOXEL_MESH_CHUNK_ROWS / VOXEL_MESH_GROUP_SIZE);
+  std::array<uint32_t, GPU_VOXEL_MESH_PASSES> groupCounts = {rowGroups, input.chunkCount, rowGroups};
+  for (uint32_t pass = 0; pass < GPU_VOXEL_MESH_PASSES; pass++) {
+    if (pass > 0) {
+      memoryBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, voxelMeshPipelines[pass]);
+    vkCmdDispatch(commandBuffer, groupCounts[pass], 1, 1);
+  }
+  memoryBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  memoryBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+  SubmitUploadCommands(commandBuffer, staging.id);
+  renderStats.Current().bytesUploaded += inputSize;
+
+  std::vector<std::weak_ptr<Mesh>> batchMeshes;
+  batchMeshes.reserve(input.chunkCount);
+  for (uint32_t chunk = 0; chunk < input.chunkCount; chunk++) {
+    auto mesh = std::make_shared<Mesh>(0, 0, glm::vec3(0.0f), glm::vec3(32.0f), VERTEX_FORMAT_VOXEL);
+    VulkanMesh vulkanMesh{};
+    vulkanMesh.vertexBuffer       = batch->vertexBuffer;
+    vulkanMesh.vertexBufferMemory = VK_NULL_HANDLE;
+    vulkanMesh.indexBuffer        = VK_NULL_HANDLE;
+    vulkanMesh.indexBufferMemory  = VK_NULL_HANDLE;
+    vulkanMesh.indexCount         = 0;
+    vulkanMesh.voxelBatch         = batch;
+    vulkanMesh.drawOffset         = VkDeviceSize(chunk) * sizeof(VkDrawIndexedIndirectCommand);
+    vulkanMesh.gpuMeshed          = true;
+    meshResources[mesh] = vulkanMesh;
+    meshes.push_back(mesh);
+    batchMeshes.push_back(mesh);
+  }
+
+  // Runs once the batch has executed, so the status is final
+  const uint32_t *status = static_cast<const uint32_t *>(statusMapped);
+  DeferDestruction([this, status, batch, batchMeshes, set, inputBuffer, inputMemory, rowsBuffer,
+                    rowsMemory, statusBuffer, statusMemory]() {
+    const uint32_t *chunkQuads = status + VOXEL_MESH_STATUS_HEADER / sizeof(uint32_t);
+    if (status[1] > 0) {
+      for (size_t chunk = 0; chunk < batchMeshes.size(); chunk++) {
+        if (chunkQuads[chunk * 2] == VOXEL_MESH_NO_CHUNK) { voxelMeshOverflows.push_back(batchMeshes[chunk]); }
+      }
+    }
+    finishedVoxelBatches.push_back(
+      {batch, batchMeshes, std::vector<uint32_t>(chunkQuads, chunkQuads + batchMeshes.size() * 2)});
+    vkUnmapMemory(device, statusMemory);
+    vkFreeDescriptorSets(device, voxelMeshDescriptorPool, 1, &set);
+    vkDestroyBuffer(device, inputBuffer, nullptr);
+    vkFreeMemory(device, inputMemory, nullptr);
+    vkDestroyBuffer(device, rowsBuffer, nullptr);
+    vkFreeMemory(device, rowsMemory, nullptr);
+    vkDestroyBuffer(device, statusBuffer, nullptr);
+    vkFreeMemory(device, statusMemory, nullptr);
+  });
+}
+
+// Copies each chunk of the batches the GPU has run into a vertex buffer
+// of its exact size and retires the batches, so the worst-case vertex
+// space is only held while a batch runs. Overflowed and empty chunks are
+// left without buffers and draw nothing.
+void VulkanDriver::CompactGpuVoxelMeshes() {
+  if (finishedVoxelBatches.empty()) { return; }
+  std::vector<FinishedVoxelBatch> finished = std::move(finishedVoxelBatches);
+  finishedVoxelBatches.clear();
+
+  struct ChunkCopy {
+      VulkanMesh  *mesh;
+      VkBuffer     source;
+      VkDeviceSize offset;
+      uint32_t     quads;
+  };
+  std::vector<ChunkCopy> copies;
+  uint32_t               largest = 0;
+  for (const FinishedVoxelBatch &batch : finished) {
+    for (size_t chunk = 0; chunk < batch.meshes.size(); chunk++) {
+      // Released meshes are gone from meshResources
+      std::shared_ptr<Mesh> mesh = batch.meshes[chunk].lock();
+      auto                  it   = mesh ? meshResources.find(mesh) : meshResources.end();
+      if (it == meshResources.end() || it->second.voxelBatch != batch.batch) { continue; }
+
+      VulkanMesh &vulkanMesh = it->second;
+      vulkanMesh.voxelBatch.reset();
+      vulkanMesh.vertexBuffer = VK_NULL_HANDLE;
+      vulkanMesh.drawOffset   = 0;
+      uint32_t first = batch.chunkQuads[chunk * 2];
+      uint32_t quads = batch.chunkQuads[chunk * 2 + 1];
+      if (first == VOXEL_MESH_NO_CHUNK || quads == 0) { continue; }
+      copies.push_back({&vulkanMesh, batch.batch->vertexBuffer,
+                        VkDeviceSize(first) * 4 * sizeof(VoxelVertex), quads});
+      largest = std::max(largest, quads);
+    }
+  }
+
+  if (!copies.empty()) {
+    EnsureQuadIndices(largest);
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    for (const ChunkCopy &chunkCopy : copies) {
+      VulkanMesh  &vulkanMesh = *chunkCopy.mesh;
+      VkDeviceSize size       = VkDeviceSize(chunkCopy.quads) * 4 * sizeof(VoxelVertex);
+      CreateBuffer(size,
+                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vulkanMesh.vertexBuffer,
+                   vulkanMesh.vertexBufferMemory);
+      VkBufferCopy copy{};
+      copy.srcOffset = chunkCopy.offset;
+      copy.size      = size;
+      vkCmdCopyBuffer(commandBuffer, chunkCopy.source, vulkanMesh.vertexBuffer, 1, &copy);
+      vulkanMesh.indexCount = chunkCopy.quads * 6;
+    }
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    SubmitSingleTimeCommands(commandBuffer);
+  }
+
+  // Frames already submitted and the copies above still read the batches
+  for (const FinishedVoxelBatch &batch : finished) {
+    std::shared_ptr<VulkanVoxelBatch> buffers = batch.batch;
+    DeferDestruction([this, buffers]() {
+      vkDestroyBuffer(device, buffers->vertexBuffer, nullptr);
+      vkFreeMemory(device, buffers->vertexBufferMemory, nullptr);
+      vkDestroyBuffer(device, buffers->drawBuffer, nullptr);
+      vkFreeMemory(device, buffers->drawBufferMemory, nullptr);
+    });
+  }
+}
+
+void VulkanDriver::CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>> &meshes) {
+  CollectDeferredDestructions();
+  CompactGpuVoxelMeshes();
+  for (const std::weak_ptr<Mesh> &overflow : voxelMeshOverflows) {
+    // Released meshes need no fallback
+    if (auto mesh = overflow.lock()) { meshes.push_back(mesh); }
+  }
+  voxelMeshOverflows.clear();
+}
+
+void VulkanDriver::ReadGpuVoxelMesh(const std::shared_ptr<Mesh> &mesh, std::vector<VoxelVertex> &vertices) {
+  vertices.clear();
+  auto it = meshResources.find(mesh);
+  if (it == meshResources.end() || !it->second.gpuMeshed) {
+    throw std::runtime_error("ReadGpuVoxelMesh called for a mesh that wasn't meshed on the GPU!");
+  }
+  const VulkanMesh &vulkanMesh = it->second;
+
+  // Copies a range of a GPU-written buffer into host memory
+  auto readBack = [this](VkBuffer source, VkDeviceSize offset, VkDeviceSize size, void *out) {
+    VkBuffer       buffer;
+    VkDeviceMemory memory;
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer,
+                 memory);
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    VkBufferCopy copy{};
+    copy.srcOffset = offset;
+    copy.size      = size;
+    vkCmdCopyBuffer(commandBuffer, source, buffer, 1, &copy);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+    EndSingleTimeCommands(commandBuffer);
+
+    void *mapped;
+    vkMapMemory(device, memory, 0, size, 0, &mapped);
+    memcpy(out, mapped, size);
+    vkUnmapMemory(device, memory);
+    vkDestroyBuffer(device, buffer, nullptr);
+    vkFreeMemory(device, memory, nullptr);
+  };
+
+  // Moved out of its batch: the vertices fill its own buffer
+  if (!vulkanMesh.voxelBatch) {
+    vertices.resize(vulkanMesh.indexCount / 6 * 4);
+    if (!vertices.empty()) {
+      readBack(vulkanMesh.vertexBuffer, 0, vertices.size() * sizeof(VoxelVertex), vertices.data());
+    }
+    return;
+  }
+
+  VkDrawIndexedIndirectCommand draw{};
+  readBack(vulkanMesh.voxelBatch->drawBuffer, vulkanMesh.drawOffset, sizeof(draw), &draw);
+  if (draw.indexCount == 0) { return; }
+  vertices.resize(draw.indexCount / 6 * 4);
+  readBack(vulkanMesh.voxelBatch->vertexBuffer, VkDeviceSize(draw.vertexOffset) * sizeof(VoxelVertex),
+           vertices.size() * sizeof(VoxelVertex), vertices.data());
+}
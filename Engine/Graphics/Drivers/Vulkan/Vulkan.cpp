@@ -1,15 +1,24 @@
 #include "Vulkan.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <iostream>
 #include <vulkan/vulkan_core.h>
 
-VulkanDriver::VulkanDriver() {}
+VulkanDriver::VulkanDriver() {
+  framePacer.SetPacing(FramePacing{});
+}
 
 VulkanDriver::~VulkanDriver() {}
 
 void VulkanDriver::RenderFrame() {
-  DrawFrame();
+  if (offscreen) {
+    DrawOffscreenFrame();
+  } else {
+    DrawFrame();
+  }
+  renderStats.EndFrame();
 }
 
 void VulkanDriver::Setup(GLFWwindow *engineWindow) {
@@ -17,6 +26,98 @@ void VulkanDriver::Setup(GLFWwindow *engineWindow) {
   InitVulkan();
 }
 
+void VulkanDriver::SetupOffscreen(uint32_t width, uint32_t height) {
+  window          = nullptr;
+  offscreen       = true;
+  swapChainExtent = {width, height};
+  InitVulkan();
+}
+
+void VulkanDriver::SetFramePacing(const FramePacing &pacing) {
+  FramePacing applied    = pacing;
+  applied.framesInFlight = std::clamp<uint32_t>(pacing.framesInFlight, 1,
+                                                MAX_FRAMES_IN_FLIGHT);
+  bool presentModeChanged = applied.mode != framePacer.Pacing().mode;
+
+  // Frame slots can only be renumbered once nothing is in flight
+  if (device != VK_NULL_HANDLE) {
+    vkDeviceWaitIdle(device);
+    for (uint32_t frame = 0; frame < offscreenReadbacks.size(); frame++) {
+      CompleteFrameReadback(frame);
+    }
+    CollectDeferredDestructions(true);
+  }
+
+  framePacer.SetPacing(applied);
+  framesInFlight = applied.framesInFlight;
+  currentFrame   = 0;
+  frameSlotBegun = false;
+
+  if (presentModeChanged && swapChain != VK_NULL_HANDLE) {
+    RecreateSwapChain();
+  }
+}
+
+void VulkanDriver::WaitForNextFrame() {
+  waitPacingSleepMs += framePacer.Throttle();
+  WaitForFrameSlot();
+  framePacer.LatchInput();
+}
+
+// Only waits, without touching the GPU timeline bookkeeping that uploads
+// share; the render thread runs this outside the driver lock
+void VulkanDriver::WaitForFrameSlot() {
+  auto     fenceWaitStart = std::chrono::steady_clock::now();
+  uint64_t workValue      = slotWorkValues[currentFrame];
+  if (workValue > 0) {
+    if (timelineSupported) {
+      VkSemaphoreWaitInfoKHR waitInfo{};
+      waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+      waitInfo.semaphoreCount = 1;
+      waitInfo.pSemaphores    = &gpuTimeline;
+      waitInfo.pValues        = &workValue;
+      waitSemaphores(device, &waitInfo, UINT64_MAX);
+    } else {
+      vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+  }
+  waitFenceMs += std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - fenceWaitStart)
+                   .count();
+
+  // The slot's previous frame is done, this is as close to its present
+  // as we can observe without present timing extensions
+  double latency = framePacer.FrameCompleted(currentFrame);
+  if (latency > 0.0) {
+    waitInputLatencyMs = latency;
+  }
+}
+
+// Recycles the slot WaitForFrameSlot() waited for, once per frame and
+// before anything is recorded into it
+void VulkanDriver::BeginFrameSlot() {
+  if (frameSlotBegun) {
+    return;
+  }
+  frameSlotBegun     = true;
+  completedWorkValue = std::max(completedWorkValue, slotWorkValues[currentFrame]);
+
+  FrameStats &stats = renderStats.Current();
+  stats.pacingSleepMs += waitPacingSleepMs;
+  stats.fenceWaitMs += waitFenceMs;
+  if (waitInputLatencyMs > 0.0) {
+    stats.inputLatencyMs = waitInputLatencyMs;
+  }
+  waitPacingSleepMs  = 0.0;
+  waitFenceMs        = 0.0;
+  waitInputLatencyMs = 0.0;
+
+  // Nothing reads the slot's frame data anymore
+  ResetFrameAllocator(currentFrame);
+  CollectDeferredDestructions();
+  CompactGpuVoxelMeshes();
+}
+
 void VulkanDriver::Destruct() {
   DestroyVulkan();
 }
@@ -24,15 +125,24 @@ void VulkanDriver::Destruct() {
 void VulkanDriver::InitVulkan() {
   CreateVulkanInstance();
   SetupDebugMessenger();
-  CreateVulkanSurface();
+  if (!offscreen) {
+    CreateVulkanSurface();
+  }
   PickPhysicalDevice();
   CreateLogicalDevice();
-  CreateSwapChain();
-  CreateImageViews();
+  CreateGpuTimeline();
+  if (offscreen) {
+    CreateOffscreenTargets();
+  } else {
+    CreateSwapChain();
+    CreateImageViews();
+  }
   CreateRenderPass();
   CreateDescriptorSetLayout();
+  CreateFrameAllocator();
   CreateGraphicsPipeline();
   CreateCommandPool();
+  CreateStagingRing();
   CreateDepthResources();
   CreateFrameBuffers();
   CreateDefaultTextureSampler();
@@ -45,17 +155,32 @@ void VulkanDriver::InitVulkan() {
 }
 
 void VulkanDriver::WindowIsResized() {
-	framebufferResized = true;
+	// Offscreen targets keep the size they were created with
+	if (!offscreen) {
+		framebufferResized = true;
+	}
+}
+
+void VulkanDriver::SetFramebufferSize(uint32_t width, uint32_t height) {
+	framebufferSizeGiven = true;
+	framebufferSize      = {width, height};
 }
 
 void VulkanDriver::DestroyVulkan() {
   vkDeviceWaitIdle(device);
+  CollectDeferredDestructions(true);
 
   // Clean up mesh resources
   for (auto& [mesh, vulkanMesh] : meshResources) {
     DestroyVulkanMesh(vulkanMesh);
   }
   meshResources.clear();
+  if (quadIndexBuffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(device, quadIndexBuffer, nullptr);
+    vkFreeMemory(device, quadIndexBufferMemory, nullptr);
+  }
+  DestroyGpuVoxelMesher();
+  gpuVoxelMesherProbed = false;
 
   // Clean up texture resources
   for (auto& [texture, vulkanTexture] : textureResources) {
@@ -72,23 +197,37 @@ void VulkanDriver::DestroyVulkan() {
 	vkFreeMemory(device, uniformBuffersMemory[i], nullptr); 
   }
 
+  DestroyStagingRing();
+  if (gpuTimeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(device, gpuTimeline, nullptr);
+  }
   vkDestroyCommandPool(device, commandPool, nullptr);
 
   CleanupSwapChain();
+  if (offscreen) {
+    DestroyOffscreenTargets();
+  }
   vkDestroyDescriptorPool(device, descriptorPool, nullptr);
   vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+  DestroyFrameAllocator();
 
   vkDestroySampler(device, defaultTextureSampler, nullptr);
   vkDestroyImageView(device, defaultTextureImageView, nullptr);
   vkDestroyImage(device, defaultTextureImage, nullptr);
   vkFreeMemory(device, defaultTextureImageMemory, nullptr);
 
-  vkDestroyPipeline(device, graphicsPipeline, nullptr);
+  pipelineCache.Stop();
+  vkDestroyShaderModule(device, fragShaderModule, nullptr);
+  vkDestroyShaderModule(device, vertShaderModule, nullptr);
+  vkDestroyShaderModule(device, voxelFragShaderModule, nullptr);
+  vkDestroyShaderModule(device, voxelVertShaderModule, nullptr);
   vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
   vkDestroyRenderPass(device, renderPass, nullptr);
 
   vkDestroyDevice(device, nullptr);
-  vkDestroySurfaceKHR(instance, surface, nullptr);
+  if (surface != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+  }
 
   if (enableValidationLayers) {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
@@ -8,9 +8,14 @@
 #include "Mesh.h"
 #include "Texture.h"
 #include "RenderObject.h"
+#include "PipelineCache.h"
+#include "../../RenderQueue.h"
 
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
+#include <array>
+#include <deque>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <unordered_map>
@@ -23,18 +28,41 @@ const bool enableValidationLayers = true;
 
 const std::vector<const char *> validationLayers = {
   "VK_LAYER_KHRONOS_validation"};
-const std::vector<const char *> deviceExtensions = {
-  VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-  // @todo Need to figure out a way to check if needed
-  "VK_KHR_portability_subset"};
+// Required for presenting to a window, not needed in offscreen mode
+const std::vector<const char *> presentDeviceExtensions = {
+  VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+// Enabled only when the device advertises them (e.g. MoltenVK)
+const std::vector<const char *> optionalDeviceExtensions = {
+  "VK_KHR_portability_subset", VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME};
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Upper bound for the runtime frames in flight setting, per-frame
+// resources are allocated for this many frames
+const int MAX_FRAMES_IN_FLIGHT = 3;
+
+// Bytes of dynamic uniform/storage data in each frame allocator block, a
+// frame that needs more chains on further blocks
+const VkDeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
+// Ranges visible through the dynamic bindings from each allocation's offset
+const VkDeviceSize FRAME_UNIFORM_RANGE = 256;
+const VkDeviceSize FRAME_STORAGE_RANGE = FRAME_DATA_MAX_SIZE;
+// Driver pipeline cache data, relative to the working directory like shaders/
+const char *const PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+// Persistently mapped staging memory for uploads, larger ones get a
+// dedicated buffer
+const VkDeviceSize STAGING_RING_SIZE = 16 * 1024 * 1024;
+// Depth buffers are rounded up to this many pixels so small resizes reuse them
+const uint32_t DEPTH_EXTENT_GRANULARITY = 128;
+// GPU voxel meshing batches whose descriptor sets can be in flight at once,
+// more wait for the GPU to catch up
+const uint32_t GPU_VOXEL_MAX_BATCHES = 16;
+// Passes of shaders/voxel_mesh.comp, each built as its own pipeline
+const uint32_t GPU_VOXEL_MESH_PASSES = 3;
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
 
-    bool isComplete();
+    bool isComplete(bool requirePresent = true);
 };
 
 // Removed hardcoded paths - models/textures are loaded via API
@@ -50,8 +78,44 @@ struct UniformBufferObject {
     alignas(16) glm::mat4 proj;
 };
 
+// Per-object data written through the frame allocator (set 1, binding 0)
+struct ObjectUniforms {
+    alignas(16) glm::vec4 materialColor;
+    alignas(16) glm::vec4 uvTransform;
+};
+
+// Sub-allocation from the frame allocator, valid until the frame's fence
+// signals. offset is the dynamic offset to bind the block's sets with.
+struct FrameAllocation {
+    void    *data;
+    uint32_t offset;
+    uint32_t block;
+};
+
+// One persistently mapped buffer of the frame allocator with the sets that
+// bind it: set 1 (object uniforms) and set 2 (frame data storage)
+struct FrameDataBlock {
+    VkBuffer         buffer         = VK_NULL_HANDLE;
+    VkDeviceMemory   memory         = VK_NULL_HANDLE;
+    uint8_t         *mapped         = nullptr;
+    VkDeviceSize     size           = 0; // Allocatable bytes, without the tail padding
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet  objectSet      = VK_NULL_HANDLE;
+    VkDescriptorSet  storageSet     = VK_NULL_HANDLE;
+};
+
 bool                      checkValidationLayerSupport();
-std::vector<const char *> getRequiredExtensions();
+std::vector<const char *> getRequiredExtensions(bool withSurface);
+
+// Vertex and indirect draw buffers one GPU voxel meshing batch writes,
+// sized for the batch's whole quad budget. Its meshes draw from them until
+// the batch has run and CompactGpuVoxelMeshes() moves them out.
+struct VulkanVoxelBatch {
+    VkBuffer vertexBuffer;
+    VkDeviceMemory vertexBufferMemory;
+    VkBuffer drawBuffer;
+    VkDeviceMemory drawBufferMemory;
+};
 
 // Internal mesh data structure for Vulkan resources
 struct VulkanMesh {
@@ -60,6 +124,11 @@ struct VulkanMesh {
     VkBuffer indexBuffer;
     VkDeviceMemory indexBufferMemory;
     uint32_t indexCount;
+    // GPU-meshed voxel chunks draw indirectly from their batch until it
+    // has run, then from a vertex buffer of their own
+    std::shared_ptr<VulkanVoxelBatch> voxelBatch;
+    VkDeviceSize drawOffset = 0;
+    bool gpuMeshed = false; // Its buffers can be read back, see ReadGpuVoxelMesh
 };
 
 // Internal texture data structure
@@ -70,6 +139,15 @@ struct VulkanTexture {
     VkSampler sampler;
 };
 
+// Host-visible copy target for one frame in flight in offscreen mode
+struct OffscreenReadback {
+    VkBuffer              buffer       = VK_NULL_HANDLE;
+    VkDeviceMemory        bufferMemory = VK_NULL_HANDLE;
+    void                 *mapped       = nullptr;
+    FrameReadbackCallback callback;
+    uint64_t              frameIndex = 0;
+};
+
 class VulkanDriver : public IGraphicsDriver {
   public:
     VulkanDriver();
@@ -79,36 +157,70 @@ class VulkanDriver : public IGraphicsDriver {
     void Destruct() override;
     void RenderFrame() override;
     void WindowIsResized() override;
+    void SetFramebufferSize(uint32_t width, uint32_t height) override;
+    void SetupOffscreen(uint32_t width, uint32_t height) override;
+    void RequestFrameReadback(FrameReadbackCallback callback) override;
     
     // IGraphicsDriver API
-    std::shared_ptr<Mesh> LoadMesh(const std::string& modelPath) override;
+    std::shared_ptr<Mesh> LoadMesh(const std::string& modelPath, MeshCreateFlags flags = 0) override;
     std::shared_ptr<Texture> LoadTexture(const std::string& texturePath) override;
-    std::shared_ptr<Mesh> CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) override;
+    std::shared_ptr<Mesh> CreateMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshCreateFlags flags = 0) override;
+    std::shared_ptr<Mesh> CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, MeshCreateFlags flags = 0) override;
+    std::shared_ptr<Mesh> CreateMesh(const Vertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshCreateFlags flags = 0) override;
     std::shared_ptr<Texture> CreateTexture(uint32_t width, uint32_t height, const void* pixelData) override;
+    TextureUpload BeginTextureUpload(uint32_t width, uint32_t height) override;
+    std::shared_ptr<Texture> CommitTextureUpload(const TextureUpload& upload) override;
+    void CancelTextureUpload(const TextureUpload& upload) override;
+    MeshUpload BeginMeshUpload(size_t vertexCount, size_t indexCount) override;
+    std::shared_ptr<Mesh> CommitMeshUpload(const MeshUpload& upload) override;
+    void CancelMeshUpload(const MeshUpload& upload) override;
+    std::shared_ptr<Mesh> CreateVoxelMesh(const VoxelVertex* vertices, size_t vertexCount) override;
+    bool SupportsGpuVoxelMeshing() override;
+    void MeshVoxelChunksOnGpu(const GpuVoxelMeshInput& input, std::vector<std::shared_ptr<Mesh>>& meshes) override;
+    void CollectGpuVoxelMeshOverflows(std::vector<std::shared_ptr<Mesh>>& meshes) override;
+    void ReleaseMesh(const std::shared_ptr<Mesh>& mesh) override;
+    void ReleaseTexture(const std::shared_ptr<Texture>& texture) override;
+    void PrecompilePipelines(const std::vector<PipelineFeatures>& featureSets) override;
     void SubmitRenderObject(const RenderObject& renderObject) override;
+    void SubmitRenderPackets(const RenderPacket* packets, size_t count) override;
     void ClearRenderQueue() override;
+    FrameDataAllocation AllocateFrameData(size_t size) override;
     void SetViewMatrix(const glm::mat4& view) override;
     void SetProjectionMatrix(const glm::mat4& projection) override;
+    void SetFramePacing(const FramePacing& pacing) override;
+    void WaitForNextFrame() override;
+    RenderStats& GetRenderStats() override;
+
+    // Copies a GPU-meshed voxel mesh's vertices back, waiting for the GPU;
+    // for checking the compute mesher against the CPU one
+    void ReadGpuVoxelMesh(const std::shared_ptr<Mesh>& mesh, std::vector<VoxelVertex>& vertices);
 
   private:
     GLFWwindow *window;
 
     VkInstance               instance;
-    VkSurfaceKHR             surface;
+    VkSurfaceKHR             surface = VK_NULL_HANDLE;
     VkPhysicalDevice         physicalDevice = VK_NULL_HANDLE;
-    VkDevice                 device;
+    VkDevice                 device = VK_NULL_HANDLE;
     VkQueue                  graphicsQueue;
     VkQueue                  presentQueue;
     VkDebugUtilsMessengerEXT debugMessenger;
 
-    VkSwapchainKHR        swapChain;
+    VkSwapchainKHR        swapChain = VK_NULL_HANDLE;
     VkFormat              swapChainImageFormat;
     VkExtent2D            swapChainExtent;
-    VkPipeline            graphicsPipeline;
+    VkPipeline            graphicsPipeline; // Default variant, owned by pipelineCache
     VkRenderPass          renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout      pipelineLayout;
     VkCommandPool         commandPool;
+    VkShaderModule        vertShaderModule;
+    VkShaderModule        fragShaderModule;
+    VkShaderModule        voxelVertShaderModule;
+    VkShaderModule        voxelFragShaderModule;
+    VkPipeline            voxelPipeline; // PIPELINE_FEATURE_VOXEL default, owned by pipelineCache
+    PipelineCache         pipelineCache;
+    bool                  wireframeSupported = false;
     VkSampler             defaultTextureSampler;  // Shared sampler for all textures
     
     // Default white texture for descriptor set initialization
@@ -116,9 +228,12 @@ class VulkanDriver : public IGraphicsDriver {
     VkDeviceMemory defaultTextureImageMemory;
     VkImageView    defaultTextureImageView;
 
-    VkImage        depthImage;
-    VkDeviceMemory depthImageMemory;
-    VkImageView    depthImageView;
+    // The depth image can be larger than swapChainExtent, it is kept across
+    // swapchain recreations as long as the new extent fits
+    VkImage        depthImage       = VK_NULL_HANDLE;
+    VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+    VkImageView    depthImageView   = VK_NULL_HANDLE;
+    VkExtent2D     depthImageExtent = {0, 0};
 
     VkDescriptorPool             descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
@@ -134,45 +249,190 @@ class VulkanDriver : public IGraphicsDriver {
     std::vector<VkFence>     inFlightFences;
 
     bool framebufferResized = false;
+    // Set through SetFramebufferSize when another thread owns the window
+    bool       framebufferSizeGiven = false;
+    VkExtent2D framebufferSize      = {0, 0};
 
+    // In offscreen mode these hold the driver-owned color targets, one per
+    // frame in flight, and swapChainExtent is the requested render size
     std::vector<VkImageView>   swapChainImageViews;
     std::vector<VkImage>       swapChainImages;
     std::vector<VkFramebuffer> swapChainFramebuffers;
 
+    // Offscreen rendering
+    bool                           offscreen = false;
+    std::vector<VkDeviceMemory>    offscreenImagesMemory;
+    std::vector<OffscreenReadback> offscreenReadbacks;
+    FrameReadbackCallback          nextFrameReadback;
+    std::vector<const char *>      enabledDeviceExtensions;
+
     uint32_t currentFrame = 0;
+
+    // GPU progress counter: every graphics queue submission is numbered and
+    // a timeline semaphore is signaled with that value, so any subsystem can
+    // ask whether work N finished. Without VK_KHR_timeline_semaphore the
+    // frame fences and queue idles stand in for the semaphore.
+    bool                                       timelineSupported  = false;
+    VkSemaphore                                gpuTimeline        = VK_NULL_HANDLE;
+    PFN_vkWaitSemaphoresKHR                    waitSemaphores     = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR          getCounterValue    = nullptr;
+    uint64_t                                   submittedWorkValue = 0;
+    uint64_t                                   completedWorkValue = 0;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> slotWorkValues{};
+
+    // Destruction of resources that GPU work may still use, run once all
+    // work submitted before the resource was retired has completed
+    struct DeferredDestruction {
+      uint64_t              retiredAfterWork;
+      std::function<void()> destroy;
+    };
+    std::deque<DeferredDestruction> deferredDestructions;
+
+    // Frame pacing, framesInFlight <= MAX_FRAMES_IN_FLIGHT
+    FramePacer framePacer;
+    uint32_t   framesInFlight = 2;
+    // WaitForNextFrame() may run next to resource calls on another thread,
+    // so it keeps its timings here until BeginFrameSlot() adds them to the
+    // frame's stats
+    double     waitPacingSleepMs  = 0.0;
+    double     waitFenceMs        = 0.0;
+    double     waitInputLatencyMs = 0.0;
+    bool       frameSlotBegun     = false; // Until the frame is submitted
     
     // Resource management
     std::unordered_map<std::shared_ptr<Mesh>, VulkanMesh> meshResources;
     std::unordered_map<std::shared_ptr<Texture>, VulkanTexture> textureResources;
     std::unordered_map<std::shared_ptr<Texture>, std::vector<VkDescriptorSet>> textureDescriptorSets;  // Per-texture descriptor sets
+
+    // Index pattern (0, 1, 2, 2, 3, 0) repeated per quad, shared by every
+    // voxel mesh; grown (and the old one retired) when a larger mesh comes
+    VkBuffer       quadIndexBuffer       = VK_NULL_HANDLE;
+    VkDeviceMemory quadIndexBufferMemory = VK_NULL_HANDLE;
+    size_t         quadIndexCapacity     = 0; // In quads
+
+    // GPU voxel meshing, built on first use and only when the graphics
+    // queue can run compute work and the shader is there
+    bool                  gpuVoxelMesherProbed     = false;
+    bool                  gpuVoxelMeshingSupported = false;
+    VkShaderModule        voxelMeshShaderModule    = VK_NULL_HANDLE;
+    VkDescriptorSetLayout voxelMeshSetLayout       = VK_NULL_HANDLE;
+    VkPipelineLayout      voxelMeshPipelineLayout  = VK_NULL_HANDLE;
+    VkDescriptorPool      voxelMeshDescriptorPool  = VK_NULL_HANDLE;
+    std::array<VkPipeline, GPU_VOXEL_MESH_PASSES> voxelMeshPipelines{};
+    // Meshes whose chunks didn't fit their batch, found once it has run
+    std::vector<std::weak_ptr<Mesh>> voxelMeshOverflows;
+    // Batches the GPU has run, with each chunk's first quad in the batch
+    // (or the overflow marker) and quad count as the status buffer had them
+    struct FinishedVoxelBatch {
+      std::shared_ptr<VulkanVoxelBatch> batch;
+      std::vector<std::weak_ptr<Mesh>>  meshes;
+      std::vector<uint32_t>             chunkQuads;
+    };
+    std::vector<FinishedVoxelBatch> finishedVoxelBatches;
     
-    // Render queue
-    std::vector<RenderObject> renderQueue;
+    // Render queue, culled and sorted when the frame is recorded
+    RenderQueue renderQueue;
     
     // Camera matrices
     glm::mat4 viewMatrix = glm::mat4(1.0f);
     glm::mat4 projectionMatrix = glm::mat4(1.0f);
 
+    // Frame allocator: a chain of blocks per frame in flight, bound through
+    // sets 1 and 2 with dynamic offsets. Blocks added when a frame runs out
+    // of space are kept for later frames in the same slot.
+    std::array<std::vector<FrameDataBlock>, MAX_FRAMES_IN_FLIGHT> frameDataBlocks;
+    VkDeviceSize          frameDataAlignment = 256;
+    uint32_t              frameDataFrame     = 0; // Slot being allocated from
+    uint32_t              frameDataBlock     = 0; // Current block in the slot's chain
+    VkDeviceSize          frameDataHead      = 0;
+    VkDescriptorSetLayout objectDescriptorSetLayout;
+    VkDescriptorSetLayout frameDataDescriptorSetLayout;
+
+    // Staging ring: reservations are handed out in order from one mapped
+    // buffer and reclaimed from the front once their copy has executed.
+    // Reservations that don't fit get a dedicated buffer instead.
+    struct StagingReservation {
+      uint64_t       id;
+      VkBuffer       buffer;
+      VkDeviceSize   offset;
+      VkDeviceSize   size;
+      uint8_t       *data;
+      VkDeviceMemory dedicatedMemory  = VK_NULL_HANDLE;
+      bool           committed        = false;
+      uint64_t       retiredAfterWork = 0;
+    };
+    VkBuffer                                         stagingRingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory                                   stagingRingMemory = VK_NULL_HANDLE;
+    uint8_t                                         *stagingRingMapped = nullptr;
+    VkDeviceSize                                     stagingRingHead   = 0;
+    std::deque<StagingReservation>                   stagingReservations;
+    std::unordered_map<uint64_t, StagingReservation> dedicatedStaging;
+    uint64_t                                         nextStagingId = 1;
+
+    // Per-frame counters and timings
+    RenderStats renderStats;
+
     void InitVulkan();
     void CreateVulkanInstance();
     
     // Resource creation helpers
-    VulkanMesh CreateVulkanMesh(const Mesh& mesh);
+    void RegisterMesh(const std::shared_ptr<Mesh>& mesh, MeshCreateFlags flags);
+    VulkanMesh UploadMesh(const MeshUpload& upload);
+    void EnsureQuadIndices(size_t quadCount);
+    void UploadStagedBuffer(const StagingReservation& staging, VkDeviceSize size,
+                            VkBufferUsageFlags usage, VkAccessFlags dstAccess,
+                            VkBuffer& buffer, VkDeviceMemory& memory);
     void DestroyVulkanMesh(VulkanMesh& vulkanMesh);
-    VulkanTexture CreateVulkanTexture(const std::string& texturePath);
+    void CreateGpuVoxelMesher();
+    void DestroyGpuVoxelMesher();
+    VkDescriptorSet AllocateVoxelMeshSet();
+    void CompactGpuVoxelMeshes();
     void DestroyVulkanTexture(VulkanTexture& vulkanTexture);
     void CreateVulkanSurface();
     void PickPhysicalDevice();
     void CreateLogicalDevice();
-    void CreateSwapChain();
+    void CreateOffscreenTargets();
+    void DestroyOffscreenTargets();
+    void CompleteFrameReadback(uint32_t frame);
+    void RecordReadbackCopy(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void DrawOffscreenFrame();
+    void WaitForFrameSlot();
+    void BeginFrameSlot();
+    void CreateGpuTimeline();
+    uint64_t SubmitGraphicsWork(const VkSubmitInfo &submitInfo,
+                                VkFence             fallbackFence);
+    bool IsGpuWorkComplete(uint64_t workValue);
+    void WaitForGpuWork(uint64_t workValue);
+    void FrameSubmitted(uint64_t workValue);
+    void DeferDestruction(std::function<void()> destroy);
+    void CollectDeferredDestructions(bool waitedIdle = false);
+    void CreateSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
     void RecreateSwapChain();
+    VkExtent2D CurrentFramebufferSize();
     void CleanupSwapChain();
     void CreateImageViews();
     void CreateDescriptorSetLayout();
     void CreateGraphicsPipeline();
+    PipelineState PipelineStateFor(PipelineFeatures features) const;
+    VkPipeline    CreatePipelineVariant(const PipelineState &state,
+                                        VkPipelineCache      cache);
     void CreateUniformBuffers();
     void CreateDescriptorPool();
     void CreateDescriptorSets();
+    void CreateFrameAllocator();
+    void DestroyFrameAllocator();
+    void AddFrameDataBlock(uint32_t frame, VkDeviceSize size);
+    void ResetFrameAllocator(uint32_t frame);
+    FrameAllocation AllocateFrameMemory(VkDeviceSize size);
+    void CreateStagingRing();
+    void DestroyStagingRing();
+    StagingReservation  ReserveStaging(VkDeviceSize size);
+    StagingReservation *FindStaging(uint64_t id);
+    void RetireStaging(uint64_t id);
+    void CancelStaging(uint64_t id);
+    void SubmitUploadCommands(VkCommandBuffer commandBuffer, uint64_t stagingId);
+    void SubmitSingleTimeCommands(VkCommandBuffer commandBuffer);
+    void ReclaimStaging();
     void CreateDepthResources();
     void CreateDefaultTextureSampler();
     void CreateDefaultTexture();
@@ -219,6 +479,12 @@ class VulkanDriver : public IGraphicsDriver {
                                           VkImageLayout newLayout);
     void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
                            uint32_t height);
+    void RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image,
+                                     VkFormat format, VkImageLayout oldLayout,
+                                     VkImageLayout newLayout);
+    void RecordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                                 VkDeviceSize bufferOffset, VkImage image,
+                                 uint32_t width, uint32_t height);
     VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
     VkFormat    FindSupportedFormat(const std::vector<VkFormat> &candidates,
                                     VkImageTiling                tiling,
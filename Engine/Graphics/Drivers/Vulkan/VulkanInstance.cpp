@@ -31,7 +31,7 @@ void VulkanDriver::CreateVulkanInstance() {
     createInfo.pNext             = nullptr;
   }
 
-  auto requiredExtensions            = getRequiredExtensions();
+  auto requiredExtensions            = getRequiredExtensions(!offscreen);
   createInfo.enabledExtensionCount   = (uint32_t) requiredExtensions.size();
   createInfo.ppEnabledExtensionNames = requiredExtensions.data();
   createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
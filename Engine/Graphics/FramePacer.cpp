@@ -0,0 +1,68 @@
+#include "FramePacer.h"
+
+#include <thread>
+
+FramePacing DefaultFramePacing(FramePacingMode mode) {
+  FramePacing pacing;
+  pacing.mode = mode;
+  switch (mode) {
+  case FramePacingMode::Throughput:
+    pacing.framesInFlight = 3;
+    break;
+  case FramePacingMode::LowLatency:
+    pacing.framesInFlight = 1;
+    break;
+  case FramePacingMode::PowerSaver:
+    pacing.framesInFlight = 2;
+    pacing.maxFps         = 30.0;
+    break;
+  }
+  return pacing;
+}
+
+void FramePacer::SetPacing(const FramePacing &newPacing) {
+  pacing        = newPacing;
+  nextFrameTime = Clock::time_point{};
+  slotLatchTimes.assign(pacing.framesInFlight, Clock::time_point{});
+  slotPending.assign(pacing.framesInFlight, false);
+}
+
+double FramePacer::Throttle() {
+  if (pacing.maxFps <= 0.0) { return 0.0; }
+
+  auto now   = Clock::now();
+  auto start = now;
+  if (nextFrameTime > now) {
+    std::this_thread::sleep_until(nextFrameTime);
+    now = Clock::now();
+  }
+
+  // Schedule from the due time rather than from now so sleep overshoot
+  // doesn't accumulate, but don't try to catch up after a long frame
+  auto period = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(1.0 / pacing.maxFps));
+  nextFrameTime = (nextFrameTime + period > now ? nextFrameTime : now) + period;
+
+  return std::chrono::duration<double, std::milli>(now - start).count();
+}
+
+void FramePacer::LatchInput() {
+  latchTime = Clock::now();
+  latched   = true;
+}
+
+void FramePacer::FrameSubmitted(uint32_t slot) {
+  if (slot >= slotPending.size()) {
+    slotLatchTimes.resize(slot + 1);
+    slotPending.resize(slot + 1, false);
+  }
+  slotLatchTimes[slot] = latched ? latchTime : Clock::now();
+  slotPending[slot]    = true;
+  latched              = false;
+}
+
+double FramePacer::FrameCompleted(uint32_t slot) {
+  if (slot >= slotPending.size() || !slotPending[slot]) { return 0.0; }
+  slotPending[slot] = false;
+  return std::chrono::duration<double, std::milli>(Clock::now() - slotLatchTimes[slot]).count();
+}
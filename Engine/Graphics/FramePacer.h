@@ -0,0 +1,57 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+enum class FramePacingMode {
+  Throughput, // Deepest CPU/GPU queue, highest frame rate
+  LowLatency, // Single frame in flight, input latched right before recording
+  PowerSaver, // Vsync'd present and a frame rate cap
+};
+
+struct FramePacing {
+  FramePacingMode mode           = FramePacingMode::Throughput;
+  uint32_t        framesInFlight = 2;
+  double          maxFps         = 0.0; // Frame cap, 0 for none
+};
+
+// Recommended settings for a mode
+FramePacing DefaultFramePacing(FramePacingMode mode);
+
+// Driver-side bookkeeping for frame pacing: the frame cap, and the time
+// the app latched input for each frame slot so the driver can report how
+// long it took until that frame's GPU work completed.
+class FramePacer {
+  public:
+    void               SetPacing(const FramePacing &newPacing);
+    const FramePacing &Pacing() const { return pacing; }
+
+    // Sleeps until the next frame is due under the frame cap, returns ms slept
+    double Throttle();
+
+    // Marks the moment input is sampled for the frame being built
+    void LatchInput();
+    bool InputLatched() const { return latched; }
+    // Forgets the latch of a frame that is dropped before it is submitted
+    void ClearInputLatch() { latched = false; }
+
+    // Hands the latch over to the frame slot that was just submitted
+    void FrameSubmitted(uint32_t slot);
+    // Ms from input latch to now for the frame in slot, 0 if none is pending
+    double FrameCompleted(uint32_t slot);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacing       pacing;
+    Clock::time_point nextFrameTime;
+    Clock::time_point latchTime;
+    bool              latched = false;
+
+    std::vector<Clock::time_point> slotLatchTimes;
+    std::vector<bool>              slotPending;
+};
+
+#endif // FRAMEPACER_H
@@ -62,8 +62,20 @@ bool GraphicsManager::shouldClose() {
 	return glfwWindowShouldClose(window);
 }
 
+// Waits for the driver to accept a frame, then samples input, so the
+// frame is built from the latest events
+void GraphicsManager::beginFrame() {
+	driver->WaitForNextFrame();
+	glfwPollEvents();
+	eventsPolled = true;
+}
+
 void GraphicsManager::update() {
+	// Loops that don't call beginFrame() still get their events here
+	if (!eventsPolled) {
+		glfwPollEvents();
+	}
+	eventsPolled = false;
 	glfwSwapBuffers(window);
 	driver->RenderFrame();
-	glfwPollEvents();
 }
@@ -7,6 +7,7 @@ class GraphicsManager {
 	GLFWwindow* window; 
 	bool isManagerUp = false;
 	IGraphicsDriver* driver = nullptr;
+	bool eventsPolled = false; // By beginFrame() since the last update()
 
 	public: 
 	static void ResizeCallback(GLFWwindow* window, int newWidth, int newHeight);
@@ -14,6 +15,9 @@ class GraphicsManager {
 	GLFWwindow* getWindow() const;
 	bool shouldClose();
 	bool isInitialized();
+	// Optional, call before building the frame: waits for the driver, then
+	// polls events; update() polls itself when this wasn't called
+	void beginFrame();
 	void update();
 	void destroyWindow();
 }; 
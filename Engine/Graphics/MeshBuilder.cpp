@@ -0,0 +1,70 @@
+#include "MeshBuilder.h"
+
+#include <iostream>
+#include <stdexcept>
+
+MeshBuilder::MeshBuilder(IGraphicsDriver &driver, size_t vertexCount, size_t indexCount)
+    : driver(driver), upload(driver.BeginMeshUpload(vertexCount, indexCount)) {}
+
+MeshBuilder::~MeshBuilder() {
+  try {
+    Cancel();
+  } catch (const std::exception &e) {
+    std::cerr << "Warning: MeshBuilder could not cancel its upload: " << e.what() << std::endl;
+  }
+}
+
+uint32_t MeshBuilder::AddVertex(const Vertex &vertex) {
+  if (finished) {
+    throw std::runtime_error("MeshBuilder used after Finish or Cancel");
+  }
+  if (vertexCount == upload.vertexCount) {
+    Cancel();
+    throw std::runtime_error("MeshBuilder vertex capacity exceeded");
+  }
+
+  if (vertexCount == 0) {
+    upload.boundsMin = vertex.pos;
+    upload.boundsMax = vertex.pos;
+  } else {
+    upload.boundsMin = glm::min(upload.boundsMin, vertex.pos);
+    upload.boundsMax = glm::max(upload.boundsMax, vertex.pos);
+  }
+  upload.vertices[vertexCount] = vertex;
+  return static_cast<uint32_t>(vertexCount++);
+}
+
+void MeshBuilder::AddIndex(uint32_t index) {
+  if (finished) {
+    throw std::runtime_error("MeshBuilder used after Finish or Cancel");
+  }
+  if (indexCount == upload.indexCount) {
+    Cancel();
+    throw std::runtime_error("MeshBuilder index capacity exceeded");
+  }
+  upload.indices[indexCount++] = index;
+}
+
+void MeshBuilder::AddTriangle(uint32_t a, uint32_t b, uint32_t c) {
+  AddIndex(a);
+  AddIndex(b);
+  AddIndex(c);
+}
+
+std::shared_ptr<Mesh> MeshBuilder::Finish() {
+  if (finished) {
+    throw std::runtime_error("MeshBuilder used after Finish or Cancel");
+  }
+  if (vertexCount != upload.vertexCount || indexCount != upload.indexCount) {
+    Cancel();
+    throw std::runtime_error("MeshBuilder finished with fewer vertices or indices than reserved");
+  }
+  finished = true;
+  return driver.CommitMeshUpload(upload);
+}
+
+void MeshBuilder::Cancel() {
+  if (finished) { return; }
+  finished = true;
+  driver.CancelMeshUpload(upload);
+}
@@ -0,0 +1,44 @@
+#ifndef MESHBUILDER_H
+#define MESHBUILDER_H
+
+#include "Drivers/IGraphicsDriver.h"
+#include "Drivers/Vulkan/Vertex.h"
+#include <cstdint>
+#include <memory>
+
+// Writes a mesh of known size straight into a driver's staging memory,
+// tracking the bounds on the way, so the geometry is never held in a
+// vector of its own. The resulting mesh keeps no CPU copy. Finish() must
+// be called once the vertices and indices have been added; a builder that
+// is dropped or throws before then cancels its upload, so the staging
+// memory goes back to the driver.
+class MeshBuilder {
+  public:
+    MeshBuilder(IGraphicsDriver &driver, size_t vertexCount, size_t indexCount);
+    ~MeshBuilder();
+
+    MeshBuilder(const MeshBuilder &)            = delete;
+    MeshBuilder &operator=(const MeshBuilder &) = delete;
+
+    // Returns the index of the new vertex
+    uint32_t AddVertex(const Vertex &vertex);
+    void     AddIndex(uint32_t index);
+    void     AddTriangle(uint32_t a, uint32_t b, uint32_t c);
+
+    size_t VertexCount() const { return vertexCount; }
+    size_t IndexCount() const { return indexCount; }
+
+    // Throws unless exactly the reserved counts were added
+    std::shared_ptr<Mesh> Finish();
+    // Drops the mesh; nothing can be added afterwards
+    void Cancel();
+
+  private:
+    IGraphicsDriver &driver;
+    MeshUpload       upload;
+    size_t           vertexCount = 0;
+    size_t           indexCount  = 0;
+    bool             finished    = false; // Committed or cancelled
+};
+
+#endif // MESHBUILDER_H
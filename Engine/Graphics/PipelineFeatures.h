@@ -0,0 +1,25 @@
+#ifndef PIPELINEFEATURES_H
+#define PIPELINEFEATURES_H
+
+#include <cstdint>
+
+// Per-object shader and raster toggles. Every combination in use is its own
+// pipeline variant; the shader toggles reach the shaders as specialization
+// constants with constant_id equal to the bit index.
+using PipelineFeatures = uint32_t;
+
+const PipelineFeatures PIPELINE_FEATURE_ALPHA_TEST   = 1u << 0; // Discard alpha < 0.5
+const PipelineFeatures PIPELINE_FEATURE_DOUBLE_SIDED = 1u << 1; // No back-face culling
+const PipelineFeatures PIPELINE_FEATURE_WIREFRAME    = 1u << 2; // Line fill, for debugging
+// Packed VoxelVertex input and the voxel shaders; required for, and only
+// valid with, meshes from CreateVoxelMesh
+const PipelineFeatures PIPELINE_FEATURE_VOXEL        = 1u << 3;
+// Draws RenderObject::instanceCount instances of a standard mesh, each
+// transformed by the model matrix times its mat4 in RenderObject::frameData.
+// Not culled, the queue doesn't know where the instances are.
+const PipelineFeatures PIPELINE_FEATURE_INSTANCED    = 1u << 4;
+
+// Features that change shader code rather than fixed-function state
+const PipelineFeatures PIPELINE_SHADER_FEATURES = PIPELINE_FEATURE_ALPHA_TEST | PIPELINE_FEATURE_INSTANCED;
+
+#endif // PIPELINEFEATURES_H
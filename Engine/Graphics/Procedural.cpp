@@ -0,0 +1,106 @@
+#include "Procedural.h"
+#include <algorithm>
+
+// Generate a cube mesh programmatically
+std::pair<std::vector<Vertex>, std::vector<uint32_t>> GenerateCubeMesh(float size) {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    
+    float s = size * 0.5f; // around origin we need to halve for the right size
+    
+    // Define the 8 vertices of a cube
+    std::vector<glm::vec3> positions = {
+        {-s, -s, -s}, { s, -s, -s}, { s,  s, -s}, {-s,  s, -s},  // Back face
+        {-s, -s,  s}, { s, -s,  s}, { s,  s,  s}, {-s,  s,  s}   // Front face
+    };
+    
+    // Define texture coordinates for each face
+    std::vector<glm::vec2> texCoords = {
+        {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}
+    };
+    
+    // Define the 6 faces of the cube
+    struct Face {
+        int v0, v1, v2, v3;
+    };
+    
+    std::vector<Face> faces = {
+        {0, 1, 2, 3},  // Back
+        {4, 7, 6, 5},  // Front
+        {0, 4, 5, 1},  // Bottom
+        {2, 6, 7, 3},  // Top
+        {0, 3, 7, 4},  // Left
+        {1, 5, 6, 2}   // Right
+    };
+    
+    uint32_t indexOffset = 0;
+    for (const auto& face : faces) {
+        // Add 4 vertices for this face
+        for (int i = 0; i < 4; i++) {
+            int vertexIdx = (i == 0) ? face.v0 : (i == 1) ? face.v1 : (i == 2) ? face.v2 : face.v3;
+            Vertex v;
+            v.pos = positions[vertexIdx];
+            v.color = {1.0f, 1.0f, 1.0f};  // White color
+            v.texCoord = texCoords[i];
+            vertices.push_back(v);
+        }
+        
+        // Add 2 triangles (6 indices) for this face
+        indices.push_back(indexOffset + 0);
+        indices.push_back(indexOffset + 1);
+        indices.push_back(indexOffset + 2);
+        indices.push_back(indexOffset + 2);
+        indices.push_back(indexOffset + 3);
+        indices.push_back(indexOffset + 0);
+        
+        indexOffset += 4;
+    }
+    
+    return {vertices, indices};
+}
+
+// Generate a grass-like pixelated texture programmatically
+std::vector<uint8_t> GenerateGrassTexture(uint32_t width, uint32_t height) {
+    std::vector<uint8_t> pixels(width * height * 4);  // RGBA
+    GenerateGrassTexture(width, height, pixels.data());
+    return pixels;
+}
+
+void GenerateGrassTexture(uint32_t width, uint32_t height, uint8_t* pixels) {
+    // Main grass color
+    const uint8_t base_r = 55;
+    const uint8_t base_g = 170;
+    const uint8_t base_b = 47;
+
+    // For a "pixelated" look, create chunky blocks of grass blades and dirt
+    uint32_t blockSize = std::max(2u, width / 16); // controls "pixels" size for pixelated effect
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t index = (y * width + x) * 4;
+
+            // Calculate block coordinates
+            uint32_t bx = x / blockSize;
+            uint32_t by = y / blockSize;
+
+            // Add variation in green tones for the grass "pixels"
+            uint8_t r = base_r + static_cast<uint8_t>((bx * by + x + y) % 13);
+            uint8_t g = base_g + static_cast<uint8_t>((bx * 5 + by * 13 + x) % 30); // stronger green
+            uint8_t b = base_b + static_cast<uint8_t>((bx * 7 + by * 3 + y) % 14);
+
+            // Optionally: simulate some dirt at the bottom (brownish, last ~15% rows)
+            float fy = static_cast<float>(y) / height;
+            if (fy > 0.85f) {
+                // Brown dirt
+                r = 111 + static_cast<uint8_t>((bx * 19 + x) % 14);
+                g = 79 + static_cast<uint8_t>((by * 11 + y) % 8);
+                b = 44 + static_cast<uint8_t>((bx * 13 + y) % 8);
+            }
+
+            pixels[index + 0] = r;
+            pixels[index + 1] = g;
+            pixels[index + 2] = b;
+            pixels[index + 3] = 255; // Alpha
+        }
+    }
+}
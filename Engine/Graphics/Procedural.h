@@ -0,0 +1,18 @@
+#ifndef PROCEDURAL_H
+#define PROCEDURAL_H
+
+#include "Drivers/Vulkan/Vertex.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Generate a cube mesh programmatically, centered on the origin
+std::pair<std::vector<Vertex>, std::vector<uint32_t>> GenerateCubeMesh(float size = 0.5f);
+
+// Generate a grass-like pixelated RGBA texture programmatically
+std::vector<uint8_t> GenerateGrassTexture(uint32_t width, uint32_t height);
+// Same, written into width * height * 4 bytes the caller provides (e.g. a
+// TextureUpload's staging memory)
+void GenerateGrassTexture(uint32_t width, uint32_t height, uint8_t* pixels);
+
+#endif // PROCEDURAL_H
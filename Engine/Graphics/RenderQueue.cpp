@@ -0,0 +1,137 @@
+#include "RenderQueue.h"
+#include "Drivers/Vulkan/Mesh.h"
+#include "../Jobs/JobSystem.h"
+
+#include <algorithm>
+
+// Boxes per culling job, small enough to balance, large enough that the
+// scheduling cost disappears
+static const uint32_t CULL_CHUNK = 1024;
+
+static const RenderMaterial DEFAULT_MATERIAL{glm::vec4(1.0f), glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)};
+
+RenderQueue::RenderQueue() { materials.push_back(DEFAULT_MATERIAL); }
+
+void RenderQueue::Submit(const RenderObject &renderObject) {
+  RenderPacket packet{renderObject.mesh.get(), renderObject.texture.get(),
+                      renderObject.modelMatrix};
+  packet.pipelineFeatures = renderObject.pipelineFeatures;
+  packets.push_back(packet);
+
+  // Runs of objects usually share parameters, so only consecutive
+  // duplicates are folded
+  RenderMaterial material{renderObject.materialColor, renderObject.uvTransform,
+                          renderObject.frameData, renderObject.instanceCount};
+  if (material == DEFAULT_MATERIAL) {
+    packetMaterials.push_back(0);
+    return;
+  }
+  if (!(material == materials.back())) {
+    materials.push_back(material);
+  }
+  packetMaterials.push_back(static_cast<uint32_t>(materials.size() - 1));
+}
+
+void RenderQueue::Submit(const RenderPacket *batch, size_t count) {
+  packets.insert(packets.end(), batch, batch + count);
+  packetMaterials.resize(packets.size(), 0);
+}
+
+void RenderQueue::Forget(const void *resource) {
+  size_t kept = 0;
+  for (size_t i = 0; i < packets.size(); i++) {
+    if (packets[i].mesh == resource || packets[i].texture == resource) { continue; }
+    packets[kept]         = packets[i];
+    packetMaterials[kept] = packetMaterials[i];
+    kept++;
+  }
+  packets.resize(kept);
+  packetMaterials.resize(kept);
+  visible.clear();
+}
+
+void RenderQueue::Clear() {
+  packets.clear();
+  packetMaterials.clear();
+  materials.resize(1);
+  visible.clear();
+}
+
+void RenderQueue::Prepare(const glm::mat4 &viewProjection, JobSystem *jobs) {
+  FrustumPlanes planes = ExtractFrustumPlanes(viewProjection);
+
+  auto cull = [this, &planes](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      if (packets[i].pipelineFeatures & PIPELINE_FEATURE_INSTANCED) {
+        cullResults[i] = 1;
+        continue;
+      }
+      const Mesh &mesh = *packets[i].mesh;
+      cullResults[i]   = IsBoxInFrustum(planes, mesh.GetBoundsMin(), mesh.GetBoundsMax(),
+                                        packets[i].modelMatrix);
+    }
+  };
+  uint32_t count = static_cast<uint32_t>(packets.size());
+  cullResults.resize(count);
+  if (jobs) {
+    jobs->ParallelFor(count, CULL_CHUNK, cull);
+  } else {
+    cull(0, count);
+  }
+
+  visible.clear();
+  visible.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (cullResults[i]) { visible.push_back(i); }
+  }
+
+  // Sorting indices keeps the swaps small, the packets stay where they are
+  std::sort(visible.begin(), visible.end(), [this](uint32_t ia, uint32_t ib) {
+    const RenderPacket &a = packets[ia];
+    const RenderPacket &b = packets[ib];
+    if (a.sortKey != b.sortKey) { return a.sortKey < b.sortKey; }
+    if (a.pipelineFeatures != b.pipelineFeatures) {
+      return a.pipelineFeatures < b.pipelineFeatures;
+    }
+    if (a.texture != b.texture) { return a.texture < b.texture; }
+    return a.mesh < b.mesh;
+  });
+}
+
+FrustumPlanes ExtractFrustumPlanes(const glm::mat4 &viewProjection) {
+  // Rows of the matrix (glm is column major)
+  glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+  glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+  glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+  glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+  // The near plane uses the -w <= z convention, which also contains the
+  // 0 <= z clip range so culling stays conservative for either depth range
+  FrustumPlanes planes = {row3 + row0, row3 - row0, row3 + row1,
+                          row3 - row1, row3 + row2, row3 - row2};
+  for (auto &plane : planes) {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.0f) { plane /= length; }
+  }
+  return planes;
+}
+
+bool IsBoxInFrustum(const FrustumPlanes &planes, const glm::vec3 &boundsMin,
+                    const glm::vec3 &boundsMax, const glm::mat4 &modelMatrix) {
+  // Transform the box to world space as center plus extents
+  glm::vec3 localCenter  = (boundsMin + boundsMax) * 0.5f;
+  glm::vec3 localExtents = (boundsMax - boundsMin) * 0.5f;
+  glm::vec3 center       = glm::vec3(modelMatrix * glm::vec4(localCenter, 1.0f));
+  glm::vec3 extents(0.0f);
+  for (int axis = 0; axis < 3; axis++) {
+    extents += glm::abs(glm::vec3(modelMatrix[axis])) * localExtents[axis];
+  }
+
+  for (const auto &plane : planes) {
+    glm::vec3 normal(plane);
+    float     distance = glm::dot(normal, center) + plane.w;
+    float     radius   = glm::dot(glm::abs(normal), extents);
+    if (distance < -radius) { return false; }
+  }
+  return true;
+}
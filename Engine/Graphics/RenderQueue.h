@@ -0,0 +1,76 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "Drivers/Vulkan/RenderObject.h"
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Per-draw parameters that don't fit in a RenderPacket
+struct RenderMaterial {
+    glm::vec4 color;
+    glm::vec4 uvTransform;
+    uint64_t  frameData     = 0; // FrameDataAllocation::handle
+    uint32_t  instanceCount = 1;
+
+    // The parameters that go into ObjectUniforms
+    bool SameUniforms(const RenderMaterial &other) const {
+      return color == other.color && uvTransform == other.uvTransform;
+    }
+    bool operator==(const RenderMaterial &other) const {
+      return SameUniforms(other) && frameData == other.frameData &&
+             instanceCount == other.instanceCount;
+    }
+};
+
+// Per-frame list of submitted draws, shared by the graphics drivers.
+// Everything is stored as RenderPackets plus a small material table, in
+// storage that Clear() keeps so steady-state frames don't allocate.
+// Prepare() culls draws whose mesh bounds are outside the view frustum
+// (instanced draws are kept) and sorts the rest by sort key, then pipeline
+// variant, texture and mesh so consecutive draws can reuse pipeline,
+// descriptor set and vertex buffer binds. The queue does not own the resources it references.
+class RenderQueue {
+  public:
+    RenderQueue();
+
+    void Submit(const RenderObject &renderObject);
+    // Appends a batch of packets drawing with the default material
+    void Submit(const RenderPacket *packets, size_t count);
+    // Drops queued draws that reference a resource being released
+    void Forget(const void *resource);
+    void Clear();
+
+    // Culling is spread over the job system when one is given
+    void Prepare(const glm::mat4 &viewProjection, JobSystem *jobs = nullptr);
+
+    // Indices of the draws that survived culling, in draw order (valid
+    // after Prepare)
+    const std::vector<uint32_t> &Visible() const { return visible; }
+    const RenderPacket          &Packet(uint32_t index) const { return packets[index]; }
+    const RenderMaterial        &Material(uint32_t index) const {
+      return materials[packetMaterials[index]];
+    }
+    size_t SubmittedCount() const { return packets.size(); }
+    size_t CulledCount() const { return packets.size() - visible.size(); }
+
+  private:
+    std::vector<RenderPacket>   packets;
+    std::vector<uint32_t>       packetMaterials; // Index into materials, per packet
+    std::vector<RenderMaterial> materials;       // [0] is the default material
+    std::vector<uint32_t>       visible;
+    std::vector<uint8_t>        cullResults; // Per packet, written in parallel
+};
+
+// Frustum planes (xyz normal, w distance) extracted from a view-projection
+// matrix, normals point inwards
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+FrustumPlanes ExtractFrustumPlanes(const glm::mat4 &viewProjection);
+bool          IsBoxInFrustum(const FrustumPlanes &planes, const glm::vec3 &boundsMin,
+                             const glm::vec3 &boundsMax, const glm::mat4 &modelMatrix);
+
+#endif // RENDERQUEUE_H
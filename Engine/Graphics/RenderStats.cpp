@@ -0,0 +1,233 @@
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+RenderStats::RenderStats(size_t historySize)
+    : history(std::max<size_t>(historySize, 1)) {}
+
+RenderStats::~RenderStats() {
+  DisableDump();
+}
+
+void RenderStats::EndFrame() {
+  auto now = std::chrono::steady_clock::now();
+  if (hasLastFrameEnd) {
+    current.frameTimeMs =
+      std::chrono::duration<double, std::milli>(now - lastFrameEnd).count();
+  }
+  lastFrameEnd    = now;
+  hasLastFrameEnd = true;
+
+  AddFrame(current);
+  current = FrameStats{};
+}
+
+void RenderStats::AddFrame(const FrameStats &frame) {
+  lastFrame            = frame;
+  lastFrame.frameIndex = frameCount++;
+
+  history[historyHead] = lastFrame;
+  historyHead          = (historyHead + 1) % history.size();
+  historyUsed          = std::min(historyUsed + 1, history.size());
+
+  if (dumpInterval > 0 && ++framesSinceDump >= dumpInterval) {
+    Dump();
+    framesSinceDump = 0;
+  }
+}
+
+void RenderStats::Reset() {
+  frameCount      = 0;
+  historyHead     = 0;
+  historyUsed     = 0;
+  framesSinceDump = 0;
+  hasLastFrameEnd = false;
+  current         = FrameStats{};
+  lastFrame       = FrameStats{};
+}
+
+size_t RenderStats::HistorySize() const {
+  return historyUsed;
+}
+
+const FrameStats &RenderStats::HistoryAt(size_t age) const {
+  // age 0 is the most recently finished frame
+  size_t index = (historyHead + history.size() - 1 - age) % history.size();
+  return history[index];
+}
+
+FrameStats RenderStats::Average() const {
+  FrameStats average{};
+  if (historyUsed == 0) { return average; }
+
+  double drawCalls = 0, pipelineBinds = 0, descriptorSetBinds = 0;
+  double vertexBufferBinds = 0, triangles = 0, bytesUploaded = 0;
+  double stagingBytes = 0, stagingAllocations = 0, descriptorSets = 0;
+
+  for (size_t i = 0; i < historyUsed; i++) {
+    const FrameStats &frame = HistoryAt(i);
+    drawCalls += frame.drawCalls;
+    pipelineBinds += frame.pipelineBinds;
+    descriptorSetBinds += frame.descriptorSetBinds;
+    vertexBufferBinds += frame.vertexBufferBinds;
+    triangles += static_cast<double>(frame.trianglesSubmitted);
+    bytesUploaded += static_cast<double>(frame.bytesUploaded);
+    stagingBytes += static_cast<double>(frame.stagingBytes);
+    stagingAllocations += frame.stagingAllocations;
+    descriptorSets += frame.descriptorSetsAllocated;
+    average.cpuRecordMs += frame.cpuRecordMs;
+    average.fenceWaitMs += frame.fenceWaitMs;
+    average.frameTimeMs += frame.frameTimeMs;
+    average.inputLatencyMs += frame.inputLatencyMs;
+    average.pacingSleepMs += frame.pacingSleepMs;
+  }
+
+  double count                    = static_cast<double>(historyUsed);
+  average.frameIndex              = lastFrame.frameIndex;
+  average.drawCalls               = static_cast<uint32_t>(drawCalls / count);
+  average.pipelineBinds           = static_cast<uint32_t>(pipelineBinds / count);
+  average.descriptorSetBinds      = static_cast<uint32_t>(descriptorSetBinds / count);
+  average.vertexBufferBinds       = static_cast<uint32_t>(vertexBufferBinds / count);
+  average.trianglesSubmitted      = static_cast<uint64_t>(triangles / count);
+  average.bytesUploaded           = static_cast<uint64_t>(bytesUploaded / count);
+  average.stagingBytes            = static_cast<uint64_t>(stagingBytes / count);
+  average.stagingAllocations      = static_cast<uint32_t>(stagingAllocations / count);
+  average.descriptorSetsAllocated = static_cast<uint32_t>(descriptorSets / count);
+  average.cpuRecordMs /= count;
+  average.fenceWaitMs /= count;
+  average.frameTimeMs /= count;
+  average.inputLatencyMs /= count;
+  average.pacingSleepMs /= count;
+  return average;
+}
+
+double RenderStats::FrameTimePercentile(double percentile) const {
+  return Percentile(&FrameStats::frameTimeMs, percentile);
+}
+
+double RenderStats::InputLatencyPercentile(double percentile) const {
+  return Percentile(&FrameStats::inputLatencyMs, percentile);
+}
+
+double RenderStats::Percentile(double FrameStats::*field, double percentile) const {
+  if (historyUsed == 0) { return 0.0; }
+
+  std::vector<double> values(historyUsed);
+  for (size_t i = 0; i < historyUsed; i++) {
+    values[i] = HistoryAt(i).*field;
+  }
+
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  size_t rank =
+    static_cast<size_t>(std::ceil(percentile / 100.0 * historyUsed));
+  rank = std::clamp<size_t>(rank, 1, historyUsed) - 1;
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank];
+}
+
+double RenderStats::FrameTimeVariance() const {
+  if (historyUsed < 2) { return 0.0; }
+
+  double mean = Average().frameTimeMs;
+  double sum  = 0.0;
+  for (size_t i = 0; i < historyUsed; i++) {
+    double delta = HistoryAt(i).frameTimeMs - mean;
+    sum += delta * delta;
+  }
+  return sum / static_cast<double>(historyUsed - 1);
+}
+
+void RenderStats::EnableDump(const std::string &path, StatsDumpFormat format,
+                             uint32_t everyNFrames) {
+  DisableDump();
+
+  dumpFile.open(path, std::ios::out | std::ios::trunc);
+  if (!dumpFile.is_open()) {
+    std::cerr << "Warning: could not open stats dump file " << path
+              << std::endl;
+    return;
+  }
+
+  // The history has to hold a full batch so no frame is skipped on dump
+  if (everyNFrames > history.size()) {
+    history.assign(everyNFrames, FrameStats{});
+    historyHead = 0;
+    historyUsed = 0;
+  }
+
+  dumpFormat      = format;
+  dumpInterval    = everyNFrames;
+  framesSinceDump = 0;
+
+  if (dumpFormat == StatsDumpFormat::Csv) { WriteCsvHeader(dumpFile); }
+}
+
+void RenderStats::DisableDump() {
+  if (dumpFile.is_open()) {
+    dumpFile.flush();
+    dumpFile.close();
+  }
+  dumpInterval = 0;
+}
+
+void RenderStats::Dump() {
+  if (!dumpFile.is_open()) { return; }
+
+  if (dumpFormat == StatsDumpFormat::Csv) {
+    size_t rows = std::min<size_t>(framesSinceDump, historyUsed);
+    for (size_t age = rows; age-- > 0;) {
+      WriteCsvRow(dumpFile, HistoryAt(age));
+    }
+  } else {
+    WriteJsonSummary(dumpFile);
+    dumpFile << '\n';
+  }
+  dumpFile.flush();
+}
+
+void RenderStats::WriteCsvHeader(std::ostream &out) const {
+  out << "frame,frameTimeMs,cpuRecordMs,fenceWaitMs,drawCalls,pipelineBinds,"
+         "descriptorSetBinds,vertexBufferBinds,triangles,bytesUploaded,"
+         "stagingBytes,stagingAllocations,descriptorSetsAllocated,"
+         "inputLatencyMs,pacingSleepMs\n";
+}
+
+void RenderStats::WriteCsvRow(std::ostream     &out,
+                              const FrameStats &stats) const {
+  out << stats.frameIndex << ',' << stats.frameTimeMs << ','
+      << stats.cpuRecordMs << ',' << stats.fenceWaitMs << ','
+      << stats.drawCalls << ',' << stats.pipelineBinds << ','
+      << stats.descriptorSetBinds << ',' << stats.vertexBufferBinds << ','
+      << stats.trianglesSubmitted << ',' << stats.bytesUploaded << ','
+      << stats.stagingBytes << ',' << stats.stagingAllocations << ','
+      << stats.descriptorSetsAllocated << ',' << stats.inputLatencyMs << ','
+      << stats.pacingSleepMs << '\n';
+}
+
+void RenderStats::WriteJsonSummary(std::ostream &out) const {
+  FrameStats average = Average();
+  out << "{\"frame\":" << lastFrame.frameIndex
+      << ",\"samples\":" << historyUsed
+      << ",\"frameTimeMs\":{\"avg\":" << average.frameTimeMs
+      << ",\"p50\":" << FrameTimePercentile(50.0)
+      << ",\"p99\":" << FrameTimePercentile(99.0)
+      << ",\"variance\":" << FrameTimeVariance() << "}"
+      << ",\"inputLatencyMs\":{\"avg\":" << average.inputLatencyMs
+      << ",\"p50\":" << InputLatencyPercentile(50.0)
+      << ",\"p99\":" << InputLatencyPercentile(99.0) << "}"
+      << ",\"pacingSleepMs\":" << average.pacingSleepMs
+      << ",\"cpuRecordMs\":" << average.cpuRecordMs
+      << ",\"fenceWaitMs\":" << average.fenceWaitMs
+      << ",\"drawCalls\":" << average.drawCalls
+      << ",\"pipelineBinds\":" << average.pipelineBinds
+      << ",\"descriptorSetBinds\":" << average.descriptorSetBinds
+      << ",\"vertexBufferBinds\":" << average.vertexBufferBinds
+      << ",\"triangles\":" << average.trianglesSubmitted
+      << ",\"bytesUploaded\":" << average.bytesUploaded
+      << ",\"stagingBytes\":" << average.stagingBytes
+      << ",\"stagingAllocations\":" << average.stagingAllocations
+      << ",\"descriptorSetsAllocated\":" << average.descriptorSetsAllocated
+      << "}";
+}
@@ -0,0 +1,93 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Counters collected by a graphics driver for a single frame
+struct FrameStats {
+  uint64_t frameIndex              = 0;
+  uint32_t drawCalls               = 0;
+  uint32_t pipelineBinds           = 0;
+  uint32_t descriptorSetBinds      = 0;
+  uint32_t vertexBufferBinds       = 0;
+  uint64_t trianglesSubmitted      = 0;
+  uint64_t bytesUploaded           = 0; // Bytes copied to GPU memory
+  uint64_t stagingBytes            = 0; // Bytes of staging memory allocated
+  uint32_t stagingAllocations      = 0;
+  uint32_t descriptorSetsAllocated = 0;
+  double   cpuRecordMs             = 0.0; // Command recording time
+  double   fenceWaitMs             = 0.0; // Time blocked on frame fences
+  double   frameTimeMs             = 0.0; // Wall time since the previous frame
+  double   inputLatencyMs          = 0.0; // Input latch to GPU completion of the
+                                          // most recently completed frame
+  double   pacingSleepMs           = 0.0; // Time slept to hold the frame cap
+};
+
+enum class StatsDumpFormat {
+  Csv,  // One row per frame, appended in batches
+  Json, // One summary object per batch (JSON Lines)
+};
+
+// Rolling per-frame statistics for a graphics driver.
+// Drivers add to Current() while building a frame and call EndFrame() once
+// the frame is submitted; the finished frame goes into a fixed-size history
+// that averages and percentiles are computed from.
+class RenderStats {
+  public:
+    explicit RenderStats(size_t historySize = 300);
+    ~RenderStats();
+
+    FrameStats       &Current() { return current; }
+    const FrameStats &LastFrame() const { return lastFrame; }
+    uint64_t          FrameCount() const { return frameCount; }
+
+    void EndFrame();
+    // Adds a frame finished by another RenderStats as is, frame time
+    // included, for copies kept on another thread
+    void AddFrame(const FrameStats &frame);
+    // Starts over: history, frame count and the frame in progress
+    void Reset();
+
+    // Aggregates over the frames currently held in history
+    FrameStats Average() const;
+    double     FrameTimePercentile(double percentile) const;
+    double     FrameTimeVariance() const;
+    double     InputLatencyPercentile(double percentile) const;
+    size_t     HistorySize() const;
+
+    // Append stats to a file every N frames (0 disables dumping)
+    void EnableDump(const std::string &path, StatsDumpFormat format,
+                    uint32_t everyNFrames);
+    void DisableDump();
+
+    void WriteCsvHeader(std::ostream &out) const;
+    void WriteCsvRow(std::ostream &out, const FrameStats &stats) const;
+    void WriteJsonSummary(std::ostream &out) const;
+
+  private:
+    std::vector<FrameStats> history;
+    size_t                  historyHead = 0;
+    size_t                  historyUsed = 0;
+    FrameStats              current;
+    FrameStats              lastFrame;
+    uint64_t                frameCount = 0;
+
+    std::chrono::steady_clock::time_point lastFrameEnd;
+    bool                                  hasLastFrameEnd = false;
+
+    std::ofstream   dumpFile;
+    StatsDumpFormat dumpFormat      = StatsDumpFormat::Csv;
+    uint32_t        dumpInterval    = 0;
+    uint32_t        framesSinceDump = 0;
+
+    const FrameStats &HistoryAt(size_t age) const;
+    double            Percentile(double FrameStats::*field, double percentile) const;
+    void              Dump();
+};
+
+#endif // RENDERSTATS_H
@@ -0,0 +1,190 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+uint32_t AlignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Bottom-left skyline packer: the top edge of everything placed on a page,
+// as horizontal segments from left to right
+class Skyline {
+  public:
+    explicit Skyline(uint32_t size) : size(size), segments{{0, 0, size}} {}
+
+    // Places a width x height rectangle at the lowest, then leftmost, spot
+    bool Insert(uint32_t width, uint32_t height, uint32_t &outX, uint32_t &outY) {
+      size_t   bestIndex = segments.size();
+      uint32_t bestY     = UINT32_MAX;
+      for (size_t i = 0; i < segments.size(); i++) {
+        uint32_t x = segments[i].x;
+        if (x + width > size) { break; }
+
+        // The rectangle rests on the highest segment it spans
+        uint32_t y = 0;
+        for (size_t j = i; j < segments.size() && segments[j].x < x + width; j++) {
+          y = std::max(y, segments[j].y);
+        }
+        if (y + height <= size && y < bestY) {
+          bestY     = y;
+          bestIndex = i;
+        }
+      }
+      if (bestIndex == segments.size()) { return false; }
+
+      outX           = segments[bestIndex].x;
+      outY           = bestY;
+      uint32_t right = outX + width;
+
+      // Drop or trim the segments now hidden under the rectangle
+      size_t i = bestIndex;
+      while (i < segments.size() && segments[i].x < right) {
+        uint32_t end = segments[i].x + segments[i].width;
+        if (end <= right) {
+          segments.erase(segments.begin() + i);
+        } else {
+          segments[i].width = end - right;
+          segments[i].x     = right;
+          break;
+        }
+      }
+      segments.insert(segments.begin() + bestIndex, {outX, outY + height, width});
+
+      for (size_t k = 0; k + 1 < segments.size();) {
+        if (segments[k].y == segments[k + 1].y) {
+          segments[k].width += segments[k + 1].width;
+          segments.erase(segments.begin() + k + 1);
+        } else {
+          k++;
+        }
+      }
+      return true;
+    }
+
+  private:
+    struct Segment {
+      uint32_t x;
+      uint32_t y;
+      uint32_t width;
+    };
+
+    uint32_t             size;
+    std::vector<Segment> segments;
+};
+} // namespace
+
+TextureAtlas::TextureAtlas(uint32_t pageSize, uint32_t padding, uint32_t mipLevels)
+    : pageSize(pageSize) {
+  alignment = 1u << (std::max<uint32_t>(mipLevels, 1) - 1);
+  gutter    = AlignUp(std::max(padding, mipLevels > 1 ? alignment : 0u), alignment);
+}
+
+uint32_t TextureAtlas::Add(uint32_t width, uint32_t height, const void *pixels) {
+  if (packed) {
+    throw std::runtime_error("TextureAtlas::Add called after the atlas was packed");
+  }
+  if (width == 0 || height == 0 || !pixels) {
+    throw std::runtime_error("TextureAtlas::Add called without pixel data");
+  }
+  if (AlignUp(width + 2 * gutter, alignment) > pageSize ||
+      AlignUp(height + 2 * gutter, alignment) > pageSize) {
+    throw std::runtime_error("Texture does not fit on an atlas page");
+  }
+
+  const uint8_t *bytes = static_cast<const uint8_t *>(pixels);
+  sources.push_back({width, height,
+                     std::vector<uint8_t>(bytes, bytes + static_cast<size_t>(width) * height * 4)});
+  regions.emplace_back();
+  return static_cast<uint32_t>(regions.size() - 1);
+}
+
+void TextureAtlas::Pack() {
+  if (packed) { return; }
+
+  // Tallest first keeps the skyline flat
+  std::vector<uint32_t> order(sources.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    if (sources[a].height != sources[b].height) {
+      return sources[a].height > sources[b].height;
+    }
+    return sources[a].width > sources[b].width;
+  });
+
+  std::vector<Skyline> skylines;
+  const float          texel = 1.0f / static_cast<float>(pageSize);
+  for (uint32_t id : order) {
+    const Source &source = sources[id];
+    uint32_t      width  = AlignUp(source.width + 2 * gutter, alignment);
+    uint32_t      height = AlignUp(source.height + 2 * gutter, alignment);
+
+    uint32_t x = 0, y = 0;
+    size_t   page = 0;
+    while (page < skylines.size() && !skylines[page].Insert(width, height, x, y)) {
+      page++;
+    }
+    if (page == skylines.size()) {
+      skylines.emplace_back(pageSize);
+      pages.emplace_back(static_cast<size_t>(pageSize) * pageSize * 4, 0);
+      skylines.back().Insert(width, height, x, y);
+    }
+
+    Blit(pages[page], source, x + gutter, y + gutter);
+    regions[id].page        = static_cast<uint32_t>(page);
+    regions[id].uvTransform = glm::vec4(source.width * texel, source.height * texel,
+                                        (x + gutter) * texel, (y + gutter) * texel);
+    usedArea += static_cast<uint64_t>(width) * height;
+  }
+
+  sources.clear();
+  sources.shrink_to_fit();
+  pageCount = pages.size();
+  packed    = true;
+}
+
+void TextureAtlas::Build(IGraphicsDriver &driver) {
+  Pack();
+
+  std::vector<std::shared_ptr<Texture>> pageTextures;
+  for (const auto &page : pages) {
+    pageTextures.push_back(driver.CreateTexture(pageSize, pageSize, page.data()));
+  }
+  for (auto &region : regions) {
+    region.texture = pageTextures[region.page];
+  }
+
+  // The driver keeps its own copy
+  pages.clear();
+  pages.shrink_to_fit();
+}
+
+float TextureAtlas::Occupancy() const {
+  if (pageCount == 0) { return 0.0f; }
+  double pageArea = static_cast<double>(pageSize) * pageSize * pageCount;
+  return static_cast<float>(usedArea / pageArea);
+}
+
+void TextureAtlas::Blit(std::vector<uint8_t> &page, const Source &source,
+                        uint32_t x, uint32_t y) const {
+  // Copies the texels and replicates the edges into the gutter
+  const uint32_t width  = source.width;
+  const uint32_t height = source.height;
+  for (int64_t row = -static_cast<int64_t>(gutter); row < height + gutter; row++) {
+    uint32_t       sourceRow = static_cast<uint32_t>(std::clamp<int64_t>(row, 0, height - 1));
+    const uint8_t *sourceTexels = source.pixels.data() + static_cast<size_t>(sourceRow) * width * 4;
+    uint8_t       *destination =
+      page.data() + ((static_cast<size_t>(y + row) * pageSize) + x - gutter) * 4;
+
+    for (uint32_t i = 0; i < gutter; i++) {
+      memcpy(destination + i * 4, sourceTexels, 4);
+    }
+    memcpy(destination + gutter * 4, sourceTexels, static_cast<size_t>(width) * 4);
+    for (uint32_t i = 0; i < gutter; i++) {
+      memcpy(destination + (gutter + width + i) * 4, sourceTexels + (width - 1) * 4, 4);
+    }
+  }
+}
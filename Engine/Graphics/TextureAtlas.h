@@ -0,0 +1,74 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include "Drivers/IGraphicsDriver.h"
+#include "Drivers/Vulkan/RenderObject.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A region of an atlas page. Shaders sample the page at
+// uv * uvTransform.xy + uvTransform.zw, so meshes keep their 0..1 UVs.
+struct SubTexture {
+  std::shared_ptr<Texture> texture; // The page texture, set by Build()
+  uint32_t                 page        = 0;
+  glm::vec4                uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+// Points a render object at an atlas region
+inline void ApplySubTexture(RenderObject &renderObject, const SubTexture &subTexture) {
+  renderObject.texture     = subTexture.texture;
+  renderObject.uvTransform = subTexture.uvTransform;
+}
+
+// Packs many small RGBA8 textures into a few large pages with a skyline
+// packer, so objects that use them share one texture bind. Every region is
+// surrounded by a gutter of replicated edge texels; regions are aligned to
+// 2^(mipLevels-1) texels and the gutter is at least that wide, so each mip
+// level down to the last keeps a one texel gutter and filtering never
+// pulls in a neighbour.
+class TextureAtlas {
+  public:
+    explicit TextureAtlas(uint32_t pageSize = 1024, uint32_t padding = 2,
+                          uint32_t mipLevels = 1);
+
+    // Copies the pixels and returns the id of the future region
+    uint32_t Add(uint32_t width, uint32_t height, const void *pixels);
+
+    // Packs everything added so far into page pixels (CPU only)
+    void Pack();
+    // Packs and creates one driver texture per page
+    void Build(IGraphicsDriver &driver);
+
+    const SubTexture                        &Get(uint32_t id) const { return regions[id]; }
+    size_t                                   RegionCount() const { return regions.size(); }
+    size_t                                   PageCount() const { return pageCount; }
+    uint32_t                                 PageSize() const { return pageSize; }
+    // Page pixels, released once Build() has uploaded them
+    const std::vector<std::vector<uint8_t>> &PagePixels() const { return pages; }
+    // Fraction of the page area covered by regions and their gutters
+    float                                    Occupancy() const;
+
+  private:
+    struct Source {
+      uint32_t             width;
+      uint32_t             height;
+      std::vector<uint8_t> pixels;
+    };
+
+    uint32_t pageSize;
+    uint32_t gutter;
+    uint32_t alignment;
+    bool     packed = false;
+
+    std::vector<Source>               sources;
+    std::vector<SubTexture>           regions;
+    std::vector<std::vector<uint8_t>> pages;
+    size_t                            pageCount = 0;
+    uint64_t                          usedArea  = 0;
+
+    void Blit(std::vector<uint8_t> &page, const Source &source, uint32_t x, uint32_t y) const;
+};
+
+#endif // TEXTUREATLAS_H
@@ -0,0 +1,318 @@
+#include "ChunkMeshScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Chunks outside the frustum sort after every visible chunk this close
+static const float INVISIBLE_PENALTY = 1.0e6f;
+
+static glm::vec3 ChunkOrigin(const ChunkCoord &coord) {
+  const float size = static_cast<float>(VoxelChunk::SIZE);
+  return glm::vec3(coord.x * size, coord.y * size, coord.z * size);
+}
+
+static bool ChunkCoordLess(const ChunkCoord &a, const ChunkCoord &b) {
+  if (a.x != b.x) { return a.x < b.x; }
+  if (a.y != b.y) { return a.y < b.y; }
+  return a.z < b.z;
+}
+
+ChunkMeshScheduler::ChunkMeshScheduler(VoxelWorld &world, IGraphicsDriver &driver, JobSystem &jobs,
+                                       const ChunkMeshSchedulerOptions &options)
+    : world(world), driver(driver), jobs(jobs), options(options) {
+  if (this->options.maxJobsInFlight == 0) { this->options.maxJobsInFlight = 2 * jobs.ThreadCount(); }
+}
+
+ChunkMeshScheduler::~ChunkMeshScheduler() {
+  for (auto &entry : inFlight) {
+    entry.second->cancelled = true;
+  }
+  jobs.Wait(counter);
+  for (auto &entry : meshes) {
+    driver.ReleaseMesh(entry.second);
+  }
+}
+
+void ChunkMeshScheduler::Update(const glm::vec3 &cameraPosition, const FrustumPlanes &frustum) {
+  CollectGpuOverflows();
+  Dispatch(cameraPosition, frustum);
+  if (jobs.ThreadCount() == 1) { jobs.Wait(counter); }
+  CollectFinished();
+  Upload(cameraPosition, frustum);
+
+  stats.pending  = static_cast<uint32_t>(pending.size());
+  stats.inFlight = runningJobs.load();
+  stats.ready    = static_cast<uint32_t>(ready.size());
+}
+
+bool ChunkMeshScheduler::IsIdle() const {
+  return pending.empty() && inFlight.empty() && ready.empty();
+}
+
+void ChunkMeshScheduler::AppendRenderPackets(const Texture *texture, std::vector<RenderPacket> &packets) const {
+  for (const auto &entry : meshes) {
+    RenderPacket packet{};
+    packet.mesh             = entry.second.get();
+    packet.texture          = texture;
+    packet.modelMatrix      = glm::mat4(1.0f);
+    packet.modelMatrix[3]   = glm::vec4(ChunkOrigin(entry.first), 1.0f);
+    packet.pipelineFeatures = PIPELINE_FEATURE_VOXEL;
+    packets.push_back(packet);
+  }
+}
+
+const Mesh *ChunkMeshScheduler::GetMesh(const ChunkCoord &coord) const {
+  auto it = meshes.find(coord);
+  return it != meshes.end() ? it->second.get() : nullptr;
+}
+
+void ChunkMeshScheduler::CollectFinished() {
+  std::vector<MeshResult> results;
+  {
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    results.swap(finished);
+  }
+  for (MeshResult &result : results) {
+    auto it = inFlight.find(result.coord);
+    if (it != inFlight.end() && it->second->version == result.version) { inFlight.erase(it); }
+    // Finished just before it was cancelled; the newer job is counted
+    if (world.Version(result.coord) != result.version) { continue; }
+    stats.meshed++;
+    ready.push_back(std::move(result));
+  }
+}
+
+void ChunkMeshScheduler::Upload(const glm::vec3 &cameraPosition, const FrustumPlanes &frustum) {
+  if (ready.empty()) { return; }
+  for (MeshResult &result : ready) {
+    result.priority = Priority(result.coord, cameraPosition, frustum);
+  }
+  std::sort(ready.begin(), ready.end(),
+            [](const MeshResult &a, const MeshResult &b) { return a.priority < b.priority; });
+
+  size_t spent = 0;
+  size_t done  = 0;
+  for (; done < ready.size(); done++) {
+    MeshResult &result = ready[done];
+    // Edited or unloaded since
+    if (world.Version(result.coord) != result.version) { continue; }
+    size_t bytes = result.vertices.size() * sizeof(VoxelVertex);
+    if (spent > 0 && spent + bytes > options.uploadBytesPerFrame) { break; }
+    spent += bytes;
+
+    DropMesh(result.coord);
+    if (!result.vertices.empty()) {
+      meshes[result.coord] = driver.CreateVoxelMesh(result.vertices.data(), result.vertices.size());
+    }
+    cpuFallback.erase(result.coord);
+    stats.uploaded++;
+  }
+  ready.erase(ready.begin(), ready.begin() + done);
+}
+
+void ChunkMeshScheduler::Dispatch(const glm::vec3 &cameraPosition, const FrustumPlanes &frustum) {
+  world.TakeDirtyChunks(dirty);
+  if (!dirty.empty()) {
+    for (const ChunkCoord &coord : dirty) {
+      if (world.Version(coord) != 0) {
+        pending.push_back(coord);
+        continue;
+      }
+      // Unloaded: its mesh and any work on it go
+      DropMesh(coord);
+      cpuFallback.erase(coord);
+      auto it = inFlight.find(coord);
+      if (it != inFlight.end()) {
+        it->second->cancelled = true;
+        inFlight.erase(it);
+        stats.cancelled++;
+      }
+    }
+    dirty.clear();
+    std::sort(pending.begin(), pending.end(), ChunkCoordLess);
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+  }
+
+  if (pending.empty()) { return; }
+
+  if (options.gpuMeshing && driver.SupportsGpuVoxelMeshing()) {
+    // Only chunks that overflowed a batch get jobs
+    std::vector<ChunkCoord> batched;
+    std::vector<ChunkCoord> fallback;
+    for (const ChunkCoord &coord : pending) {
+      (cpuFallback.count(coord) ? fallback : batched).push_back(coord);
+    }
+    DispatchGpu(TakeMostUrgent(batched, options.gpuChunksPerUpdate, cameraPosition, frustum));
+    uint32_t running = runningJobs.load();
+    if (running < options.maxJobsInFlight) {
+      StartJobs(TakeMostUrgent(fallback, options.maxJobsInFlight - running, cameraPosition, frustum));
+    }
+    pending.swap(batched);
+    pending.insert(pending.end(), fallback.begin(), fallback.end());
+    return;
+  }
+
+  uint32_t running = runningJobs.load();
+  if (running >= options.maxJobsInFlight) { return; }
+  StartJobs(TakeMostUrgent(pending, options.maxJobsInFlight - running, cameraPosition, frustum));
+}
+
+// Removes the count most urgent chunks from coords, most urgent first
+std::vector<ChunkCoord> ChunkMeshScheduler::TakeMostUrgent(std::vector<ChunkCoord> &coords, size_t count,
+                                                           const glm::vec3     &cameraPosition,
+                                                           const FrustumPlanes &frustum) const {
+  count = std::min(count, coords.size());
+  std::vector<std::pair<float, ChunkCoord>> order;
+  order.reserve(coords.size());
+  for (const ChunkCoord &coord : coords) {
+    order.emplace_back(Priority(coord, cameraPosition, frustum), coord);
+  }
+  std::partial_sort(order.begin(), order.begin() + count, order.end(),
+                    [](const std::pair<float, ChunkCoord> &a, const std::pair<float, ChunkCoord> &b) {
+                      return a.first < b.first;
+                    });
+  std::vector<ChunkCoord> taken;
+  taken.reserve(count);
+  coords.clear();
+  for (size_t i = 0; i < order.size(); i++) {
+    (i < count ? taken : coords).push_back(order[i].second);
+  }
+  return taken;
+}
+
+void ChunkMeshScheduler::StartJobs(const std::vector<ChunkCoord> &coords) {
+  for (const ChunkCoord &coord : coords) {
+    uint64_t version = world.Version(coord);
+    if (version == 0) { continue; }
+
+    // A job for an older version is wasted work now, as is its result
+    auto existing = inFlight.find(coord);
+    if (existing != inFlight.end() && existing->second->version == version) { continue; }
+    CancelWork(coord);
+
+    auto job     = std::make_shared<MeshJob>();
+    job->coord   = coord;
+    job->version = version;
+    world.Snapshot(coord, job->snapshot);
+    inFlight[coord] = job;
+    runningJobs.fetch_add(1);
+    jobs.Run(
+        [this, job]() {
+          RunJob(*job);
+          runningJobs.fetch_sub(1);
+        },
+        counter);
+  }
+}
+
+// Meshes the chunks as one GPU batch. Their meshes replace the old ones
+// now: the batch runs before any frame that draws them.
+void ChunkMeshScheduler::DispatchGpu(const std::vector<ChunkCoord> &coords) {
+  // The batch refers to the snapshots' chunks until it is submitted
+  std::vector<VoxelSnapshot> snapshots(coords.size());
+  std::vector<ChunkCoord>    batched;
+  gpuBatch.Clear();
+  for (size_t i = 0; i < coords.size(); i++) {
+    const ChunkCoord &coord = coords[i];
+    if (world.Version(coord) == 0) { continue; }
+    CancelWork(coord);
+    world.Snapshot(coord, snapshots[i]);
+    VoxelNeighborhood neighborhood = snapshots[i].Neighborhood();
+    // All air, nothing to draw
+    if (neighborhood.Center()->IsUniform() && neighborhood.Center()->Palette()[0] == VOXEL_AIR) {
+      DropMesh(coord);
+      stats.uploaded++;
+      continue;
+    }
+    gpuBatch.Add(neighborhood);
+    batched.push_back(coord);
+  }
+  if (batched.empty()) { return; }
+
+  uint32_t maxQuads = static_cast<uint32_t>(
+    std::min<uint64_t>(uint64_t(batched.size()) * options.gpuQuadsPerChunk, INT32_MAX / 4));
+  gpuMeshes.clear();
+  driver.MeshVoxelChunksOnGpu(gpuBatch.Input(options.ambientOcclusion, maxQuads), gpuMeshes);
+  for (size_t i = 0; i < batched.size(); i++) {
+    DropMesh(batched[i]);
+    meshes[batched[i]]                = gpuMeshes[i];
+    gpuMeshCoords[gpuMeshes[i].get()] = batched[i];
+  }
+  gpuMeshes.clear();
+  gpuBatch.Clear();
+  stats.meshedOnGpu += batched.size();
+  stats.uploaded += batched.size();
+}
+
+// Chunks that didn't fit their batch are meshed again, on the CPU
+void ChunkMeshScheduler::CollectGpuOverflows() {
+  if (gpuMeshCoords.empty()) { return; }
+  gpuMeshes.clear();
+  driver.CollectGpuVoxelMeshOverflows(gpuMeshes);
+  for (const std::shared_ptr<Mesh> &mesh : gpuMeshes) {
+    auto it = gpuMeshCoords.find(mesh.get());
+    if (it == gpuMeshCoords.end()) { continue; }
+    stats.gpuOverflows++;
+    cpuFallback.insert(it->second);
+    dirty.push_back(it->second);
+  }
+  gpuMeshes.clear();
+}
+
+// Runs on a worker
+void ChunkMeshScheduler::RunJob(MeshJob &job) {
+  if (job.cancelled) { return; }
+  thread_local BinaryGreedyMesher     mesher;
+  thread_local std::vector<VoxelQuad> quads;
+  quads.clear();
+  mesher.Mesh(job.snapshot.Neighborhood(), quads, options.ambientOcclusion);
+  // Let the world edit these chunks again without copying them
+  job.snapshot = VoxelSnapshot();
+
+  MeshResult result;
+  result.coord   = job.coord;
+  result.version = job.version;
+  result.vertices.reserve(quads.size() * 4);
+  for (const VoxelQuad &quad : quads) {
+    AppendQuadPackedVertices(quad, quad.type, result.vertices);
+  }
+  if (job.cancelled) { return; }
+
+  std::lock_guard<std::mutex> lock(finishedMutex);
+  finished.push_back(std::move(result));
+}
+
+// Cancels the chunk's job and drops its results waiting for upload
+void ChunkMeshScheduler::CancelWork(const ChunkCoord &coord) {
+  auto existing = inFlight.find(coord);
+  if (existing != inFlight.end()) {
+    existing->second->cancelled = true;
+    inFlight.erase(existing);
+    stats.cancelled++;
+  }
+  size_t before = ready.size();
+  ready.erase(std::remove_if(ready.begin(), ready.end(),
+                             [&coord](const MeshResult &result) { return result.coord == coord; }),
+              ready.end());
+  stats.cancelled += before - ready.size();
+}
+
+void ChunkMeshScheduler::DropMesh(const ChunkCoord &coord) {
+  auto it = meshes.find(coord);
+  if (it == meshes.end()) { return; }
+  gpuMeshCoords.erase(it->second.get());
+  driver.ReleaseMesh(it->second);
+  meshes.erase(it);
+}
+
+// Lower is more urgent: distance from the camera to the chunk's center,
+// pushed back when the chunk is outside the frustum
+float ChunkMeshScheduler::Priority(const ChunkCoord &coord, const glm::vec3 &cameraPosition,
+                                   const FrustumPlanes &frustum) const {
+  glm::vec3 boundsMin = ChunkOrigin(coord);
+  glm::vec3 boundsMax = boundsMin + glm::vec3(static_cast<float>(VoxelChunk::SIZE));
+  glm::vec3 offset    = (boundsMin + boundsMax) * 0.5f - cameraPosition;
+  float     distance  = std::sqrt(glm::dot(offset, offset));
+  if (!IsBoxInFrustum(frustum, boundsMin, boundsMax, glm::mat4(1.0f))) { distance += INVISIBLE_PENALTY; }
+  return distance;
+}
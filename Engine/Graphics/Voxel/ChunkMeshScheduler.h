@@ -0,0 +1,141 @@
+#ifndef CHUNKMESHSCHEDULER_H
+#define CHUNKMESHSCHEDULER_H
+
+#include "../Drivers/IGraphicsDriver.h"
+#include "../RenderQueue.h"
+#include "../../Jobs/JobSystem.h"
+#include "GpuVoxelBatch.h"
+#include "VoxelWorld.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct ChunkMeshSchedulerOptions {
+    uint32_t maxJobsInFlight     = 0;       // 0 = two per job system thread
+    size_t   uploadBytesPerFrame = 1 << 20; // Vertex data; at least one mesh a frame
+    bool     ambientOcclusion    = true;
+    // Mesh on the GPU when the driver can, see MeshVoxelChunksOnGpu. The
+    // GPU writes a quad per face rather than greedy ones, about 1.75x the
+    // vertices on the generated terrain.
+    bool     gpuMeshing          = false;
+    uint32_t gpuChunksPerUpdate  = 64;   // Chunks per batch, one batch an update
+    uint32_t gpuQuadsPerChunk    = 8192; // Vertex scratch per batched chunk while it runs
+};
+
+struct ChunkMeshStats {
+    uint64_t meshed    = 0; // Jobs that produced a mesh
+    uint64_t uploaded  = 0; // Meshes created (or dropped, when empty)
+    uint64_t cancelled = 0; // Jobs or results made stale by a later edit
+    uint32_t pending   = 0; // Dirty chunks waiting for a job
+    uint32_t inFlight  = 0; // Queued or running jobs
+    uint32_t ready     = 0; // Results waiting for upload budget
+    uint64_t meshedOnGpu  = 0; // Chunks sent to GPU batches
+    uint64_t gpuOverflows = 0; // GPU-meshed chunks redone on the CPU
+};
+
+// Keeps GPU meshes of a VoxelWorld's chunks up to date.
+//
+// Update() takes the chunks the world dirtied, and starts jobs for the most
+// urgent ones: chunks in the view frustum first, nearest first. A job
+// meshes a snapshot of the chunk and its neighbours with the binary greedy
+// mesher, so the world can keep changing meanwhile. Finished meshes go
+// through CreateVoxelMesh, nearest first, until the frame's upload budget
+// is spent. A chunk edited again while its job runs gets a new job; the old
+// one skips its work if it hasn't started, and its result is dropped
+// either way, so a stale mesh is never uploaded.
+//
+// With gpuMeshing on a driver that supports it, the most urgent dirty
+// chunks instead go to the GPU as one batch per Update(), and their meshes
+// replace the old ones right away. A chunk that didn't fit its batch's
+// vertex space draws nothing until it has been meshed again by a job; the
+// driver reports it a frame or two later, and from then on the chunk is
+// meshed on the CPU until that mesh is uploaded.
+//
+// Chunk meshes use packed chunk-local vertices, with voxel types as
+// texture layers (see BuildVoxelTypeTexture); AppendRenderPackets() places
+// them with their model matrix and PIPELINE_FEATURE_VOXEL. Call everything
+// from one thread. With a single-threaded job system the jobs run inside
+// Update().
+class ChunkMeshScheduler {
+  public:
+    ChunkMeshScheduler(VoxelWorld &world, IGraphicsDriver &driver, JobSystem &jobs,
+                       const ChunkMeshSchedulerOptions &options = ChunkMeshSchedulerOptions());
+    // Waits for running jobs and releases the meshes
+    ~ChunkMeshScheduler();
+
+    ChunkMeshScheduler(const ChunkMeshScheduler &)            = delete;
+    ChunkMeshScheduler &operator=(const ChunkMeshScheduler &) = delete;
+
+    void Update(const glm::vec3 &cameraPosition, const FrustumPlanes &frustum);
+    // No dirty chunk left to mesh or upload; GPU batches count as done once
+    // submitted, their overflows dirty chunks again later
+    bool IsIdle() const;
+
+    // One packet per chunk with a mesh
+    void AppendRenderPackets(const Texture *texture, std::vector<RenderPacket> &packets) const;
+    size_t MeshCount() const { return meshes.size(); }
+    const Mesh *GetMesh(const ChunkCoord &coord) const;
+
+    const ChunkMeshStats &Stats() const { return stats; }
+
+  private:
+    struct MeshJob {
+        ChunkCoord        coord;
+        uint64_t          version = 0;
+        VoxelSnapshot     snapshot;
+        std::atomic<bool> cancelled{false};
+    };
+
+    struct MeshResult {
+        ChunkCoord               coord;
+        uint64_t                 version = 0;
+        std::vector<VoxelVertex> vertices;
+        float                    priority = 0.0f;
+    };
+
+    VoxelWorld               &world;
+    IGraphicsDriver          &driver;
+    JobSystem                &jobs;
+    ChunkMeshSchedulerOptions options;
+    ChunkMeshStats            stats;
+
+    std::unordered_map<ChunkCoord, std::shared_ptr<Mesh>, ChunkCoordHash>    meshes;
+    std::unordered_map<ChunkCoord, std::shared_ptr<MeshJob>, ChunkCoordHash> inFlight;
+    std::vector<ChunkCoord>                                                  pending;
+    std::vector<ChunkCoord>                                                  dirty; // Scratch
+    std::vector<MeshResult>                                                  ready;
+
+    // GPU meshing: which chunk each GPU mesh draws, and the chunks that
+    // overflowed a batch and wait for a CPU mesh
+    std::unordered_map<const Mesh *, ChunkCoord>        gpuMeshCoords;
+    std::unordered_set<ChunkCoord, ChunkCoordHash>      cpuFallback;
+    GpuVoxelBatch                                       gpuBatch;     // Scratch
+    std::vector<std::shared_ptr<Mesh>>                  gpuMeshes;    // Scratch
+
+    // Filled by the jobs
+    std::mutex              finishedMutex;
+    std::vector<MeshResult> finished;
+    std::atomic<uint32_t>   runningJobs{0};
+    JobCounter              counter;
+
+    void  CollectFinished();
+    void  Upload(const glm::vec3 &cameraPosition, const FrustumPlanes &frustum);
+    void  Dispatch(const glm::vec3 &cameraPosition, const FrustumPlanes &frustum);
+    void  DispatchGpu(const std::vector<ChunkCoord> &coords);
+    void  CollectGpuOverflows();
+    void  StartJobs(const std::vector<ChunkCoord> &coords);
+    void  RunJob(MeshJob &job);
+    void  CancelWork(const ChunkCoord &coord);
+    void  DropMesh(const ChunkCoord &coord);
+    std::vector<ChunkCoord> TakeMostUrgent(std::vector<ChunkCoord> &coords, size_t count,
+                                           const glm::vec3 &cameraPosition, const FrustumPlanes &frustum) const;
+    float Priority(const ChunkCoord &coord, const glm::vec3 &cameraPosition,
+                   const FrustumPlanes &frustum) const;
+};
+
+#endif // CHUNKMESHSCHEDULER_H
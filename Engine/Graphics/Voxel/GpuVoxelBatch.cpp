@@ -0,0 +1,59 @@
+#include "GpuVoxelBatch.h"
+
+#include <cstring>
+#include <stdexcept>
+
+void GpuVoxelBatch::Clear() {
+  slots.clear();
+  records.clear();
+  recordOffsets.clear();
+}
+
+void GpuVoxelBatch::Add(const VoxelNeighborhood &neighborhood) {
+  if (!neighborhood.Center()) {
+    throw std::runtime_error("Voxel neighborhood has no center chunk!");
+  }
+  for (int slot = 0; slot < 27; slot++) {
+    slots.push_back(Record(neighborhood.chunks[slot]));
+  }
+}
+
+GpuVoxelMeshInput GpuVoxelBatch::Input(bool ambientOcclusion, uint32_t maxQuads) const {
+  GpuVoxelMeshInput input;
+  input.slots            = slots.data();
+  input.records          = records.data();
+  input.recordWords      = records.size();
+  input.chunkCount       = ChunkCount();
+  input.maxQuads         = maxQuads;
+  input.ambientOcclusion = ambientOcclusion;
+  return input;
+}
+
+uint32_t GpuVoxelBatch::Record(const VoxelChunk *chunk) {
+  if (!chunk || (chunk->IsUniform() && chunk->Palette()[0] == VOXEL_AIR)) { return GPU_VOXEL_NO_CHUNK; }
+  auto it = recordOffsets.find(chunk);
+  if (it != recordOffsets.end()) { return it->second; }
+
+  uint32_t offset = static_cast<uint32_t>(records.size());
+  uint32_t bits   = chunk->BitsPerIndex();
+  // A uniform chunk only needs its type
+  const std::vector<VoxelType> &palette     = chunk->Palette();
+  uint32_t                      paletteSize = bits == 0 ? 1 : static_cast<uint32_t>(palette.size());
+  records.push_back(bits);
+  records.push_back(paletteSize);
+  for (uint32_t entry = 0; entry < paletteSize; entry++) {
+    // The shader writes types as layers, see VoxelVertex::Pack
+    if (palette[entry] >= VOXEL_VERTEX_MAX_LAYERS) {
+      throw std::runtime_error("Voxel type out of range for the texture layers!");
+    }
+    records.push_back(palette[entry]);
+  }
+  // Little-endian 64-bit words read the same as pairs of 32-bit ones
+  size_t words = static_cast<size_t>(VoxelChunk::VOLUME) * bits / 32;
+  if (words > 0) {
+    records.resize(records.size() + words);
+    memcpy(records.data() + records.size() - words, chunk->Words(), words * sizeof(uint32_t));
+  }
+  recordOffsets[chunk] = offset;
+  return offset;
+}
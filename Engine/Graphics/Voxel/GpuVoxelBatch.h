@@ -0,0 +1,45 @@
+#ifndef GPUVOXELBATCH_H
+#define GPUVOXELBATCH_H
+
+#include "../Drivers/IGraphicsDriver.h"
+#include "VoxelMesher.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// GpuVoxelMeshInput::slots entry for a neighbour that reads as air
+const uint32_t GPU_VOXEL_NO_CHUNK = 0xFFFFFFFFu;
+
+// Chunks packed for IGraphicsDriver::MeshVoxelChunksOnGpu.
+//
+// Chunks go up the way VoxelChunk stores them: a record per chunk holding
+// its bits per index, palette size, palette (a word per entry) and then
+// its packed indices, none when uniform. Each chunk to mesh gets 27 slots,
+// the record offsets of its neighbourhood in VoxelNeighborhood::Slot
+// order; missing and all-air chunks need no record. A chunk several
+// neighbourhoods share is stored once, so a batch of adjacent chunks costs
+// about a record per chunk. shaders/voxel_mesh.comp reads voxels straight
+// from this layout. Chunks are told apart by address, so keep them alive
+// until the batch is cleared.
+class GpuVoxelBatch {
+  public:
+    void Clear();
+    // The center chunk must be set
+    void Add(const VoxelNeighborhood &neighborhood);
+
+    uint32_t ChunkCount() const { return static_cast<uint32_t>(slots.size() / 27); }
+    size_t   Bytes() const { return (slots.size() + records.size()) * sizeof(uint32_t); }
+
+    // Valid until the batch changes
+    GpuVoxelMeshInput Input(bool ambientOcclusion, uint32_t maxQuads) const;
+
+  private:
+    std::vector<uint32_t>                            slots;
+    std::vector<uint32_t>                            records;
+    std::unordered_map<const VoxelChunk *, uint32_t> recordOffsets;
+
+    uint32_t Record(const VoxelChunk *chunk);
+};
+
+#endif // GPUVOXELBATCH_H
@@ -0,0 +1,224 @@
+#include "VoxelChunk.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Smallest supported index width for a palette of this size
+static uint32_t BitsForPaletteSize(size_t size) {
+  if (size <= 1) { return 0; }
+  uint32_t bits = 1;
+  while ((size_t(1) << bits) < size) {
+    bits *= 2;
+  }
+  return bits;
+}
+
+VoxelChunk::VoxelChunk(VoxelType fill, VoxelStoragePool &pool) : pool(&pool) {
+  Fill(fill);
+}
+
+VoxelChunk::~VoxelChunk() {
+  ReleaseWords();
+}
+
+VoxelChunk::VoxelChunk(const VoxelChunk &other)
+    : pool(other.pool), bitsPerIndex(other.bitsPerIndex), palette(other.palette),
+      counts(other.counts) {
+  if (other.words) {
+    words = pool->Allocate(bitsPerIndex);
+    std::memcpy(words, other.words, VoxelStoragePool::WordCount(bitsPerIndex) * sizeof(uint64_t));
+  }
+}
+
+VoxelChunk &VoxelChunk::operator=(const VoxelChunk &other) {
+  if (this != &other) {
+    VoxelChunk copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+VoxelChunk::VoxelChunk(VoxelChunk &&other) noexcept
+    : pool(other.pool), bitsPerIndex(other.bitsPerIndex), words(other.words),
+      palette(std::move(other.palette)), counts(std::move(other.counts)) {
+  other.words        = nullptr;
+  other.bitsPerIndex = 0;
+  other.palette.assign(1, VOXEL_AIR);
+  other.counts.assign(1, VOLUME);
+}
+
+VoxelChunk &VoxelChunk::operator=(VoxelChunk &&other) noexcept {
+  if (this != &other) {
+    ReleaseWords();
+    pool               = other.pool;
+    bitsPerIndex       = other.bitsPerIndex;
+    words              = other.words;
+    palette            = std::move(other.palette);
+    counts             = std::move(other.counts);
+    other.words        = nullptr;
+    other.bitsPerIndex = 0;
+    other.palette.assign(1, VOXEL_AIR);
+    other.counts.assign(1, VOLUME);
+  }
+  return *this;
+}
+
+void VoxelChunk::Set(uint32_t x, uint32_t y, uint32_t z, VoxelType type) {
+  uint32_t index = Index(x, y, z);
+  if (bitsPerIndex == 0) {
+    if (palette[0] == type) { return; }
+    // Leaving the uniform fast path: every voxel points at entry 0
+    Widen(1);
+  } else if (palette[PaletteIndexAt(index)] == type) {
+    return;
+  }
+
+  uint32_t oldEntry = PaletteIndexAt(index);
+  uint32_t newEntry = FindOrAddEntry(type);
+  SetPaletteIndexAt(index, newEntry);
+  counts[oldEntry]--;
+  counts[newEntry]++;
+
+  // Back to a single type
+  if (counts[newEntry] == VOLUME) { Fill(type); }
+}
+
+void VoxelChunk::Fill(VoxelType type) {
+  ReleaseWords();
+  bitsPerIndex = 0;
+  palette.assign(1, type);
+  counts.assign(1, VOLUME);
+}
+
+void VoxelChunk::Read(VoxelType *voxels) const {
+  if (bitsPerIndex == 0) {
+    std::fill(voxels, voxels + VOLUME, palette[0]);
+    return;
+  }
+
+  // Whole words at a time; widths divide 64, so no index spans two words
+  uint32_t perWord = 64 / bitsPerIndex;
+  uint64_t mask    = (uint64_t(1) << bitsPerIndex) - 1;
+  size_t   count   = VoxelStoragePool::WordCount(bitsPerIndex);
+  for (size_t w = 0; w < count; w++) {
+    uint64_t word = words[w];
+    for (uint32_t i = 0; i < perWord; i++) {
+      *voxels++ = palette[word & mask];
+      word >>= bitsPerIndex;
+    }
+  }
+}
+
+void VoxelChunk::Write(const VoxelType *voxels) {
+  // Palette entry per type, valid where the stamp matches this call
+  thread_local std::vector<uint32_t> stamps(65536, 0);
+  thread_local std::vector<uint16_t> entries(65536);
+  thread_local uint32_t              stamp = 0;
+  if (++stamp == 0) {
+    std::fill(stamps.begin(), stamps.end(), 0);
+    stamp = 1;
+  }
+
+  std::vector<VoxelType> newPalette;
+  std::vector<uint32_t>  newCounts;
+  for (uint32_t i = 0; i < VOLUME; i++) {
+    VoxelType type = voxels[i];
+    if (stamps[type] != stamp) {
+      stamps[type]  = stamp;
+      entries[type] = static_cast<uint16_t>(newPalette.size());
+      newPalette.push_back(type);
+      newCounts.push_back(0);
+    }
+    newCounts[entries[type]]++;
+  }
+
+  if (newPalette.size() == 1) {
+    Fill(newPalette[0]);
+    return;
+  }
+
+  uint32_t newBits = BitsForPaletteSize(newPalette.size());
+  if (newBits != bitsPerIndex) {
+    ReleaseWords();
+    words        = pool->Allocate(newBits);
+    bitsPerIndex = newBits;
+  }
+  palette.swap(newPalette);
+  counts.swap(newCounts);
+
+  uint32_t perWord = 64 / bitsPerIndex;
+  size_t   count   = VoxelStoragePool::WordCount(bitsPerIndex);
+  for (size_t w = 0; w < count; w++) {
+    uint64_t word = 0;
+    for (uint32_t i = perWord; i-- > 0;) {
+      word = (word << bitsPerIndex) | entries[voxels[w * perWord + i]];
+    }
+    words[w] = word;
+  }
+}
+
+void VoxelChunk::Compact() {
+  if (bitsPerIndex == 0) { return; }
+  size_t used = std::count_if(counts.begin(), counts.end(), [](uint32_t count) { return count > 0; });
+  if (used == palette.size() && BitsForPaletteSize(used) == bitsPerIndex) { return; }
+
+  std::vector<VoxelType> voxels(VOLUME);
+  Read(voxels.data());
+  Write(voxels.data());
+}
+
+size_t VoxelChunk::MemoryUsage() const {
+  size_t bytes = sizeof(VoxelChunk) + palette.capacity() * sizeof(VoxelType) +
+                 counts.capacity() * sizeof(uint32_t);
+  if (words) { bytes += VoxelStoragePool::WordCount(bitsPerIndex) * sizeof(uint64_t); }
+  return bytes;
+}
+
+// Reuses an entry no voxel points at any more before growing the palette
+uint32_t VoxelChunk::FindOrAddEntry(VoxelType type) {
+  uint32_t unused = UINT32_MAX;
+  for (uint32_t i = 0; i < palette.size(); i++) {
+    if (counts[i] == 0) {
+      if (unused == UINT32_MAX) { unused = i; }
+    } else if (palette[i] == type) {
+      return i;
+    }
+  }
+  if (unused != UINT32_MAX) {
+    palette[unused] = type;
+    return unused;
+  }
+
+  if (palette.size() == (size_t(1) << bitsPerIndex)) { Widen(bitsPerIndex * 2); }
+  palette.push_back(type);
+  counts.push_back(0);
+  return static_cast<uint32_t>(palette.size() - 1);
+}
+
+// Repacks the indices at a larger width; from uniform, every index is 0
+void VoxelChunk::Widen(uint32_t newBitsPerIndex) {
+  uint64_t *newWords = pool->Allocate(newBitsPerIndex);
+  if (bitsPerIndex == 0) {
+    std::memset(newWords, 0, VoxelStoragePool::WordCount(newBitsPerIndex) * sizeof(uint64_t));
+  } else {
+    uint32_t perWord = 64 / newBitsPerIndex;
+    size_t   count   = VoxelStoragePool::WordCount(newBitsPerIndex);
+    for (size_t w = 0; w < count; w++) {
+      uint64_t word = 0;
+      for (uint32_t i = 0; i < perWord; i++) {
+        word |= uint64_t(PaletteIndexAt(static_cast<uint32_t>(w * perWord + i))) << (i * newBitsPerIndex);
+      }
+      newWords[w] = word;
+    }
+  }
+  ReleaseWords();
+  words        = newWords;
+  bitsPerIndex = newBitsPerIndex;
+}
+
+void VoxelChunk::ReleaseWords() {
+  if (words) {
+    pool->Free(words, bitsPerIndex);
+    words = nullptr;
+  }
+}
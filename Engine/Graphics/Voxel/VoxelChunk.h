@@ -0,0 +1,83 @@
+#ifndef VOXELCHUNK_H
+#define VOXELCHUNK_H
+
+#include "VoxelStoragePool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using VoxelType = uint16_t;
+
+const VoxelType VOXEL_AIR = 0;
+
+// A 32x32x32 block of voxels stored as indices into a per-chunk palette.
+//
+// A chunk holding a single type (all air, solid rock) stores no indices
+// at all. Otherwise indices are bit-packed at the smallest width of 1, 2,
+// 4, 8 or 16 bits that fits the palette, so a chunk with a handful of
+// types takes 4-16 KB instead of 64 KB. The width grows as new types are
+// written; palette entries whose voxels were all overwritten are reused,
+// and Compact() shrinks the width again. Index storage comes from a
+// VoxelStoragePool.
+class VoxelChunk {
+  public:
+    static constexpr uint32_t SIZE   = 32;
+    static constexpr uint32_t VOLUME = SIZE * SIZE * SIZE;
+
+    explicit VoxelChunk(VoxelType fill = VOXEL_AIR, VoxelStoragePool &pool = VoxelStoragePool::Shared());
+    ~VoxelChunk();
+    VoxelChunk(const VoxelChunk &other);
+    VoxelChunk &operator=(const VoxelChunk &other);
+    VoxelChunk(VoxelChunk &&other) noexcept;
+    VoxelChunk &operator=(VoxelChunk &&other) noexcept;
+
+    // x varies fastest, then y, then z
+    static uint32_t Index(uint32_t x, uint32_t y, uint32_t z) { return x + SIZE * (y + SIZE * z); }
+
+    VoxelType Get(uint32_t x, uint32_t y, uint32_t z) const {
+      if (bitsPerIndex == 0) { return palette[0]; }
+      return palette[PaletteIndexAt(Index(x, y, z))];
+    }
+    void Set(uint32_t x, uint32_t y, uint32_t z, VoxelType type);
+    void Fill(VoxelType type);
+
+    // Bulk access to all VOLUME voxels in Index() order
+    void Read(VoxelType *voxels) const;
+    void Write(const VoxelType *voxels);
+
+    // Drops unused palette entries and narrows the indices to fit
+    void Compact();
+
+    bool     IsUniform() const { return bitsPerIndex == 0; }
+    uint32_t BitsPerIndex() const { return bitsPerIndex; }
+    // May contain entries no voxel uses any more
+    const std::vector<VoxelType> &Palette() const { return palette; }
+    // Packed indices, Index() order from the lowest bits up; nullptr when
+    // uniform
+    const uint64_t *Words() const { return words; }
+    // Bytes held by this chunk, including its palette and indices
+    size_t MemoryUsage() const;
+
+  private:
+    VoxelStoragePool     *pool;
+    uint32_t              bitsPerIndex = 0;
+    uint64_t             *words        = nullptr;
+    std::vector<VoxelType> palette;
+    std::vector<uint32_t>  counts; // Voxels using each palette entry
+
+    uint32_t PaletteIndexAt(uint32_t index) const {
+      uint32_t bit = index * bitsPerIndex;
+      return static_cast<uint32_t>(words[bit >> 6] >> (bit & 63)) & ((1u << bitsPerIndex) - 1);
+    }
+    void SetPaletteIndexAt(uint32_t index, uint32_t paletteIndex) {
+      uint32_t bit  = index * bitsPerIndex;
+      uint64_t mask = ((uint64_t(1) << bitsPerIndex) - 1) << (bit & 63);
+      words[bit >> 6] = (words[bit >> 6] & ~mask) | (uint64_t(paletteIndex) << (bit & 63));
+    }
+
+    uint32_t FindOrAddEntry(VoxelType type);
+    void     Widen(uint32_t newBitsPerIndex);
+    void     ReleaseWords();
+};
+
+#endif // VOXELCHUNK_H
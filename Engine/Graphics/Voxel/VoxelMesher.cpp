@@ -0,0 +1,384 @@
+#include "VoxelMesher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+// In-plane axes per face axis, matching VoxelQuad's width and height
+static const uint32_t PLANE_AXES[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+// Light per ambient occlusion level, as in shaders/voxel.vert
+static const float OCCLUSION_LIGHT[4] = {0.45f, 0.65f, 0.85f, 1.0f};
+
+static uint32_t LowestBit(uint64_t bits) {
+  return static_cast<uint32_t>(__builtin_ctzll(bits));
+}
+
+// Index into the padded grid; coordinates are chunk-local plus one
+static uint32_t PaddedIndex(uint32_t x, uint32_t y, uint32_t z) {
+  const uint32_t padded = VoxelChunk::SIZE + 2;
+  return x + padded * (y + padded * z);
+}
+
+// Chunk coordinates of a face cell of a direction along this axis
+static void FaceCellToVoxel(uint32_t axis, uint32_t depth, uint32_t u, uint32_t v, uint32_t &x,
+                            uint32_t &y, uint32_t &z) {
+  switch (axis) {
+    case 0: x = depth, y = u, z = v; break;
+    case 1: x = u, y = depth, z = v; break;
+    default: x = u, y = v, z = depth; break;
+  }
+}
+
+// Ambient occlusion at a face's corners in VoxelQuad::ao order. front is
+// the cell the face looks into; each corner darkens with the solid cells
+// beside and diagonal to it in that layer, fully when both sides are.
+template <typename Solid>
+static uint8_t CornerOcclusion(uint32_t axis, const int front[3], Solid solid) {
+  static const int corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  const uint32_t   uAxis         = PLANE_AXES[axis][0];
+  const uint32_t   vAxis         = PLANE_AXES[axis][1];
+  uint32_t         ao            = 0;
+  for (uint32_t corner = 0; corner < 4; corner++) {
+    int uSide[3]    = {front[0], front[1], front[2]};
+    int vSide[3]    = {front[0], front[1], front[2]};
+    int diagonal[3] = {front[0], front[1], front[2]};
+    uSide[uAxis]    += corners[corner][0];
+    vSide[vAxis]    += corners[corner][1];
+    diagonal[uAxis] += corners[corner][0];
+    diagonal[vAxis] += corners[corner][1];
+    bool     a    = solid(uSide[0], uSide[1], uSide[2]);
+    bool     b    = solid(vSide[0], vSide[1], vSide[2]);
+    bool     c    = solid(diagonal[0], diagonal[1], diagonal[2]);
+    uint32_t open = (a && b) ? 0 : 3 - (uint32_t(a) + uint32_t(b) + uint32_t(c));
+    ao |= open << (2 * corner);
+  }
+  return static_cast<uint8_t>(ao);
+}
+
+VoxelType VoxelNeighborhood::Get(int x, int y, int z) const {
+  const int size = static_cast<int>(VoxelChunk::SIZE);
+  int       dx   = x < 0 ? -1 : (x >= size ? 1 : 0);
+  int       dy   = y < 0 ? -1 : (y >= size ? 1 : 0);
+  int       dz   = z < 0 ? -1 : (z >= size ? 1 : 0);
+  const VoxelChunk *chunk = At(dx, dy, dz);
+  if (!chunk) { return VOXEL_AIR; }
+  return chunk->Get(x - dx * size, y - dy * size, z - dz * size);
+}
+
+void BinaryGreedyMesher::Mesh(const VoxelNeighborhood &neighborhood, std::vector<VoxelQuad> &quads,
+                              bool ambientOcclusion) {
+  const VoxelChunk *center = neighborhood.Center();
+  if (!center) {
+    throw std::runtime_error("Voxel neighborhood has no center chunk!");
+  }
+  // An all-air chunk has no faces of its own
+  if (center->IsUniform() && center->Palette()[0] == VOXEL_AIR) { return; }
+  ReadPadded(neighborhood);
+  BuildColumns();
+  for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++) {
+    MeshDirection(face, ambientOcclusion, quads);
+  }
+}
+
+void BinaryGreedyMesher::ReadPadded(const VoxelNeighborhood &neighborhood) {
+  const uint32_t size = VoxelChunk::SIZE;
+  voxels.resize(PADDED * PADDED * PADDED);
+  decoded.resize(VoxelChunk::VOLUME);
+  neighborhood.Center()->Read(decoded.data());
+  for (uint32_t z = 0; z < size; z++) {
+    for (uint32_t y = 0; y < size; y++) {
+      std::memcpy(&voxels[PaddedIndex(1, y + 1, z + 1)], &decoded[VoxelChunk::Index(0, y, z)],
+                  size * sizeof(VoxelType));
+    }
+  }
+
+  // The border: one layer, row or single voxel from each neighbour. Along
+  // each axis offset -1 reads the neighbour's last voxel into padded 0, 0
+  // the whole chunk into 1..32 and 1 its first voxel into 33.
+  for (int dz = -1; dz <= 1; dz++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+        if (dx == 0 && dy == 0 && dz == 0) { continue; }
+        const VoxelChunk *chunk = neighborhood.At(dx, dy, dz);
+        uint32_t          begin[3], end[3];
+        int               shift[3]; // Padded to chunk coordinates
+        const int         offsets[3] = {dx, dy, dz};
+        for (int axis = 0; axis < 3; axis++) {
+          begin[axis]  = offsets[axis] < 0 ? 0 : (offsets[axis] == 0 ? 1 : PADDED - 1);
+          end[axis]    = offsets[axis] == 0 ? PADDED - 1 : begin[axis] + 1;
+          shift[axis]  = -1 - offsets[axis] * static_cast<int>(size);
+        }
+        bool      uniform = !chunk || chunk->IsUniform();
+        VoxelType fill    = chunk ? chunk->Palette()[0] : VOXEL_AIR;
+        for (uint32_t z = begin[2]; z < end[2]; z++) {
+          for (uint32_t y = begin[1]; y < end[1]; y++) {
+            VoxelType *row = &voxels[PaddedIndex(0, y, z)];
+            for (uint32_t x = begin[0]; x < end[0]; x++) {
+              row[x] = uniform ? fill : chunk->Get(x + shift[0], y + shift[1], z + shift[2]);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void BinaryGreedyMesher::BuildColumns() {
+  std::memset(columns, 0, sizeof(columns));
+  for (uint32_t z = 0; z < PADDED; z++) {
+    for (uint32_t y = 0; y < PADDED; y++) {
+      const VoxelType *row = &voxels[PaddedIndex(0, y, z)];
+      // Masks rather than shifts by x, so these loops vectorize
+      uint64_t *yColumns = columns[1][z];
+      uint64_t *zColumns = columns[2][y];
+      uint64_t  yBit     = uint64_t(1) << y;
+      uint64_t  zBit     = uint64_t(1) << z;
+      for (uint32_t x = 0; x < PADDED; x++) {
+        uint64_t solid = uint64_t(0) - (row[x] != VOXEL_AIR);
+        yColumns[x] |= solid & yBit;
+        zColumns[x] |= solid & zBit;
+      }
+      uint64_t xBits = 0;
+      for (uint32_t x = 0; x < PADDED; x++) {
+        xBits |= uint64_t(row[x] != VOXEL_AIR) << x;
+      }
+      columns[0][z][y] = xBits;
+    }
+  }
+}
+
+void BinaryGreedyMesher::MeshDirection(uint8_t face, bool ambientOcclusion, std::vector<VoxelQuad> &quads) {
+  const uint32_t size     = VoxelChunk::SIZE;
+  const uint32_t axis     = face / 2;
+  const bool     positive = (face & 1) == 0;
+
+  // A face is visible where a solid bit is followed by air in the facing
+  // direction. Columns run over the padded grid, so the neighbour's border
+  // voxel decides the outermost faces; only the inner 32 bits are kept.
+  // Every column is indexed [v][u] in padded coordinates.
+  std::memset(faces, 0, sizeof(faces));
+  bool any = false;
+  for (uint32_t v = 0; v < size; v++) {
+    for (uint32_t u = 0; u < size; u++) {
+      uint64_t column  = columns[axis][v + 1][u + 1];
+      uint64_t visible = positive ? column & ~(column >> 1) : column & ~(column << 1);
+      visible          = (visible >> 1) & 0xFFFFFFFFull;
+      any |= visible != 0;
+      while (visible) {
+        faces[LowestBit(visible)][v] |= 1u << u;
+        visible &= visible - 1;
+      }
+    }
+  }
+  if (!any) { return; }
+
+  if (typeStamps.empty()) {
+    typeStamps.assign(65536, 0);
+    typeSlots.resize(65536);
+  }
+
+  for (uint32_t depth = 0; depth < size; depth++) {
+    // Split the slice into one bitmap per type, or per type and occlusion
+    if (++stamp == 0) {
+      std::fill(typeStamps.begin(), typeStamps.end(), 0);
+      stamp = 1;
+    }
+    sliceKeys.clear();
+    sliceRows.clear();
+    uint32_t lastKey  = UINT32_MAX;
+    size_t   lastSlot = 0;
+    for (uint32_t v = 0; v < size; v++) {
+      uint32_t row = faces[depth][v];
+      while (row) {
+        uint32_t u = LowestBit(row);
+        row &= row - 1;
+        uint32_t x, y, z;
+        FaceCellToVoxel(axis, depth, u, v, x, y, z);
+        VoxelType type = decoded[VoxelChunk::Index(x, y, z)];
+        size_t    slot;
+        if (!ambientOcclusion) {
+          if (typeStamps[type] != stamp) {
+            typeStamps[type] = stamp;
+            typeSlots[type]  = static_cast<uint16_t>(sliceKeys.size());
+            sliceKeys.push_back(type | uint32_t(VOXEL_QUAD_UNOCCLUDED) << 16);
+            sliceRows.resize(sliceRows.size() + size, 0);
+          }
+          slot = typeSlots[type];
+        } else {
+          // A slice has few keys, and neighbouring faces mostly share one
+          uint32_t key = type | uint32_t(FaceOcclusion(face, x, y, z)) << 16;
+          if (key != lastKey) {
+            lastKey  = key;
+            lastSlot = std::find(sliceKeys.begin(), sliceKeys.end(), key) - sliceKeys.begin();
+            if (lastSlot == sliceKeys.size()) {
+              sliceKeys.push_back(key);
+              sliceRows.resize(sliceRows.size() + size, 0);
+            }
+          }
+          slot = lastSlot;
+        }
+        sliceRows[slot * size + v] |= 1u << u;
+      }
+    }
+
+    // Greedy merge: take the first run of set bits in a row, then extend it
+    // over following rows while they contain the whole run. Occlusion that
+    // differs between corners would stretch over a merged quad, so those
+    // faces stay single.
+    for (size_t slot = 0; slot < sliceKeys.size(); slot++) {
+      uint32_t *rows      = &sliceRows[slot * size];
+      uint8_t   ao        = static_cast<uint8_t>(sliceKeys[slot] >> 16);
+      bool      mergeable = ao == (ao & 3u) * 0x55u;
+      for (uint32_t v = 0; v < size; v++) {
+        while (rows[v]) {
+          uint32_t u     = LowestBit(rows[v]);
+          uint32_t width = mergeable ? LowestBit(~(uint64_t(rows[v]) >> u)) : 1;
+          uint32_t mask  = static_cast<uint32_t>(((uint64_t(1) << width) - 1) << u);
+          rows[v] &= ~mask;
+          uint32_t height = 1;
+          while (mergeable && v + height < size && (rows[v + height] & mask) == mask) {
+            rows[v + height] &= ~mask;
+            height++;
+          }
+
+          VoxelQuad quad;
+          uint32_t  x, y, z;
+          FaceCellToVoxel(axis, depth, u, v, x, y, z);
+          quad.x      = static_cast<uint8_t>(x);
+          quad.y      = static_cast<uint8_t>(y);
+          quad.z      = static_cast<uint8_t>(z);
+          quad.width  = static_cast<uint8_t>(width);
+          quad.height = static_cast<uint8_t>(height);
+          quad.face   = face;
+          quad.ao     = ao;
+          quad.type   = static_cast<VoxelType>(sliceKeys[slot]);
+          quads.push_back(quad);
+        }
+      }
+    }
+  }
+}
+
+uint8_t BinaryGreedyMesher::FaceOcclusion(uint8_t face, uint32_t x, uint32_t y, uint32_t z) const {
+  // Padded coordinates of the cell in front of the face
+  int front[3] = {int(x) + 1, int(y) + 1, int(z) + 1};
+  front[face / 2] += (face & 1) == 0 ? 1 : -1;
+  return CornerOcclusion(face / 2, front, [this](int fx, int fy, int fz) {
+    return voxels[PaddedIndex(fx, fy, fz)] != VOXEL_AIR;
+  });
+}
+
+void MeshVoxelChunkNaive(const VoxelNeighborhood &neighborhood, std::vector<VoxelQuad> &quads,
+                         bool ambientOcclusion) {
+  const VoxelChunk *center = neighborhood.Center();
+  if (!center) {
+    throw std::runtime_error("Voxel neighborhood has no center chunk!");
+  }
+  static const int offsets[VOXEL_FACE_COUNT][3] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                                                   {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+  const int size = static_cast<int>(VoxelChunk::SIZE);
+  for (int z = 0; z < size; z++) {
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        VoxelType type = center->Get(x, y, z);
+        if (type == VOXEL_AIR) { continue; }
+        for (uint8_t face = 0; face < VOXEL_FACE_COUNT; face++) {
+          const int *offset = offsets[face];
+          int front[3] = {x + offset[0], y + offset[1], z + offset[2]};
+          if (neighborhood.Get(front[0], front[1], front[2]) != VOXEL_AIR) { continue; }
+          VoxelQuad quad;
+          quad.x      = static_cast<uint8_t>(x);
+          quad.y      = static_cast<uint8_t>(y);
+          quad.z      = static_cast<uint8_t>(z);
+          quad.width  = 1;
+          quad.height = 1;
+          quad.face   = face;
+          quad.ao     = VOXEL_QUAD_UNOCCLUDED;
+          quad.type   = type;
+          if (ambientOcclusion) {
+            quad.ao = CornerOcclusion(face / 2, front, [&neighborhood](int fx, int fy, int fz) {
+              return neighborhood.Get(fx, fy, fz) != VOXEL_AIR;
+            });
+          }
+          quads.push_back(quad);
+        }
+      }
+    }
+  }
+}
+
+// A quad's corners in VoxelQuad::ao order, in chunk-local voxel units
+static void QuadCorners(const VoxelQuad &quad, uint32_t corners[4][3]) {
+  const uint32_t axis    = quad.face / 2;
+  uint32_t       base[3] = {quad.x, quad.y, quad.z};
+  if ((quad.face & 1) == 0) { base[axis] += 1; }
+  for (uint32_t corner = 0; corner < 4; corner++) {
+    corners[corner][0] = base[0];
+    corners[corner][1] = base[1];
+    corners[corner][2] = base[2];
+  }
+  corners[1][PLANE_AXES[axis][0]] += quad.width;
+  corners[2][PLANE_AXES[axis][0]] += quad.width;
+  corners[2][PLANE_AXES[axis][1]] += quad.height;
+  corners[3][PLANE_AXES[axis][1]] += quad.height;
+}
+
+// The order to emit a quad's corners in for triangles (0, 1, 2) and
+// (2, 3, 0): counter-clockwise seen from outside, with the shared diagonal
+// between the corners whose occlusion differs least, so a dark corner
+// stays in its own triangle instead of smearing along the diagonal
+static void QuadCornerOrder(const VoxelQuad &quad, uint32_t order[4]) {
+  // u x v points along +X and +Z but along -Y, so the winding flips there
+  // and on the negative faces
+  const uint32_t axis        = quad.face / 2;
+  const bool     positive    = (quad.face & 1) == 0;
+  const bool     alongNormal = positive == (axis != 1);
+  uint32_t       corners[4]  = {0, 1, 2, 3};
+  if (!alongNormal) { std::swap(corners[1], corners[3]); }
+
+  int ao[4];
+  for (uint32_t corner = 0; corner < 4; corner++) {
+    ao[corner] = (quad.ao >> (2 * corner)) & 3;
+  }
+  bool flip = std::abs(ao[0] - ao[2]) > std::abs(ao[1] - ao[3]);
+  for (uint32_t i = 0; i < 4; i++) {
+    order[i] = corners[(i + (flip ? 1 : 0)) & 3];
+  }
+}
+
+void AppendQuadVertices(const VoxelQuad &quad, const glm::vec3 &origin, const glm::vec3 &color,
+                        std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  // Top faces brightest, bottoms darkest
+  static const float shades[VOXEL_FACE_COUNT] = {0.8f, 0.8f, 1.0f, 0.5f, 0.65f, 0.65f};
+
+  uint32_t corners[4][3];
+  uint32_t order[4];
+  QuadCorners(quad, corners);
+  QuadCornerOrder(quad, order);
+  const glm::vec2 texCoords[4] = {glm::vec2(0.0f, 0.0f), glm::vec2(float(quad.width), 0.0f),
+                                  glm::vec2(float(quad.width), float(quad.height)),
+                                  glm::vec2(0.0f, float(quad.height))};
+  glm::vec3 shaded = color * shades[quad.face];
+
+  uint32_t first = static_cast<uint32_t>(vertices.size());
+  for (uint32_t corner : order) {
+    const uint32_t *position = corners[corner];
+    float           light    = OCCLUSION_LIGHT[(quad.ao >> (2 * corner)) & 3];
+    vertices.push_back({origin + glm::vec3(float(position[0]), float(position[1]), float(position[2])),
+                        shaded * light, texCoords[corner]});
+  }
+  indices.insert(indices.end(), {first, first + 1, first + 2, first + 2, first + 3, first});
+}
+
+void AppendQuadPackedVertices(const VoxelQuad &quad, uint32_t layer, std::vector<VoxelVertex> &vertices) {
+  uint32_t corners[4][3];
+  uint32_t order[4];
+  QuadCorners(quad, corners);
+  QuadCornerOrder(quad, order);
+  for (uint32_t corner : order) {
+    const uint32_t *position = corners[corner];
+    vertices.push_back(VoxelVertex::Pack(position[0], position[1], position[2], quad.face,
+                                         (quad.ao >> (2 * corner)) & 3, layer));
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef VOXELMESHER_H
+#define VOXELMESHER_H
+
+#include "../Drivers/Vulkan/Vertex.h"
+#include "VoxelChunk.h"
+#include <cstdint>
+#include <vector>
+
+// Quad face directions, in the order the mesher emits them
+const uint8_t VOXEL_FACE_POS_X = 0;
+const uint8_t VOXEL_FACE_NEG_X = 1;
+const uint8_t VOXEL_FACE_POS_Y = 2;
+const uint8_t VOXEL_FACE_NEG_Y = 3;
+const uint8_t VOXEL_FACE_POS_Z = 4;
+const uint8_t VOXEL_FACE_NEG_Z = 5;
+const uint8_t VOXEL_FACE_COUNT = 6;
+
+// A chunk and the 26 chunks around it. Missing neighbours (nullptr) read
+// as air, so chunks at the edge of the loaded world get closed borders.
+struct VoxelNeighborhood {
+    const VoxelChunk *chunks[27] = {};
+
+    // Offsets are -1, 0 or 1 along each axis
+    static int Slot(int dx, int dy, int dz) { return (dx + 1) + 3 * ((dy + 1) + 3 * (dz + 1)); }
+
+    const VoxelChunk *&At(int dx, int dy, int dz) { return chunks[Slot(dx, dy, dz)]; }
+    const VoxelChunk  *At(int dx, int dy, int dz) const { return chunks[Slot(dx, dy, dz)]; }
+    const VoxelChunk  *Center() const { return chunks[Slot(0, 0, 0)]; }
+
+    // Voxel at chunk-local coordinates -1..SIZE, reaching into neighbours
+    VoxelType Get(int x, int y, int z) const;
+};
+
+// VoxelQuad::ao when ambient occlusion isn't computed, or nothing occludes
+const uint8_t VOXEL_QUAD_UNOCCLUDED = 0xFF;
+
+// A rectangle of same-type faces. (x, y, z) is the voxel at its minimum
+// corner; width runs along the face's first in-plane axis and height along
+// the second: y/z for X faces, x/z for Y faces and x/y for Z faces. ao holds
+// the ambient occlusion at corners (0, 0), (width, 0), (width, height) and
+// (0, height), 2 bits each from the lowest, 0 darkest to 3 open.
+struct VoxelQuad {
+    uint8_t   x, y, z;
+    uint8_t   width, height;
+    uint8_t   face;
+    uint8_t   ao;
+    VoxelType type;
+};
+
+// Builds greedy-merged quads for a chunk with bit operations.
+//
+// The chunk and a one voxel border from its neighbours are read into a
+// padded 34^3 grid, from which every row of voxels along each axis becomes
+// a 64-bit occupancy column. A visible face is a solid bit whose next bit
+// is clear, so one shift, AND and NOT per column finds all faces along it.
+// The faces are transposed into a 32x32 bitmap per slice and type, and
+// merged by scanning for runs of set bits and growing each run over the
+// rows below it. With ambient occlusion, faces only merge when their
+// occlusion matches and is the same at all four corners, so a merged quad
+// shades exactly like its faces would. Keeps its scratch buffers, so reuse
+// one per thread.
+class BinaryGreedyMesher {
+  public:
+    // Appends the chunk's quads; the center chunk must be set
+    void Mesh(const VoxelNeighborhood &neighborhood, std::vector<VoxelQuad> &quads,
+              bool ambientOcclusion = false);
+
+  private:
+    static constexpr uint32_t PADDED = VoxelChunk::SIZE + 2;
+
+    std::vector<VoxelType> voxels;  // PADDED^3, x fastest
+    std::vector<VoxelType> decoded; // Center chunk in Index() order
+    // Occupancy columns along x, y and z over the padded grid, indexed by
+    // the other two padded coordinates
+    uint64_t columns[3][PADDED][PADDED];
+    // Visible faces of one direction: [depth][v], bit u
+    uint32_t faces[VoxelChunk::SIZE][VoxelChunk::SIZE];
+
+    // Per slice split by type, and by occlusion when it is computed
+    std::vector<uint32_t> typeStamps;
+    std::vector<uint16_t> typeSlots;
+    uint32_t              stamp = 0;
+    std::vector<uint32_t> sliceKeys; // Type | ao << 16
+    std::vector<uint32_t> sliceRows; // 32 rows per slice key
+
+    void    ReadPadded(const VoxelNeighborhood &neighborhood);
+    void    BuildColumns();
+    void    MeshDirection(uint8_t face, bool ambientOcclusion, std::vector<VoxelQuad> &quads);
+    uint8_t FaceOcclusion(uint8_t face, uint32_t x, uint32_t y, uint32_t z) const;
+};
+
+// One 1x1 quad per visible face, the straightforward way; the reference
+// the greedy mesher is checked against
+void MeshVoxelChunkNaive(const VoxelNeighborhood &neighborhood, std::vector<VoxelQuad> &quads,
+                         bool ambientOcclusion = false);
+
+// Appends a quad as two triangles, counter-clockwise seen from outside.
+// Positions are origin plus voxel units; texture coordinates count voxels,
+// so a repeating texture tiles once per voxel. The color is shaded by face
+// direction and ambient occlusion.
+void AppendQuadVertices(const VoxelQuad &quad, const glm::vec3 &origin, const glm::vec3 &color,
+                        std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+// Appends a quad as four packed chunk-local vertices in the order
+// CreateVoxelMesh draws them, triangles (0, 1, 2) and (2, 3, 0)
+// counter-clockwise seen from outside. Throws if the layer is not below
+// VOXEL_VERTEX_MAX_LAYERS.
+void AppendQuadPackedVertices(const VoxelQuad &quad, uint32_t layer, std::vector<VoxelVertex> &vertices);
+
+#endif // VOXELMESHER_H
@@ -0,0 +1,69 @@
+#include "VoxelStoragePool.h"
+#include "VoxelChunk.h"
+
+#include <stdexcept>
+
+VoxelStoragePool &VoxelStoragePool::Shared() {
+  static VoxelStoragePool pool;
+  return pool;
+}
+
+uint64_t *VoxelStoragePool::Allocate(uint32_t bitsPerIndex) {
+  std::lock_guard<std::mutex> lock(mutex);
+  SizeClass                  &sizeClass = classes[ClassOf(bitsPerIndex)];
+  if (sizeClass.free.empty()) {
+    size_t words       = WordCount(bitsPerIndex);
+    size_t perSlab     = SLAB_BYTES / (words * sizeof(uint64_t));
+    auto   slab        = std::make_unique<uint64_t[]>(perSlab * words);
+    for (size_t i = perSlab; i-- > 0;) {
+      sizeClass.free.push_back(slab.get() + i * words);
+    }
+    sizeClass.slabs.push_back(std::move(slab));
+  }
+
+  uint64_t *words = sizeClass.free.back();
+  sizeClass.free.pop_back();
+  sizeClass.used++;
+  return words;
+}
+
+void VoxelStoragePool::Free(uint64_t *words, uint32_t bitsPerIndex) {
+  if (!words) { return; }
+  std::lock_guard<std::mutex> lock(mutex);
+  SizeClass                  &sizeClass = classes[ClassOf(bitsPerIndex)];
+  sizeClass.free.push_back(words);
+  sizeClass.used--;
+}
+
+size_t VoxelStoragePool::WordCount(uint32_t bitsPerIndex) {
+  return VoxelChunk::VOLUME * bitsPerIndex / 64;
+}
+
+size_t VoxelStoragePool::ReservedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t                      bytes = 0;
+  for (const SizeClass &sizeClass : classes) {
+    bytes += sizeClass.slabs.size() * SLAB_BYTES;
+  }
+  return bytes;
+}
+
+size_t VoxelStoragePool::UsedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t                      bytes = 0;
+  for (int i = 0; i < CLASS_COUNT; i++) {
+    bytes += classes[i].used * WordCount(1u << i) * sizeof(uint64_t);
+  }
+  return bytes;
+}
+
+int VoxelStoragePool::ClassOf(uint32_t bitsPerIndex) {
+  switch (bitsPerIndex) {
+    case 1: return 0;
+    case 2: return 1;
+    case 4: return 2;
+    case 8: return 3;
+    case 16: return 4;
+  }
+  throw std::runtime_error("Unsupported voxel index width!");
+}
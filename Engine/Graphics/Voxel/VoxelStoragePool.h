@@ -0,0 +1,49 @@
+#ifndef VOXELSTORAGEPOOL_H
+#define VOXELSTORAGEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Slab allocator for voxel chunk index storage. Each index width (1, 2, 4,
+// 8 or 16 bits for a whole chunk) is a size class; buffers are carved out
+// of 256 KB slabs and recycled through a free list per class, so chunks
+// streaming in and out don't go through the general purpose heap. Slabs
+// are only returned when the pool is destroyed. Thread-safe.
+class VoxelStoragePool {
+  public:
+    // Shared by chunks that aren't given a pool
+    static VoxelStoragePool &Shared();
+
+    VoxelStoragePool()                                    = default;
+    VoxelStoragePool(const VoxelStoragePool &)            = delete;
+    VoxelStoragePool &operator=(const VoxelStoragePool &) = delete;
+
+    // Storage for a chunk's indices at this width, contents undefined
+    uint64_t *Allocate(uint32_t bitsPerIndex);
+    void      Free(uint64_t *words, uint32_t bitsPerIndex);
+
+    static size_t WordCount(uint32_t bitsPerIndex);
+
+    size_t ReservedBytes() const; // Slabs
+    size_t UsedBytes() const;     // Buffers handed out
+
+  private:
+    static const size_t SLAB_BYTES  = 256 * 1024;
+    static const int    CLASS_COUNT = 5; // 1, 2, 4, 8 and 16 bits
+
+    struct SizeClass {
+        std::vector<std::unique_ptr<uint64_t[]>> slabs;
+        std::vector<uint64_t *>                  free;
+        size_t                                   used = 0;
+    };
+
+    mutable std::mutex mutex;
+    SizeClass          classes[CLASS_COUNT];
+
+    static int ClassOf(uint32_t bitsPerIndex);
+};
+
+#endif // VOXELSTORAGEPOOL_H
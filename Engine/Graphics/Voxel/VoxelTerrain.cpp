@@ -0,0 +1,61 @@
+#include "VoxelTerrain.h"
+
+#include <cmath>
+#include <vector>
+
+// Integer hash to a value in [0, 1)
+static float Hash(int32_t x, int32_t z, uint32_t seed) {
+  uint32_t h = static_cast<uint32_t>(x) * 374761393u + static_cast<uint32_t>(z) * 668265263u + seed * 2246822519u;
+  h          = (h ^ (h >> 13)) * 1274126177u;
+  return static_cast<float>((h ^ (h >> 16)) & 0xFFFF) / 65536.0f;
+}
+
+void GenerateVoxelTerrain(VoxelChunk &chunk, int32_t chunkX, int32_t chunkY, int32_t chunkZ,
+                          uint32_t seed) {
+  const int32_t          size = static_cast<int32_t>(VoxelChunk::SIZE);
+  std::vector<VoxelType> voxels(VoxelChunk::VOLUME);
+  for (int32_t z = 0; z < size; z++) {
+    for (int32_t x = 0; x < size; x++) {
+      int32_t worldX = chunkX * size + x;
+      int32_t worldZ = chunkZ * size + z;
+      float   height = 24.0f + 6.0f * std::sin(worldX * 0.15f) * std::cos(worldZ * 0.11f) +
+                     2.0f * Hash(worldX, worldZ, seed);
+      int32_t surface = static_cast<int32_t>(height);
+      for (int32_t y = 0; y < size; y++) {
+        int32_t   worldY = chunkY * size + y;
+        VoxelType type   = VOXEL_AIR;
+        if (worldY < surface - 3) {
+          type = VOXEL_STONE;
+        } else if (worldY < surface) {
+          type = VOXEL_DIRT;
+        } else if (worldY == surface) {
+          type = VOXEL_GRASS;
+        }
+        voxels[VoxelChunk::Index(x, y, z)] = type;
+      }
+    }
+  }
+  chunk.Write(voxels.data());
+}
+
+glm::vec3 VoxelTypeColor(VoxelType type) {
+  switch (type) {
+    case VOXEL_STONE: return glm::vec3(0.55f, 0.55f, 0.58f);
+    case VOXEL_DIRT: return glm::vec3(0.5f, 0.35f, 0.2f);
+    case VOXEL_GRASS: return glm::vec3(0.3f, 0.65f, 0.2f);
+  }
+  return glm::vec3(0.7f);
+}
+
+void BuildVoxelTypeTexture(std::vector<uint8_t> &pixels, uint32_t &width, uint32_t &height) {
+  width  = VOXEL_GRASS + 1;
+  height = 1;
+  pixels.resize(width * 4);
+  for (uint32_t type = 0; type < width; type++) {
+    glm::vec3 color      = VoxelTypeColor(static_cast<VoxelType>(type));
+    pixels[type * 4 + 0] = static_cast<uint8_t>(color.x * 255.0f + 0.5f);
+    pixels[type * 4 + 1] = static_cast<uint8_t>(color.y * 255.0f + 0.5f);
+    pixels[type * 4 + 2] = static_cast<uint8_t>(color.z * 255.0f + 0.5f);
+    pixels[type * 4 + 3] = 255;
+  }
+}
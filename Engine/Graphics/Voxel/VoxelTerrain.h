@@ -0,0 +1,26 @@
+#ifndef VOXELTERRAIN_H
+#define VOXELTERRAIN_H
+
+#include "VoxelChunk.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+const VoxelType VOXEL_STONE = 1;
+const VoxelType VOXEL_DIRT  = 2;
+const VoxelType VOXEL_GRASS = 3;
+
+// Fills a chunk with rolling heightfield terrain (stone, a few layers of
+// dirt, grass on top) around y = 24. Chunk coordinates are in chunks, so
+// neighbouring chunks line up; the seed jitters the surface.
+void GenerateVoxelTerrain(VoxelChunk &chunk, int32_t chunkX, int32_t chunkY, int32_t chunkZ,
+                          uint32_t seed = 0);
+
+// Vertex color for a voxel type; types other than the terrain's are gray
+glm::vec3 VoxelTypeColor(VoxelType type);
+
+// RGBA8 pixels for the voxel shaders' layer strip: one texel per type from
+// air to grass, each VoxelTypeColor, so width is the type count and height 1
+void BuildVoxelTypeTexture(std::vector<uint8_t> &pixels, uint32_t &width, uint32_t &height);
+
+#endif // VOXELTERRAIN_H
@@ -0,0 +1,123 @@
+#include "VoxelWorld.h"
+
+// Splits a world coordinate into chunk and chunk-local parts, rounding
+// towards negative infinity
+static int32_t SplitCoordinate(int32_t world, uint32_t &local) {
+  const int32_t size  = static_cast<int32_t>(VoxelChunk::SIZE);
+  int32_t       chunk = world >= 0 ? world / size : (world - size + 1) / size;
+  local               = static_cast<uint32_t>(world - chunk * size);
+  return chunk;
+}
+
+VoxelNeighborhood VoxelSnapshot::Neighborhood() const {
+  VoxelNeighborhood neighborhood;
+  for (int i = 0; i < 27; i++) {
+    neighborhood.chunks[i] = chunks[i].get();
+  }
+  return neighborhood;
+}
+
+void VoxelWorld::SetChunk(const ChunkCoord &coord, VoxelChunk chunk) {
+  chunks[coord].chunk = std::make_shared<VoxelChunk>(std::move(chunk));
+  MarkDirty(coord);
+  MarkNeighborsDirty(coord);
+}
+
+void VoxelWorld::RemoveChunk(const ChunkCoord &coord) {
+  if (chunks.erase(coord) == 0) { return; }
+  dirtyChunks.push_back(coord);
+  MarkNeighborsDirty(coord);
+}
+
+std::shared_ptr<const VoxelChunk> VoxelWorld::GetChunk(const ChunkCoord &coord) const {
+  auto it = chunks.find(coord);
+  return it != chunks.end() ? it->second.chunk : nullptr;
+}
+
+VoxelType VoxelWorld::GetVoxel(int32_t x, int32_t y, int32_t z) const {
+  uint32_t   lx, ly, lz;
+  ChunkCoord coord{SplitCoordinate(x, lx), SplitCoordinate(y, ly), SplitCoordinate(z, lz)};
+  auto       it = chunks.find(coord);
+  return it != chunks.end() ? it->second.chunk->Get(lx, ly, lz) : VOXEL_AIR;
+}
+
+void VoxelWorld::SetVoxel(int32_t x, int32_t y, int32_t z, VoxelType type) {
+  uint32_t   local[3];
+  ChunkCoord coord{SplitCoordinate(x, local[0]), SplitCoordinate(y, local[1]),
+                   SplitCoordinate(z, local[2])};
+  if (type == VOXEL_AIR && !chunks.count(coord)) { return; }
+  Entry &entry = chunks[coord];
+  if (!entry.chunk) { entry.chunk = std::make_shared<VoxelChunk>(); }
+
+  VoxelType old = entry.chunk->Get(local[0], local[1], local[2]);
+  if (old == type) { return; }
+  // Snapshots keep the old chunk
+  if (entry.chunk.use_count() > 1) { entry.chunk = std::make_shared<VoxelChunk>(*entry.chunk); }
+  entry.chunk->Set(local[0], local[1], local[2], type);
+  MarkDirty(coord);
+  if ((old == VOXEL_AIR) == (type == VOXEL_AIR)) { return; }
+
+  // Neighbours whose padded border holds this voxel: along each axis the
+  // one before for local 0, the one after for local 31
+  const uint32_t last = VoxelChunk::SIZE - 1;
+  int            low[3], high[3];
+  for (int axis = 0; axis < 3; axis++) {
+    low[axis]  = local[axis] == 0 ? -1 : 0;
+    high[axis] = local[axis] == last ? 1 : 0;
+  }
+  for (int dz = low[2]; dz <= high[2]; dz++) {
+    for (int dy = low[1]; dy <= high[1]; dy++) {
+      for (int dx = low[0]; dx <= high[0]; dx++) {
+        if (dx == 0 && dy == 0 && dz == 0) { continue; }
+        MarkDirty({coord.x + dx, coord.y + dy, coord.z + dz});
+      }
+    }
+  }
+}
+
+uint64_t VoxelWorld::Version(const ChunkCoord &coord) const {
+  auto it = chunks.find(coord);
+  return it != chunks.end() ? it->second.version : 0;
+}
+
+void VoxelWorld::Snapshot(const ChunkCoord &coord, VoxelSnapshot &snapshot) const {
+  for (int dz = -1; dz <= 1; dz++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+        snapshot.chunks[VoxelNeighborhood::Slot(dx, dy, dz)] =
+            GetChunk({coord.x + dx, coord.y + dy, coord.z + dz});
+      }
+    }
+  }
+}
+
+void VoxelWorld::TakeDirtyChunks(std::vector<ChunkCoord> &dirty) {
+  for (const ChunkCoord &coord : dirtyChunks) {
+    auto it = chunks.find(coord);
+    if (it != chunks.end()) { it->second.dirty = false; }
+  }
+  dirty.insert(dirty.end(), dirtyChunks.begin(), dirtyChunks.end());
+  dirtyChunks.clear();
+}
+
+// Unloaded chunks have no mesh to update
+void VoxelWorld::MarkDirty(const ChunkCoord &coord) {
+  auto it = chunks.find(coord);
+  if (it == chunks.end()) { return; }
+  it->second.version = nextVersion++;
+  if (!it->second.dirty) {
+    it->second.dirty = true;
+    dirtyChunks.push_back(coord);
+  }
+}
+
+void VoxelWorld::MarkNeighborsDirty(const ChunkCoord &coord) {
+  for (int dz = -1; dz <= 1; dz++) {
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+        if (dx == 0 && dy == 0 && dz == 0) { continue; }
+        MarkDirty({coord.x + dx, coord.y + dy, coord.z + dz});
+      }
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef VOXELWORLD_H
+#define VOXELWORLD_H
+
+#include "VoxelChunk.h"
+#include "VoxelMesher.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Position of a chunk in chunks; voxel (x, y, z) lives in chunk
+// (floor(x / 32), floor(y / 32), floor(z / 32))
+struct ChunkCoord {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t z = 0;
+
+    bool operator==(const ChunkCoord &other) const {
+      return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct ChunkCoordHash {
+    size_t operator()(const ChunkCoord &coord) const {
+      return (static_cast<size_t>(static_cast<uint32_t>(coord.x)) * 73856093u) ^
+             (static_cast<size_t>(static_cast<uint32_t>(coord.y)) * 19349663u) ^
+             (static_cast<size_t>(static_cast<uint32_t>(coord.z)) * 83492791u);
+    }
+};
+
+// A chunk and its 26 neighbours as they were when the snapshot was taken.
+// Holds references to the world's chunks, which are never modified once
+// shared, so it can be read on any thread while the world keeps changing.
+struct VoxelSnapshot {
+    std::shared_ptr<const VoxelChunk> chunks[27];
+
+    VoxelNeighborhood Neighborhood() const;
+};
+
+// The loaded chunks of a voxel world, plus which of them need new meshes.
+//
+// Chunks are copy-on-write: an edit to a chunk that a snapshot still
+// references copies it first. Every change bumps a version on each chunk
+// whose mesh can see it, i.e. whose padded 34^3 region (see
+// BinaryGreedyMesher) contains the edited voxel, and queues the chunk as
+// dirty. Changing a voxel's type without changing whether it is solid
+// only dirties its own chunk, since neighbours only see solidity.
+class VoxelWorld {
+  public:
+    // Replaces the chunk at coord, e.g. when streaming in; dirties it and
+    // its neighbours
+    void SetChunk(const ChunkCoord &coord, VoxelChunk chunk);
+    void RemoveChunk(const ChunkCoord &coord);
+    // nullptr when the chunk isn't loaded
+    std::shared_ptr<const VoxelChunk> GetChunk(const ChunkCoord &coord) const;
+    size_t                            ChunkCount() const { return chunks.size(); }
+
+    // World voxel coordinates. Unloaded chunks read as air; writing to one
+    // creates it.
+    VoxelType GetVoxel(int32_t x, int32_t y, int32_t z) const;
+    void      SetVoxel(int32_t x, int32_t y, int32_t z, VoxelType type);
+
+    // Changes whenever the chunk's mesh would; 0 when it isn't loaded
+    uint64_t Version(const ChunkCoord &coord) const;
+    void     Snapshot(const ChunkCoord &coord, VoxelSnapshot &snapshot) const;
+
+    // Moves out the chunks dirtied since the last call. Removed chunks are
+    // included so their meshes can be dropped.
+    void TakeDirtyChunks(std::vector<ChunkCoord> &dirty);
+
+  private:
+    struct Entry {
+        std::shared_ptr<VoxelChunk> chunk;
+        uint64_t                    version = 0;
+        bool                        dirty   = false;
+    };
+
+    std::unordered_map<ChunkCoord, Entry, ChunkCoordHash> chunks;
+    std::vector<ChunkCoord>                               dirtyChunks;
+    uint64_t                                              nextVersion = 1;
+
+    void MarkDirty(const ChunkCoord &coord);
+    void MarkNeighborsDirty(const ChunkCoord &coord);
+};
+
+#endif // VOXELWORLD_H
@@ -0,0 +1,283 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Threads that own one of a job system's deques
+struct WorkerIdentity {
+    const JobSystem *system = nullptr;
+    uint32_t         index  = 0;
+};
+static thread_local WorkerIdentity currentWorker;
+
+static const uint32_t NO_DEQUE = UINT32_MAX;
+// Rounds of looking for work before an idle worker goes to sleep
+static const uint32_t IDLE_SPINS = 64;
+
+static void PinCurrentThread(uint32_t core) {
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(core % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    std::cerr << "Warning: failed to pin job worker to core " << core << std::endl;
+  }
+#else
+  (void) core;
+#endif
+}
+
+JobSystem::JobSystem(const JobSystemOptions &options) {
+  uint32_t threadCount = options.threadCount;
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (uint32_t i = 0; i < threadCount; i++) {
+    deques.push_back(std::make_unique<WorkStealingDeque>());
+  }
+  currentWorker = WorkerIdentity{this, 0};
+  for (uint32_t i = 1; i < threadCount; i++) {
+    workers.emplace_back(&JobSystem::WorkerLoop, this, i, options.pinThreads);
+  }
+}
+
+// Everything queued should have been waited for; leftovers are dropped
+JobSystem::~JobSystem() {
+  stopping.store(true);
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (auto &deque : deques) {
+    while (Job *job = deque->Steal()) {
+      delete job;
+    }
+  }
+  for (Job *job : injection) {
+    delete job;
+  }
+  if (currentWorker.system == this) { currentWorker = WorkerIdentity(); }
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter &counter) {
+  Job *job      = new Job();
+  job->function = std::move(function);
+  job->counter  = &counter;
+  counter.pending.fetch_add(1);
+  Schedule(job);
+}
+
+void JobSystem::RunAfter(JobCounter &dependency, std::function<void()> function,
+                         JobCounter &counter) {
+  Job *job      = new Job();
+  job->function = std::move(function);
+  job->counter  = &counter;
+  counter.pending.fetch_add(1);
+
+  {
+    // Finish takes the same lock once the count hits zero, so the job is
+    // either parked here before that or scheduled right away
+    std::lock_guard<std::mutex> lock(dependency.mutex);
+    if (dependency.pending.load() != 0) {
+      dependency.continuations.push_back(job);
+      return;
+    }
+  }
+  Schedule(job);
+}
+
+// Runs queued jobs while there are any; once there has been nothing to
+// run for a while it sleeps like an idle worker until jobs are queued or
+// the counter's last job finishes
+void JobSystem::Wait(JobCounter &counter) {
+  uint32_t index      = CurrentIndex();
+  uint32_t idleRounds = 0;
+  while (!counter.IsDone()) {
+    if (Job *job = FindJob(index)) {
+      Execute(job);
+      idleRounds = 0;
+      continue;
+    }
+    if (++idleRounds < IDLE_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepingWorkers.fetch_add(1);
+    wake.wait(lock, [&]() { return queuedJobs.load() > 0 || counter.IsDone(); });
+    sleepingWorkers.fetch_sub(1);
+    idleRounds = 0;
+  }
+
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(counter.mutex);
+    std::swap(error, counter.error);
+  }
+  if (error) { std::rethrow_exception(error); }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minChunk, const ParallelForBody &body) {
+  if (count == 0) { return; }
+  // Enough pieces for every thread to steal a few, never below minChunk
+  uint32_t grain = std::max({1u, minChunk, count / (ThreadCount() * 8)});
+  if (count <= grain || ThreadCount() == 1) {
+    body(0, count);
+    return;
+  }
+
+  JobCounter counter;
+  counter.pending.fetch_add(1);
+  try {
+    RunRange(body, 0, count, grain, counter);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(counter.mutex);
+    if (!counter.error) { counter.error = std::current_exception(); }
+  }
+  Finish(counter);
+  Wait(counter);
+}
+
+// Splits off the upper half as a stealable job until the range is down
+// to the grain, then runs what is left
+void JobSystem::RunRange(const ParallelForBody &body, uint32_t begin, uint32_t end,
+                         uint32_t grain, JobCounter &counter) {
+  while (end - begin > grain) {
+    uint32_t middle = begin + (end - begin) / 2;
+    Job     *job    = new Job();
+    job->body       = &body;
+    job->begin      = middle;
+    job->end        = end;
+    job->grain      = grain;
+    job->counter    = &counter;
+    counter.pending.fetch_add(1);
+    Schedule(job);
+    end = middle;
+  }
+  body(begin, end);
+}
+
+uint32_t JobSystem::CurrentIndex() const {
+  return currentWorker.system == this ? currentWorker.index : NO_DEQUE;
+}
+
+void JobSystem::Schedule(Job *job) {
+  // Counted first so a thief that takes the job never sees the count wrap
+  queuedJobs.fetch_add(1);
+  uint32_t index = CurrentIndex();
+  if (index == NO_DEQUE || !deques[index]->Push(job)) {
+    std::lock_guard<std::mutex> lock(injectionMutex);
+    injection.push_back(job);
+  }
+
+  if (sleepingWorkers.load() > 0) {
+    // A worker that checked queuedJobs under the lock is either already
+    // waiting or will see the new count
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+  }
+}
+
+Job *JobSystem::FindJob(uint32_t index) {
+  Job *job = nullptr;
+  if (index != NO_DEQUE) { job = deques[index]->Pop(); }
+
+  if (!job) {
+    std::lock_guard<std::mutex> lock(injectionMutex);
+    if (!injection.empty()) {
+      job = injection.front();
+      injection.pop_front();
+    }
+  }
+
+  if (!job) {
+    // Start at a different victim per thread so thieves spread out
+    uint32_t count = ThreadCount();
+    uint32_t start = index == NO_DEQUE ? 0 : index + 1;
+    for (uint32_t i = 0; i < count && !job; i++) {
+      uint32_t victim = (start + i) % count;
+      if (victim != index) { job = deques[victim]->Steal(); }
+    }
+  }
+
+  if (job) { queuedJobs.fetch_sub(1); }
+  return job;
+}
+
+void JobSystem::Execute(Job *job) {
+  JobCounter &counter = *job->counter;
+  try {
+    if (job->body) {
+      RunRange(*job->body, job->begin, job->end, job->grain, counter);
+    } else {
+      job->function();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(counter.mutex);
+    if (!counter.error) { counter.error = std::current_exception(); }
+  }
+  delete job;
+  Finish(counter);
+}
+
+void JobSystem::Finish(JobCounter &counter) {
+  counter.finishing.fetch_add(1);
+  bool drained = counter.pending.fetch_sub(1) == 1;
+  if (drained) {
+    std::vector<Job *> continuations;
+    {
+      std::lock_guard<std::mutex> lock(counter.mutex);
+      continuations.swap(counter.continuations);
+    }
+    for (Job *job : continuations) {
+      Schedule(job);
+    }
+  }
+  counter.finishing.fetch_sub(1);
+
+  // The counter may be gone by now, wake any thread sleeping in Wait so
+  // it checks again
+  if (drained && sleepingWorkers.load() > 0) {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+  }
+}
+
+void JobSystem::WorkerLoop(uint32_t index, bool pin) {
+  currentWorker = WorkerIdentity{this, index};
+  if (pin) { PinCurrentThread(index); }
+
+  uint32_t idleRounds = 0;
+  while (!stopping.load()) {
+    if (Job *job = FindJob(index)) {
+      Execute(job);
+      idleRounds = 0;
+      continue;
+    }
+    if (++idleRounds < IDLE_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepingWorkers.fetch_add(1);
+    wake.wait(lock, [this]() { return queuedJobs.load() > 0 || stopping.load(); });
+    sleepingWorkers.fetch_sub(1);
+    idleRounds = 0;
+  }
+}
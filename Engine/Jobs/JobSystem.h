@@ -0,0 +1,110 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "WorkStealingDeque.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+// Body of a ParallelFor, called with half-open index ranges
+using ParallelForBody = std::function<void(uint32_t begin, uint32_t end)>;
+
+struct Job {
+    std::function<void()> function;        // Run/RunAfter jobs
+    const ParallelForBody *body    = nullptr; // ParallelFor range jobs
+    uint32_t               begin   = 0;
+    uint32_t               end     = 0;
+    uint32_t               grain   = 0;
+    JobCounter            *counter = nullptr;
+};
+
+// Tracks a group of jobs. JobSystem::Wait helps run jobs until they have
+// all finished, and jobs queued with RunAfter start once it reaches zero.
+// The first exception thrown by one of the jobs is rethrown by Wait.
+class JobCounter {
+  public:
+    bool IsDone() const {
+      return pending.load() == 0 && finishing.load() == 0;
+    }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> pending{0};
+    // Jobs past their decrement that may still touch the counter, so a
+    // waiter doesn't destroy it under them
+    std::atomic<uint32_t> finishing{0};
+    std::mutex            mutex;
+    std::vector<Job *>    continuations;
+    std::exception_ptr    error;
+};
+
+struct JobSystemOptions {
+    uint32_t threadCount = 0;     // Including the creating thread, 0 = one per core
+    bool     pinThreads  = false; // Pin worker i to core i (Linux only)
+};
+
+// Work-stealing job system: one worker thread per core besides the thread
+// that creates it, which takes part whenever it waits. Each of them owns a
+// Chase-Lev deque, runs its own jobs newest first and steals the oldest
+// ones from the others when it runs dry; idle workers sleep until jobs are
+// queued. Other threads (e.g. the render thread) queue through a shared
+// injection list and can wait and help like everyone else.
+class JobSystem {
+  public:
+    explicit JobSystem(const JobSystemOptions &options = JobSystemOptions());
+    ~JobSystem();
+
+    JobSystem(const JobSystem &)            = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    uint32_t ThreadCount() const { return static_cast<uint32_t>(deques.size()); }
+
+    void Run(std::function<void()> function, JobCounter &counter);
+    // Queues the job once every job counted by dependency has finished
+    void RunAfter(JobCounter &dependency, std::function<void()> function, JobCounter &counter);
+    // Runs other jobs until the counter's jobs are done, sleeping while
+    // there are none to run
+    void Wait(JobCounter &counter);
+
+    // Calls body over [0, count) in parallel and returns when it is done.
+    // Ranges are split in half on demand down to minChunk, so idle threads
+    // steal large pieces and a busy machine leaves most of the range with
+    // the caller.
+    void ParallelFor(uint32_t count, uint32_t minChunk, const ParallelForBody &body);
+
+  private:
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques; // [0] belongs to the creating thread
+    std::vector<std::thread>                        workers;
+
+    // Jobs queued from threads that don't own a deque, and overflow
+    std::mutex       injectionMutex;
+    std::deque<Job *> injection;
+
+    // Jobs sitting in a queue, lets idle workers sleep
+    std::atomic<uint32_t>   queuedJobs{0};
+    std::atomic<uint32_t>   sleepingWorkers{0};
+    std::atomic<bool>       stopping{false};
+    std::mutex              sleepMutex;
+    std::condition_variable wake;
+
+    void     WorkerLoop(uint32_t index, bool pin);
+    uint32_t CurrentIndex() const;
+    void     Schedule(Job *job);
+    Job     *FindJob(uint32_t index);
+    void     Execute(Job *job);
+    void     Finish(JobCounter &counter);
+    void     RunRange(const ParallelForBody &body, uint32_t begin, uint32_t end,
+                      uint32_t grain, JobCounter &counter);
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,66 @@
+#include "WorkStealingDeque.h"
+
+#include <stdexcept>
+
+WorkStealingDeque::WorkStealingDeque(uint32_t capacity)
+    : mask(capacity - 1), buffer(new std::atomic<Job *>[capacity]) {
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::runtime_error("WorkStealingDeque capacity must be a power of two!");
+  }
+  for (uint32_t i = 0; i < capacity; i++) {
+    buffer[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+bool WorkStealingDeque::Push(Job *job) {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t > static_cast<int64_t>(mask)) { return false; }
+
+  buffer[b & mask].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+Job *WorkStealingDeque::Pop() {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // Already empty
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  Job *job = buffer[b & mask].load(std::memory_order_relaxed);
+  if (t == b) {
+    // Last job, race the thieves for it
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+Job *WorkStealingDeque::Steal() {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) { return nullptr; }
+
+  Job *job = buffer[t & mask].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return job;
+}
+
+bool WorkStealingDeque::Empty() const {
+  return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+}
@@ -0,0 +1,36 @@
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+struct Job;
+
+// Chase-Lev work-stealing deque (with the C11 memory orders from Lê et
+// al.). The owning thread pushes and pops at the bottom, any thread can
+// steal from the top. Capacity is fixed; Push fails when it is full and
+// JobSystem queues the job on its shared injection list instead.
+class WorkStealingDeque {
+  public:
+    explicit WorkStealingDeque(uint32_t capacity = 4096);
+
+    // Owner thread only
+    bool Push(Job *job);
+    Job *Pop();
+
+    // Any thread; returns nullptr when empty or when another thief won
+    Job *Steal();
+
+    bool Empty() const;
+
+  private:
+    uint32_t                           mask;
+    std::unique_ptr<std::atomic<Job *>[]> buffer;
+    // On separate cache lines, thieves hammer top while the owner works
+    // the bottom
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+};
+
+#endif // WORKSTEALINGDEQUE_H
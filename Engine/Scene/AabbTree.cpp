@@ -0,0 +1,358 @@
+#include "AabbTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+static float HalfSurfaceArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+  glm::vec3 size = boundsMax - boundsMin;
+  return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// Half surface area of the union of two boxes
+static float UnionArea(const glm::vec3 &minA, const glm::vec3 &maxA, const glm::vec3 &minB,
+                       const glm::vec3 &maxB) {
+  return HalfSurfaceArea(glm::min(minA, minB), glm::max(maxA, maxB));
+}
+
+static bool Contains(const glm::vec3 &outerMin, const glm::vec3 &outerMax,
+                     const glm::vec3 &innerMin, const glm::vec3 &innerMax) {
+  return outerMin.x <= innerMin.x && outerMin.y <= innerMin.y && outerMin.z <= innerMin.z &&
+         innerMax.x <= outerMax.x && innerMax.y <= outerMax.y && innerMax.z <= outerMax.z;
+}
+
+// Slab test; the distance where the ray enters the box, or a negative
+// value when it misses it within maxDistance
+static float RayBoxDistance(const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+                            float maxDistance, const glm::vec3 &boundsMin,
+                            const glm::vec3 &boundsMax) {
+  float enter = 0.0f;
+  float exit  = maxDistance;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+    float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+    // NaN from 0 * inf (a ray in the slab's plane) keeps the old bounds
+    enter = std::max(enter, std::min(t0, t1));
+    exit  = std::min(exit, std::max(t0, t1));
+  }
+  return enter <= exit ? enter : -1.0f;
+}
+
+void WorldBounds(const glm::vec3 &localMin, const glm::vec3 &localMax, const glm::mat4 &modelMatrix,
+                 glm::vec3 &worldMin, glm::vec3 &worldMax) {
+  glm::vec3 localCenter  = (localMin + localMax) * 0.5f;
+  glm::vec3 localExtents = (localMax - localMin) * 0.5f;
+  glm::vec3 center       = glm::vec3(modelMatrix * glm::vec4(localCenter, 1.0f));
+  glm::vec3 extents(0.0f);
+  for (int axis = 0; axis < 3; axis++) {
+    extents += glm::abs(glm::vec3(modelMatrix[axis])) * localExtents[axis];
+  }
+  worldMin = center - extents;
+  worldMax = center + extents;
+}
+
+AabbTree::AabbTree(float margin) : margin(margin) {}
+
+AabbProxy AabbTree::Insert(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                           uint32_t userData) {
+  uint32_t leaf        = AllocateNode();
+  Node    &node        = nodes[leaf];
+  node.boundsMin       = boundsMin - glm::vec3(margin);
+  node.boundsMax       = boundsMax + glm::vec3(margin);
+  node.exactMin        = boundsMin;
+  node.exactMax        = boundsMax;
+  node.userData        = userData;
+  node.height          = 0;
+  InsertLeaf(leaf);
+  proxyCount++;
+  return leaf;
+}
+
+void AabbTree::Remove(AabbProxy proxy) {
+  RemoveLeaf(proxy);
+  FreeNode(proxy);
+  proxyCount--;
+}
+
+bool AabbTree::Move(AabbProxy proxy, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                    const glm::vec3 &displacement) {
+  Node &node    = nodes[proxy];
+  node.exactMin = boundsMin;
+  node.exactMax = boundsMax;
+  if (Contains(node.boundsMin, node.boundsMax, boundsMin, boundsMax)) { return false; }
+
+  RemoveLeaf(proxy);
+  // Stretch the fat box the way the object is heading, so steady motion
+  // reinserts it less often
+  glm::vec3 fatMin = boundsMin - glm::vec3(margin);
+  glm::vec3 fatMax = boundsMax + glm::vec3(margin);
+  glm::vec3 ahead  = displacement * 4.0f;
+  for (int axis = 0; axis < 3; axis++) {
+    if (ahead[axis] < 0.0f) {
+      fatMin[axis] += ahead[axis];
+    } else {
+      fatMax[axis] += ahead[axis];
+    }
+  }
+  nodes[proxy].boundsMin = fatMin;
+  nodes[proxy].boundsMax = fatMax;
+  InsertLeaf(proxy);
+  return true;
+}
+
+void AabbTree::Rebuild() {
+  std::vector<uint32_t> leaves;
+  leaves.reserve(proxyCount);
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i].height == UINT32_MAX) { continue; }
+    if (nodes[i].IsLeaf()) {
+      leaves.push_back(i);
+    } else {
+      FreeNode(i);
+    }
+  }
+  root = leaves.empty() ? NULL_NODE : BuildTopDown(leaves.data(), leaves.size());
+  if (root != NULL_NODE) { nodes[root].parent = NULL_NODE; }
+}
+
+bool AabbTree::Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                       RayHit &hit) const {
+  if (root == NULL_NODE) { return false; }
+  CheckStackDepth();
+  glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+  bool     found = false;
+  float    best  = maxDistance;
+  uint32_t stack[MAX_STACK];
+  uint32_t size = 0;
+  stack[size++] = root;
+  while (size > 0) {
+    const Node &node = nodes[stack[--size]];
+    if (node.IsLeaf()) {
+      float distance = RayBoxDistance(origin, inverseDirection, best, node.exactMin, node.exactMax);
+      if (distance >= 0.0f) {
+        found        = true;
+        best         = distance;
+        hit.userData = node.userData;
+        hit.distance = distance;
+      }
+      continue;
+    }
+
+    // Visit the nearer child first so it can shorten the ray for the other
+    const Node &child1 = nodes[node.child1];
+    const Node &child2 = nodes[node.child2];
+    float distance1 = RayBoxDistance(origin, inverseDirection, best, child1.boundsMin, child1.boundsMax);
+    float distance2 = RayBoxDistance(origin, inverseDirection, best, child2.boundsMin, child2.boundsMax);
+    if (distance1 >= 0.0f && distance2 >= 0.0f) {
+      bool firstIsNearer = distance1 <= distance2;
+      stack[size++]      = firstIsNearer ? node.child2 : node.child1;
+      stack[size++]      = firstIsNearer ? node.child1 : node.child2;
+    } else if (distance1 >= 0.0f) {
+      stack[size++] = node.child1;
+    } else if (distance2 >= 0.0f) {
+      stack[size++] = node.child2;
+    }
+  }
+  return found;
+}
+
+void AabbTree::CheckStackDepth() const {
+  if (nodes[root].height >= MAX_STACK) {
+    throw std::runtime_error("AABB tree is too deep for its query stack!");
+  }
+}
+
+uint32_t AabbTree::AllocateNode() {
+  if (freeList == NULL_NODE) {
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+  }
+  uint32_t node = freeList;
+  freeList      = nodes[node].parent;
+  nodes[node]   = Node();
+  return node;
+}
+
+void AabbTree::FreeNode(uint32_t node) {
+  nodes[node].parent = freeList;
+  nodes[node].height = UINT32_MAX;
+  freeList           = node;
+}
+
+// Walks down to the sibling where the leaf adds the least surface area,
+// counting the growth of every ancestor on the way, then pairs them under
+// a new parent and rebalances up to the root
+void AabbTree::InsertLeaf(uint32_t leaf) {
+  if (root == NULL_NODE) {
+    root               = leaf;
+    nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  glm::vec3 leafMin = nodes[leaf].boundsMin;
+  glm::vec3 leafMax = nodes[leaf].boundsMax;
+  uint32_t  index   = root;
+  while (!nodes[index].IsLeaf()) {
+    const Node &node         = nodes[index];
+    float       area         = HalfSurfaceArea(node.boundsMin, node.boundsMax);
+    float       combinedArea = UnionArea(node.boundsMin, node.boundsMax, leafMin, leafMax);
+
+    // Pairing with this node, or pushing the leaf further down, which
+    // grows this node by the same amount either way
+    float cost            = 2.0f * combinedArea;
+    float inheritanceCost = 2.0f * (combinedArea - area);
+
+    auto descendCost = [&](uint32_t childIndex) {
+      const Node &child = nodes[childIndex];
+      float       grown = UnionArea(child.boundsMin, child.boundsMax, leafMin, leafMax);
+      if (child.IsLeaf()) { return grown + inheritanceCost; }
+      return grown - HalfSurfaceArea(child.boundsMin, child.boundsMax) + inheritanceCost;
+    };
+    float cost1 = descendCost(node.child1);
+    float cost2 = descendCost(node.child2);
+
+    if (cost < cost1 && cost < cost2) { break; }
+    index = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  uint32_t sibling   = index;
+  uint32_t oldParent = nodes[sibling].parent;
+  uint32_t newParent = AllocateNode();
+  Node    &parent    = nodes[newParent];
+  parent.parent      = oldParent;
+  parent.boundsMin   = glm::min(leafMin, nodes[sibling].boundsMin);
+  parent.boundsMax   = glm::max(leafMax, nodes[sibling].boundsMax);
+  parent.height      = nodes[sibling].height + 1;
+  parent.child1      = sibling;
+  parent.child2      = leaf;
+  nodes[sibling].parent = newParent;
+  nodes[leaf].parent    = newParent;
+
+  if (oldParent == NULL_NODE) {
+    root = newParent;
+  } else if (nodes[oldParent].child1 == sibling) {
+    nodes[oldParent].child1 = newParent;
+  } else {
+    nodes[oldParent].child2 = newParent;
+  }
+
+  for (index = nodes[leaf].parent; index != NULL_NODE; index = nodes[index].parent) {
+    index = Balance(index);
+    Refit(index);
+  }
+}
+
+void AabbTree::RemoveLeaf(uint32_t leaf) {
+  if (leaf == root) {
+    root = NULL_NODE;
+    return;
+  }
+
+  uint32_t parent      = nodes[leaf].parent;
+  uint32_t grandParent = nodes[parent].parent;
+  uint32_t sibling     = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+  FreeNode(parent);
+
+  if (grandParent == NULL_NODE) {
+    root                  = sibling;
+    nodes[sibling].parent = NULL_NODE;
+    return;
+  }
+
+  if (nodes[grandParent].child1 == parent) {
+    nodes[grandParent].child1 = sibling;
+  } else {
+    nodes[grandParent].child2 = sibling;
+  }
+  nodes[sibling].parent = grandParent;
+
+  for (uint32_t index = grandParent; index != NULL_NODE; index = nodes[index].parent) {
+    index = Balance(index);
+    Refit(index);
+  }
+}
+
+// If one child is more than one level taller than the other, rotates it
+// up into the node's place. Returns the index now at the node's place.
+uint32_t AabbTree::Balance(uint32_t a) {
+  if (nodes[a].IsLeaf() || nodes[a].height < 2) { return a; }
+
+  uint32_t b       = nodes[a].child1;
+  uint32_t c       = nodes[a].child2;
+  int      balance = static_cast<int>(nodes[c].height) - static_cast<int>(nodes[b].height);
+  if (balance >= -1 && balance <= 1) { return a; }
+
+  // The taller child moves up, a takes its place and keeps its shorter
+  // grandchild, the taller grandchild stays with the risen child
+  uint32_t up = balance > 1 ? c : b;
+  uint32_t f  = nodes[up].child1;
+  uint32_t g  = nodes[up].child2;
+
+  nodes[up].child1 = a;
+  nodes[up].parent = nodes[a].parent;
+  nodes[a].parent  = up;
+  if (nodes[up].parent == NULL_NODE) {
+    root = up;
+  } else if (nodes[nodes[up].parent].child1 == a) {
+    nodes[nodes[up].parent].child1 = up;
+  } else {
+    nodes[nodes[up].parent].child2 = up;
+  }
+
+  uint32_t taller  = nodes[f].height > nodes[g].height ? f : g;
+  uint32_t shorter = taller == f ? g : f;
+  nodes[up].child2 = taller;
+  if (balance > 1) {
+    nodes[a].child2 = shorter;
+  } else {
+    nodes[a].child1 = shorter;
+  }
+  nodes[shorter].parent = a;
+
+  Refit(a);
+  Refit(up);
+  return up;
+}
+
+void AabbTree::Refit(uint32_t index) {
+  Node       &node   = nodes[index];
+  const Node &child1 = nodes[node.child1];
+  const Node &child2 = nodes[node.child2];
+  node.boundsMin     = glm::min(child1.boundsMin, child2.boundsMin);
+  node.boundsMax     = glm::max(child1.boundsMax, child2.boundsMax);
+  node.height        = 1 + std::max(child1.height, child2.height);
+}
+
+// Splits the leaves at the median of their centers along the axis where
+// the centers spread the most
+uint32_t AabbTree::BuildTopDown(uint32_t *leaves, size_t count) {
+  if (count == 1) { return leaves[0]; }
+
+  glm::vec3 centersMin(std::numeric_limits<float>::max());
+  glm::vec3 centersMax(std::numeric_limits<float>::lowest());
+  for (size_t i = 0; i < count; i++) {
+    glm::vec3 center = (nodes[leaves[i]].boundsMin + nodes[leaves[i]].boundsMax) * 0.5f;
+    centersMin       = glm::min(centersMin, center);
+    centersMax       = glm::max(centersMax, center);
+  }
+  glm::vec3 spread = centersMax - centersMin;
+  int       axis   = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+  size_t half = count / 2;
+  std::nth_element(leaves, leaves + half, leaves + count, [this, axis](uint32_t a, uint32_t b) {
+    return nodes[a].boundsMin[axis] + nodes[a].boundsMax[axis] <
+           nodes[b].boundsMin[axis] + nodes[b].boundsMax[axis];
+  });
+
+  uint32_t child1 = BuildTopDown(leaves, half);
+  uint32_t child2 = BuildTopDown(leaves + half, count - half);
+  uint32_t parent = AllocateNode();
+  nodes[parent].child1 = child1;
+  nodes[parent].child2 = child2;
+  nodes[child1].parent = parent;
+  nodes[child2].parent = parent;
+  Refit(parent);
+  return parent;
+}
@@ -0,0 +1,191 @@
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include "../Graphics/RenderQueue.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+using AabbProxy = uint32_t;
+
+const AabbProxy INVALID_PROXY = UINT32_MAX;
+
+struct RayHit {
+    uint32_t userData = 0;
+    float    distance = 0.0f; // Along the ray, in units of its direction's length
+};
+
+// World-space box around a local box transformed by a model matrix
+void WorldBounds(const glm::vec3 &localMin, const glm::vec3 &localMax, const glm::mat4 &modelMatrix,
+                 glm::vec3 &worldMin, glm::vec3 &worldMax);
+
+// Dynamic AABB tree over world-space boxes for culling and scene queries.
+//
+// Each proxy's box is stored fattened by a margin (and stretched along its
+// last displacement), so objects that move a little don't touch the tree
+// at all; ones leaving their fat box are removed and reinserted where they
+// add the least surface area, with AVL-style rotations keeping the tree
+// balanced. Leaves keep the exact box too, so query results are exact.
+// Rebuild() builds the whole tree again top-down when its quality has
+// drifted, e.g. after loading a level.
+//
+// Proxies carry a user value (e.g. an entity index or a packet index),
+// which is what the queries return.
+class AabbTree {
+  public:
+    explicit AabbTree(float margin = 0.1f);
+
+    AabbProxy Insert(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, uint32_t userData);
+    void      Remove(AabbProxy proxy);
+    // Returns true when the proxy left its fat box and was reinserted
+    bool Move(AabbProxy proxy, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+              const glm::vec3 &displacement = glm::vec3(0.0f));
+    void Rebuild();
+
+    uint32_t GetUserData(AabbProxy proxy) const { return nodes[proxy].userData; }
+    size_t   ProxyCount() const { return proxyCount; }
+    uint32_t Height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+    // Calls visit(userData) for every proxy whose box intersects the
+    // frustum. Subtrees entirely inside it are reported without further
+    // plane tests.
+    template <typename F> void QueryFrustum(const FrustumPlanes &planes, F &&visit) const;
+    void QueryFrustum(const FrustumPlanes &planes, std::vector<uint32_t> &results) const {
+      QueryFrustum(planes, [&results](uint32_t userData) { results.push_back(userData); });
+    }
+
+    // Calls visit(userData) for every proxy whose box overlaps the box
+    template <typename F>
+    void QueryBox(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, F &&visit) const;
+    void QueryBox(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                  std::vector<uint32_t> &results) const {
+      QueryBox(boundsMin, boundsMax, [&results](uint32_t userData) { results.push_back(userData); });
+    }
+
+    // Nearest box hit by the ray within maxDistance
+    bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                 RayHit &hit) const;
+
+  private:
+    static const uint32_t NULL_NODE = UINT32_MAX;
+    // The tree is kept balanced, so its height stays far below this and
+    // queries can traverse it on a fixed stack. A depth-first walk holds at
+    // most one pending sibling per level, height + 1 entries.
+    static const uint32_t MAX_STACK = 256;
+
+    struct Node {
+        glm::vec3 boundsMin; // Fat box for leaves
+        glm::vec3 boundsMax;
+        glm::vec3 exactMin; // Leaves only
+        glm::vec3 exactMax;
+        uint32_t  parent   = NULL_NODE; // Next free node while on the free list
+        uint32_t  child1   = NULL_NODE; // NULL_NODE for leaves
+        uint32_t  child2   = NULL_NODE;
+        uint32_t  height   = 0; // Leaves are 0, free nodes UINT32_MAX
+        uint32_t  userData = 0;
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    float             margin;
+    std::vector<Node> nodes;
+    uint32_t          root       = NULL_NODE;
+    uint32_t          freeList   = NULL_NODE;
+    size_t            proxyCount = 0;
+
+    uint32_t AllocateNode();
+    void     FreeNode(uint32_t node);
+    void     InsertLeaf(uint32_t leaf);
+    void     RemoveLeaf(uint32_t leaf);
+    uint32_t Balance(uint32_t node);
+    void     Refit(uint32_t node);
+    uint32_t BuildTopDown(uint32_t *leaves, size_t count);
+    // Throws if a query's fixed stack could overflow
+    void CheckStackDepth() const;
+};
+
+// Plane bits still to test ride along each stack entry; a box entirely in
+// front of a plane clears its bit for the whole subtree
+template <typename F> void AabbTree::QueryFrustum(const FrustumPlanes &planes, F &&visit) const {
+  if (root == NULL_NODE) { return; }
+  CheckStackDepth();
+  const uint32_t ALL_PLANES = (1u << 6) - 1;
+
+  uint32_t stack[MAX_STACK * 2]; // Node, plane mask pairs
+  uint32_t size = 0;
+  stack[size++] = root;
+  stack[size++] = ALL_PLANES;
+  while (size > 0) {
+    uint32_t    mask = stack[--size];
+    const Node &node = nodes[stack[--size]];
+
+    if (mask == 0) {
+      // Entirely inside, report every leaf below without testing
+      if (node.IsLeaf()) {
+        visit(node.userData);
+      } else {
+        stack[size++] = node.child1;
+        stack[size++] = 0;
+        stack[size++] = node.child2;
+        stack[size++] = 0;
+      }
+      continue;
+    }
+
+    const glm::vec3 &boundsMin = node.IsLeaf() ? node.exactMin : node.boundsMin;
+    const glm::vec3 &boundsMax = node.IsLeaf() ? node.exactMax : node.boundsMax;
+    glm::vec3        center    = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3        extents   = (boundsMax - boundsMin) * 0.5f;
+    bool             outside   = false;
+    for (uint32_t plane = 0; plane < 6; plane++) {
+      if (!(mask & (1u << plane))) { continue; }
+      glm::vec3 normal(planes[plane]);
+      float     distance = glm::dot(normal, center) + planes[plane].w;
+      float     radius   = glm::dot(glm::abs(normal), extents);
+      if (distance < -radius) {
+        outside = true;
+        break;
+      }
+      if (distance > radius) { mask &= ~(1u << plane); }
+    }
+    if (outside) { continue; }
+
+    if (node.IsLeaf()) {
+      visit(node.userData);
+    } else {
+      stack[size++] = node.child1;
+      stack[size++] = mask;
+      stack[size++] = node.child2;
+      stack[size++] = mask;
+    }
+  }
+}
+
+template <typename F>
+void AabbTree::QueryBox(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, F &&visit) const {
+  if (root == NULL_NODE) { return; }
+  CheckStackDepth();
+
+  uint32_t stack[MAX_STACK];
+  uint32_t size = 0;
+  stack[size++] = root;
+  while (size > 0) {
+    const Node &node = nodes[stack[--size]];
+
+    const glm::vec3 &nodeMin = node.IsLeaf() ? node.exactMin : node.boundsMin;
+    const glm::vec3 &nodeMax = node.IsLeaf() ? node.exactMax : node.boundsMax;
+    if (nodeMin.x > boundsMax.x || nodeMax.x < boundsMin.x || nodeMin.y > boundsMax.y ||
+        nodeMax.y < boundsMin.y || nodeMin.z > boundsMax.z || nodeMax.z < boundsMin.z) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      visit(node.userData);
+    } else {
+      stack[size++] = node.child1;
+      stack[size++] = node.child2;
+    }
+  }
+}
+
+#endif // AABBTREE_H
@@ -0,0 +1,499 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_HIERARCHY_AVX 1
+#include <immintrin.h>
+#endif
+
+const uint32_t NO_SLOT = UINT32_MAX;
+
+// The arrays Update composes from, indexed by slot
+struct TransformArrays {
+    const float    *positionX, *positionY, *positionZ;
+    const float    *rotationX, *rotationY, *rotationZ, *rotationW;
+    const float    *scaleX, *scaleY, *scaleZ;
+    const uint32_t *parentSlots;
+    glm::mat4      *worldMatrices;
+};
+
+// A local transform as its affine columns: x, y and z axes and translation
+struct AffineColumns {
+    float c0x, c0y, c0z;
+    float c1x, c1y, c1z;
+    float c2x, c2y, c2z;
+    float tx, ty, tz;
+};
+
+// world = parent * local, or local for roots. Parents come before their
+// children in slot order, so the parent's matrix is already up to date.
+static void ComposeWorldScalar(const TransformArrays &arrays, uint32_t slot,
+                               const AffineColumns &l) {
+  glm::mat4 &world  = arrays.worldMatrices[slot];
+  uint32_t   parent = arrays.parentSlots[slot];
+  if (parent == NO_SLOT) {
+    world = glm::mat4(glm::vec4(l.c0x, l.c0y, l.c0z, 0.0f), glm::vec4(l.c1x, l.c1y, l.c1z, 0.0f),
+                      glm::vec4(l.c2x, l.c2y, l.c2z, 0.0f), glm::vec4(l.tx, l.ty, l.tz, 1.0f));
+    return;
+  }
+
+  const glm::mat4 &p = arrays.worldMatrices[parent];
+  world[0]           = p[0] * l.c0x + p[1] * l.c0y + p[2] * l.c0z;
+  world[1]           = p[0] * l.c1x + p[1] * l.c1y + p[2] * l.c1z;
+  world[2]           = p[0] * l.c2x + p[1] * l.c2y + p[2] * l.c2z;
+  world[3]           = p[0] * l.tx + p[1] * l.ty + p[2] * l.tz + p[3];
+}
+
+// Rotation matrix of a unit quaternion, scaled per axis
+static AffineColumns LocalColumns(const TransformArrays &arrays, uint32_t slot) {
+  float x = arrays.rotationX[slot], y = arrays.rotationY[slot];
+  float z = arrays.rotationZ[slot], w = arrays.rotationW[slot];
+  float sx = arrays.scaleX[slot], sy = arrays.scaleY[slot], sz = arrays.scaleZ[slot];
+
+  AffineColumns l;
+  l.c0x = (1.0f - 2.0f * (y * y + z * z)) * sx;
+  l.c0y = 2.0f * (x * y + w * z) * sx;
+  l.c0z = 2.0f * (x * z - w * y) * sx;
+  l.c1x = 2.0f * (x * y - w * z) * sy;
+  l.c1y = (1.0f - 2.0f * (x * x + z * z)) * sy;
+  l.c1z = 2.0f * (y * z + w * x) * sy;
+  l.c2x = 2.0f * (x * z + w * y) * sz;
+  l.c2y = 2.0f * (y * z - w * x) * sz;
+  l.c2z = (1.0f - 2.0f * (x * x + y * y)) * sz;
+  l.tx  = arrays.positionX[slot];
+  l.ty  = arrays.positionY[slot];
+  l.tz  = arrays.positionZ[slot];
+  return l;
+}
+
+static void ComposeScalar(const TransformArrays &arrays, const uint32_t *slots, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    ComposeWorldScalar(arrays, slots[i], LocalColumns(arrays, slots[i]));
+  }
+}
+
+#ifdef TRANSFORM_HIERARCHY_AVX
+
+// Runs of consecutive slots, common when whole subtrees move, load directly
+__attribute__((target("avx"))) static __m256 Gather8(const float *values, const uint32_t *slots) {
+  if (slots[7] - slots[0] == 7) { return _mm256_loadu_ps(values + slots[0]); }
+  return _mm256_setr_ps(values[slots[0]], values[slots[1]], values[slots[2]], values[slots[3]],
+                        values[slots[4]], values[slots[5]], values[slots[6]], values[slots[7]]);
+}
+
+// The column in both halves
+__attribute__((target("avx"))) static __m256 Twice(const float *column) {
+  __m128 value = _mm_loadu_ps(column);
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(value), value, 1);
+}
+
+// a in the low half, b in the high half
+__attribute__((target("avx"))) static __m256 Pair(float a, float b) {
+  return _mm256_setr_ps(a, a, a, a, b, b, b, b);
+}
+
+// (1 - 2(a + b)) * s, 2(a + b) * s and 2(a - b) * s for the rotation terms
+__attribute__((target("avx"))) static __m256 Diagonal(__m256 a, __m256 b, __m256 s) {
+  return _mm256_mul_ps(
+    _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(a, b))),
+    s);
+}
+
+__attribute__((target("avx"))) static __m256 Sum(__m256 a, __m256 b, __m256 s) {
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(a, b)), s);
+}
+
+__attribute__((target("avx"))) static __m256 Difference(__m256 a, __m256 b, __m256 s) {
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_sub_ps(a, b)), s);
+}
+
+// Two columns at a time: each 256-bit register holds a column pair
+__attribute__((target("avx"))) static void ComposeWorldAvx(const TransformArrays &arrays,
+                                                           uint32_t slot, const float *l) {
+  float   *world  = &arrays.worldMatrices[slot][0][0];
+  uint32_t parent = arrays.parentSlots[slot];
+  if (parent == NO_SLOT) {
+    _mm256_storeu_ps(world, _mm256_setr_ps(l[0], l[1], l[2], 0.0f, l[3], l[4], l[5], 0.0f));
+    _mm256_storeu_ps(world + 8, _mm256_setr_ps(l[6], l[7], l[8], 0.0f, l[9], l[10], l[11], 1.0f));
+    return;
+  }
+
+  // glm matrices are not guaranteed to be 16-byte aligned
+  const float *p  = &arrays.worldMatrices[parent][0][0];
+  __m256       p0 = Twice(p);
+  __m256       p1 = Twice(p + 4);
+  __m256       p2 = Twice(p + 8);
+  __m256       p3 = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_loadu_ps(p + 12), 1);
+
+  __m256 w01 = _mm256_add_ps(
+    _mm256_add_ps(_mm256_mul_ps(p0, Pair(l[0], l[3])), _mm256_mul_ps(p1, Pair(l[1], l[4]))),
+    _mm256_mul_ps(p2, Pair(l[2], l[5])));
+  __m256 w23 = _mm256_add_ps(
+    _mm256_add_ps(_mm256_mul_ps(p0, Pair(l[6], l[9])), _mm256_mul_ps(p1, Pair(l[7], l[10]))),
+    _mm256_add_ps(_mm256_mul_ps(p2, Pair(l[8], l[11])), p3));
+  _mm256_storeu_ps(world, w01);
+  _mm256_storeu_ps(world + 8, w23);
+}
+
+// Builds the local columns of 8 nodes per instruction from the SoA
+// components, then composes them with their parents in slot order
+__attribute__((target("avx"))) static void ComposeAvx(const TransformArrays &arrays,
+                                                      const uint32_t *slots, size_t count) {
+  alignas(32) float columns[12][8];
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const uint32_t *batch = slots + i;
+    __m256          x     = Gather8(arrays.rotationX, batch);
+    __m256          y     = Gather8(arrays.rotationY, batch);
+    __m256          z     = Gather8(arrays.rotationZ, batch);
+    __m256          w     = Gather8(arrays.rotationW, batch);
+    __m256          sx    = Gather8(arrays.scaleX, batch);
+    __m256          sy    = Gather8(arrays.scaleY, batch);
+    __m256          sz    = Gather8(arrays.scaleZ, batch);
+
+    __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+    __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+    __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+    _mm256_store_ps(columns[0], Diagonal(yy, zz, sx));
+    _mm256_store_ps(columns[1], Sum(xy, wz, sx));
+    _mm256_store_ps(columns[2], Difference(xz, wy, sx));
+    _mm256_store_ps(columns[3], Difference(xy, wz, sy));
+    _mm256_store_ps(columns[4], Diagonal(xx, zz, sy));
+    _mm256_store_ps(columns[5], Sum(yz, wx, sy));
+    _mm256_store_ps(columns[6], Sum(xz, wy, sz));
+    _mm256_store_ps(columns[7], Difference(yz, wx, sz));
+    _mm256_store_ps(columns[8], Diagonal(xx, yy, sz));
+    _mm256_store_ps(columns[9], Gather8(arrays.positionX, batch));
+    _mm256_store_ps(columns[10], Gather8(arrays.positionY, batch));
+    _mm256_store_ps(columns[11], Gather8(arrays.positionZ, batch));
+
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      float local[12];
+      for (uint32_t c = 0; c < 12; c++) {
+        local[c] = columns[c][lane];
+      }
+      ComposeWorldAvx(arrays, batch[lane], local);
+    }
+  }
+
+  ComposeScalar(arrays, slots + i, count - i);
+}
+
+static bool CpuHasAvx() {
+  return __builtin_cpu_supports("avx");
+}
+
+#else
+
+static bool CpuHasAvx() {
+  return false;
+}
+
+#endif
+
+TransformHierarchy::TransformHierarchy(bool allowSimd) : useAvx(allowSimd && CpuHasAvx()) {}
+
+TransformHandle TransformHierarchy::Create(TransformHandle parent) {
+  if (parent != INVALID_TRANSFORM && !IsAlive(parent)) {
+    throw std::runtime_error("Parent transform is not alive!");
+  }
+
+  TransformHandle handle;
+  if (!freeHandles.empty()) {
+    handle = freeHandles.back();
+    freeHandles.pop_back();
+  } else {
+    handle = static_cast<TransformHandle>(nodes.size());
+    nodes.emplace_back();
+  }
+
+  // Appended for now, moved to its breadth-first place on the next Update
+  Node &node = nodes[handle];
+  node       = Node();
+  node.slot  = static_cast<uint32_t>(order.size());
+  node.alive = true;
+  order.push_back(handle);
+  parentSlots.push_back(NO_SLOT);
+  firstChildSlots.push_back(0);
+  childCounts.push_back(0);
+  positionX.push_back(0.0f);
+  positionY.push_back(0.0f);
+  positionZ.push_back(0.0f);
+  rotationX.push_back(0.0f);
+  rotationY.push_back(0.0f);
+  rotationZ.push_back(0.0f);
+  rotationW.push_back(1.0f);
+  scaleX.push_back(1.0f);
+  scaleY.push_back(1.0f);
+  scaleZ.push_back(1.0f);
+  worldMatrices.push_back(glm::mat4(1.0f));
+  dirty.push_back(0);
+
+  Link(handle, parent);
+  liveCount++;
+  orderDirty = true;
+  MarkDirty(handle);
+  return handle;
+}
+
+void TransformHierarchy::Destroy(TransformHandle handle) {
+  Slot(handle);
+  Unlink(handle);
+
+  std::vector<TransformHandle> subtree{handle};
+  while (!subtree.empty()) {
+    TransformHandle current = subtree.back();
+    subtree.pop_back();
+    for (TransformHandle child = nodes[current].firstChild; child != INVALID_TRANSFORM;
+         child                 = nodes[child].nextSibling) {
+      subtree.push_back(child);
+    }
+    nodes[current].alive = false;
+    freeHandles.push_back(current);
+    liveCount--;
+  }
+  // The slots stay behind until the order is rebuilt
+  orderDirty = true;
+}
+
+void TransformHierarchy::SetParent(TransformHandle handle, TransformHandle parent) {
+  Slot(handle);
+  if (parent != INVALID_TRANSFORM) {
+    Slot(parent);
+    for (TransformHandle ancestor = parent; ancestor != INVALID_TRANSFORM;
+         ancestor                 = nodes[ancestor].parent) {
+      if (ancestor == handle) {
+        throw std::runtime_error("Transform can't be parented to its own descendant!");
+      }
+    }
+  }
+  if (nodes[handle].parent == parent) { return; }
+
+  Unlink(handle);
+  Link(handle, parent);
+  orderDirty = true;
+  MarkDirty(handle);
+}
+
+bool TransformHierarchy::IsAlive(TransformHandle handle) const {
+  return handle < nodes.size() && nodes[handle].alive;
+}
+
+void TransformHierarchy::SetLocal(TransformHandle handle, const glm::vec3 &position,
+                                  const glm::quat &rotation, const glm::vec3 &scale) {
+  SetPosition(handle, position);
+  SetRotation(handle, rotation);
+  SetScale(handle, scale);
+}
+
+void TransformHierarchy::SetPosition(TransformHandle handle, const glm::vec3 &position) {
+  uint32_t slot   = Slot(handle);
+  positionX[slot] = position.x;
+  positionY[slot] = position.y;
+  positionZ[slot] = position.z;
+  MarkDirty(handle);
+}
+
+void TransformHierarchy::SetRotation(TransformHandle handle, const glm::quat &rotation) {
+  uint32_t slot   = Slot(handle);
+  rotationX[slot] = rotation.x;
+  rotationY[slot] = rotation.y;
+  rotationZ[slot] = rotation.z;
+  rotationW[slot] = rotation.w;
+  MarkDirty(handle);
+}
+
+void TransformHierarchy::SetScale(TransformHandle handle, const glm::vec3 &scale) {
+  uint32_t slot = Slot(handle);
+  scaleX[slot]  = scale.x;
+  scaleY[slot]  = scale.y;
+  scaleZ[slot]  = scale.z;
+  MarkDirty(handle);
+}
+
+glm::vec3 TransformHierarchy::GetPosition(TransformHandle handle) const {
+  uint32_t slot = Slot(handle);
+  return glm::vec3(positionX[slot], positionY[slot], positionZ[slot]);
+}
+
+glm::quat TransformHierarchy::GetRotation(TransformHandle handle) const {
+  uint32_t slot = Slot(handle);
+  return glm::quat(rotationW[slot], rotationX[slot], rotationY[slot], rotationZ[slot]);
+}
+
+glm::vec3 TransformHierarchy::GetScale(TransformHandle handle) const {
+  uint32_t slot = Slot(handle);
+  return glm::vec3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+}
+
+void TransformHierarchy::Update() {
+  if (orderDirty) {
+    RebuildOrder();
+    orderDirty = false;
+  }
+
+  changed.clear();
+  if (dirtyHandles.empty()) { return; }
+
+  updateSlots.clear();
+  if (dirtyHandles.size() < order.size() / 64) {
+    // Few flagged nodes: queue them, then their subtrees through the
+    // contiguous child ranges; 2 marks a queued slot
+    for (TransformHandle handle : dirtyHandles) {
+      if (!nodes[handle].alive) { continue; }
+      uint32_t slot = nodes[handle].slot;
+      if (dirty[slot] == 1) {
+        dirty[slot] = 2;
+        updateSlots.push_back(slot);
+      }
+    }
+    for (size_t i = 0; i < updateSlots.size(); i++) {
+      uint32_t first = firstChildSlots[updateSlots[i]];
+      uint32_t last  = first + childCounts[updateSlots[i]];
+      for (uint32_t child = first; child < last; child++) {
+        if (dirty[child] != 2) {
+          dirty[child] = 2;
+          updateSlots.push_back(child);
+        }
+      }
+    }
+    // Composition needs parents first, i.e. slot order
+    std::sort(updateSlots.begin(), updateSlots.end());
+  } else {
+    // Many: one pass in slot order from the first flagged node, where a
+    // node inherits its parent's flag, so the slots come out sorted
+    uint32_t first = static_cast<uint32_t>(order.size());
+    for (TransformHandle handle : dirtyHandles) {
+      if (nodes[handle].alive) { first = std::min(first, nodes[handle].slot); }
+    }
+    for (uint32_t slot = first; slot < order.size(); slot++) {
+      uint32_t parent = parentSlots[slot];
+      if (dirty[slot] || (parent != NO_SLOT && dirty[parent])) {
+        dirty[slot] = 1;
+        updateSlots.push_back(slot);
+      }
+    }
+  }
+  dirtyHandles.clear();
+
+  TransformArrays arrays{positionX.data(), positionY.data(),   positionZ.data(), rotationX.data(),
+                         rotationY.data(), rotationZ.data(),   rotationW.data(), scaleX.data(),
+                         scaleY.data(),    scaleZ.data(),      parentSlots.data(),
+                         worldMatrices.data()};
+#ifdef TRANSFORM_HIERARCHY_AVX
+  if (useAvx) {
+    ComposeAvx(arrays, updateSlots.data(), updateSlots.size());
+  } else {
+    ComposeScalar(arrays, updateSlots.data(), updateSlots.size());
+  }
+#else
+  ComposeScalar(arrays, updateSlots.data(), updateSlots.size());
+#endif
+
+  changed.reserve(updateSlots.size());
+  for (uint32_t slot : updateSlots) {
+    dirty[slot] = 0;
+    changed.push_back(order[slot]);
+  }
+}
+
+// New nodes go first among their siblings
+void TransformHierarchy::Link(TransformHandle handle, TransformHandle parent) {
+  TransformHandle &head = parent == INVALID_TRANSFORM ? firstRoot : nodes[parent].firstChild;
+  Node            &node = nodes[handle];
+  node.parent           = parent;
+  node.prevSibling      = INVALID_TRANSFORM;
+  node.nextSibling      = head;
+  if (head != INVALID_TRANSFORM) { nodes[head].prevSibling = handle; }
+  head = handle;
+}
+
+void TransformHierarchy::Unlink(TransformHandle handle) {
+  Node &node = nodes[handle];
+  if (node.prevSibling != INVALID_TRANSFORM) {
+    nodes[node.prevSibling].nextSibling = node.nextSibling;
+  } else if (node.parent != INVALID_TRANSFORM) {
+    nodes[node.parent].firstChild = node.nextSibling;
+  } else {
+    firstRoot = node.nextSibling;
+  }
+  if (node.nextSibling != INVALID_TRANSFORM) {
+    nodes[node.nextSibling].prevSibling = node.prevSibling;
+  }
+  node.parent      = INVALID_TRANSFORM;
+  node.prevSibling = INVALID_TRANSFORM;
+  node.nextSibling = INVALID_TRANSFORM;
+}
+
+void TransformHierarchy::MarkDirty(TransformHandle handle) {
+  uint32_t slot = nodes[handle].slot;
+  if (dirty[slot] == 0) {
+    dirty[slot] = 1;
+    dirtyHandles.push_back(handle);
+  }
+}
+
+uint32_t TransformHierarchy::Slot(TransformHandle handle) const {
+  if (!IsAlive(handle)) {
+    throw std::runtime_error("Transform is not alive!");
+  }
+  return nodes[handle].slot;
+}
+
+// Walks the tree breadth first from the roots, dropping destroyed slots
+// and placing each node's children next to each other
+void TransformHierarchy::RebuildOrder() {
+  std::vector<TransformHandle> newOrder;
+  std::vector<uint32_t>        newParents;
+  newOrder.reserve(liveCount);
+  newParents.reserve(liveCount);
+  for (TransformHandle root = firstRoot; root != INVALID_TRANSFORM; root = nodes[root].nextSibling) {
+    newOrder.push_back(root);
+    newParents.push_back(NO_SLOT);
+  }
+
+  std::vector<uint32_t> newFirstChildren(liveCount);
+  std::vector<uint32_t> newChildCounts(liveCount);
+  for (size_t i = 0; i < newOrder.size(); i++) {
+    newFirstChildren[i] = static_cast<uint32_t>(newOrder.size());
+    for (TransformHandle child = nodes[newOrder[i]].firstChild; child != INVALID_TRANSFORM;
+         child                 = nodes[child].nextSibling) {
+      newOrder.push_back(child);
+      newParents.push_back(static_cast<uint32_t>(i));
+      newChildCounts[i]++;
+    }
+  }
+
+  auto permute = [&newOrder, this](auto &values) {
+    std::remove_reference_t<decltype(values)> permuted(newOrder.size());
+    for (size_t i = 0; i < newOrder.size(); i++) {
+      permuted[i] = values[nodes[newOrder[i]].slot];
+    }
+    values.swap(permuted);
+  };
+  permute(positionX);
+  permute(positionY);
+  permute(positionZ);
+  permute(rotationX);
+  permute(rotationY);
+  permute(rotationZ);
+  permute(rotationW);
+  permute(scaleX);
+  permute(scaleY);
+  permute(scaleZ);
+  permute(worldMatrices);
+  permute(dirty);
+
+  for (size_t i = 0; i < newOrder.size(); i++) {
+    nodes[newOrder[i]].slot = static_cast<uint32_t>(i);
+  }
+  order.swap(newOrder);
+  parentSlots.swap(newParents);
+  firstChildSlots.swap(newFirstChildren);
+  childCounts.swap(newChildCounts);
+}
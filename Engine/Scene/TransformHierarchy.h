@@ -0,0 +1,99 @@
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+using TransformHandle = uint32_t;
+
+const TransformHandle INVALID_TRANSFORM = UINT32_MAX;
+
+// Parent/child transforms with local translation, rotation and scale.
+//
+// Local TRS components are stored SoA and, together with the world
+// matrices, kept in breadth-first order: parents come before their
+// children and each node's children are contiguous. Setting a local
+// transform only flags the node; Update() recomputes the world matrices of
+// flagged nodes and their descendants, composing them in batches (8 nodes
+// per AVX instruction where the CPU has it). When nothing moved, Update()
+// returns straight away, so static nodes cost nothing per frame.
+//
+// Creating, destroying and reparenting nodes reorders the arrays on the
+// next Update(). Handles stay valid until their node is destroyed and are
+// then reused.
+class TransformHierarchy {
+  public:
+    explicit TransformHierarchy(bool allowSimd = true);
+
+    TransformHandle Create(TransformHandle parent = INVALID_TRANSFORM);
+    // Destroys the node together with all of its descendants
+    void Destroy(TransformHandle handle);
+    // Throws when the new parent is the node itself or one of its descendants
+    void            SetParent(TransformHandle handle, TransformHandle parent);
+    TransformHandle GetParent(TransformHandle handle) const { return nodes[handle].parent; }
+    bool            IsAlive(TransformHandle handle) const;
+    size_t          Count() const { return liveCount; }
+
+    void SetLocal(TransformHandle handle, const glm::vec3 &position, const glm::quat &rotation,
+                  const glm::vec3 &scale);
+    void SetPosition(TransformHandle handle, const glm::vec3 &position);
+    void SetRotation(TransformHandle handle, const glm::quat &rotation);
+    void SetScale(TransformHandle handle, const glm::vec3 &scale);
+
+    glm::vec3 GetPosition(TransformHandle handle) const;
+    glm::quat GetRotation(TransformHandle handle) const;
+    glm::vec3 GetScale(TransformHandle handle) const;
+
+    // As of the last Update()
+    const glm::mat4 &GetWorldMatrix(TransformHandle handle) const {
+      return worldMatrices[nodes[handle].slot];
+    }
+
+    void Update();
+    // Nodes whose world matrix the last Update() recomputed
+    const std::vector<TransformHandle> &Changed() const { return changed; }
+
+  private:
+    // Per handle: the tree as linked lists, and where the node sits in the
+    // breadth-first arrays
+    struct Node {
+        uint32_t        slot        = 0;
+        TransformHandle parent      = INVALID_TRANSFORM;
+        TransformHandle firstChild  = INVALID_TRANSFORM;
+        TransformHandle nextSibling = INVALID_TRANSFORM;
+        TransformHandle prevSibling = INVALID_TRANSFORM;
+        bool            alive       = false;
+    };
+
+    bool                         useAvx;
+    std::vector<Node>            nodes;
+    std::vector<TransformHandle> freeHandles;
+    TransformHandle              firstRoot  = INVALID_TRANSFORM;
+    size_t                       liveCount  = 0;
+    bool                         orderDirty = false;
+
+    // Per slot, in breadth-first order once the order is up to date
+    std::vector<TransformHandle> order; // Handle of each slot
+    std::vector<uint32_t>        parentSlots;
+    std::vector<uint32_t>        firstChildSlots;
+    std::vector<uint32_t>        childCounts;
+    std::vector<float>           positionX, positionY, positionZ;
+    std::vector<float>           rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float>           scaleX, scaleY, scaleZ;
+    std::vector<glm::mat4>       worldMatrices;
+    std::vector<uint8_t>         dirty;
+
+    std::vector<TransformHandle> dirtyHandles;
+    std::vector<TransformHandle> changed;
+    std::vector<uint32_t>        updateSlots; // Scratch for Update
+
+    void     Link(TransformHandle handle, TransformHandle parent);
+    void     Unlink(TransformHandle handle);
+    void     MarkDirty(TransformHandle handle);
+    uint32_t Slot(TransformHandle handle) const;
+    void     RebuildOrder();
+};
+
+#endif // TRANSFORMHIERARCHY_H
@@ -0,0 +1,103 @@
+#include "Engine/Graphics/Drivers/Vulkan/Vulkan.h"
+#include "Engine/Graphics/MeshBuilder.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Abandons uploads in each way the API allows, then streams several ring's
+// worth of textures and meshes through the driver. Every one of them must
+// come from the staging ring: an abandoned reservation left at the front
+// would stop reclaim, and the rest would fall back to dedicated buffers.
+
+static const int SKIPPED = 77; // No Vulkan device, see SKIP_RETURN_CODE
+
+static const uint32_t TEXTURE_SIZE = 512; // 1 MB of RGBA8 staging each
+
+static uint32_t StagingAllocations(VulkanDriver &driver) {
+  return driver.GetRenderStats().Current().stagingAllocations;
+}
+
+static void AbandonUploads(VulkanDriver &driver) {
+  Vertex vertex{};
+
+  // Dropped half way
+  {
+    MeshBuilder builder(driver, 3, 3);
+    builder.AddVertex(vertex);
+  }
+
+  // Overrun, which throws and cancels
+  {
+    MeshBuilder builder(driver, 1, 3);
+    builder.AddVertex(vertex);
+    bool threw = false;
+    try {
+      builder.AddVertex(vertex);
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    if (!threw) { throw std::runtime_error("MeshBuilder took more vertices than reserved"); }
+  }
+
+  // Finished short, which throws and cancels
+  {
+    MeshBuilder builder(driver, 3, 3);
+    builder.AddVertex(vertex);
+    bool threw = false;
+    try {
+      builder.Finish();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    if (!threw) { throw std::runtime_error("MeshBuilder finished with vertices missing"); }
+  }
+
+  driver.CancelTextureUpload(driver.BeginTextureUpload(TEXTURE_SIZE, TEXTURE_SIZE));
+}
+
+int main() {
+  VulkanDriver driver;
+  try {
+    driver.SetupOffscreen(64, 64);
+  } catch (const std::exception &e) {
+    std::cout << "Skipped, no Vulkan device: " << e.what() << std::endl;
+    return SKIPPED;
+  }
+
+  int status = 0;
+  try {
+    // Counters start over each frame, this one takes setup's buffers away
+    driver.RenderFrame();
+    AbandonUploads(driver);
+
+    uint32_t textures = 3 * static_cast<uint32_t>(STAGING_RING_SIZE / (TEXTURE_SIZE * TEXTURE_SIZE * 4));
+    for (uint32_t i = 0; i < textures; i++) {
+      TextureUpload upload = driver.BeginTextureUpload(TEXTURE_SIZE, TEXTURE_SIZE);
+      std::fill(upload.pixels, upload.pixels + upload.Size(), static_cast<uint8_t>(i));
+      driver.ReleaseTexture(driver.CommitTextureUpload(upload));
+
+      MeshBuilder builder(driver, 3, 3);
+      for (int corner = 0; corner < 3; corner++) {
+        Vertex vertex{};
+        vertex.pos = glm::vec3(float(corner == 1), float(corner == 2), 0.0f);
+        builder.AddVertex(vertex);
+      }
+      builder.AddTriangle(0, 1, 2);
+      driver.ReleaseMesh(builder.Finish());
+
+      if (StagingAllocations(driver) != 0) {
+        throw std::runtime_error("upload " + std::to_string(i) + " got a dedicated staging buffer");
+      }
+      driver.RenderFrame();
+    }
+    std::cout << textures << " textures and meshes went through the staging ring" << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << "FAILED: " << e.what() << std::endl;
+    status = 1;
+  }
+
+  driver.Destruct();
+  return status;
+}
@@ -0,0 +1,93 @@
+#include "Engine/Graphics/Drivers/Capture/CaptureReplayer.h"
+#include "Engine/Graphics/Drivers/Dummy/Dummy.h"
+#include "Engine/Graphics/Drivers/Vulkan/Vulkan.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+static void PrintUsage() {
+  std::cout << "Usage: DarkestPlanetReplay <capture> [options]\n"
+               "  --driver <null|vulkan>  Driver to replay into (default null)\n"
+               "  --repeat <n>            Replay the capture n times (default 1)\n"
+               "  --size <w>x<h>          Offscreen size for the Vulkan driver (default 1024x768)\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    PrintUsage();
+    return 2;
+  }
+
+  std::string capturePath = argv[1];
+  std::string driverName  = "null";
+  uint32_t    repeat      = 1;
+  uint32_t    width       = 1024;
+  uint32_t    height      = 768;
+  for (int i = 2; i < argc; i++) {
+    std::string arg     = argv[i];
+    bool        hasNext = i + 1 < argc;
+    if (arg == "--driver" && hasNext) {
+      driverName = argv[++i];
+    } else if (arg == "--repeat" && hasNext) {
+      repeat = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--size" && hasNext) {
+      std::string size      = argv[++i];
+      size_t      separator = size.find('x');
+      if (separator == std::string::npos) {
+        PrintUsage();
+        return 2;
+      }
+      width  = static_cast<uint32_t>(std::stoul(size.substr(0, separator)));
+      height = static_cast<uint32_t>(std::stoul(size.substr(separator + 1)));
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  std::unique_ptr<IGraphicsDriver> driver;
+  if (driverName == "null") {
+    driver = std::make_unique<DummyDriver>();
+  } else if (driverName == "vulkan") {
+    driver = std::make_unique<VulkanDriver>();
+  } else {
+    PrintUsage();
+    return 2;
+  }
+
+  CaptureReplayer replayer;
+  try {
+    replayer.Load(capturePath);
+    driver->SetupOffscreen(width, height);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "Loaded " << capturePath << ": " << replayer.FrameCount() << " frames, "
+            << replayer.CommandCount() << " commands" << std::endl;
+
+  try {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < repeat; i++) {
+      replayer.Replay(*driver);
+    }
+    double totalMs =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    RenderStats &stats   = driver->GetRenderStats();
+    FrameStats   average = stats.Average();
+    std::cout << "Replayed " << stats.FrameCount() << " frames in " << totalMs << " ms: avg "
+              << average.frameTimeMs << " ms, p50 " << stats.FrameTimePercentile(50.0)
+              << " ms, p99 " << stats.FrameTimePercentile(99.0) << " ms, record "
+              << average.cpuRecordMs << " ms" << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    driver->Destruct();
+    return 1;
+  }
+
+  driver->Destruct();
+  return 0;
+}
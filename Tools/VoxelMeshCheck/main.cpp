@@ -0,0 +1,231 @@
+#include "Engine/Graphics/Drivers/Vulkan/Vulkan.h"
+#include "Engine/Graphics/Voxel/GpuVoxelBatch.h"
+#include "Engine/Graphics/Voxel/VoxelMesher.h"
+#include "Engine/Graphics/Voxel/VoxelTerrain.h"
+#include "Engine/Graphics/Voxel/VoxelWorld.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Checks the compute voxel mesher against the meshes the CPU path uploads,
+// on an offscreen Vulkan device. The CPU path is greedy while the shader
+// writes a 1x1 quad per face, so both sides are cut into unit faces, each
+// packed as its four vertices, and compared as sorted lists. Greedy quads
+// only merge faces whose occlusion is the same at all four corners, so
+// their unit faces pack exactly like the faces they cover.
+
+using PackedFace = std::array<uint32_t, 4>;
+
+static const int32_t WORLD_CHUNKS = 3; // Along each axis
+
+static const int SKIPPED = 77; // No Vulkan device, see SKIP_RETURN_CODE
+
+// The CPU path's quads cut into unit faces
+static std::vector<PackedFace> CpuFaces(const std::vector<VoxelQuad> &quads) {
+  // In-plane axes per face axis, VoxelQuad's width and height
+  static const int planeAxes[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+  std::vector<PackedFace>  faces;
+  std::vector<VoxelVertex> vertices;
+  for (const VoxelQuad &quad : quads) {
+    const int *axes = planeAxes[quad.face / 2];
+    for (uint32_t v = 0; v < quad.height; v++) {
+      for (uint32_t u = 0; u < quad.width; u++) {
+        VoxelQuad unit        = quad;
+        uint8_t  *position[3] = {&unit.x, &unit.y, &unit.z};
+        *position[axes[0]] += u;
+        *position[axes[1]] += v;
+        unit.width  = 1;
+        unit.height = 1;
+        vertices.clear();
+        AppendQuadPackedVertices(unit, unit.type, vertices);
+        faces.push_back({vertices[0].data, vertices[1].data, vertices[2].data, vertices[3].data});
+      }
+    }
+  }
+  std::sort(faces.begin(), faces.end());
+  return faces;
+}
+
+static std::vector<PackedFace> GpuFaces(const std::vector<VoxelVertex> &vertices) {
+  std::vector<PackedFace> faces;
+  for (size_t i = 0; i + 3 < vertices.size(); i += 4) {
+    faces.push_back({vertices[i].data, vertices[i + 1].data, vertices[i + 2].data,
+                     vertices[i + 3].data});
+  }
+  std::sort(faces.begin(), faces.end());
+  return faces;
+}
+
+// Terrain with scattered edits, so palettes hold more types and occlusion
+// varies from face to face
+static void BuildWorld(VoxelWorld &world) {
+  for (int32_t z = 0; z < WORLD_CHUNKS; z++) {
+    for (int32_t y = 0; y < WORLD_CHUNKS; y++) {
+      for (int32_t x = 0; x < WORLD_CHUNKS; x++) {
+        VoxelChunk chunk;
+        GenerateVoxelTerrain(chunk, x, y, z);
+        world.SetChunk({x, y, z}, std::move(chunk));
+      }
+    }
+  }
+  std::mt19937                            random(1234);
+  std::uniform_int_distribution<int32_t>  position(0, WORLD_CHUNKS * int32_t(VoxelChunk::SIZE) - 1);
+  std::uniform_int_distribution<uint32_t> type(0, 12);
+  for (uint32_t edit = 0; edit < 20000; edit++) {
+    int32_t x = position(random);
+    int32_t y = position(random);
+    int32_t z = position(random);
+    world.SetVoxel(x, y, z, static_cast<VoxelType>(type(random)));
+  }
+}
+
+struct CheckResult {
+    uint32_t chunks      = 0;
+    uint32_t overflowed  = 0;
+    size_t   gpuVertices = 0;
+    size_t   cpuVertices = 0;
+};
+
+// Meshes every chunk in one batch of maxQuads and compares each mesh as
+// the shader wrote it and again once the driver has moved it out of the
+// batch. Chunks the driver reports as overflowed must read back empty.
+static CheckResult CheckBatch(VulkanDriver &driver, const VoxelWorld &world, bool ambientOcclusion,
+                              uint32_t maxQuads) {
+  std::vector<VoxelSnapshot> snapshots(size_t(WORLD_CHUNKS * WORLD_CHUNKS * WORLD_CHUNKS));
+  GpuVoxelBatch              batch;
+  size_t                     next = 0;
+  for (int32_t z = 0; z < WORLD_CHUNKS; z++) {
+    for (int32_t y = 0; y < WORLD_CHUNKS; y++) {
+      for (int32_t x = 0; x < WORLD_CHUNKS; x++) {
+        world.Snapshot({x, y, z}, snapshots[next]);
+        batch.Add(snapshots[next].Neighborhood());
+        next++;
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<Mesh>> meshes;
+  driver.MeshVoxelChunksOnGpu(batch.Input(ambientOcclusion, maxQuads), meshes);
+  if (meshes.size() != snapshots.size()) {
+    throw std::runtime_error("MeshVoxelChunksOnGpu returned " + std::to_string(meshes.size()) +
+                             " meshes for " + std::to_string(snapshots.size()) + " chunks");
+  }
+
+  BinaryGreedyMesher                   mesher;
+  std::vector<std::vector<PackedFace>> expected(snapshots.size());
+  std::vector<VoxelQuad>               quads;
+  CheckResult                          result;
+  result.chunks = static_cast<uint32_t>(snapshots.size());
+  for (size_t chunk = 0; chunk < snapshots.size(); chunk++) {
+    quads.clear();
+    mesher.Mesh(snapshots[chunk].Neighborhood(), quads, ambientOcclusion);
+    expected[chunk] = CpuFaces(quads);
+    result.cpuVertices += quads.size() * 4;
+  }
+
+  // Reading back waits for the GPU, so the batch has run by the second
+  // round and collecting the overflows also moves the meshes out
+  static const char *const stages[2] = {"in its batch", "moved out of its batch"};
+  std::vector<std::shared_ptr<Mesh>> overflows;
+  std::vector<VoxelVertex>           vertices;
+  for (int round = 0; round < 2; round++) {
+    if (round == 1) { driver.CollectGpuVoxelMeshOverflows(overflows); }
+    for (size_t chunk = 0; chunk < meshes.size(); chunk++) {
+      driver.ReadGpuVoxelMesh(meshes[chunk], vertices);
+      bool overflowed =
+        std::find(overflows.begin(), overflows.end(), meshes[chunk]) != overflows.end();
+      std::vector<PackedFace> actual = GpuFaces(vertices);
+      // Which chunks overflowed is only known once collected, but they read
+      // back empty from the start
+      bool matches = round == 0 ? actual.empty() || actual == expected[chunk]
+                                : (overflowed ? actual.empty() : actual == expected[chunk]);
+      if (!matches) {
+        std::string problem = overflowed ? "overflowed but has " + std::to_string(actual.size()) + " faces"
+                            : actual.size() != expected[chunk].size()
+                              ? "has " + std::to_string(actual.size()) + " faces, the CPU mesh " +
+                                  std::to_string(expected[chunk].size())
+                              : "has different faces from the CPU mesh";
+        throw std::runtime_error("chunk " + std::to_string(chunk) + " " + stages[round] + " " + problem);
+      }
+      if (round == 1) { result.gpuVertices += vertices.size(); }
+    }
+  }
+  result.overflowed = static_cast<uint32_t>(overflows.size());
+
+  // Chunks only take space when they fit, so every chunk that overflowed
+  // needs more than was left once the batch had run
+  size_t usedQuads = result.gpuVertices / 4;
+  for (size_t chunk = 0; chunk < meshes.size(); chunk++) {
+    bool overflowed = std::find(overflows.begin(), overflows.end(), meshes[chunk]) != overflows.end();
+    if (overflowed && expected[chunk].size() <= maxQuads - usedQuads) {
+      throw std::runtime_error("chunk " + std::to_string(chunk) + " overflowed with " +
+                               std::to_string(maxQuads - usedQuads) + " quads left for its " +
+                               std::to_string(expected[chunk].size()));
+    }
+  }
+
+  for (const std::shared_ptr<Mesh> &mesh : meshes) {
+    driver.ReleaseMesh(mesh);
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    std::cout << "Usage: DarkestPlanetVoxelMeshCheck\n"
+                 "Checks GPU voxel meshing against the CPU mesher on an offscreen Vulkan\n"
+                 "device; run it from the build directory so the shaders are found.\n"
+                 "Exits with 77 when there is no Vulkan device.\n";
+    return 2;
+  }
+
+  VulkanDriver driver;
+  try {
+    driver.SetupOffscreen(64, 64);
+  } catch (const std::exception &e) {
+    std::cout << "Skipped, no Vulkan device: " << e.what() << std::endl;
+    return SKIPPED;
+  }
+
+  int status = 0;
+  try {
+    // A device without the shader is a failure, not a skip
+    if (!driver.SupportsGpuVoxelMeshing()) {
+      throw std::runtime_error("this device or build can't mesh voxels on the GPU");
+    }
+
+    VoxelWorld world;
+    BuildWorld(world);
+    for (bool ambientOcclusion : {false, true}) {
+      // Room for every face, then about a third of them so chunks overflow
+      const uint32_t roomy = WORLD_CHUNKS * WORLD_CHUNKS * WORLD_CHUNKS * 32 * 32 * 32 * 3;
+      CheckResult    full  = CheckBatch(driver, world, ambientOcclusion, roomy);
+      if (full.overflowed > 0) {
+        throw std::runtime_error(std::to_string(full.overflowed) +
+                                 " chunks overflowed a batch with room for all of them");
+      }
+      CheckResult tight =
+        CheckBatch(driver, world, ambientOcclusion, static_cast<uint32_t>(full.gpuVertices / 4 / 3));
+      if (tight.overflowed == 0) {
+        throw std::runtime_error("no chunk overflowed a batch a third of the size it needs");
+      }
+      std::cout << "ambient occlusion " << (ambientOcclusion ? "on" : "off") << ": " << full.chunks
+                << " chunks match, " << full.gpuVertices << " GPU vertices against "
+                << full.cpuVertices << " greedy; " << tight.overflowed
+                << " overflowed in the small batch" << std::endl;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "FAILED: " << e.what() << std::endl;
+    status = 1;
+  }
+
+  driver.Destruct();
+  if (status == 0) { std::cout << "GPU voxel meshing matches the CPU" << std::endl; }
+  return status;
+}
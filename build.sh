@@ -55,6 +55,9 @@ echo ""
 echo "Compiling shaders..."
 glslc "$PROJECT_ROOT/shaders/triangle.vert" -o "$SHADER_DIR/vert.spv"
 glslc "$PROJECT_ROOT/shaders/triangle.frag" -o "$SHADER_DIR/frag.spv"
+glslc "$PROJECT_ROOT/shaders/voxel.vert" -o "$SHADER_DIR/voxel_vert.spv"
+glslc "$PROJECT_ROOT/shaders/voxel.frag" -o "$SHADER_DIR/voxel_frag.spv"
+glslc "$PROJECT_ROOT/shaders/voxel_mesh.comp" -o "$SHADER_DIR/voxel_mesh_comp.spv"
 
 if [ $? -eq 0 ]; then
     echo "✓ Shaders compiled successfully"
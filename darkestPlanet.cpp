@@ -1,8 +1,16 @@
 #include "Engine/Graphics/Drivers/Vulkan/Vulkan.h"
+#include "Engine/Graphics/Drivers/Dummy/Dummy.h"
+#include "Engine/Graphics/Drivers/Capture/CaptureDriver.h"
+#include "Engine/Graphics/Drivers/Threaded/ThreadedDriver.h"
 #include "Engine/Graphics/Drivers/Vulkan/RenderObject.h"
 #include "Engine/Graphics/Drivers/Vulkan/Vertex.h"
 #include "Engine/Graphics/GraphicsManager.h"
+#include "Engine/Graphics/Procedural.h"
 #include "Engine/Graphics/Drivers/IGraphicsDriver.h"
+#include "Engine/ECS/RenderExtraction.h"
+#include "Engine/ECS/TransformSync.h"
+#include "Engine/ECS/World.h"
+#include "Engine/Scene/TransformHierarchy.h"
 #include "GLFW/glfw3.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <chrono>
@@ -10,119 +18,73 @@
 #include <vector>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <string>
 
 bool shouldQuit = false;
+// F1 toggles the wireframe pipeline variant
+PipelineFeatures debugFeatures = 0;
+
+const uint32_t HEADLESS_WIDTH = 1024;
+const uint32_t HEADLESS_HEIGHT = 768;
 
 void HandleKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
 		shouldQuit = true;
 	}
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+		debugFeatures ^= PIPELINE_FEATURE_WIREFRAME;
+	}
 }
 
-// Generate a cube mesh programmatically
-std::pair<std::vector<Vertex>, std::vector<uint32_t>> GenerateCubeMesh(float size = 0.5f) {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    
-    float s = size * 0.5f; // around origin we need to halve for the right size
-    
-    // Define the 8 vertices of a cube
-    std::vector<glm::vec3> positions = {
-        {-s, -s, -s}, { s, -s, -s}, { s,  s, -s}, {-s,  s, -s},  // Back face
-        {-s, -s,  s}, { s, -s,  s}, { s,  s,  s}, {-s,  s,  s}   // Front face
-    };
-    
-    // Define texture coordinates for each face
-    std::vector<glm::vec2> texCoords = {
-        {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}
-    };
-    
-    // Define the 6 faces of the cube
-    struct Face {
-        int v0, v1, v2, v3;
-    };
-    
-    std::vector<Face> faces = {
-        {0, 1, 2, 3},  // Back
-        {4, 7, 6, 5},  // Front
-        {0, 4, 5, 1},  // Bottom
-        {2, 6, 7, 3},  // Top
-        {0, 3, 7, 4},  // Left
-        {1, 5, 6, 2}   // Right
-    };
-    
-    uint32_t indexOffset = 0;
-    for (const auto& face : faces) {
-        // Add 4 vertices for this face
-        for (int i = 0; i < 4; i++) {
-            int vertexIdx = (i == 0) ? face.v0 : (i == 1) ? face.v1 : (i == 2) ? face.v2 : face.v3;
-            Vertex v;
-            v.pos = positions[vertexIdx];
-            v.color = {1.0f, 1.0f, 1.0f};  // White color
-            v.texCoord = texCoords[i];
-            vertices.push_back(v);
-        }
-        
-        // Add 2 triangles (6 indices) for this face
-        indices.push_back(indexOffset + 0);
-        indices.push_back(indexOffset + 1);
-        indices.push_back(indexOffset + 2);
-        indices.push_back(indexOffset + 2);
-        indices.push_back(indexOffset + 3);
-        indices.push_back(indexOffset + 0);
-        
-        indexOffset += 4;
-    }
-    
-    return {vertices, indices};
-}
+// Demo component: turns the entity's transform around an axis at a fixed rate
+struct Spin {
+	TransformHandle node;
+	glm::vec3 axis;
+	float degreesPerSecond;
+};
+
+// The demo's entities and the transforms driving their LocalToWorld
+struct DemoScene {
+	World world;
+	TransformHierarchy transforms;
+	TransformSync transformSync;
+};
+
+// Submits the demo scene for one frame at the given animation time
+void SubmitScene(IGraphicsDriver* driver, float time, float aspectRatio, DemoScene& scene) {
+	glm::vec3 cameraPos = glm::vec3(3.0f, 3.0f, 2.5f);
+	glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 cameraDirection = glm::normalize(cameraTarget - cameraPos);
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 cameraRight = glm::normalize(glm::cross(cameraDirection, up));	
+	glm::vec3 cameraUp = glm::normalize(glm::cross(cameraDirection, cameraRight));
+	
+	glm::mat4 view = glm::lookAt(cameraPos, cameraTarget, cameraUp);
+	driver->SetViewMatrix(view);
+	
+	// Set projection matrix
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 20.0f);
+	driver->SetProjectionMatrix(proj);
+	
+	TransformHierarchy& transforms = scene.transforms;
+	scene.world.Each<const Spin, RenderMesh>(
+		[time, &transforms](Entity, const Spin& spin, RenderMesh& renderMesh) {
+			transforms.SetRotation(spin.node, glm::angleAxis(time * glm::radians(spin.degreesPerSecond), spin.axis));
+			renderMesh.pipelineFeatures = debugFeatures;
+		});
+	transforms.Update();
+	scene.transformSync.Apply(transforms, scene.world);
 
-// Generate a grass-like pixelated texture programmatically
-std::vector<uint8_t> GenerateGrassTexture(uint32_t width, uint32_t height) {
-    std::vector<uint8_t> pixels(width * height * 4);  // RGBA
-
-    // Main grass color
-    const uint8_t base_r = 55;
-    const uint8_t base_g = 170;
-    const uint8_t base_b = 47;
-
-    // For a "pixelated" look, create chunky blocks of grass blades and dirt
-    uint32_t blockSize = std::max(2u, width / 16); // controls "pixels" size for pixelated effect
-
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            uint32_t index = (y * width + x) * 4;
-
-            // Calculate block coordinates
-            uint32_t bx = x / blockSize;
-            uint32_t by = y / blockSize;
-
-            // Add variation in green tones for the grass "pixels"
-            uint8_t r = base_r + static_cast<uint8_t>((bx * by + x + y) % 13);
-            uint8_t g = base_g + static_cast<uint8_t>((bx * 5 + by * 13 + x) % 30); // stronger green
-            uint8_t b = base_b + static_cast<uint8_t>((bx * 7 + by * 3 + y) % 14);
-
-            // Optionally: simulate some dirt at the bottom (brownish, last ~15% rows)
-            float fy = static_cast<float>(y) / height;
-            if (fy > 0.85f) {
-                // Brown dirt
-                r = 111 + static_cast<uint8_t>((bx * 19 + x) % 14);
-                g = 79 + static_cast<uint8_t>((by * 11 + y) % 8);
-                b = 44 + static_cast<uint8_t>((bx * 13 + y) % 8);
-            }
-
-            pixels[index + 0] = r;
-            pixels[index + 1] = g;
-            pixels[index + 2] = b;
-            pixels[index + 3] = 255; // Alpha
-        }
-    }
-
-    return pixels;
+	// Reused from frame to frame
+	static std::vector<RenderPacket> packets;
+	ExtractRenderPackets(scene.world, packets);
+	driver->SubmitRenderPackets(packets.data(), packets.size());
 }
 
-void GameLoop(GraphicsManager* gManager, IGraphicsDriver* driver, 
-              std::shared_ptr<Mesh> cubeMesh, std::shared_ptr<Texture> rainbowTexture) {
+void GameLoop(GraphicsManager* gManager, IGraphicsDriver* driver, DemoScene& scene) {
 	// Check Input
 	// Update entities
 	// Render Screen
@@ -131,6 +93,8 @@ void GameLoop(GraphicsManager* gManager, IGraphicsDriver* driver,
 	static auto startTime = std::chrono::high_resolution_clock::now();
 	
 	while (!shouldQuit) {
+		gManager->beginFrame();
+
 		// Clear render queue each frame
 		driver->ClearRenderQueue();
 		
@@ -138,43 +102,145 @@ void GameLoop(GraphicsManager* gManager, IGraphicsDriver* driver,
 		auto currentTime = std::chrono::high_resolution_clock::now();
 		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 		
-
-		glm::vec3 cameraPos = glm::vec3(3.0f, 3.0f, 2.5f);
-		glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
-		glm::vec3 cameraDirection = glm::normalize(cameraTarget - cameraPos);
-		glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-		glm::vec3 cameraRight = glm::normalize(glm::cross(cameraDirection, up));	
-		glm::vec3 cameraUp = glm::normalize(glm::cross(cameraDirection, cameraRight));
-		
-		glm::mat4 view = glm::lookAt(cameraPos, cameraTarget, cameraUp);
-		driver->SetViewMatrix(view);
-		
-		// Set projection matrix
 		int width, height;
 		glfwGetFramebufferSize(gManager->getWindow(), &width, &height);
-		glm::mat4 proj = glm::perspective(glm::radians(45.0f), width / (float)height, 0.1f, 20.0f);
-		driver->SetProjectionMatrix(proj);
-		
-		// 1. Cube on the left, rotating on Y axis
-		glm::mat4 modelMatrix2 = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
-		modelMatrix2 = glm::rotate(modelMatrix2, time * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		RenderObject obj2(cubeMesh, rainbowTexture, modelMatrix2);
-		driver->SubmitRenderObject(obj2);
-		
+		SubmitScene(driver, time, width / (float)height, scene);
 		
 		gManager->update();
 	}
 }
 
-int main() {
+// Writes an RGBA8 readback as a binary PPM (alpha is dropped)
+void WritePpm(const std::string& path, const FrameReadback& readback) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Failed to write capture to " << path << std::endl;
+		return;
+	}
+
+	file << "P6\n" << readback.width << " " << readback.height << "\n255\n";
+	size_t pixelCount = static_cast<size_t>(readback.width) * readback.height;
+	for (size_t i = 0; i < pixelCount; i++) {
+		file.write(reinterpret_cast<const char*>(readback.pixels + i * 4), 3);
+	}
+	std::cout << "Captured frame " << readback.frameIndex << " to " << path << std::endl;
+}
+
+// Renders a fixed number of frames offscreen with a fixed time step so the
+// output is deterministic and can be compared against golden images
+void HeadlessLoop(IGraphicsDriver* driver, uint32_t frameCount, const std::string& capturePath,
+                  DemoScene& scene) {
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		driver->WaitForNextFrame();
+		driver->ClearRenderQueue();
+		SubmitScene(driver, frame / 60.0f, HEADLESS_WIDTH / (float)HEADLESS_HEIGHT, scene);
+
+		if (frame + 1 == frameCount && !capturePath.empty()) {
+			driver->RequestFrameReadback([capturePath](const FrameReadback& readback) {
+				WritePpm(capturePath, readback);
+			});
+		}
+		driver->RenderFrame();
+	}
+
+	RenderStats& stats = driver->GetRenderStats();
+	FrameStats average = stats.Average();
+	std::cout << "Rendered " << frameCount << " frames offscreen: avg "
+	          << average.frameTimeMs << " ms, p50 " << stats.FrameTimePercentile(50.0)
+	          << " ms, p99 " << stats.FrameTimePercentile(99.0) << " ms, variance "
+	          << stats.FrameTimeVariance() << ", input latency p50 "
+	          << stats.InputLatencyPercentile(50.0) << " ms, p99 "
+	          << stats.InputLatencyPercentile(99.0) << " ms" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	// --headless <frames> renders offscreen without a window,
+	// --capture <file.ppm> saves the last headless frame,
+	// --null-driver runs headless on the CPU-only null driver,
+	// --render-thread records and submits frames on a separate thread,
+	// --pacing <throughput|low-latency|power-saver>, --frames-in-flight <n>
+	// and --max-fps <fps> pick the frame pacing
+	uint32_t headlessFrames = 0;
+	std::string capturePath;
+	bool useNullDriver = false;
+	bool useRenderThread = false;
+	FramePacing pacing;
+	uint32_t framesInFlight = 0;
+	double maxFps = -1.0;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--headless" && i + 1 < argc) {
+			headlessFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--capture" && i + 1 < argc) {
+			capturePath = argv[++i];
+		} else if (arg == "--null-driver") {
+			useNullDriver = true;
+		} else if (arg == "--render-thread") {
+			useRenderThread = true;
+		} else if (arg == "--pacing" && i + 1 < argc) {
+			std::string mode = argv[++i];
+			if (mode == "low-latency") {
+				pacing = DefaultFramePacing(FramePacingMode::LowLatency);
+			} else if (mode == "power-saver") {
+				pacing = DefaultFramePacing(FramePacingMode::PowerSaver);
+			} else {
+				pacing = DefaultFramePacing(FramePacingMode::Throughput);
+			}
+		} else if (arg == "--frames-in-flight" && i + 1 < argc) {
+			framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		} else if (arg == "--max-fps" && i + 1 < argc) {
+			maxFps = std::stod(argv[++i]);
+		}
+	}
+	if (framesInFlight > 0) {
+		pacing.framesInFlight = framesInFlight;
+	}
+	if (maxFps >= 0.0) {
+		pacing.maxFps = maxFps;
+	}
+
 	VulkanDriver vulkanDriver{};
+	DummyDriver nullDriver{};
+	vulkanDriver.SetFramePacing(pacing);
+	nullDriver.SetFramePacing(pacing);
+	IGraphicsDriver* driver = &vulkanDriver;
+	if (useNullDriver) {
+		driver = &nullDriver;
+		if (headlessFrames == 0) {
+			headlessFrames = 1000;
+		}
+	}
 
-	// Setup window
-	GraphicsManager gManager = GraphicsManager(1024, 768, "Darkest Planet", &vulkanDriver);	
-	if (!gManager.isInitialized()) {
-		return -1;
+	// Optional capture of the render command stream for DarkestPlanetReplay
+	std::unique_ptr<CaptureDriver> captureDriver;
+	if (const char* capturePathEnv = std::getenv("DARKEST_CAPTURE")) {
+		captureDriver = std::make_unique<CaptureDriver>(driver, capturePathEnv);
+		driver = captureDriver.get();
+	}
+
+	// Outermost, so capture and the driver itself run on the render thread
+	std::unique_ptr<ThreadedDriver> threadedDriver;
+	if (useRenderThread) {
+		threadedDriver = std::make_unique<ThreadedDriver>(driver);
+		driver = threadedDriver.get();
+	}
+
+	std::optional<GraphicsManager> gManager;
+	if (headlessFrames > 0) {
+		try {
+			driver->SetupOffscreen(HEADLESS_WIDTH, HEADLESS_HEIGHT);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return -1;
+		}
+	} else {
+		// Setup window
+		gManager.emplace(1024, 768, "Darkest Planet", driver);
+		if (!gManager->isInitialized()) {
+			return -1;
+		}
+		glfwSetKeyCallback(gManager->getWindow(), HandleKey);
 	}
-	glfwSetKeyCallback(gManager.getWindow(), HandleKey);
 	
 	// Load resources using the new API
 	// std::shared_ptr<Mesh> loadedMesh;
@@ -192,19 +258,47 @@ int main() {
 	// Create programmatic resources
 	std::cout << "\nCreating programmatic cube mesh..." << std::endl;
 	auto [cubeVertices, cubeIndices] = GenerateCubeMesh(0.3f);
-	std::shared_ptr<Mesh> cubeMesh = vulkanDriver.CreateMesh(cubeVertices, cubeIndices);
+	std::shared_ptr<Mesh> cubeMesh = driver->CreateMesh(
+		std::move(cubeVertices), std::move(cubeIndices), MESH_CREATE_RELEASE_CPU_DATA);
 	
 	std::cout << "Creating programmatic grass texture..." << std::endl;
 	const uint32_t textureSize = 256;
-	auto grassPixels = GenerateGrassTexture(textureSize, textureSize);
-	std::shared_ptr<Texture> grassTexture = vulkanDriver.CreateTexture(
-		textureSize, textureSize, grassPixels.data());
+	TextureUpload grassUpload = driver->BeginTextureUpload(textureSize, textureSize);
+	GenerateGrassTexture(textureSize, textureSize, grassUpload.pixels);
+	std::shared_ptr<Texture> grassTexture = driver->CommitTextureUpload(grassUpload);
 	
+	// The scene: the cube spinning on the Y axis
+	DemoScene scene;
+	Entity cube = scene.world.Create();
+	TransformHandle cubeNode = scene.transforms.Create();
+	scene.transformSync.Bind(cubeNode, cube);
+	scene.world.Add(cube, LocalToWorld{});
+	scene.world.Add(cube, RenderMesh{cubeMesh.get(), grassTexture.get()});
+	scene.world.Add(cube, Spin{cubeNode, glm::vec3(0.0f, 1.0f, 0.0f), 90.0f});
+
+	// The debug toggle shouldn't hitch on first use
+	driver->PrecompilePipelines({PIPELINE_FEATURE_WIREFRAME});
+
+	// Optional per-frame stats dump for soak tests (.json or .csv)
+	if (const char* statsPath = std::getenv("DARKEST_STATS")) {
+		std::string path = statsPath;
+		StatsDumpFormat format = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0
+			? StatsDumpFormat::Json
+			: StatsDumpFormat::Csv;
+		driver->GetRenderStats().EnableDump(path, format, 120);
+	}
+
+	if (headlessFrames > 0) {
+		HeadlessLoop(driver, headlessFrames, capturePath, scene);
+		driver->Destruct();
+		return 0;
+	}
+
 	std::cout << "Rendering the game..." << std::endl;
 	std::cout << "\nPress ESC to exit\n" << std::endl;
 	
-	GameLoop(&gManager, &vulkanDriver, cubeMesh, grassTexture);
+	GameLoop(&*gManager, driver, scene);
 
-	gManager.destroyWindow();
+	gManager->destroyWindow();
 	return 0;
 }
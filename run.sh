@@ -17,12 +17,18 @@ if [ ! -f "$EXECUTABLE" ]; then
 fi
 
 # Check if shaders exist
-if [ ! -f "$BUILD_DIR/shaders/vert.spv" ] || [ ! -f "$BUILD_DIR/shaders/frag.spv" ]; then
+if [ ! -f "$BUILD_DIR/shaders/vert.spv" ] || [ ! -f "$BUILD_DIR/shaders/frag.spv" ] ||
+   [ ! -f "$BUILD_DIR/shaders/voxel_vert.spv" ] || [ ! -f "$BUILD_DIR/shaders/voxel_frag.spv" ]; then
     echo "ERROR: Shaders not found in build directory."
     echo "Please run ./build.sh first to compile shaders."
     exit 1
 fi
 
+# Only GPU voxel meshing needs the compute shader, voxels mesh on the CPU without it
+if [ ! -f "$BUILD_DIR/shaders/voxel_mesh_comp.spv" ]; then
+    echo "WARNING: voxel_mesh_comp.spv not found, GPU voxel meshing is disabled."
+fi
+
 # Check if assets exist
 if [ ! -d "$BUILD_DIR/models" ] || [ ! -d "$BUILD_DIR/textures" ]; then
     echo "WARNING: Models or textures directory not found in build directory."
@@ -1,12 +1,25 @@
 #version 450
 
+// Feature toggles baked in per pipeline variant (see PipelineFeatures.h),
+// constant_id is the PIPELINE_FEATURE_* bit index
+layout(constant_id = 0) const bool ALPHA_TEST = false;
+
 layout(binding = 1) uniform sampler2D texSampler;
 
+// Per-object data from the frame allocator, bound with a dynamic offset
+layout(set = 1, binding = 0) uniform ObjectUniforms {
+	vec4 materialColor;
+	vec4 uvTransform; // Atlas region: uv * xy + zw
+} object;
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 inTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, inTexCoord); 
+    outColor = texture(texSampler, inTexCoord * object.uvTransform.xy + object.uvTransform.zw) * object.materialColor;
+    if (ALPHA_TEST && outColor.a < 0.5) {
+        discard;
+    }
 }
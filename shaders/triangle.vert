@@ -9,6 +9,15 @@ layout(push_constant) uniform PushConstants {
 	mat4 model;
 } push;
 
+// PIPELINE_FEATURE_INSTANCED, bit 4
+layout(constant_id = 4) const bool INSTANCED = false;
+
+// Frame data (set 2): with INSTANCED, a model matrix per instance applied
+// before the object's own
+layout(std430, set = 2, binding = 0) readonly buffer FrameData {
+	mat4 instanceModels[];
+} frameData;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
@@ -17,7 +26,11 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * push.model * vec4(inPosition, 1.0); 
+	mat4 model = push.model;
+	if (INSTANCED) {
+		model = model * frameData.instanceModels[gl_InstanceIndex];
+	}
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0); 
     fragColor = inColor; 
 	fragTexCoord = inTexCoord;
 }
@@ -0,0 +1,37 @@
+#version 450
+
+// Same specialization constants as triangle.frag, see PipelineFeatures.h
+layout(constant_id = 0) const bool ALPHA_TEST = false;
+
+// Texture layers side by side in one row of square tiles, layer i at
+// x = i * height; a 1 pixel high strip gives one flat color per layer
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(set = 1, binding = 0) uniform ObjectUniforms {
+	vec4 materialColor;
+	vec4 uvTransform; // Unused, the layer picks the tile
+} object;
+
+layout(location = 0) in vec2 inTexCoord;
+layout(location = 1) in float inLight;
+layout(location = 2) flat in uint inLayer;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	vec2 size = vec2(textureSize(texSampler, 0));
+	float tiles = size.x / size.y;
+	// Stay half a texel inside the tile so filtering never reads the next one
+	float inset = 0.5 / size.y;
+	vec2 tileCoord = clamp(fract(inTexCoord), inset, 1.0 - inset);
+	vec2 uv = vec2((float(inLayer) + tileCoord.x) / tiles, tileCoord.y);
+	// Gradients of the unwrapped coordinates, fract() would jump at every
+	// voxel edge and pick the smallest mip there
+	vec2 scale = vec2(1.0 / tiles, 1.0);
+	vec4 color = textureGrad(texSampler, uv, dFdx(inTexCoord) * scale, dFdy(inTexCoord) * scale);
+
+	outColor = vec4(color.rgb * inLight, color.a) * object.materialColor;
+	if (ALPHA_TEST && outColor.a < 0.5) {
+		discard;
+	}
+}
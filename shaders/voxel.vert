@@ -0,0 +1,41 @@
+#version 450
+
+// Voxel chunk geometry, one packed word per vertex (see VoxelVertex):
+// chunk-local position, face direction, ambient occlusion and texture
+// layer. The model matrix moves the chunk to its origin.
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+layout(push_constant) uniform PushConstants {
+	mat4 model;
+} push;
+
+layout(location = 0) in uint inPacked;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out float fragLight;
+layout(location = 2) flat out uint fragLayer;
+
+// Per VOXEL_FACE_*: top faces brightest, bottoms darkest
+const float faceShades[6] = float[](0.8, 0.8, 1.0, 0.5, 0.65, 0.65);
+// Ambient occlusion 0 (corner between two solid voxels) to 3 (open)
+const float occlusionLight[4] = float[](0.45, 0.65, 0.85, 1.0);
+
+void main() {
+	vec3 position = vec3(float(inPacked & 63u), float((inPacked >> 6) & 63u),
+	                     float((inPacked >> 12) & 63u));
+	uint face = (inPacked >> 18) & 7u;
+	uint occlusion = (inPacked >> 21) & 3u;
+
+	gl_Position = ubo.proj * ubo.view * push.model * vec4(position, 1.0);
+
+	// One texture repeat per voxel across merged quads: the in-plane axes
+	// are y/z for X faces, x/z for Y faces and x/y for Z faces
+	uint axis = face / 2u;
+	fragTexCoord = axis == 0u ? position.yz : (axis == 1u ? position.xz : position.xy);
+	fragLight = faceShades[face] * occlusionLight[occlusion];
+	fragLayer = inPacked >> 23;
+}